@@ -5,6 +5,8 @@
 #include <fstream>
 #include <vector>
 #include <time.h>
+#include <mutex>
+#include <climits>
 
 // Parameters used to define 'unstable' regions, based on segm noise/bg dynamics and local distance threshold values
 #define UNSTABLE_REG_RATIO_MIN  (0.10f)
@@ -14,6 +16,83 @@
 #define DEFAULT_FRAME_SIZE cv::Size(320,240)
 // Pre-processing Gaussian size
 #define PRE_DEFAULT_GAUSSIAN_SIZE cv::Size(9,9)
+// Guided filter radius (full-resolution pixels per process scale step) and regularisation
+#define UPSAMPLE_RADIUS_PER_SCALE 2
+#define UPSAMPLE_EPSILON (0.0004f)
+// Size of the header in front of the background words (one page)
+#define MODEL_STORAGE_HEADER_SIZE 4096
+// Adaptive model: size class step, initial capacity (words), consecutive own-model misses
+// before a pixel grows and consecutive frames below the persistence floor before it shrinks
+#define ADAPTIVE_WORD_STEP 5
+#define ADAPTIVE_INITIAL_WORDS 10
+#define ADAPTIVE_GROW_MISS_NO 8
+#define ADAPTIVE_SHRINK_FRAME_NO 100
+// 16-bit word stamps: a pixel's epoch moves forward by WORD_STAMP_REBASE_SHIFT frames once the
+// current frame is WORD_STAMP_REBASE frames past it, less up to WORD_STAMP_STAGGER frames so the
+// pixels do not all rebase on the same frame
+#define WORD_STAMP_REBASE 0xE000
+#define WORD_STAMP_REBASE_SHIFT 0x8000
+#define WORD_STAMP_STAGGER 0x1000
+// Word count with its own specialised per-pixel loop (the default model size)
+#define PROCESS_SPECIALISED_WORDS_NO 35
+// Charge the time since the last lap to a Process stage (only when a profiler is attached)
+#define PROFILE_LAP(stage) if (profiler) { profiler->Lap(stage); }
+// Charge the time since the last per-pixel lap to a per-pixel stage
+#define PROFILE_PIXEL_LAP(stage) if (profiler) { const long long lapNow = Profiler::Now(); profiler->Record(stage, lapNow - pixelLapStart); pixelLapStart = lapNow; }
+
+/*=====LOOK-UP TABLE=====*/
+// neighborhood's offset value
+const cv::Point BackgroundSubtractorLCDP::nbOffset[48] = {
+	/*cv::Point(0, -1),	cv::Point(1, 0),	cv::Point(0, 1),	cv::Point(-1, 0),
+	cv::Point(-1, -1),  cv::Point(1, -1),	cv::Point(1, 1),	cv::Point(-1, 1),
+
+	cv::Point(0, -2),   cv::Point(2, 0),    cv::Point(0, 2),    cv::Point(-2, 0),
+	cv::Point(-2, -2),  cv::Point(2, -2),	cv::Point(2, 2),    cv::Point(-2, 2),
+
+	cv::Point(-1, -3),	cv::Point(1, -3),	cv::Point(1, 3),	cv::Point(-1, 3),
+	cv::Point(-3, -1),  cv::Point(3, -1),	cv::Point(3, 1),	cv::Point(-3, 1),
+	cv::Point(-3, -3),  cv::Point(3, -3),   cv::Point(3, 3),	cv::Point(-3, 3),
+
+
+	cv::Point(-2, 1),	cv::Point(2, 1),  	cv::Point(-1, 2),   cv::Point(1, 2),
+	cv::Point(0, -3),	cv::Point(3, 0),	cv::Point(0, 3),	cv::Point(-3, 0),				  
+	cv::Point(-2, -3),  cv::Point(2, -3),	cv::Point(2, 3),	cv::Point(-2, 3),
+	cv::Point(-3, -2),  cv::Point(3, -2),	cv::Point(3, 2),	cv::Point(-3, 2),		
+	cv::Point(-1, -2),  cv::Point(1, -2),	cv::Point(-2, -1),  cv::Point(2, -1)*/
+	cv::Point(0, -1),	cv::Point(1, 0),	cv::Point(0, 1),	cv::Point(-1, 0),
+	cv::Point(-1, -1),  cv::Point(1, -1),	cv::Point(1, 1),	cv::Point(-1, 1),
+	cv::Point(-2, -2), cv::Point(0, -2), cv::Point(2, -2),
+	cv::Point(-2, 0),  cv::Point(2, 0),
+	cv::Point(-2, 2),  cv::Point(0, 2),  cv::Point(2, 2),
+	cv::Point(-1, -2),  cv::Point(1, -2),
+	cv::Point(-2, -1),  cv::Point(2, -1),
+	cv::Point(-2, 1),  cv::Point(2, 1),
+	cv::Point(-1, 2),  cv::Point(1, 2),
+	cv::Point(-3, -3),  cv::Point(0, -3),cv::Point(3, -3),
+	cv::Point(-3, 0),  cv::Point(3, 0),
+	cv::Point(-3, 3),  cv::Point(0, 3),cv::Point(3, 3),
+	cv::Point(-2, -3),  cv::Point(-1, -3),cv::Point(1, -3),cv::Point(2, -3),
+	cv::Point(-3, -2),  cv::Point(3, -2),
+	cv::Point(-3, -1),  cv::Point(3, -1),
+	cv::Point(-3, 2),  cv::Point(3, 2),
+	cv::Point(-3, 1),  cv::Point(3, 1),
+	cv::Point(-2, 3),  cv::Point(-1, 3),cv::Point(1, 3),cv::Point(2, 3)
+};
+// LCD differences
+float BackgroundSubtractorLCDP::LCDDiffLUTPtr[3][(6 * LCDP_MAX_DESC_NB) + 1][(3 * LCDP_MAX_DESC_NB) + 1];
+// Guards the one-time generation of the shared LCD differences LUT
+static std::once_flag LCDDiffLUTFlag;
+// Set one bit of a packed LCDP plane
+static inline void SetPackedBit(unsigned int *plane, int bit) {
+	plane[bit >> 5] |= (1u << (bit & 31));
+}
+static inline void SetPackedBit(unsigned short *plane, int bit) {
+	plane[bit >> 4] |= (unsigned short)(1u << (bit & 15));
+}
+// Number of set bits
+static inline size_t BitCount(unsigned int value) {
+	return std::bitset<32>(value).count();
+}
 
 /*******CONSTRUCTOR*******/ // Checked
 BackgroundSubtractorLCDP::BackgroundSubtractorLCDP(size_t inputWordsNo, bool inputPreSwitch,
@@ -23,7 +102,7 @@ BackgroundSubtractorLCDP::BackgroundSubtractorLCDP(size_t inputWordsNo, bool inp
 	bool inputUpFeedbackSwitch, float inputUpDynamicRateIncrease, float inputUpDynamicRateDecrease, float inputUpMinDynamicRate, float inputUpUpdateRateIncrease,
 	float inputUpUpdateRateDecrease, float inputUpUpdateRateLowest, float inputUpUpdateRateHighest,
 	float inputDarkMinIntensityRatio, float inputDarkMaxIntensityRatio, float inputDarkRDiffRatioMin, float inputDarkRDiffRatioMax,
-	float inputDarkGDiffRatioMin, float inputDarkGDiffRatioMax,	bool inputPostSwitch) :
+	float inputDarkGDiffRatioMin, float inputDarkGDiffRatioMax,	bool inputPostSwitch, int inputProcessScale) :
 	/*=====LOOK-UP TABLE=====*/
 	// Internal pixel info LUT for all possible pixel indexes
 	pxInfoLUTPtr(nullptr),
@@ -37,10 +116,26 @@ BackgroundSubtractorLCDP::BackgroundSubtractorLCDP(size_t inputWordsNo, bool inp
 	// Store the current frame's words and it's iterator
 	currWordPtr(nullptr),
 	currWordPtrIter(nullptr),
+	// Sized by Initialize
+	wordSize(0),
 	// Total number of words to represent a pixel
 	WORDS_NO(inputWordsNo),
 	// Frame index
 	frameIndex(1),
+	// Where the background words are placed
+	modelStorageBackend(ModelStorage::STORAGE_HEAP),
+	// Page size of the per-pixel arrays
+	pageSize(ModelStorage::PAGES_DEFAULT),
+
+	/*====ADAPTIVE MODEL=====*/
+	// WORDS_NO words per pixel until SetAdaptiveModel
+	adaptiveModelSwitch(false),
+	modelBudgetBytes(0),
+	wordMinCapacity(inputWordsNo),
+	wordInitialCapacity(inputWordsNo),
+	wordGrowNo(0),
+	wordShrinkNo(0),
+	wordGrowFailedNo(0),
 
 	/*=====PRE-PROCESS Parameters=====*/
 	// Pre processing switch
@@ -50,9 +145,9 @@ BackgroundSubtractorLCDP::BackgroundSubtractorLCDP(size_t inputWordsNo, bool inp
 
 	/*=====DESCRIPTOR Parameters=====*/
 	// Size of neighborhood 3(3x3)/5(5x5)
-	descNbSize(5),
-	// Total number of neighborhood pixel 8(3x3)/16(5x5)
-	descNbNo(16),
+	descNbSize((LCDP_MAX_DESC_NB >= 16) ? 5 : 3),
+	// Total number of neighborhood pixel 8(3x3)/16(5x5)/24(5x5)
+	descNbNo(std::min(16, LCDP_MAX_DESC_NB)),
 	// LCD color differences ratio
 	descColourDiffRatio(inputDescColourDiffRatio),
 	// Total number of differences per descriptor
@@ -82,17 +177,23 @@ BackgroundSubtractorLCDP::BackgroundSubtractorLCDP(size_t inputWordsNo, bool inp
 
 	/*=====FRAME Parameters=====*/
 	// ROI frame
-	frameRoi(inputROI),
+	frameRoi(ScaledROI(inputROI, ScaledFrameSize(inputFrameSize, inputProcessScale))),
 	// Size of input frame
-	frameSize(inputFrameSize),
+	frameSize(ScaledFrameSize(inputFrameSize, inputProcessScale)),
 	// Total number of input frame
 	frameNo(inputFrameNo),
 	// Size of input frame starting from 0
-	frameSizeZero(cv::Size(inputFrameSize.width - 1, inputFrameSize.height - 1)),
+	frameSizeZero(cv::Size(frameSize.width - 1, frameSize.height - 1)),
 	// Total number of pixel of region of interest
-	frameRoiTotalPixel(cv::countNonZero(inputROI)),
+	frameRoiTotalPixel(size_t(cv::countNonZero(frameRoi))),
 	// Total number of pixel of input frame
-	frameInitTotalPixel(inputFrameSize.area()),
+	frameInitTotalPixel(frameSize.area()),
+	// Reduced-resolution mode
+	processScale(std::max(1, inputProcessScale)),
+	// Size of the input (and output) frame
+	fullFrameSize(inputFrameSize),
+	// BGR until Initialize sees the first frame
+	frameChannels(3),
 
 	/*=====UPDATE Parameters=====*/
 	// Random replace model switch
@@ -132,55 +233,94 @@ BackgroundSubtractorLCDP::BackgroundSubtractorLCDP(size_t inputWordsNo, bool inp
 	// Post processing switch
 	postSwitch(inputPostSwitch),
 	// The compensation motion history threshold
-	postCompensationThreshold(0.7f)
+	postCompensationThreshold(0.7f),
+
+	/*====DEGRADATION=====*/
+	// Current work limits
+	qualityLimits(FullQuality()),
+
+	/*====CHANGE GATE=====*/
+	// Off until SetChangeGate
+	gateBlockSize(0),
+	gateNoiseThreshold(0.0f),
+	gateFullPassInterval(0),
+	gateSkippedFraction(0.0),
+
+	/*====PROFILING=====*/
+	// Stage profiler
+	profiler(nullptr),
+
+	/*====RANDOM=====*/
+	// Seeded from the clock
+	randomSeed(0),
+	randomGenerator(std::random_device()()),
+
+	/*====OPTIMISATIONS=====*/
+	// Everything on
+	matchHintSwitch(true),
+	specialisedKernelSwitch(true),
+	compactWordSwitch(true)
 {
-	CV_Assert(WORDS_NO > 0);
+	// Word capacities and match hints are 16-bit
+	CV_Assert((WORDS_NO > 0) && (WORDS_NO <= USHRT_MAX));
+	// The switches are fixed from here on: pick the per-pixel loop once
+	processPixelsFn = SelectProcessPixels();
 }
 
 /*******DESTRUCTOR*******/ // Checked
 BackgroundSubtractorLCDP::~BackgroundSubtractorLCDP() {
-	delete[] pxInfoLUTPtr;
-
 	/*for (int i = 0; i < 3; ++i) {
 		delete[] LCDDiffLUTPtr[i];
 	}
 	delete[] LCDDiffLUTPtr;*/
-	delete[] bgWordPtr;
-	delete[] currWordPtr;
+	// The LUT, the words and the float state are released with their storage
 }
 
 /*******INITIALIZATION*******/ // Checked
-void BackgroundSubtractorLCDP::Initialize(cv::Mat inputFrame, cv::Mat inputROI)
+void BackgroundSubtractorLCDP::Initialize(const cv::Mat &inputImg, cv::Mat inputROI)
 {
+	Initialize(FrameView(inputImg), inputROI);
+}
+void BackgroundSubtractorLCDP::Initialize(const FrameView &frameView, cv::Mat inputROI)
+{
+	CV_Assert((frameView.data != nullptr) && (frameView.GetSize() == fullFrameSize));
+	// Read only: the downsampled and blurred frames go to the input buffers
+	cv::Mat inputFrame = InputHeader(frameView);
+	if (processScale > 1) {
+		cv::resize(inputFrame, bufScaledImg, frameSize, 0, 0, cv::INTER_AREA);
+		inputFrame = bufScaledImg;
+	}
+	// Gray frames run the single-channel variants
+	CV_Assert((inputFrame.type() == CV_8UC3) || (inputFrame.type() == CV_8UC1));
+	frameChannels = inputFrame.channels();
+	processPixelsFn = SelectProcessPixels();
 	/*=====LOOK-UP TABLE=====*/
-	// Internal pixel info LUT for all possible pixel indexes
-	pxInfoLUTPtr = new PxInfo[frameInitTotalPixel];
-	memset(pxInfoLUTPtr, 0, sizeof(PxInfo)*frameInitTotalPixel);
+	// Compact index of the ROI pixels
+	BuildROIIndex();
+	// Internal pixel info LUT for the ROI pixels
+	pxInfoLUTPtr = reinterpret_cast<PxInfo*>(AllocatePixelArray(pxInfoStorage, sizeof(PxInfo)*frameRoiTotalPixel));
+	GenerateROIPxInfo(pxInfoLUTPtr);
 	//// LCD differences LUT
 	//LCDDiffLUTPtr = new float*[3];
 	//for (int i = 0; i < 3; i++) {
 	//	LCDDiffLUTPtr[i] = new float[6];
 	//}
 	//memset(LCDDiffLUTPtr, 0, sizeof(float)*3*9);
-	// Generate LCD difference Lookup table
-	GenerateLCDDiffLUT();
+	// Generate LCD difference Lookup table (once for all instances)
+	std::call_once(LCDDiffLUTFlag, &BackgroundSubtractorLCDP::GenerateLCDDiffLUT);
 
 	/*=====MODEL Parameters=====*/
-	// Store the background's word and it's iterator
-	bgWordPtr = new DescriptorStruct[frameInitTotalPixel*WORDS_NO];
-	memset(bgWordPtr, 0, sizeof(DescriptorStruct)*frameInitTotalPixel*WORDS_NO);
-	bgWordPtrIter = bgWordPtr;
-	// Store the current frame's word and it's iterator
-	currWordPtr = new DescriptorStruct[frameInitTotalPixel];
-	memset(currWordPtr, 0, sizeof(DescriptorStruct)*frameInitTotalPixel);
+	// Words only hold the LCDP bits of this instance's neighbourhood and channel count
+	wordSize = compactWordSwitch ? GetWordSize(descNbNo, frameChannels == 1) : sizeof(DescriptorStruct);
+	// Store the background's word and it's iterator (zero-filled by the storage)
+	AllocateModel(frameRoiTotalPixel);
+	// Store the current frame's word and it's iterator (zero-filled by the storage)
+	currWordPtr = AllocatePixelArray(currWordStorage, wordSize*frameRoiTotalPixel);
 	currWordPtrIter = currWordPtr;
 
 	/*=====CLASSIFIER Parameters=====*/
 	// Minimum persistence threshold value 
 	clsMinPersistenceThreshold = (1.0f / descOffsetValue);
-	// Matched persistence value threshold
-	clsPersistenceThreshold.create(frameSize, CV_32FC1);
-	clsPersistenceThreshold = cv::Scalar(clsMinPersistenceThreshold);
 
 	/*=====POST-PROCESS Parameters=====*/
 	// Size of median filter
@@ -211,28 +351,8 @@ void BackgroundSubtractorLCDP::Initialize(cv::Mat inputFrame, cv::Mat inputROI)
 	}
 
 	/*=====RESULTS=====*/
-	// Per-pixel distance thresholds ('R(x)', but used as a relative value to determine both 
-	// intensity and descriptor variation thresholds)
-	resDistThreshold.create(frameSize, CV_32FC1);
-	resDistThreshold = cv::Scalar(1.0f);
-	// Per-pixel dynamic learning rate ('V(x)')
-	resDynamicRate.create(frameSize, CV_32FC1);
-	resDynamicRate = cv::Scalar(10.0f);
-	// Per-pixel update rates('T(x)')
-	resUpdateRate.create(frameSize, CV_32FC1);
-	resUpdateRate = cv::Scalar(upLearningRateLowerCap);
-	// Current pixel distance
-	resCurrPxDistance.create(frameSize, CV_32FC1);
-	resCurrPxDistance = cv::Scalar(0.0f);
-	// Minimum LCDP distance
-	resMinLCDPDistance.create(frameSize, CV_32FC1);
-	resMinLCDPDistance = cv::Scalar(1.0f);
-	// Minimum RGB distance
-	resMinRGBDistance.create(frameSize, CV_32FC1);
-	resMinRGBDistance = cv::Scalar(1.0f);
-	// Total PERSISTENCE
-	resTotalPersistence.create(frameSize, CV_32FC1);
-	resTotalPersistence = cv::Scalar(1.0f);
+	// Per-pixel float state of the ROI pixels
+	CreateStateMaps();
 	// Current foreground mask
 	resCurrFGMask.create(frameSize, CV_8UC1);
 	resCurrFGMask = cv::Scalar_<uchar>::all(0);
@@ -280,31 +400,18 @@ void BackgroundSubtractorLCDP::Initialize(cv::Mat inputFrame, cv::Mat inputROI)
 
 	// Last frame image
 	inputFrame.copyTo(resLastImg);
-	cv::cvtColor(inputFrame, resLastGrayImg, CV_RGB2GRAY);
-	// Pixel pointer index
-	size_t pxPointer = 0;
+	if (frameChannels == 1) {
+		inputFrame.copyTo(resLastGrayImg);
+	}
+	else {
+		cv::cvtColor(inputFrame, resLastGrayImg, cv::COLOR_RGB2GRAY);
+	}
 	// PRE PROCESSING
-	cv::GaussianBlur(inputFrame, inputFrame, preGaussianSize, 0, 0);
+	cv::GaussianBlur(inputFrame, bufPreImg, preGaussianSize, 0, 0);
 
-	for (size_t rowIndex = 0; rowIndex < frameSize.height; rowIndex++) {
-		for (size_t colIndex = 0; colIndex < frameSize.width; colIndex++) {
-			// Coordinate Y value
-			pxInfoLUTPtr[pxPointer].coor_y = (int)rowIndex;
-			// Coordinate X value
-			pxInfoLUTPtr[pxPointer].coor_x = (int)colIndex;
-			// Data index for current pixel's pointer
-			pxInfoLUTPtr[pxPointer].dataIndex = pxPointer;
-			// Data index for current pixel's BGR pointer
-			pxInfoLUTPtr[pxPointer].bgrDataIndex = pxPointer * 3;
-			// Model index for current pixel
-			pxInfoLUTPtr[pxPointer].modelIndex = pxPointer*WORDS_NO;
-			/*=====LUT Methods=====*/
-			// Generate neighborhood pixel offset value
-			GenerateNbOffset(pxInfoLUTPtr[pxPointer]);
-			// Descriptor Generator-Generate pixels' descriptor (RGB+LCDP)
-			DescriptorGenerator(inputFrame, pxInfoLUTPtr[pxPointer], currWordPtr[pxPointer]);
-			pxPointer++;
-		}
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		// Descriptor Generator-Generate pixels' descriptor (RGB+LCDP)
+		DescriptorGenerator(bufPreImg, pxInfoLUTPtr[roiIndex], *CurrWord(roiIndex));
 	}
 
 	// Refresh model
@@ -312,517 +419,937 @@ void BackgroundSubtractorLCDP::Initialize(cv::Mat inputFrame, cv::Mat inputROI)
 }
 
 /*=====METHODS=====*/
+/*=====INPUT Methods=====*/
+// Header over a caller's frame in the BGR / gray layout of the model
+cv::Mat BackgroundSubtractorLCDP::InputHeader(const FrameView &inputFrame)
+{
+	const cv::Mat header = inputFrame.Header();
+	if (inputFrame.format == FrameView::FORMAT_RGB8) {
+		cv::cvtColor(header, bufConvertedImg, cv::COLOR_RGB2BGR);
+		return bufConvertedImg;
+	}
+	if (inputFrame.format == FrameView::FORMAT_BGRA8) {
+		cv::cvtColor(header, bufConvertedImg, cv::COLOR_BGRA2BGR);
+		return bufConvertedImg;
+	}
+	return header;
+}
+
 /*=====DEFAULT methods=====*/
+// Reseed the instance's generator for the current frame (fixed seed only)
+void BackgroundSubtractorLCDP::SeedRandom()
+{
+	if (randomSeed != 0) {
+		randomGenerator.seed(unsigned(randomSeed + frameIndex));
+	}
+}
 // Refreshes all samples based on the last analyzed frame - checked
 void BackgroundSubtractorLCDP::RefreshModel(float refreshFraction)
 {
-	srand(time(NULL));
+	SeedRandom();
+	// Fraction of the full model; a pixel with a smaller model refreshes the part it owns
 	const size_t noSampleBeRefresh = refreshFraction < 1.0f ? (size_t)(refreshFraction*WORDS_NO) : WORDS_NO;
-	const size_t refreshStartPos = refreshFraction < 1.0f ? rand() % WORDS_NO : 0;
+	const size_t refreshStartPos = refreshFraction < 1.0f ? randomGenerator() % WORDS_NO : 0;
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		const size_t capacity = wordCapacity[roiIndex];
+		if (refreshStartPos < capacity) {
+			RefreshPixel(roiIndex, refreshStartPos, std::min(noSampleBeRefresh, capacity - refreshStartPos));
+		}
+	}
+}
+// Refresh words of one ROI pixel from the current words of its 7x7 neighbourhood
+void BackgroundSubtractorLCDP::RefreshPixel(size_t roiIndex, size_t startWord, size_t wordNo)
+{
 	DescriptorStruct * bgWord = nullptr;
 	DescriptorStruct * currWord = nullptr;
-	for (size_t pxPointer = 0; pxPointer < frameInitTotalPixel; pxPointer++) {
-		if (frameRoi.data[pxPointer]) {
-			// Start index of the model of the current pixel
-			size_t modelIndex = pxInfoLUTPtr[pxPointer].modelIndex;
-			for (size_t currModelIndex = refreshStartPos; currModelIndex < refreshStartPos + noSampleBeRefresh; ++currModelIndex) {
-
-				cv::Point sampleCoor;
-				getRandSamplePosition_7x7(sampleCoor, cv::Point(pxInfoLUTPtr[pxPointer].coor_x, pxInfoLUTPtr[pxPointer].coor_y), 0, frameSize);
-				size_t samplePxIndex = (frameSize.width*sampleCoor.y) + sampleCoor.x;
-				currWord = (currWordPtr + samplePxIndex);
-
-				bgWord = (bgWordPtr + modelIndex + currModelIndex);
-				for (size_t channel = 0; channel < 3; channel++) {
-					(*bgWord).rgb[channel] = (*currWord).rgb[channel];
-				}
-				for (size_t channel = 0; channel < 2; channel++) {
-					(*bgWord).LCDPColour[channel] = std::bitset<96>((*currWord).LCDPColour[channel]);
-					(*bgWord).LCDPTexture[channel] = std::bitset<48>((*currWord).LCDPTexture[channel]);
-				}
-				(*bgWord).frameCount = 1;
-				(*bgWord).p = frameIndex;
-				(*bgWord).q = frameIndex;
+	// Start index of the model of the current pixel
+	const size_t modelIndex = pxInfoLUTPtr[roiIndex].modelIndex;
+	const size_t currStamp = GetWordStamp(roiIndex);
+	for (size_t currModelIndex = startWord; currModelIndex < startWord + wordNo; ++currModelIndex) {
+
+		cv::Point sampleCoor;
+		getRandSamplePosition_7x7(sampleCoor, cv::Point(pxInfoLUTPtr[roiIndex].coor_x, pxInfoLUTPtr[roiIndex].coor_y), 0, frameSize, randomGenerator);
+		// Samples outside the ROI have no current word; use the pixel's own
+		const int sampleRoiIndex = roiIndexMap.at<int>(sampleCoor.y, sampleCoor.x);
+		currWord = CurrWord((sampleRoiIndex >= 0) ? size_t(sampleRoiIndex) : roiIndex);
+
+		bgWord = BgWord(modelIndex + currModelIndex);
+		// Intensities and LCDP bits; the stamps are set below
+		memcpy(bgWord, currWord, wordSize);
+		StampNewWord(*bgWord, currStamp);
+	}
+}
+// Allocate the storage header and the word pool of 'pixelNo' pixels
+void BackgroundSubtractorLCDP::AllocateModel(size_t pixelNo)
+{
+	bgWordStorage.SetPageSize(pageSize);
+	// Without an adaptive model (or budget) every pixel can own WORDS_NO words
+	size_t poolWords = pixelNo*WORDS_NO;
+	if (adaptiveModelSwitch && (modelBudgetBytes > 0)) {
+		poolWords = std::min(poolWords, std::max(pixelNo*wordMinCapacity, modelBudgetBytes / wordSize));
+	}
+	const size_t bgWordBytes = wordSize*poolWords;
+	if (!bgWordStorage.Allocate(modelStorageBackend, MODEL_STORAGE_HEADER_SIZE + bgWordBytes, modelStorageName)) {
+		std::cout << "Cannot create " << ModelStorage::GetBackendName(modelStorageBackend) << " model storage "
+			<< modelStorageName << ". Keep the model on the heap." << std::endl;
+		bgWordStorage.Allocate(ModelStorage::STORAGE_HEAP, MODEL_STORAGE_HEADER_SIZE + bgWordBytes, "");
+	}
+	if ((bgWordStorage.GetBackend() == ModelStorage::STORAGE_HEAP) && (pageSize == ModelStorage::PAGES_HUGE) && !bgWordStorage.UsesReservedHugePages()) {
+		std::cout << "No reserved huge pages for the model. Using transparent huge pages." << std::endl;
+	}
+	StorageHeader * storageHeader = reinterpret_cast<StorageHeader*>(bgWordStorage.Data());
+	memcpy(storageHeader->magic, "LCDPMM02", sizeof(storageHeader->magic));
+	storageHeader->rows = (unsigned int)frameSize.height;
+	storageHeader->cols = (unsigned int)frameSize.width;
+	storageHeader->wordsNo = (unsigned int)WORDS_NO;
+	storageHeader->wordSize = (unsigned int)wordSize;
+	storageHeader->frameIndex = frameIndex;
+	storageHeader->roiPixelNo = pixelNo;
+	storageHeader->poolWords = poolWords;
+	bgWordPtr = bgWordStorage.Data() + MODEL_STORAGE_HEADER_SIZE;
+	bgWordPtrIter = bgWordPtr;
+	// Process walks the words pixel by pixel in row-major order
+	bgWordStorage.Advise(ModelStorage::ACCESS_SEQUENTIAL, MODEL_STORAGE_HEADER_SIZE, bgWordBytes);
+	// Every pixel starts with its initial block
+	ResetWordPool();
+	for (size_t roiIndex = 0; roiIndex < pixelNo; ++roiIndex) {
+		AllocatePixelWords(roiIndex, wordInitialCapacity);
+	}
+}
+// Empty the word pool and forget every pixel's block
+void BackgroundSubtractorLCDP::ResetWordPool()
+{
+	const size_t poolWords = size_t(reinterpret_cast<StorageHeader*>(bgWordStorage.Data())->poolWords);
+	// A fixed model is a single size class of WORDS_NO words
+	wordPool.Reset(adaptiveModelSwitch ? ADAPTIVE_WORD_STEP : WORDS_NO, WORDS_NO, poolWords);
+	wordCapacity.assign(frameRoiTotalPixel, 0);
+	wordMissCount.assign(frameRoiTotalPixel, 0);
+	wordLowCount.assign(frameRoiTotalPixel, 0);
+	wordEpoch.assign(frameRoiTotalPixel, frameIndex);
+	// Hints of 0 walk the normal order
+	matchHintWord.assign(frameRoiTotalPixel, 0);
+	matchHintNb.assign(frameRoiTotalPixel, 0);
+}
+// Give a pixel a block of 'capacity' words, or of a smaller class when the budget is spent
+size_t BackgroundSubtractorLCDP::AllocatePixelWords(size_t roiIndex, size_t capacity)
+{
+	capacity = wordPool.ClassCapacity(capacity);
+	size_t offset = 0;
+	while (!wordPool.Allocate(capacity, offset)) {
+		if (capacity <= wordMinCapacity) {
+			return 0;
+		}
+		capacity = std::max(wordMinCapacity, wordPool.SmallerCapacity(capacity));
+	}
+	pxInfoLUTPtr[roiIndex].modelIndex = offset;
+	wordCapacity[roiIndex] = (unsigned short)capacity;
+	return capacity;
+}
+// Move a pixel's words to a block of another class, keeping the first words
+bool BackgroundSubtractorLCDP::ResizePixelWords(size_t roiIndex, size_t capacity)
+{
+	const size_t oldCapacity = wordCapacity[roiIndex];
+	size_t offset = 0;
+	if (!wordPool.Allocate(capacity, offset)) {
+		return false;
+	}
+	const size_t oldOffset = pxInfoLUTPtr[roiIndex].modelIndex;
+	memcpy(BgWord(offset), BgWord(oldOffset), wordSize*std::min(oldCapacity, capacity));
+	wordPool.Free(oldOffset, oldCapacity);
+	pxInfoLUTPtr[roiIndex].modelIndex = offset;
+	wordCapacity[roiIndex] = (unsigned short)capacity;
+	return true;
+}
+// Grow or shrink a pixel's model after it was processed
+void BackgroundSubtractorLCDP::AdaptPixelWords(size_t roiIndex, bool matched)
+{
+	const size_t capacity = wordCapacity[roiIndex];
+	// Grow by one class while the pixel keeps failing to match its own model
+	if (matched) {
+		wordMissCount[roiIndex] = 0;
+	}
+	else if (++wordMissCount[roiIndex] >= ADAPTIVE_GROW_MISS_NO) {
+		wordMissCount[roiIndex] = 0;
+		wordLowCount[roiIndex] = 0;
+		const size_t largerCapacity = wordPool.LargerCapacity(capacity);
+		if (largerCapacity > capacity) {
+			if (ResizePixelWords(roiIndex, largerCapacity)) {
+				// New words come from the neighbourhood, the first one is the unmatched observation
+				RefreshPixel(roiIndex, capacity, largerCapacity - capacity);
+				DescriptorStruct * newWord = BgWord(pxInfoLUTPtr[roiIndex].modelIndex + capacity);
+				memcpy(newWord, CurrWord(roiIndex), wordSize);
+				StampNewWord(*newWord, GetWordStamp(roiIndex));
+				wordGrowNo++;
+			}
+			else {
+				wordGrowFailedNo++;
 			}
 		}
+		return;
+	}
+	// Shrink by one class once the words it would evict (the least persistent, the model is
+	// sorted) stay below the persistence floor
+	const size_t smallerCapacity = std::max(wordMinCapacity, wordPool.SmallerCapacity(capacity));
+	if (smallerCapacity >= capacity) {
+		return;
+	}
+	const size_t modelIndex = pxInfoLUTPtr[roiIndex].modelIndex;
+	const size_t currStamp = GetWordStamp(roiIndex);
+	float tailPersistence = 0.0f;
+	for (size_t wordIndex = smallerCapacity; wordIndex < capacity; ++wordIndex) {
+		float wordPersistence;
+		GetLocalWordPersistence(*BgWord(modelIndex + wordIndex), currStamp, descOffsetValue, wordPersistence);
+		tailPersistence = std::max(tailPersistence, wordPersistence);
+	}
+	if (tailPersistence >= clsMinPersistenceThreshold) {
+		wordLowCount[roiIndex] = 0;
+	}
+	else if (++wordLowCount[roiIndex] >= ADAPTIVE_SHRINK_FRAME_NO) {
+		wordLowCount[roiIndex] = 0;
+		if (ResizePixelWords(roiIndex, smallerCapacity)) {
+			wordShrinkNo++;
+		}
 	}
 }
+// Allocate zero-filled memory for a per-pixel array with the current page size
+unsigned char * BackgroundSubtractorLCDP::AllocatePixelArray(ModelStorage &storage, size_t bytes)
+{
+	storage.SetPageSize(pageSize);
+	// An empty ROI still gets a valid pointer
+	storage.Allocate(ModelStorage::STORAGE_HEAP, std::max(size_t(1), bytes), "");
+	return storage.Data();
+}
+// Create the float state maps for the current ROI
+void BackgroundSubtractorLCDP::CreateStateMaps()
+{
+	// One column per ROI pixel; the maps share one block from the page allocator
+	const cv::Size stateSize(int(frameRoiTotalPixel), 1);
+	float * stateData = reinterpret_cast<float*>(AllocatePixelArray(stateStorage, 8 * sizeof(float)*frameRoiTotalPixel));
+	// Matched persistence value threshold
+	clsPersistenceThreshold = cv::Mat(stateSize, CV_32FC1, stateData);
+	clsPersistenceThreshold = cv::Scalar(clsMinPersistenceThreshold);
+	// Per-pixel distance thresholds ('R(x)', but used as a relative value to determine both 
+	// intensity and descriptor variation thresholds)
+	resDistThreshold = cv::Mat(stateSize, CV_32FC1, stateData + frameRoiTotalPixel);
+	resDistThreshold = cv::Scalar(1.0f);
+	// Per-pixel dynamic learning rate ('V(x)')
+	resDynamicRate = cv::Mat(stateSize, CV_32FC1, stateData + 2 * frameRoiTotalPixel);
+	resDynamicRate = cv::Scalar(10.0f);
+	// Per-pixel update rates('T(x)')
+	resUpdateRate = cv::Mat(stateSize, CV_32FC1, stateData + 3 * frameRoiTotalPixel);
+	resUpdateRate = cv::Scalar(upLearningRateLowerCap);
+	// Current pixel distance
+	resCurrPxDistance = cv::Mat(stateSize, CV_32FC1, stateData + 4 * frameRoiTotalPixel);
+	resCurrPxDistance = cv::Scalar(0.0f);
+	// Minimum LCDP distance
+	resMinLCDPDistance = cv::Mat(stateSize, CV_32FC1, stateData + 5 * frameRoiTotalPixel);
+	resMinLCDPDistance = cv::Scalar(1.0f);
+	// Minimum RGB distance
+	resMinRGBDistance = cv::Mat(stateSize, CV_32FC1, stateData + 6 * frameRoiTotalPixel);
+	resMinRGBDistance = cv::Scalar(1.0f);
+	// Total PERSISTENCE
+	resTotalPersistence = cv::Mat(stateSize, CV_32FC1, stateData + 7 * frameRoiTotalPixel);
+	resTotalPersistence = cv::Scalar(1.0f);
+}
 
 // Program processing
-void BackgroundSubtractorLCDP::Process(cv::Mat inputImg, cv::Mat &outputImg)
+void BackgroundSubtractorLCDP::Process(const cv::Mat &inputImg, cv::Mat &outputImg)
 {
-	srand(time(NULL));
+	outputImg.create(fullFrameSize, CV_8UC1);
+	Process(FrameView(inputImg), MaskView(outputImg));
+}
+void BackgroundSubtractorLCDP::Process(const FrameView &frameView, const MaskView &outputMask)
+{
+	SeedRandom();
+	if (profiler) {
+		profiler->StartFrame();
+	}
+	CV_Assert((frameView.data != nullptr) && (frameView.GetSize() == fullFrameSize));
+	CV_Assert((outputMask.data != nullptr) && (outputMask.GetSize() == fullFrameSize));
+	// Header over the caller's frame, only read: every image derived from it is an input buffer
+	cv::Mat inputImg = InputHeader(frameView);
+	// Reduced-resolution mode: model the downsampled frame, keep the full frame to guide the upsampling
+	cv::Mat fullInputImg;
+	if (processScale > 1) {
+		fullInputImg = inputImg;
+		cv::resize(inputImg, bufScaledImg, frameSize, 0, 0, cv::INTER_AREA);
+		inputImg = bufScaledImg;
+	}
+	CV_Assert(inputImg.channels() == frameChannels);
 	cv::Mat inputGrayImg;
-	cv::cvtColor(inputImg, inputGrayImg, CV_RGB2GRAY);
+	if (frameChannels == 1) {
+		// A gray frame is its own gray image; padded rows are packed for the dark pixel map
+		if (inputImg.isContinuous()) {
+			inputGrayImg = inputImg;
+		}
+		else {
+			inputImg.copyTo(bufGrayImg);
+			inputGrayImg = bufGrayImg;
+		}
+	}
+	else {
+		cv::cvtColor(inputImg, bufGrayImg, cv::COLOR_RGB2GRAY);
+		inputGrayImg = bufGrayImg;
+	}
 	// Update average image
 	resLastImg = (inputImg + (resLastImg*(frameIndex - 1))) / frameIndex;
-	// PRE PROCESSING
+	PROFILE_LAP(STAGE_INPUT);
+	// PRE PROCESSING: the per-pixel loop indexes packed rows, so an unblurred padded frame is packed
 	if (preSwitch) {
-		cv::GaussianBlur(inputImg, inputImg, preGaussianSize, 0, 0);
+		cv::GaussianBlur(inputImg, bufPreImg, preGaussianSize, 0, 0);
+		inputImg = bufPreImg;
+		PROFILE_LAP(STAGE_PRE_BLUR);
+	}
+	else if (!inputImg.isContinuous()) {
+		inputImg.copyTo(bufPreImg);
+		inputImg = bufPreImg;
+	}
+	// Change gate: compare with the previous input unless this frame is a forced full pass
+	const bool gateActive = (gateBlockSize > 0) && !gateLastImg.empty() &&
+		((gateFullPassInterval == 0) || (frameIndex % gateFullPassInterval != 0));
+	if (gateActive) {
+		UpdateChangeGate(inputImg);
 	}
+	if (gateBlockSize > 0) {
+		inputImg.copyTo(gateLastImg);
+		PROFILE_LAP(STAGE_CHANGE_GATE);
+	}
+	// Total number of pixels skipped by the change gate
+	size_t gateSkippedNo = 0;
 	bool bootstrapping = frameIndex <= 500;
 	// DETECTION PROCESS
 	// Generate a map to indicate dark pixel (255: Not dark pixel, 0: Dark pixel)
 	DarkPixelGenerator(inputGrayImg, inputImg, resLastGrayImg, resLastImg, resDarkPixel);
+	PROFILE_LAP(STAGE_DARK_PIXEL);
+	// Model the ROI pixels with the variant selected at construction
+	(this->*processPixelsFn)(inputImg, gateActive, bootstrapping, gateSkippedNo);
+	if (gateBlockSize > 0) {
+		// Raw classification, reused by the next frame's unchanged blocks
+		resCurrFGMask.copyTo(gateLastRawFGMask);
+		resMatchResultBoth.copyTo(gateLastMatchBoth);
+		gateSkippedFraction = (frameRoiTotalPixel > 0) ? (double(gateSkippedNo) / frameRoiTotalPixel) : 0.0;
+		gateSkippedLog.push_back(float(gateSkippedFraction));
+	}
+	if (profiler) {
+		// The pixel loop was charged pixel by pixel
+		profiler->ResetLap();
+	}
+	// POST PROCESSING
+	if (postSwitch) {
+		PostProcess(inputGrayImg);
+	}
+	// The final mask is written once, into the caller's buffer
+	cv::Mat outputImg = outputMask.Header();
+	const cv::Mat &finalFGMask = postSwitch ? resLastFGMask : resCurrFGMask;
+	if (processScale > 1) {
+		UpsampleMask(finalFGMask, fullInputImg, outputImg);
+	}
+	else {
+		finalFGMask.copyTo(outputImg);
+	}
+	// Frame Index
+	frameIndex++;
+	reinterpret_cast<StorageHeader*>(bgWordStorage.Data())->frameIndex = frameIndex;
+	// Reset minimum matching distance
+	resMinLCDPDistance = cv::Scalar(1.0f);
+	resMinRGBDistance = cv::Scalar(1.0f);
+	resTotalPersistence = cv::Scalar(0.0f);
+	resCurrFGMask = cv::Scalar_<uchar>::all(0);
+	resMatchResultBoth = cv::Scalar_<uchar>::all(0);
+	resLastGrayImg = (inputGrayImg + (resLastGrayImg*(frameIndex - 1))) / frameIndex;
+	if (profiler) {
+		profiler->Lap(STAGE_OUTPUT);
+		profiler->EndFrame();
+	}
+}
+
+// Post-processing chain of Process: blink map, motion history compensation, gradient and
+// morphology filters, border line reconstruction and hole filling of resCurrFGMask into resLastFGMask
+void BackgroundSubtractorLCDP::PostProcess(const cv::Mat &inputGrayImg)
+{
+	// Median filter size under the current quality limits
+	const int medianFilterSize = (qualityLimits.medianFilterSize > 0) ? qualityLimits.medianFilterSize : int(postMedianFilterSize);
+	cv::bitwise_xor(resCurrFGMask, resLastRawFGMask, resCurrRawBlink);
+	cv::bitwise_or(resCurrRawBlink, resLastRawBlink, resBlinkFrame);
+	resCurrRawBlink.copyTo(resLastRawBlink);
+	PROFILE_LAP(STAGE_POST_BLINK);
+	cv::Mat element = cv::getStructuringElement(0, cv::Size(5, 5));
+	cv::Mat tempCurrFGMask;
+	resCurrFGMask.copyTo(tempCurrFGMask);
+
+	postCompensationResult = CompensationMotionHist(resT_1FGMask, resT_2FGMask, resCurrFGMask, postCompensationThreshold);
+	PROFILE_LAP(STAGE_POST_COMPENSATION);
+	cv::Mat grad_x, grad_y, grad;
+	cv::Mat abs_grad_x, abs_grad_y;
+	int ddepth = CV_16S;
+	int scale = 1;
+	int delta = 0;
+	/// Gradient X
+	cv::Sobel(inputGrayImg, grad_x, ddepth, 1, 0, 3, scale, delta, cv::BORDER_DEFAULT);
+	/// Gradient Y
+	cv::Sobel(inputGrayImg, grad_y, ddepth, 0, 1, 3, scale, delta, cv::BORDER_DEFAULT);
+	convertScaleAbs(grad_x, abs_grad_x);
+	convertScaleAbs(grad_y, abs_grad_y);
+	addWeighted(abs_grad_x, 0.5, abs_grad_y, 0.5, 0, grad);
+
+	cv::Mat gradientResult, gradientResult2;
+
+	cv::inRange(grad, cv::Scalar(75), cv::Scalar(110), gradientResult);
+	//cv::bitwise_not(resDarkPixel, gradientResult2);
+	//cv::bitwise_and(gradientResult, gradientResult2, gradientResult);
+
+	cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 3);
+	cv::bitwise_not(gradientResult, gradientResult);
+	cv::bitwise_and(grad, gradientResult, gradientResult);
+	cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 1);
+	cv::inRange(grad, cv::Scalar(75), cv::Scalar(150), gradientResult2);
+	cv::dilate(gradientResult2, gradientResult2, cv::Mat(), cv::Point(-1, -1), 4);
+	//inputGrayImg.copyTo(gradientResult);
+	//cv::threshold(gradientResult, gradientResult, 80, 255, CV_THRESH_BINARY);
+	//cv::morphologyEx(gradientResult, gradientResult, cv::MORPH_GRADIENT, element);
+	//cv::Mat invDarkPixel;
+	//resDarkPixel.copyTo(invDarkPixel);
+	//cv::bitwise_not(invDarkPixel, invDarkPixel);
+	//cv::erode(invDarkPixel, invDarkPixel, cv::Mat(), cv::Point(-1, -1), 3);
+	//cv::dilate(invDarkPixel, invDarkPixel, cv::Mat(), cv::Point(-1, -1), 3);
+
+	//cv::bitwise_and(invDarkPixel, gradientResult, gradientResult);
+	//cv::bitwise_and(invDarkPixel, gradientResult2, gradientResult2);
+	//cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 5);
+	//cv::dilate(gradientResult2, gradientResult2, cv::Mat(), cv::Point(-1, -1), 5);
+	//cv::bitwise_not(gradientResult, gradientResult);
+	cv::bitwise_not(gradientResult2, gradientResult2);
+	PROFILE_LAP(STAGE_POST_GRADIENT);
+
+	// ADD NEW
+	cv::erode(resCurrFGMask, resCurrFGMask, cv::Mat(), cv::Point(-1, -1), 1);
+	cv::dilate(resCurrFGMask, resCurrFGMask, cv::Mat(), cv::Point(-1, -1), 1);
+	//cv::bitwise_and(resCurrFGMask, gradientResult, tempCurrFGMask);
+	cv::bitwise_and(resCurrFGMask, gradientResult2, tempCurrFGMask);
+	cv::erode(resDarkPixel, resDarkPixel, cv::Mat(), cv::Point(-1, -1), 3);
+	cv::dilate(resDarkPixel, resDarkPixel, cv::Mat(), cv::Point(-1, -1), 2);
+	cv::medianBlur(resDarkPixel, resDarkPixel, 3);
+	//cv::bitwise_or(tempCurrFGMask, resDarkPixel, gradientResult);
+	cv::bitwise_or(tempCurrFGMask, resDarkPixel, gradientResult2);
+	//cv::morphologyEx(gradientResult, gradientResult, cv::MORPH_CLOSE, element);
+	cv::morphologyEx(gradientResult2, gradientResult2, cv::MORPH_CLOSE, element);
+	PROFILE_LAP(STAGE_POST_MORPHOLOGY);
+	//cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 3);
+	if (!qualityLimits.skipBorderLine) {
+		cv::Mat reconstructLine = BorderLineReconst(gradientResult2);
+		cv::bitwise_or(tempCurrFGMask, reconstructLine, resFGMaskPreFlood);
+	}
+	else {
+		tempCurrFGMask.copyTo(resFGMaskPreFlood);
+	}
+	PROFILE_LAP(STAGE_POST_BORDERLINE);
+	//cv::bitwise_or(resDarkPixel, resFGMaskPreFlood, resFGMaskPreFlood);
+	cv::dilate(resFGMaskPreFlood, resFGMaskPreFlood, cv::Mat(), cv::Point(-1, -1), 3);
+	cv::morphologyEx(resFGMaskPreFlood, resFGMaskPreFlood, cv::MORPH_CLOSE, element);
+	resFGMaskFloodedHoles = qualityLimits.skipContourFill ? resFGMaskPreFlood.clone() : ContourFill(resFGMaskPreFlood);
+	PROFILE_LAP(STAGE_POST_CONTOUR_FILL);
+	cv::bitwise_not(resMatchResultBoth, resMatchResultBoth);
+	cv::bitwise_and(resFGMaskFloodedHoles, resMatchResultBoth, resFGMaskFloodedHoles);
+	//cv::dilate(reconstructLine, reconstructLine, cv::Mat(), cv::Point(-1, -1), 3);
+	//cv::bitwise_not(reconstructLine, reconstructLine);
+	//cv::bitwise_and(reconstructLine, resFGMaskFloodedHoles, resFGMaskFloodedHoles);
+	cv::bitwise_or(resCurrFGMask, resFGMaskFloodedHoles, resCurrFGMask);
+	cv::bitwise_or(resCurrFGMask, postCompensationResult, resLastFGMask);
+
+
+	//cv::bitwise_and(gradientResult, resLastFGMask, resLastFGMask);
+	//cv::morphologyEx(resLastFGMask, resLastFGMask, cv::MORPH_CLOSE, element);
+	cv::medianBlur(resLastFGMask, resLastFGMask, medianFilterSize);
+	//cv::dilate(resLastFGMask, resLastFGMask, cv::Mat(), cv::Point(-1, -1), 2);
+
+	cv::dilate(resLastFGMask, resLastFGMaskDilated, cv::Mat(), cv::Point(-1, -1), 3);
+	cv::bitwise_and(resBlinkFrame, resLastFGMaskDilatedInverted, resBlinkFrame);
+	cv::bitwise_not(resLastFGMaskDilated, resLastFGMaskDilatedInverted);
+	cv::bitwise_and(resBlinkFrame, resLastFGMaskDilatedInverted, resBlinkFrame);
+	cv::medianBlur(resLastFGMask, resLastFGMask, medianFilterSize);
+	cv::morphologyEx(resLastFGMask, resLastFGMask, cv::MORPH_OPEN, element);
+	cv::morphologyEx(resLastFGMask, resLastFGMask, cv::MORPH_CLOSE, element);
+	PROFILE_LAP(STAGE_POST_MEDIAN);
+	if (!qualityLimits.skipContourFill) {
+		resLastFGMask = ContourFill(resLastFGMask);
+	}
+	PROFILE_LAP(STAGE_POST_CONTOUR_FILL);
+	// The filters above spread the mask; nothing outside the ROI is foreground
+	if (frameRoiTotalPixel < frameInitTotalPixel) {
+		cv::bitwise_and(resLastFGMask, frameRoi, resLastFGMask);
+	}
+	resT_1FGMask.copyTo(resT_2FGMask);
+	resLastFGMask.copyTo(resT_1FGMask);
+}
+
+// Per-pixel detection and update over the ROI pixels. The switches and the descriptor
+// neighbourhood are template arguments, so the branches on them fold away and the descriptor
+// loops have fixed trip counts; WordsNo bounds the word loops at compile time (0: WORDS_NO).
+template <bool LCDPDiff, bool RGBDiff, bool NbMatch, bool Feedback, int NbNo, bool Mono, size_t WordsNo>
+void BackgroundSubtractorLCDP::ProcessPixels(const cv::Mat &inputImg, bool gateActive, bool bootstrapping, size_t &gateSkippedNo)
+{
+	// Words per pixel
+	const size_t wordsNo = (WordsNo > 0) ? WordsNo : WORDS_NO;
 	// BG Word pointer
 	DescriptorStruct * bgWord = nullptr;
 	// NB Word pointer
 	DescriptorStruct * nbBgWord = nullptr;
 	// Current bg word's persistence	
 	float currWordPersistence;
-	for (size_t pxPointer = 0; pxPointer < frameInitTotalPixel; ++pxPointer) {
-		if (frameRoi.data[pxPointer]) {
-			// Descriptor Generator-Generate pixels' descriptor (RGB+LCDP)
-			DescriptorGenerator(inputImg, pxInfoLUTPtr[pxPointer], currWordPtr[pxPointer]);
-			// Current distance threshold ('R(x)')r
-			float * currDistThreshold = (float*)(resDistThreshold.data + (pxPointer * 4));
-			// Current dynamic rate ('V(x)')
-			float * currDynamicRate = (float*)(resDynamicRate.data + (pxPointer * 4));
-			// Current pixel's update rate ('T(x)')
-			float * currUpdateRate = (float*)(resUpdateRate.data + (pxPointer * 4));
-			const size_t updateRate = ceil(*currUpdateRate);
-			// Model index for current pixel
-			const size_t currModelIndex = pxInfoLUTPtr[pxPointer].modelIndex;
-
-			// Current dark pixel result
-			uchar * currDarkPixel = (resDarkPixel.data + pxPointer);
-			// LCDP differences threshold
-			const double currLCDPThreshold = std::min(clsLCDPMaxThreshold, std::max(clsLCDPThreshold, (std::pow(2, double((*currDistThreshold))) / 512)));
-			// Up LCDP differences threshold
-			const double currUpLCDPThreshold = clsUpLCDPThreshold;
-			// RGB differences threshold
-			const double currRGBThreshold = std::max(clsRGBThreshold, floor(clsRGBThreshold*(*currDistThreshold)));
-			// Persistence threshold
-			float * currPersistenceThreshold = (float*)(clsPersistenceThreshold.data + (pxPointer * 4));
-			// Current pixel's foreground mask
-			uchar * currFGMask = (resCurrFGMask.data + pxPointer);
-			// Current pixel's foreground mask
-			uchar * matchResultBoth = (resMatchResultBoth.data + pxPointer);
-			// Total number of neighborhood pixel 8(3x3)/16(5x5)
-			size_t currDescNeighNo = descNbNo;
-			// Current pixel's descriptor
-			DescriptorStruct currWord = currWordPtr[pxPointer];
-
-			// Current pixel's min LCDP distance
-			float * minLCDPDistance = (float*)(resMinLCDPDistance.data + (pxPointer * 4));
-			// Current pixel's min RGB distance
-			float * minRGBDistance = (float*)(resMinRGBDistance.data + (pxPointer * 4));
-			// Current pixel's total persistence
-			float * totalPersistence = (float*)(resTotalPersistence.data + (pxPointer * 4));
-			// Current pixel distance
-			float * currPxDistance = (float*)(resCurrPxDistance.data + (pxPointer * 4));
-
-			// Last word's persistence
-			float currLastWordPersistence = FLT_MAX;
-			// Current pixel's background word index
-			int currLocalWordIdx = 0;
-
-			// Number of potential matched model
-			int clsPotentialMatch = 0;
-			while (currLocalWordIdx < WORDS_NO && (clsPotentialMatch < clsMatchThreshold)) {
-				// Current bg word
-				bgWord = (bgWordPtr + currModelIndex + currLocalWordIdx);
-				GetLocalWordPersistence(*bgWord, frameIndex, descOffsetValue, currWordPersistence);
-				float tempLCDPDistance = 1.0f;
-				float tempRGBDistance = 1.0f;
-				bool matchResult = false;
-				bool matchBoth = false;
-				// False:Match true:Not match
-				DescriptorMatching(*bgWord, currWord, currDescNeighNo, currLCDPThreshold, currUpLCDPThreshold, currRGBThreshold,
-					tempLCDPDistance, tempRGBDistance, matchResult, matchBoth);
-				// Both BG
-				if (!matchResult) {
-					if (matchBoth) {
-						(*matchResultBoth) = 255;
-					}
-					(*bgWord).frameCount += 1;
-					(*bgWord).q = frameIndex;
-					clsPotentialMatch++;
-					// Update MIN LCDP distance
-					(*minLCDPDistance) = std::min(tempLCDPDistance, (*minLCDPDistance));
-					// Update MIN RGB distance
-					(*minRGBDistance) = std::min(tempRGBDistance, (*minRGBDistance));
-					// Update MIN PERSISTENCE distance
-					(*totalPersistence) = (*totalPersistence) + currWordPersistence;
-					/*(*totalPersistence) = std::min((*currPersistenceThreshold), (*totalPersistence) + currWordPersistence);*/
-					// BG
-					if (std::rand() % (updateRate) == 0) {
-						if (tempLCDPDistance < (currLCDPThreshold / 2)) {
-							for (size_t channel = 0; channel < 3; channel++) {
-								(*bgWord).rgb[channel] = currWord.rgb[channel];
-							}
-							for (size_t channel = 0; channel < 2; channel++) {
-								(*bgWord).LCDPColour[channel] = std::bitset<96>(currWord.LCDPColour[channel]);
-								(*bgWord).LCDPTexture[channel] = std::bitset<48>(currWord.LCDPTexture[channel]);
-							}
-							/*nbBgWord = (bgWordPtr + currModelIndex + WORDS_NO - 1);
-							for (size_t channel = 0; channel < 3; channel++) {
-							(*nbBgWord).rgb[channel] = currWord.rgb[channel];
-							}
-							for (size_t channel = 0; channel < descNbNo; channel++) {
-							(*nbBgWord).LCDP[channel] = currWord.LCDP[channel];
-							}
-							(*nbBgWord).frameCount = 1;
-							(*nbBgWord).p = frameIndex;
-							(*nbBgWord).q = frameIndex;*/
+	// Total number of words scanned per pixel under the current quality limits (capped by each pixel's capacity)
+	const size_t wordsScanned = std::min(wordsNo, std::max(size_t(clsMatchThreshold), qualityLimits.maxWordsScanned));
+	// Start of the current per-pixel stage (profiling only)
+	long long pixelLapStart = profiler ? Profiler::Now() : 0;
+	// Only the ROI pixels are modelled; their words and float state are stored in compact index order
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; ++roiIndex) {
+		// Frame index of the pixel (masks and images)
+		const size_t pxPointer = pxInfoLUTPtr[roiIndex].dataIndex;
+		// Keep the pixel's 16-bit word stamps in range
+		if (GetWordStamp(roiIndex) >= WORD_STAMP_REBASE - (roiIndex % WORD_STAMP_STAGGER)) {
+			RebaseWordStamps(roiIndex);
+		}
+		// Current frame relative to the pixel's epoch
+		const size_t currStamp = GetWordStamp(roiIndex);
+		if (gateActive && gateStaticBlocks.at<uchar>(pxInfoLUTPtr[roiIndex].coor_y / gateBlockSize, pxInfoLUTPtr[roiIndex].coor_x / gateBlockSize)) {
+			// Unchanged block: keep the previous classification; a background pixel ages its top word as if it matched again
+			resCurrFGMask.data[pxPointer] = gateLastRawFGMask.data[pxPointer];
+			resMatchResultBoth.data[pxPointer] = gateLastMatchBoth.data[pxPointer];
+			if (!gateLastRawFGMask.data[pxPointer]) {
+				resDarkPixel.data[pxPointer] = 0;
+				bgWord = BgWord(pxInfoLUTPtr[roiIndex].modelIndex);
+				StampWordOccurrence(*bgWord, currStamp);
+			}
+			gateSkippedNo++;
+			continue;
+		}
+		// Descriptor Generator-Generate pixels' descriptor (RGB+LCDP)
+		DescriptorGenerator<NbNo, Mono>(inputImg, pxInfoLUTPtr[roiIndex], *CurrWord(roiIndex));
+		PROFILE_PIXEL_LAP(STAGE_DESCRIPTOR);
+		// Current distance threshold ('R(x)')r
+		float * currDistThreshold = (float*)(resDistThreshold.data + (roiIndex * 4));
+		// Current dynamic rate ('V(x)')
+		float * currDynamicRate = (float*)(resDynamicRate.data + (roiIndex * 4));
+		// Current pixel's update rate ('T(x)')
+		float * currUpdateRate = (float*)(resUpdateRate.data + (roiIndex * 4));
+		const size_t updateRate = ceil(*currUpdateRate);
+		// Model index for current pixel
+		const size_t currModelIndex = pxInfoLUTPtr[roiIndex].modelIndex;
+		// Words scanned for current pixel
+		const size_t currWordsScanned = std::min(wordsScanned, size_t(wordCapacity[roiIndex]));
+
+		// Current dark pixel result
+		uchar * currDarkPixel = (resDarkPixel.data + pxPointer);
+		// LCDP differences threshold
+		const double currLCDPThreshold = std::min(clsLCDPMaxThreshold, std::max(clsLCDPThreshold, (std::pow(2, double((*currDistThreshold))) / 512)));
+		// Up LCDP differences threshold
+		const double currUpLCDPThreshold = clsUpLCDPThreshold;
+		// RGB differences threshold
+		const double currRGBThreshold = std::max(clsRGBThreshold, floor(clsRGBThreshold*(*currDistThreshold)));
+		// Persistence threshold
+		float * currPersistenceThreshold = (float*)(clsPersistenceThreshold.data + (roiIndex * 4));
+		// Current pixel's foreground mask
+		uchar * currFGMask = (resCurrFGMask.data + pxPointer);
+		// Current pixel's foreground mask
+		uchar * matchResultBoth = (resMatchResultBoth.data + pxPointer);
+		// Total number of neighborhood pixel 8(3x3)/16(5x5)
+		size_t currDescNeighNo = descNbNo;
+		// Current pixel's descriptor (only the bytes of this neighbourhood's layout are stored)
+		DescriptorStruct currWord;
+		memcpy(&currWord, CurrWord(roiIndex), WordLayout<NbNo, Mono>::Size());
+
+		// Current pixel's min LCDP distance
+		float * minLCDPDistance = (float*)(resMinLCDPDistance.data + (roiIndex * 4));
+		// Current pixel's min RGB distance
+		float * minRGBDistance = (float*)(resMinRGBDistance.data + (roiIndex * 4));
+		// Current pixel's total persistence
+		float * totalPersistence = (float*)(resTotalPersistence.data + (roiIndex * 4));
+		// Current pixel distance
+		float * currPxDistance = (float*)(resCurrPxDistance.data + (roiIndex * 4));
+
+		// Last word's persistence
+		float currLastWordPersistence = FLT_MAX;
+		// Current pixel's background word index
+		int currLocalWordIdx = 0;
+		// Match one of the pixel's words (RETURN-true: background); the effects do not depend on the visiting order
+		auto matchOwnWord = [&](DescriptorStruct *ownWord, float ownWordPersistence) -> bool {
+			float tempLCDPDistance = 1.0f;
+			float tempRGBDistance = 1.0f;
+			bool matchResult = false;
+			bool matchBoth = false;
+			// False:Match true:Not match
+			DescriptorMatching<LCDPDiff, RGBDiff, NbNo, Mono>(*ownWord, currWord, currDescNeighNo, currLCDPThreshold, currUpLCDPThreshold, currRGBThreshold,
+				tempLCDPDistance, tempRGBDistance, matchResult, matchBoth);
+			// Both BG
+			if (!matchResult) {
+				if (matchBoth) {
+					(*matchResultBoth) = 255;
+				}
+				StampWordOccurrence(*ownWord, currStamp);
+				// Update MIN LCDP distance
+				(*minLCDPDistance) = std::min(tempLCDPDistance, (*minLCDPDistance));
+				// Update MIN RGB distance
+				(*minRGBDistance) = std::min(tempRGBDistance, (*minRGBDistance));
+				// Update MIN PERSISTENCE distance
+				(*totalPersistence) = (*totalPersistence) + ownWordPersistence;
+				/*(*totalPersistence) = std::min((*currPersistenceThreshold), (*totalPersistence) + ownWordPersistence);*/
+				// BG
+				if (randomGenerator() % (updateRate) == 0) {
+					if (tempLCDPDistance < (currLCDPThreshold / 2)) {
+						CopyDescriptor<NbNo, Mono>(*ownWord, currWord);
+						/*nbBgWord = (bgWordPtr + currModelIndex + WORDS_NO - 1);
+						for (size_t channel = 0; channel < 3; channel++) {
+						(*nbBgWord).rgb[channel] = currWord.rgb[channel];
+						}
+						for (size_t channel = 0; channel < descNbNo; channel++) {
+						(*nbBgWord).LCDP[channel] = currWord.LCDP[channel];
 						}
+						(*nbBgWord).frameCount = 1;
+						(*nbBgWord).p = frameIndex;
+						(*nbBgWord).q = frameIndex;*/
 					}
 				}
-				// Sort background model based on persistence
-				if (currWordPersistence > currLastWordPersistence) {
-					std::swap(bgWordPtr[currModelIndex + currLocalWordIdx], bgWordPtr[currModelIndex + currLocalWordIdx - 1]);
-				}
-				else {
-					currLastWordPersistence = currWordPersistence;
-				}
-				++currLocalWordIdx;
 			}
-
-			// Sorting remaining models
-			while (currLocalWordIdx < WORDS_NO) {
-				bgWord = (bgWordPtr + currModelIndex + currLocalWordIdx);
-				GetLocalWordPersistence(*bgWord, frameIndex, descOffsetValue, currWordPersistence);
-				if (currWordPersistence > currLastWordPersistence) {
-					std::swap(bgWordPtr[currModelIndex + currLocalWordIdx], bgWordPtr[currModelIndex + currLocalWordIdx - 1]);
-				}
-				else {
-					currLastWordPersistence = currWordPersistence;
-				}
-				++currLocalWordIdx;
+			return !matchResult;
+		};
+
+		// Number of potential matched model
+		int clsPotentialMatch = 0;
+		// Word that matched on the previous frame, tried first (its persistence is taken before its stamp moves)
+		const size_t hintWordIdx = matchHintSwitch ? size_t(matchHintWord[roiIndex]) : currWordsScanned;
+		float hintWordPersistence = 0.0f;
+		// Position of the first word matched on this frame
+		size_t matchedWordIdx = currWordsScanned;
+		if (hintWordIdx < currWordsScanned) {
+			bgWord = BgWord(currModelIndex + hintWordIdx);
+			GetLocalWordPersistence(*bgWord, currStamp, descOffsetValue, hintWordPersistence);
+			if (matchOwnWord(bgWord, hintWordPersistence)) {
+				clsPotentialMatch++;
+				matchedWordIdx = hintWordIdx;
 			}
-			// Successful classified as BG Pixels
-			if (clsPotentialMatch >= clsMatchThreshold) {
-				(*currFGMask) = 0;
-				(*currDarkPixel) = 0;
-				// Replace Model from NB to the last model of bg word
-
-				cv::Point sampleCoor;
-				if (!upUse3x3Spread) {
-					getRandSamplePosition_5x5(sampleCoor, cv::Point(pxInfoLUTPtr[pxPointer].coor_x, pxInfoLUTPtr[pxPointer].coor_y), 0, frameSize);
-				}
-				else {
-					getRandSamplePosition_3x3(sampleCoor, cv::Point(pxInfoLUTPtr[pxPointer].coor_x, pxInfoLUTPtr[pxPointer].coor_y), 0, frameSize);
-				}
-				int randNum = rand() % WORDS_NO;
-				const size_t samplePxIndex = frameSize.width*sampleCoor.y + sampleCoor.x;
-				// Start index of the model of the current pixel
-				const size_t startNBModelIndex = pxInfoLUTPtr[samplePxIndex].modelIndex;
-				// Current pixel's update rate ('T(x)')
-				const size_t nbUpdateRate = ceil(*((float*)(resUpdateRate.data + (samplePxIndex * 4))));
-				if (std::rand() % (nbUpdateRate * 2) == 0) {
-					nbBgWord = (bgWordPtr + startNBModelIndex + randNum);
-					for (size_t channel = 0; channel < 3; channel++) {
-						(*nbBgWord).rgb[channel] = currWord.rgb[channel];
-					}
-					for (size_t channel = 0; channel < 2; channel++) {
-						(*nbBgWord).LCDPColour[channel] = std::bitset<96>(currWord.LCDPColour[channel]);
-						(*nbBgWord).LCDPTexture[channel] = std::bitset<48>(currWord.LCDPTexture[channel]);
+		}
+		while (currLocalWordIdx < currWordsScanned && (clsPotentialMatch < clsMatchThreshold)) {
+			// Current bg word
+			bgWord = BgWord(currModelIndex + currLocalWordIdx);
+			if (size_t(currLocalWordIdx) == hintWordIdx) {
+				// Already matched above
+				currWordPersistence = hintWordPersistence;
+			}
+			else {
+				GetLocalWordPersistence(*bgWord, currStamp, descOffsetValue, currWordPersistence);
+				if (matchOwnWord(bgWord, currWordPersistence)) {
+					clsPotentialMatch++;
+					if (matchedWordIdx == currWordsScanned) {
+						matchedWordIdx = size_t(currLocalWordIdx);
 					}
-					(*nbBgWord).frameCount = 1;
-					(*nbBgWord).p = frameIndex;
-					(*nbBgWord).q = frameIndex;
 				}
-				//(*currDynamicRate) = std::max(upMinDynamicRate, (*currDynamicRate) - upDynamicRateDecrease);
 			}
-			// Classified as FG Pixels
+			// Sort background model based on persistence
+			if (currWordPersistence > currLastWordPersistence) {
+				WordLayout<NbNo, Mono>::Swap(*BgWord(currModelIndex + currLocalWordIdx), *BgWord(currModelIndex + currLocalWordIdx - 1));
+				FollowSwappedWord(matchedWordIdx, currLocalWordIdx);
+			}
 			else {
-				(*currFGMask) = 255;
-				size_t nbMatchNo = 0;
-				if (clsNbMatchSwitch) {
-					// Compare with neighbor's model
-					// neighbor matching size (Max: 5x5)				
-					nbMatchNo = std::max(16.0f, std::floor((((*currDistThreshold) / 9) * 48)));
-
-					for (size_t nbIndex = 0; nbIndex < nbMatchNo; nbIndex++) {
-						// neighbor pixel pointer
-						size_t nbPxPointer = pxInfoLUTPtr[pxPointer].nbIndex[nbIndex].dataIndex;
-						// neighbor pixel's model index
-						const size_t nbModelIndex = pxInfoLUTPtr[pxPointer].nbIndex[nbIndex].modelIndex;
-						// Current neighbor pixel's matching threshold
-						int clsNBMatchThreshold = clsMatchThreshold;
-						// Number of potential matched model
-						int clsNBPotentialMatch = 0;
-						// Current neighbor distance threshold
-						float * nbDistThreshold = (float*)(resDistThreshold.data + (nbPxPointer * 4));
-						// neighbor LCD descriptor threshold
-						const double nbLCDPThreshold = std::min(clsLCDPMaxThreshold, std::max(clsLCDPThreshold, (std::pow(2, double((*nbDistThreshold))) / 512)));
-						// neighbor Up LCD descriptor threshold
-						const double nbUpLCDPThreshold = clsUpLCDPThreshold;
-						// neighbor RGB descriptor threshold
-						const double nbRGBThreshold = std::max(clsRGBThreshold, floor(clsRGBThreshold*(*nbDistThreshold)));
-
-						// Current Match Distance
-						float currMatchDistance = 1.0f;
-						int currMatchModel = 0;
-
-						float nbLastWordPersistence = FLT_MAX;
-						size_t nbLocalWordIdx = 0;
-						while ((nbLocalWordIdx < WORDS_NO) && (clsNBPotentialMatch < clsNBMatchThreshold)) {
-
-							bgWord = (bgWordPtr + nbModelIndex + nbLocalWordIdx);
-							GetLocalWordPersistence(*bgWord, frameIndex, descOffsetValue, currWordPersistence);
-							float tempLCDPDistance = 1.0f;
-							float tempRGBDistance = 1.0f;
-
-							bool matchResult = false;
-							bool matchBoth = false;
-
-							// False:Match true:Not match
-							DescriptorMatching(*bgWord, currWord, currDescNeighNo, nbLCDPThreshold, nbUpLCDPThreshold, nbRGBThreshold,
-								tempLCDPDistance, tempRGBDistance, matchResult, matchBoth);
-
-							if (!matchResult) {
-								if (std::rand() % (updateRate) == 0) {
-									if (tempLCDPDistance < (nbLCDPThreshold / 2)) {
-										for (size_t channel = 0; channel < 3; channel++) {
-											(*bgWord).rgb[channel] = currWord.rgb[channel];
-										}
-										for (size_t channel = 0; channel < 2; channel++) {
-											(*bgWord).LCDPColour[channel] = std::bitset<96>(currWord.LCDPColour[channel]);
-											(*bgWord).LCDPTexture[channel] = std::bitset<48>(currWord.LCDPTexture[channel]);
-										}
-									}
-								}
-								if (matchBoth) {
-									(*matchResultBoth) = 255;
-								}
-								(*bgWord).frameCount += 1;
-								(*bgWord).q = frameIndex;
-								clsNBPotentialMatch++;
-								if (currMatchDistance > ((tempLCDPDistance + tempRGBDistance) / 2.0f)) {
-									currMatchModel = nbLocalWordIdx;
-									currMatchDistance = ((tempLCDPDistance + tempRGBDistance) / 2.0f);
-								}
-							}
+				currLastWordPersistence = currWordPersistence;
+			}
+			++currLocalWordIdx;
+		}
 
-							// Update position of model in background model
-							if (currWordPersistence > nbLastWordPersistence) {
-								std::swap(bgWordPtr[nbModelIndex + nbLocalWordIdx], bgWordPtr[nbModelIndex + nbLocalWordIdx - 1]);
+		// Sorting remaining models
+		while (currLocalWordIdx < currWordsScanned) {
+			bgWord = BgWord(currModelIndex + currLocalWordIdx);
+			if (size_t(currLocalWordIdx) == hintWordIdx) {
+				currWordPersistence = hintWordPersistence;
+			}
+			else {
+				GetLocalWordPersistence(*bgWord, currStamp, descOffsetValue, currWordPersistence);
+			}
+			if (currWordPersistence > currLastWordPersistence) {
+				WordLayout<NbNo, Mono>::Swap(*BgWord(currModelIndex + currLocalWordIdx), *BgWord(currModelIndex + currLocalWordIdx - 1));
+				FollowSwappedWord(matchedWordIdx, currLocalWordIdx);
+			}
+			else {
+				currLastWordPersistence = currWordPersistence;
+			}
+			++currLocalWordIdx;
+		}
+		if (matchedWordIdx < currWordsScanned) {
+			matchHintWord[roiIndex] = (unsigned short)matchedWordIdx;
+		}
+		PROFILE_PIXEL_LAP(STAGE_MODEL_MATCH);
+		// Successful classified as BG Pixels
+		if (clsPotentialMatch >= clsMatchThreshold) {
+			(*currFGMask) = 0;
+			(*currDarkPixel) = 0;
+			// Replace Model from NB to the last model of bg word
+
+			cv::Point sampleCoor;
+			if (!upUse3x3Spread) {
+				getRandSamplePosition_5x5(sampleCoor, cv::Point(pxInfoLUTPtr[roiIndex].coor_x, pxInfoLUTPtr[roiIndex].coor_y), 0, frameSize, randomGenerator);
+			}
+			else {
+				getRandSamplePosition_3x3(sampleCoor, cv::Point(pxInfoLUTPtr[roiIndex].coor_x, pxInfoLUTPtr[roiIndex].coor_y), 0, frameSize, randomGenerator);
+			}
+			// Compact index of the sampled pixel (-1: outside the ROI, no model to update)
+			const int sampleRoiIndex = roiIndexMap.at<int>(sampleCoor.y, sampleCoor.x);
+			int randNum = int(randomGenerator() % ((sampleRoiIndex >= 0) ? wordCapacity[sampleRoiIndex] : wordsNo));
+			// Start index of the model of the current pixel
+			const size_t startNBModelIndex = (sampleRoiIndex >= 0) ? pxInfoLUTPtr[sampleRoiIndex].modelIndex : 0;
+			// Current pixel's update rate ('T(x)')
+			const size_t nbUpdateRate = (sampleRoiIndex >= 0) ? size_t(ceil(*((float*)(resUpdateRate.data + (sampleRoiIndex * 4))))) : 0;
+			if ((sampleRoiIndex >= 0) && (randomGenerator() % (nbUpdateRate * 2) == 0)) {
+				nbBgWord = BgWord(startNBModelIndex + randNum);
+				CopyDescriptor<NbNo, Mono>(*nbBgWord, currWord);
+				StampNewWord(*nbBgWord, GetWordStamp(sampleRoiIndex));
+			}
+			//(*currDynamicRate) = std::max(upMinDynamicRate, (*currDynamicRate) - upDynamicRateDecrease);
+		}
+		// Classified as FG Pixels
+		else {
+			(*currFGMask) = 255;
+			size_t nbMatchNo = 0;
+			if (NbMatch) {
+				// Compare with neighbor's model
+				// neighbor matching size (Max: 5x5)				
+				nbMatchNo = std::max(16.0f, std::floor((((*currDistThreshold) / 9) * 48)));
+				nbMatchNo = std::min(nbMatchNo, qualityLimits.maxNeighbourMatch);
+
+				// Neighbour slot whose model matched last, tried first
+				const size_t hintNbIndex = matchHintSwitch ? size_t(matchHintNb[roiIndex]) : nbMatchNo;
+				const bool nbHintValid = hintNbIndex < nbMatchNo;
+				for (size_t nbOrder = nbHintValid ? 0 : 1; nbOrder <= nbMatchNo; nbOrder++) {
+					// Order 0 is the hint, then the slots outwards without it
+					const size_t nbIndex = (nbOrder == 0) ? hintNbIndex : (nbOrder - 1);
+					if ((nbOrder > 0) && nbHintValid && (nbIndex == hintNbIndex)) {
+						continue;
+					}
+					// neighbor pixel's compact index (neighbours outside the ROI have no model)
+					const size_t nbRoiIndex = pxInfoLUTPtr[roiIndex].nbIndex[nbIndex].roiIndex;
+					if (nbRoiIndex == ROI_NONE) {
+						continue;
+					}
+					// neighbor pixel's model index and words scanned
+					const size_t nbModelIndex = pxInfoLUTPtr[nbRoiIndex].modelIndex;
+					const size_t nbWordsScanned = std::min(wordsScanned, size_t(wordCapacity[nbRoiIndex]));
+					// Current frame relative to the neighbour's epoch
+					const size_t nbStamp = GetWordStamp(nbRoiIndex);
+					// Current neighbor pixel's matching threshold
+					int clsNBMatchThreshold = clsMatchThreshold;
+					// Number of potential matched model
+					int clsNBPotentialMatch = 0;
+					// Current neighbor distance threshold
+					float * nbDistThreshold = (float*)(resDistThreshold.data + (nbRoiIndex * 4));
+					// neighbor LCD descriptor threshold
+					const double nbLCDPThreshold = std::min(clsLCDPMaxThreshold, std::max(clsLCDPThreshold, (std::pow(2, double((*nbDistThreshold))) / 512)));
+					// neighbor Up LCD descriptor threshold
+					const double nbUpLCDPThreshold = clsUpLCDPThreshold;
+					// neighbor RGB descriptor threshold
+					const double nbRGBThreshold = std::max(clsRGBThreshold, floor(clsRGBThreshold*(*nbDistThreshold)));
+
+					// Current Match Distance
+					float currMatchDistance = 1.0f;
+					int currMatchModel = 0;
+
+					float nbLastWordPersistence = FLT_MAX;
+					size_t nbLocalWordIdx = 0;
+					while ((nbLocalWordIdx < nbWordsScanned) && (clsNBPotentialMatch < clsNBMatchThreshold)) {
+
+						bgWord = BgWord(nbModelIndex + nbLocalWordIdx);
+						GetLocalWordPersistence(*bgWord, nbStamp, descOffsetValue, currWordPersistence);
+						float tempLCDPDistance = 1.0f;
+						float tempRGBDistance = 1.0f;
+
+						bool matchResult = false;
+						bool matchBoth = false;
+
+						// False:Match true:Not match
+						DescriptorMatching<LCDPDiff, RGBDiff, NbNo, Mono>(*bgWord, currWord, currDescNeighNo, nbLCDPThreshold, nbUpLCDPThreshold, nbRGBThreshold,
+							tempLCDPDistance, tempRGBDistance, matchResult, matchBoth);
+
+						if (!matchResult) {
+							if (randomGenerator() % (updateRate) == 0) {
+								if (tempLCDPDistance < (nbLCDPThreshold / 2)) {
+									CopyDescriptor<NbNo, Mono>(*bgWord, currWord);
+								}
 							}
-							else
-								nbLastWordPersistence = currWordPersistence;
-							++nbLocalWordIdx;
-						}
-						// Sorting remaining models
-						while (nbLocalWordIdx < WORDS_NO) {
-							bgWord = (bgWordPtr + nbModelIndex + nbLocalWordIdx);
-							GetLocalWordPersistence(*bgWord, frameIndex, descOffsetValue, currWordPersistence);
-							if (currWordPersistence > nbLastWordPersistence) {
-								std::swap(bgWordPtr[nbModelIndex + nbLocalWordIdx], bgWordPtr[nbModelIndex + nbLocalWordIdx - 1]);
+							if (matchBoth) {
+								(*matchResultBoth) = 255;
 							}
-							else {
-								nbLastWordPersistence = currWordPersistence;
+							StampWordOccurrence(*bgWord, nbStamp);
+							clsNBPotentialMatch++;
+							if (currMatchDistance > ((tempLCDPDistance + tempRGBDistance) / 2.0f)) {
+								currMatchModel = nbLocalWordIdx;
+								currMatchDistance = ((tempLCDPDistance + tempRGBDistance) / 2.0f);
 							}
-							++nbLocalWordIdx;
 						}
-						if (clsNBPotentialMatch >= clsNBMatchThreshold) {
-							(*currFGMask) = 0;
-							(*currDarkPixel) = 0;
-							break;
+
+						// Update position of model in background model
+						if (currWordPersistence > nbLastWordPersistence) {
+							WordLayout<NbNo, Mono>::Swap(*BgWord(nbModelIndex + nbLocalWordIdx), *BgWord(nbModelIndex + nbLocalWordIdx - 1));
 						}
+						else
+							nbLastWordPersistence = currWordPersistence;
+						++nbLocalWordIdx;
+					}
+					// Sorting remaining models
+					while (nbLocalWordIdx < nbWordsScanned) {
+						bgWord = BgWord(nbModelIndex + nbLocalWordIdx);
+						GetLocalWordPersistence(*bgWord, nbStamp, descOffsetValue, currWordPersistence);
+						if (currWordPersistence > nbLastWordPersistence) {
+							WordLayout<NbNo, Mono>::Swap(*BgWord(nbModelIndex + nbLocalWordIdx), *BgWord(nbModelIndex + nbLocalWordIdx - 1));
+						}
+						else {
+							nbLastWordPersistence = currWordPersistence;
+						}
+						++nbLocalWordIdx;
+					}
+					if (clsNBPotentialMatch >= clsNBMatchThreshold) {
+						(*currFGMask) = 0;
+						(*currDarkPixel) = 0;
+						matchHintNb[roiIndex] = (unsigned char)nbIndex;
+						break;
 					}
 				}
 			}
-			(*totalPersistence) = (*totalPersistence) > (*currPersistenceThreshold) ? (*currPersistenceThreshold) : (*totalPersistence);
+		}
+		PROFILE_PIXEL_LAP(STAGE_NEIGHBOUR_MATCH);
+		(*totalPersistence) = (*totalPersistence) > (*currPersistenceThreshold) ? (*currPersistenceThreshold) : (*totalPersistence);
+		
+		//// Update minimum distance
+		if (*currFGMask) {
+			//FG
+			float currNormalizedMinDist = 0.0f;
+			if (LCDPDiff) {
+				currNormalizedMinDist = std::max((((*currPersistenceThreshold) - (*totalPersistence)) / (*currPersistenceThreshold)), std::max(*minRGBDistance, *minLCDPDistance));
+			}
+			else {
+				currNormalizedMinDist = std::max((((*currPersistenceThreshold) - (*totalPersistence)) / (*currPersistenceThreshold)), *minRGBDistance);
+			}
 			
-			//// Update minimum distance
-			if (*currFGMask) {
-				//FG
-				float currNormalizedMinDist = 0.0f;
-				if (clsLCDPDiffSwitch) {
-					currNormalizedMinDist = std::max((((*currPersistenceThreshold) - (*totalPersistence)) / (*currPersistenceThreshold)), std::max(*minRGBDistance, *minLCDPDistance));
-				}
-				else {
-					currNormalizedMinDist = std::max((((*currPersistenceThreshold) - (*totalPersistence)) / (*currPersistenceThreshold)), *minRGBDistance);
-				}
-				
-				(*currPxDistance) = ((1 - MIN_DISTANCE_ALPHA)*(*currPxDistance)) + (MIN_DISTANCE_ALPHA*currNormalizedMinDist);
+			(*currPxDistance) = ((1 - MIN_DISTANCE_ALPHA)*(*currPxDistance)) + (MIN_DISTANCE_ALPHA*currNormalizedMinDist);
+		}
+		else {
+			//BG
+			float currNormalizedMinDist = 0.0f;
+			if (LCDPDiff) {
+				currNormalizedMinDist = std::max(*minRGBDistance, *minLCDPDistance);
 			}
 			else {
-				//BG
-				float currNormalizedMinDist = 0.0f;
-				if (clsLCDPDiffSwitch) {
-					currNormalizedMinDist = std::max(*minRGBDistance, *minLCDPDistance);
-				}
-				else {
-					currNormalizedMinDist = *minRGBDistance;
-				}
-				(*currPxDistance) = ((1 - MIN_DISTANCE_ALPHA)*(*currPxDistance)) + (MIN_DISTANCE_ALPHA*currNormalizedMinDist);
+				currNormalizedMinDist = *minRGBDistance;
 			}
+			(*currPxDistance) = ((1 - MIN_DISTANCE_ALPHA)*(*currPxDistance)) + (MIN_DISTANCE_ALPHA*currNormalizedMinDist);
+		}
 
-			if (upFeedbackSwitch) {
-				// Last foreground mask
-				uchar * lastFGMask = (resLastFGMask.data + pxPointer);
+		if (Feedback) {
+			// Last foreground mask
+			uchar * lastFGMask = (resLastFGMask.data + pxPointer);
 
-				bool check1 = ((*currPxDistance)< UNSTABLE_REG_RATIO_MIN) && (*currFGMask);
-				//bool check1 = (((*currPxDistance)< UNSTABLE_REG_RATIO_MIN) && (*currFGMask)) || !(*currFGMask);
+			bool check1 = ((*currPxDistance)< UNSTABLE_REG_RATIO_MIN) && (*currFGMask);
+			//bool check1 = (((*currPxDistance)< UNSTABLE_REG_RATIO_MIN) && (*currFGMask)) || !(*currFGMask);
 
-				//bool check2 = check1 && ((*currUpdateRate) < upLearningRateUpperCap);
-				if (check1) {
-					float valueIncrease = upUpdateRateIncrease / ((*currPxDistance)*(*currDynamicRate));
-					/*if (isinf(valueIncrease)) {
-					valueIncrease = 150;
-					}*/
-					(*currUpdateRate) = std::min(upLearningRateUpperCap, (*currUpdateRate) + valueIncrease);
-				}
-				//check2 = !check1 && ((*currUpdateRate) >= upLearningRateLowerCap);
-				if (!check1) {
-					float valueDecrease = ((upUpdateRateDecrease*(*currDynamicRate)) / (*currPxDistance));
-					/*if (isinf(valueDecrease)) {
-					valueDecrease = 10;
-					}*/
-
-					(*currUpdateRate) = std::max(upLearningRateLowerCap, (*currUpdateRate) - valueDecrease);
-				}
+			//bool check2 = check1 && ((*currUpdateRate) < upLearningRateUpperCap);
+			if (check1) {
+				float valueIncrease = upUpdateRateIncrease / ((*currPxDistance)*(*currDynamicRate));
+				/*if (isinf(valueIncrease)) {
+				valueIncrease = 150;
+				}*/
+				(*currUpdateRate) = std::min(upLearningRateUpperCap, (*currUpdateRate) + valueIncrease);
+			}
+			//check2 = !check1 && ((*currUpdateRate) >= upLearningRateLowerCap);
+			if (!check1) {
+				float valueDecrease = ((upUpdateRateDecrease*(*currDynamicRate)) / (*currPxDistance));
+				/*if (isinf(valueDecrease)) {
+				valueDecrease = 10;
+				}*/
+
+				(*currUpdateRate) = std::max(upLearningRateLowerCap, (*currUpdateRate) - valueDecrease);
+			}
 
-				if (((*currPxDistance)>UNSTABLE_REG_RATIO_MIN) && resBlinkFrame.data[pxPointer])
-					(*currDynamicRate) += bootstrapping ? upDynamicRateIncrease * 2 : upDynamicRateIncrease;
-				else
-					(*currDynamicRate) = std::max((*currDynamicRate) - upDynamicRateDecrease*((bootstrapping) ? 2 : resLastFGMask.data[pxPointer] ? 0.5f : 1), upDynamicRateDecrease);
+			if (((*currPxDistance)>UNSTABLE_REG_RATIO_MIN) && resBlinkFrame.data[pxPointer])
+				(*currDynamicRate) += bootstrapping ? upDynamicRateIncrease * 2 : upDynamicRateIncrease;
+			else
+				(*currDynamicRate) = std::max((*currDynamicRate) - upDynamicRateDecrease*((bootstrapping) ? 2 : resLastFGMask.data[pxPointer] ? 0.5f : 1), upDynamicRateDecrease);
 
-				check1 = (*currDistThreshold) < (std::pow((1.0f + ((*currPxDistance) * 2)), 2));
-				if (check1) {
-					(*currDistThreshold) += (*currDynamicRate)*0.01f;
-				}
-				else {
-					(*currDistThreshold) = std::max(1.0f, (*currDistThreshold) - (0.01f / (*currDynamicRate)));
-				}
-				// Top BG word
-				bgWord = (bgWordPtr + currModelIndex);
-				GetLocalWordPersistence(*bgWord, frameIndex, descOffsetValue, currWordPersistence);
-				(*currPersistenceThreshold) = currWordPersistence / ((*currDistThreshold) * 2);
+			check1 = (*currDistThreshold) < (std::pow((1.0f + ((*currPxDistance) * 2)), 2));
+			if (check1) {
+				(*currDistThreshold) += (*currDynamicRate)*0.01f;
+			}
+			else {
+				(*currDistThreshold) = std::max(1.0f, (*currDistThreshold) - (0.01f / (*currDynamicRate)));
 			}
+			// Top BG word
+			bgWord = BgWord(currModelIndex);
+			GetLocalWordPersistence(*bgWord, currStamp, descOffsetValue, currWordPersistence);
+			(*currPersistenceThreshold) = currWordPersistence / ((*currDistThreshold) * 2);
+		}
+		if (adaptiveModelSwitch) {
+			// Resize the model on its own-model result (neighbour matches do not count)
+			AdaptPixelWords(roiIndex, clsPotentialMatch >= clsMatchThreshold);
 		}
+		PROFILE_PIXEL_LAP(STAGE_FEEDBACK);
 	}
-	// POST PROCESSING
-	if (postSwitch) {
-		cv::bitwise_xor(resCurrFGMask, resLastRawFGMask, resCurrRawBlink);
-		cv::bitwise_or(resCurrRawBlink, resLastRawBlink, resBlinkFrame);
-		resCurrRawBlink.copyTo(resLastRawBlink);
-		cv::Mat element = cv::getStructuringElement(0, cv::Size(5, 5));
-		cv::Mat tempCurrFGMask;
-		resCurrFGMask.copyTo(tempCurrFGMask);
-
-		postCompensationResult = CompensationMotionHist(resT_1FGMask, resT_2FGMask, resCurrFGMask, postCompensationThreshold);
-		cv::Mat grad_x, grad_y, grad;
-		cv::Mat abs_grad_x, abs_grad_y;
-		int ddepth = CV_16S;
-		int scale = 1;
-		int delta = 0;
-		/// Gradient X
-		cv::Sobel(inputGrayImg, grad_x, ddepth, 1, 0, 3, scale, delta, cv::BORDER_DEFAULT);
-		/// Gradient Y
-		cv::Sobel(inputGrayImg, grad_y, ddepth, 0, 1, 3, scale, delta, cv::BORDER_DEFAULT);
-		convertScaleAbs(grad_x, abs_grad_x);
-		convertScaleAbs(grad_y, abs_grad_y);
-		addWeighted(abs_grad_x, 0.5, abs_grad_y, 0.5, 0, grad);
-
-		cv::Mat gradientResult, gradientResult2;
-
-		cv::inRange(grad, cv::Scalar(75), cv::Scalar(110), gradientResult);
-		//cv::bitwise_not(resDarkPixel, gradientResult2);
-		//cv::bitwise_and(gradientResult, gradientResult2, gradientResult);
-
-		cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 3);
-		cv::bitwise_not(gradientResult, gradientResult);
-		cv::bitwise_and(grad, gradientResult, gradientResult);
-		cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 1);
-		cv::inRange(grad, cv::Scalar(75), cv::Scalar(150), gradientResult2);
-		cv::dilate(gradientResult2, gradientResult2, cv::Mat(), cv::Point(-1, -1), 4);
-		//inputGrayImg.copyTo(gradientResult);
-		//cv::threshold(gradientResult, gradientResult, 80, 255, CV_THRESH_BINARY);
-		//cv::morphologyEx(gradientResult, gradientResult, cv::MORPH_GRADIENT, element);
-		//cv::Mat invDarkPixel;
-		//resDarkPixel.copyTo(invDarkPixel);
-		//cv::bitwise_not(invDarkPixel, invDarkPixel);
-		//cv::erode(invDarkPixel, invDarkPixel, cv::Mat(), cv::Point(-1, -1), 3);
-		//cv::dilate(invDarkPixel, invDarkPixel, cv::Mat(), cv::Point(-1, -1), 3);
-
-		//cv::bitwise_and(invDarkPixel, gradientResult, gradientResult);
-		//cv::bitwise_and(invDarkPixel, gradientResult2, gradientResult2);
-		//cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 5);
-		//cv::dilate(gradientResult2, gradientResult2, cv::Mat(), cv::Point(-1, -1), 5);
-		//cv::bitwise_not(gradientResult, gradientResult);
-		cv::bitwise_not(gradientResult2, gradientResult2);
-
-		// ADD NEW
-		cv::erode(resCurrFGMask, resCurrFGMask, cv::Mat(), cv::Point(-1, -1), 1);
-		cv::dilate(resCurrFGMask, resCurrFGMask, cv::Mat(), cv::Point(-1, -1), 1);
-		//cv::bitwise_and(resCurrFGMask, gradientResult, tempCurrFGMask);
-		cv::bitwise_and(resCurrFGMask, gradientResult2, tempCurrFGMask);
-		cv::erode(resDarkPixel, resDarkPixel, cv::Mat(), cv::Point(-1, -1), 3);
-		cv::dilate(resDarkPixel, resDarkPixel, cv::Mat(), cv::Point(-1, -1), 2);
-		cv::medianBlur(resDarkPixel, resDarkPixel, 3);
-		//cv::bitwise_or(tempCurrFGMask, resDarkPixel, gradientResult);
-		cv::bitwise_or(tempCurrFGMask, resDarkPixel, gradientResult2);
-		//cv::morphologyEx(gradientResult, gradientResult, cv::MORPH_CLOSE, element);
-		cv::morphologyEx(gradientResult2, gradientResult2, cv::MORPH_CLOSE, element);
-		//cv::dilate(gradientResult, gradientResult, cv::Mat(), cv::Point(-1, -1), 3);
-		cv::Mat reconstructLine = BorderLineReconst(gradientResult2);
-		cv::bitwise_or(tempCurrFGMask, reconstructLine, resFGMaskPreFlood);
-		//cv::bitwise_or(resDarkPixel, resFGMaskPreFlood, resFGMaskPreFlood);
-		cv::dilate(resFGMaskPreFlood, resFGMaskPreFlood, cv::Mat(), cv::Point(-1, -1), 3);
-		cv::morphologyEx(resFGMaskPreFlood, resFGMaskPreFlood, cv::MORPH_CLOSE, element);
-		resFGMaskFloodedHoles = ContourFill(resFGMaskPreFlood);
-		cv::bitwise_not(resMatchResultBoth, resMatchResultBoth);
-		cv::bitwise_and(resFGMaskFloodedHoles, resMatchResultBoth, resFGMaskFloodedHoles);
-		//cv::dilate(reconstructLine, reconstructLine, cv::Mat(), cv::Point(-1, -1), 3);
-		//cv::bitwise_not(reconstructLine, reconstructLine);
-		//cv::bitwise_and(reconstructLine, resFGMaskFloodedHoles, resFGMaskFloodedHoles);
-		cv::bitwise_or(resCurrFGMask, resFGMaskFloodedHoles, resCurrFGMask);
-		cv::bitwise_or(resCurrFGMask, postCompensationResult, resLastFGMask);
-
-
-		//cv::bitwise_and(gradientResult, resLastFGMask, resLastFGMask);
-		//cv::morphologyEx(resLastFGMask, resLastFGMask, cv::MORPH_CLOSE, element);
-		cv::medianBlur(resLastFGMask, resLastFGMask, postMedianFilterSize);
-		//cv::dilate(resLastFGMask, resLastFGMask, cv::Mat(), cv::Point(-1, -1), 2);
-
-		cv::dilate(resLastFGMask, resLastFGMaskDilated, cv::Mat(), cv::Point(-1, -1), 3);
-		cv::bitwise_and(resBlinkFrame, resLastFGMaskDilatedInverted, resBlinkFrame);
-		cv::bitwise_not(resLastFGMaskDilated, resLastFGMaskDilatedInverted);
-		cv::bitwise_and(resBlinkFrame, resLastFGMaskDilatedInverted, resBlinkFrame);
-		cv::medianBlur(resLastFGMask, resLastFGMask, postMedianFilterSize);
-		cv::morphologyEx(resLastFGMask, resLastFGMask, cv::MORPH_OPEN, element);
-		cv::morphologyEx(resLastFGMask, resLastFGMask, cv::MORPH_CLOSE, element);
-		resLastFGMask = ContourFill(resLastFGMask);
-		resLastFGMask.copyTo(resCurrFGMask);
-		resT_1FGMask.copyTo(resT_2FGMask);
-		resLastFGMask.copyTo(resT_1FGMask);
+}
+// Variants for every switch combination (bit 0: LCDP, bit 1: RGB, bit 2: neighbour matching, bit 3: feedback)
+template <int NbNo, bool Mono, size_t WordsNo, size_t... Variants>
+BackgroundSubtractorLCDP::ProcessPixelsFn BackgroundSubtractorLCDP::SelectProcessPixelsVariant(size_t variant, std::index_sequence<Variants...>)
+{
+	static const ProcessPixelsFn variants[] = {
+		&BackgroundSubtractorLCDP::ProcessPixels<(Variants & 1) != 0, (Variants & 2) != 0, (Variants & 4) != 0, (Variants & 8) != 0, NbNo, Mono, WordsNo>...
+	};
+	return variants[variant];
+}
+// Variant matching the switches, the neighbourhood, the channel count and the word count of this
+// instance (only the default neighbourhood on BGR frames gets a word count specialisation)
+BackgroundSubtractorLCDP::ProcessPixelsFn BackgroundSubtractorLCDP::SelectProcessPixels() const
+{
+	const size_t variant = (clsLCDPDiffSwitch ? 1 : 0) | (clsRGBDiffSwitch ? 2 : 0) | (clsNbMatchSwitch ? 4 : 0) | (upFeedbackSwitch ? 8 : 0);
+	const bool mono = (frameChannels == 1);
+	switch (descNbNo) {
+	case 8:
+		return mono ? SelectProcessPixelsVariant<8, true, 0>(variant, std::make_index_sequence<16>()) :
+			SelectProcessPixelsVariant<8, false, 0>(variant, std::make_index_sequence<16>());
+#if LCDP_MAX_DESC_NB >= 24
+	case 24:
+		return mono ? SelectProcessPixelsVariant<24, true, 0>(variant, std::make_index_sequence<16>()) :
+			SelectProcessPixelsVariant<24, false, 0>(variant, std::make_index_sequence<16>());
+#endif
+#if LCDP_MAX_DESC_NB >= 16
+	default:
+		if (mono) {
+			return SelectProcessPixelsVariant<16, true, 0>(variant, std::make_index_sequence<16>());
+		}
+		if (specialisedKernelSwitch && (WORDS_NO == PROCESS_SPECIALISED_WORDS_NO)) {
+			return SelectProcessPixelsVariant<16, false, PROCESS_SPECIALISED_WORDS_NO>(variant, std::make_index_sequence<16>());
+		}
+		return SelectProcessPixelsVariant<16, false, 0>(variant, std::make_index_sequence<16>());
+#else
+	default:
+		return mono ? SelectProcessPixelsVariant<8, true, 0>(variant, std::make_index_sequence<16>()) :
+			SelectProcessPixelsVariant<8, false, 0>(variant, std::make_index_sequence<16>());
+#endif
 	}
-	resCurrFGMask.copyTo(outputImg);
-	// Frame Index
-	frameIndex++;
-	// Reset minimum matching distance
-	resMinLCDPDistance = cv::Scalar(1.0f);
-	resMinRGBDistance = cv::Scalar(1.0f);
-	resTotalPersistence = cv::Scalar(0.0f);
-	resCurrFGMask = cv::Scalar_<uchar>::all(0);
-	resMatchResultBoth = cv::Scalar_<uchar>::all(0);
-	resLastGrayImg = (inputGrayImg + (resLastGrayImg*(frameIndex - 1))) / frameIndex;
 }
 
 /*=====DESCRIPTOR Methods=====*/
 // Descriptor Generator-Generate pixels' descriptor (RGB+LCDP)
+template <int NbNo, bool Mono>
 void BackgroundSubtractorLCDP::DescriptorGenerator(cv::Mat inputFrame,  PxInfo &pxInfoPtr,
 	DescriptorStruct &wordPtr)
 {
-	// Debug usage
-	float gray = 0.0f;
-	wordPtr.frameCount = 1;
-	for (int channel = 0; channel < 3; channel++) {
+	// A gray word keeps its intensity in rgb[0]
+	for (int channel = 0; channel < (Mono ? 1 : 3); channel++) {
 		wordPtr.rgb[channel] = inputFrame.data[pxInfoPtr.bgrDataIndex + channel];
-		gray += inputFrame.data[pxInfoPtr.bgrDataIndex + channel];
 	}
-	gray = gray / 3.0f;
-	wordPtr.p = frameIndex;
-	wordPtr.q = frameIndex;
-	wordPtr.gray = gray;
-	wordPtr.lastF = frameIndex;
-	wordPtr.nowF = frameIndex;
-	LCDGenerator(inputFrame, pxInfoPtr, wordPtr);
+	// Current words are never aged; background words are stamped when they are stored
+	StampNewWord(wordPtr, 0);
+	if (Mono) {
+		LCDGeneratorMono<NbNo>(inputFrame, pxInfoPtr, wordPtr);
+	}
+	else {
+		LCDGenerator<NbNo>(inputFrame, pxInfoPtr, wordPtr);
+	}
 }
 // Generate LCD Descriptor
+template <int NbNo>
 void BackgroundSubtractorLCDP::LCDGenerator(cv::Mat inputFrame, PxInfo &pxInfoPtr, DescriptorStruct &wordPtr)
 {
 	// Current pixel RGB intensity
@@ -838,12 +1365,12 @@ void BackgroundSubtractorLCDP::LCDGenerator(cv::Mat inputFrame, PxInfo &pxInfoPt
 
 	
 	// New ratio calculation method
-	double ratioBNB_GCURR = std::max(3.0, abs(double(descColourDiffRatio*(B_CURR - G_CURR))));
-	double ratioBNB_RCURR = std::max(3.0, abs(double(descColourDiffRatio*(B_CURR - R_CURR))));
-	double ratioGNB_BCURR = std::max(3.0, abs(double(descColourDiffRatio*(G_CURR - B_CURR))));
-	double ratioGNB_RCURR = std::max(3.0, abs(double(descColourDiffRatio*(G_CURR - R_CURR))));
-	double ratioRNB_BCURR = std::max(3.0, abs(double(descColourDiffRatio*(R_CURR - B_CURR))));
-	double ratioRNB_GCURR = std::max(3.0, abs(double(descColourDiffRatio*(R_CURR - G_CURR))));
+	double ratioBNB_GCURR = std::max(3.0, std::abs(double(descColourDiffRatio*(B_CURR - G_CURR))));
+	double ratioBNB_RCURR = std::max(3.0, std::abs(double(descColourDiffRatio*(B_CURR - R_CURR))));
+	double ratioGNB_BCURR = std::max(3.0, std::abs(double(descColourDiffRatio*(G_CURR - B_CURR))));
+	double ratioGNB_RCURR = std::max(3.0, std::abs(double(descColourDiffRatio*(G_CURR - R_CURR))));
+	double ratioRNB_BCURR = std::max(3.0, std::abs(double(descColourDiffRatio*(R_CURR - B_CURR))));
+	double ratioRNB_GCURR = std::max(3.0, std::abs(double(descColourDiffRatio*(R_CURR - G_CURR))));
 
 	ratioBNB_GCURR_MIN = std::max(-255.0, std::min((B_CURR - G_CURR) - ratioBNB_GCURR, (B_CURR - G_CURR) + ratioBNB_GCURR));
 	ratioBNB_RCURR_MIN = std::max(-255.0, std::min((B_CURR - R_CURR) - ratioBNB_RCURR, (B_CURR - R_CURR) + ratioBNB_RCURR));
@@ -873,11 +1400,10 @@ void BackgroundSubtractorLCDP::LCDGenerator(cv::Mat inputFrame, PxInfo &pxInfoPt
 
 	double tempBNB_GCURR, tempBNB_RCURR, tempGNB_BCURR, tempGNB_RCURR, tempRNB_BCURR, tempRNB_GCURR, tempBNB_BCURR,
 		tempGNB_GCURR, tempRNB_RCURR;
-	wordPtr.LCDPTexture[0].reset();
-	wordPtr.LCDPTexture[1].reset();
-	wordPtr.LCDPColour[0].reset();
-	wordPtr.LCDPColour[1].reset();
-	for (int nbPixelIndex = 0; nbPixelIndex < descNbNo; nbPixelIndex++) {
+	memset(wordPtr.LCDPBits, 0, sizeof(unsigned int) * WordLayout<NbNo>::BITS_PARTS);
+	unsigned int * colour[2] = { WordLayout<NbNo>::Colour(wordPtr, 0), WordLayout<NbNo>::Colour(wordPtr, 1) };
+	unsigned short * texture[2] = { WordLayout<NbNo>::Texture(wordPtr, 0), WordLayout<NbNo>::Texture(wordPtr, 1) };
+	for (int nbPixelIndex = 0; nbPixelIndex < NbNo; nbPixelIndex++) {
 		// Obtain neighborhood pixel's value
 		B_NB = inputFrame.data[pxInfoPtr.nbIndex[nbPixelIndex].bgrDataIndex];
 		G_NB = inputFrame.data[pxInfoPtr.nbIndex[nbPixelIndex].bgrDataIndex + 1];
@@ -888,104 +1414,196 @@ void BackgroundSubtractorLCDP::LCDGenerator(cv::Mat inputFrame, PxInfo &pxInfoPt
 		tempRNB_RCURR = R_NB - R_CURR;
 		//tempResult += ((tempRNB_RCURR > ratioRNB_RCURR_MAX) ? 65536 : ((tempRNB_RCURR < (ratioRNB_RCURR_MIN)) ? 196608 : 0));
 		if (tempRNB_RCURR > ratioRNB_RCURR_MAX) {
-			wordPtr.LCDPTexture[0].set(2 + (3 * nbPixelIndex));
+			SetPackedBit(texture[0], 2 + (3 * nbPixelIndex));
 		}
 		else if (tempRNB_RCURR < ratioRNB_RCURR_MIN) {
-			wordPtr.LCDPTexture[0].set(2 + (3 * nbPixelIndex));
-			wordPtr.LCDPTexture[1].set(2 + (3 * nbPixelIndex));
+			SetPackedBit(texture[0], 2 + (3 * nbPixelIndex));
+			SetPackedBit(texture[1], 2 + (3 * nbPixelIndex));
 		}
 
 		// G_NB - G_CURR
 		tempGNB_GCURR = G_NB - G_CURR;
 		//tempResult += ((tempGNB_GCURR > ratioGNB_GCURR_MAX) ? 16384 : ((tempGNB_GCURR < (ratioGNB_GCURR_MIN)) ? 49152 : 0));
 		if (tempGNB_GCURR > ratioGNB_GCURR_MAX) {
-			wordPtr.LCDPTexture[0].set(1 + (3 * nbPixelIndex));
+			SetPackedBit(texture[0], 1 + (3 * nbPixelIndex));
 		}
 		else if (tempGNB_GCURR < ratioGNB_GCURR_MIN) {
-			wordPtr.LCDPTexture[0].set(1 + (3 * nbPixelIndex));
-			wordPtr.LCDPTexture[1].set(1 + (3 * nbPixelIndex));
+			SetPackedBit(texture[0], 1 + (3 * nbPixelIndex));
+			SetPackedBit(texture[1], 1 + (3 * nbPixelIndex));
 		}
 		
 		// B_NB - B_CURR
 		tempBNB_BCURR = B_NB - B_CURR;
 		//tempResult += ((tempBNB_BCURR > ratioBNB_BCURR_MAX) ? 4096 : ((tempBNB_BCURR < (ratioBNB_BCURR_MIN)) ? 12288 : 0));
 		if (tempBNB_BCURR > ratioBNB_BCURR_MAX) {
-			wordPtr.LCDPTexture[0].set(3 * nbPixelIndex);
+			SetPackedBit(texture[0], 3 * nbPixelIndex);
 		}
 		else if (tempBNB_BCURR < ratioBNB_BCURR_MIN) {
-			wordPtr.LCDPTexture[0].set(3 * nbPixelIndex);
-			wordPtr.LCDPTexture[1].set(3 * nbPixelIndex);
+			SetPackedBit(texture[0], 3 * nbPixelIndex);
+			SetPackedBit(texture[1], 3 * nbPixelIndex);
 		}
 
 		// R_NB - G_CURR
 		tempRNB_GCURR = R_NB - G_CURR;
 		//tempResult += ((tempRNB_GCURR > ratioRNB_GCURR_MAX) ? 1024 : ((tempRNB_GCURR < (ratioRNB_GCURR_MIN)) ? 3072 : 0));
 		if (tempRNB_GCURR > ratioRNB_GCURR_MAX) {
-			wordPtr.LCDPColour[0].set(5 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 5 + (6 * nbPixelIndex));
 		}
 		else if (tempRNB_GCURR < ratioRNB_GCURR_MIN) {
-			wordPtr.LCDPColour[0].set(5 + (6 * nbPixelIndex));
-			wordPtr.LCDPColour[1].set(5 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 5 + (6 * nbPixelIndex));
+			SetPackedBit(colour[1], 5 + (6 * nbPixelIndex));
 		}
 		
 		// R_NB - B_CURR
 		tempRNB_BCURR = R_NB - B_CURR;
 		//tempResult += ((tempRNB_BCURR > ratioRNB_BCURR_MAX) ? 256 : ((tempRNB_BCURR < (ratioRNB_BCURR_MIN)) ? 768 : 0));
 		if (tempRNB_BCURR > ratioRNB_BCURR_MAX) {
-			wordPtr.LCDPColour[0].set(4 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 4 + (6 * nbPixelIndex));
 		}
 		else if (tempRNB_BCURR < ratioRNB_BCURR_MIN) {
-			wordPtr.LCDPColour[0].set(4 + (6 * nbPixelIndex));
-			wordPtr.LCDPColour[1].set(4 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 4 + (6 * nbPixelIndex));
+			SetPackedBit(colour[1], 4 + (6 * nbPixelIndex));
 		}
 
 		// G_NB - R_CURR
 		tempGNB_RCURR = G_NB - R_CURR;
 		//tempResult += ((tempGNB_RCURR > ratioGNB_RCURR_MAX) ? 64 : ((tempGNB_RCURR < (ratioGNB_RCURR_MIN)) ? 192 : 0));
 		if (tempGNB_RCURR > ratioGNB_RCURR_MAX) {
-			wordPtr.LCDPColour[0].set(3 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 3 + (6 * nbPixelIndex));
 		}
 		else if (tempGNB_RCURR < ratioGNB_RCURR_MIN) {
-			wordPtr.LCDPColour[0].set(3 + (6 * nbPixelIndex));
-			wordPtr.LCDPColour[1].set(3 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 3 + (6 * nbPixelIndex));
+			SetPackedBit(colour[1], 3 + (6 * nbPixelIndex));
 		}
 		// G_NB - B_CURR
 		tempGNB_BCURR = G_NB - B_CURR;
 		//tempResult += ((tempGNB_BCURR > ratioGNB_BCURR_MAX) ? 16 : ((tempGNB_BCURR < (ratioGNB_BCURR_MIN)) ? 48 : 0));
 		if (tempGNB_BCURR > ratioGNB_BCURR_MAX) {
-			wordPtr.LCDPColour[0].set(2 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 2 + (6 * nbPixelIndex));
 		}
 		else if (tempGNB_BCURR < ratioGNB_BCURR_MIN) {
-			wordPtr.LCDPColour[0].set(2 + (6 * nbPixelIndex));
-			wordPtr.LCDPColour[1].set(2 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 2 + (6 * nbPixelIndex));
+			SetPackedBit(colour[1], 2 + (6 * nbPixelIndex));
 		}
 
 		// B_NB - R_CURR
 		tempBNB_RCURR = B_NB - R_CURR;
 		//tempResult += ((tempBNB_RCURR > ratioBNB_RCURR_MAX) ? 4 : ((tempBNB_RCURR < (ratioBNB_RCURR_MIN)) ? 12 : 0));
 		if (tempBNB_RCURR > ratioBNB_RCURR_MAX) {
-			wordPtr.LCDPColour[0].set(1 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 1 + (6 * nbPixelIndex));
 		}
 		else if (tempBNB_RCURR < ratioBNB_RCURR_MIN) {
-			wordPtr.LCDPColour[0].set(1 + (6 * nbPixelIndex));
-			wordPtr.LCDPColour[1].set(1 + (6 * nbPixelIndex));
+			SetPackedBit(colour[0], 1 + (6 * nbPixelIndex));
+			SetPackedBit(colour[1], 1 + (6 * nbPixelIndex));
 		}
 		// B_NB - G_CURR
 		tempBNB_GCURR = B_NB - G_CURR;
 		//tempResult += ((tempBNB_GCURR > ratioBNB_GCURR_MAX) ? 1 : ((tempBNB_GCURR < (ratioBNB_GCURR_MIN)) ? 3 : 0));
 		if (tempBNB_GCURR > ratioBNB_GCURR_MAX) {
-			wordPtr.LCDPColour[0].set(6 * nbPixelIndex);
+			SetPackedBit(colour[0], 6 * nbPixelIndex);
 		}
 		else if (tempBNB_GCURR < ratioBNB_GCURR_MIN) {
-			wordPtr.LCDPColour[0].set(6 * nbPixelIndex);
-			wordPtr.LCDPColour[1].set(6 * nbPixelIndex);
+			SetPackedBit(colour[0], 6 * nbPixelIndex);
+			SetPackedBit(colour[1], 6 * nbPixelIndex);
 		}		
 	}
 }
+// Generate the texture-only LCD descriptor of a gray frame
+template <int NbNo>
+void BackgroundSubtractorLCDP::LCDGeneratorMono(cv::Mat inputFrame, PxInfo &pxInfoPtr, DescriptorStruct &wordPtr)
+{
+	// Current pixel's intensity and its differences thresholds (as for each BGR channel)
+	const int I_CURR = inputFrame.data[pxInfoPtr.bgrDataIndex];
+	const double ratioINB_ICURR = std::max(3.0, double(descColourDiffRatio*I_CURR));
+	const double ratioINB_ICURR_MIN = std::max(-255.0, -ratioINB_ICURR);
+	const double ratioINB_ICURR_MAX = std::min(255.0, ratioINB_ICURR);
+	// Gray words have no colour bits
+	unsigned short * texture[2] = { WordLayout<NbNo, true>::Texture(wordPtr, 0), WordLayout<NbNo, true>::Texture(wordPtr, 1) };
+	memset(wordPtr.LCDPBits, 0, sizeof(unsigned int) * WordLayout<NbNo, true>::BITS_PARTS);
+	for (int nbPixelIndex = 0; nbPixelIndex < NbNo; nbPixelIndex++) {
+		// I_NB - I_CURR
+		const double tempINB_ICURR = double(inputFrame.data[pxInfoPtr.nbIndex[nbPixelIndex].bgrDataIndex]) - I_CURR;
+		if (tempINB_ICURR > ratioINB_ICURR_MAX) {
+			SetPackedBit(texture[0], nbPixelIndex);
+		}
+		else if (tempINB_ICURR < ratioINB_ICURR_MIN) {
+			SetPackedBit(texture[0], nbPixelIndex);
+			SetPackedBit(texture[1], nbPixelIndex);
+		}
+	}
+}
+// Copy the intensities and LCDP bits of a word
+template <int NbNo, bool Mono>
+void BackgroundSubtractorLCDP::CopyDescriptor(DescriptorStruct &targetWord, const DescriptorStruct &sourceWord)
+{
+	for (size_t channel = 0; channel < (Mono ? 1 : 3); channel++) {
+		targetWord.rgb[channel] = sourceWord.rgb[channel];
+	}
+	memcpy(targetWord.LCDPBits, sourceWord.LCDPBits, sizeof(unsigned int) * WordLayout<NbNo, Mono>::BITS_PARTS);
+}
+// Descriptor of the current neighbourhood and channel count (outside the per-pixel loop)
+void BackgroundSubtractorLCDP::DescriptorGenerator(cv::Mat inputFrame, PxInfo &pxInfoPtr, DescriptorStruct &wordPtr)
+{
+	const bool mono = (frameChannels == 1);
+	switch (descNbNo) {
+	case 8:
+		mono ? DescriptorGenerator<8, true>(inputFrame, pxInfoPtr, wordPtr) : DescriptorGenerator<8, false>(inputFrame, pxInfoPtr, wordPtr);
+		break;
+#if LCDP_MAX_DESC_NB >= 24
+	case 24:
+		mono ? DescriptorGenerator<24, true>(inputFrame, pxInfoPtr, wordPtr) : DescriptorGenerator<24, false>(inputFrame, pxInfoPtr, wordPtr);
+		break;
+#endif
+#if LCDP_MAX_DESC_NB >= 16
+	default:
+		mono ? DescriptorGenerator<16, true>(inputFrame, pxInfoPtr, wordPtr) : DescriptorGenerator<16, false>(inputFrame, pxInfoPtr, wordPtr);
+		break;
+#else
+	default:
+		mono ? DescriptorGenerator<8, true>(inputFrame, pxInfoPtr, wordPtr) : DescriptorGenerator<8, false>(inputFrame, pxInfoPtr, wordPtr);
+		break;
+#endif
+	}
+}
 // Calculate word persistence value
-void BackgroundSubtractorLCDP::GetLocalWordPersistence(DescriptorStruct &wordPtr, size_t &currFrameIndex,
+void BackgroundSubtractorLCDP::GetLocalWordPersistence(DescriptorStruct &wordPtr, size_t currStamp,
 	size_t offsetValue, float &persistenceValue) {
-	persistenceValue = (float)(wordPtr.frameCount) / ((wordPtr.q - wordPtr.p) + ((currFrameIndex - wordPtr.q) * 2) + offsetValue);
+	persistenceValue = (float)(wordPtr.frameCount) / (wordPtr.span + ((currStamp - wordPtr.q) * 2) + offsetValue);
+}
+// Keep a word position up to date when the words at 'swapIndex' and 'swapIndex - 1' swap
+void BackgroundSubtractorLCDP::FollowSwappedWord(size_t &wordIndex, size_t swapIndex) {
+	if (wordIndex == swapIndex) {
+		wordIndex--;
+	}
+	else if (wordIndex + 1 == swapIndex) {
+		wordIndex++;
+	}
+}
+// Current frame relative to a pixel's epoch
+size_t BackgroundSubtractorLCDP::GetWordStamp(size_t roiIndex) const {
+	return frameIndex - wordEpoch[roiIndex];
+}
+// A new descriptor: seen once, now
+void BackgroundSubtractorLCDP::StampNewWord(DescriptorStruct &wordPtr, size_t currStamp) {
+	wordPtr.frameCount = 1;
+	wordPtr.q = (unsigned short)currStamp;
+	wordPtr.span = 0;
+}
+// A descriptor seen again now
+void BackgroundSubtractorLCDP::StampWordOccurrence(DescriptorStruct &wordPtr, size_t currStamp) {
+	wordPtr.frameCount += 1;
+	wordPtr.span = (unsigned short)std::min(size_t(0xFFFF), wordPtr.span + (currStamp - wordPtr.q));
+	wordPtr.q = (unsigned short)currStamp;
+}
+// Move a pixel's epoch forward before its stamps run out of 16 bits; only the idle time of
+// words last seen more than WORD_STAMP_REBASE_SHIFT frames before the new epoch is cut
+void BackgroundSubtractorLCDP::RebaseWordStamps(size_t roiIndex) {
+	const size_t modelIndex = pxInfoLUTPtr[roiIndex].modelIndex;
+	for (size_t wordIndex = 0; wordIndex < wordCapacity[roiIndex]; ++wordIndex) {
+		DescriptorStruct * word = BgWord(modelIndex + wordIndex);
+		(*word).q = ((*word).q > WORD_STAMP_REBASE_SHIFT) ? (unsigned short)((*word).q - WORD_STAMP_REBASE_SHIFT) : 0;
+	}
+	wordEpoch[roiIndex] += WORD_STAMP_REBASE_SHIFT;
 }
 
 /*=====LUT Methods=====*/
@@ -1003,9 +1621,12 @@ void BackgroundSubtractorLCDP::GenerateNbOffset(PxInfo &pxInfoPtr)
 		// Data index for neighborhood pixel's pointer
 		pxInfoPtr.nbIndex[nbIndex].dataIndex = ((pxInfoPtr.nbIndex[nbIndex].coor_y*(frameSize.width)) + (pxInfoPtr.nbIndex[nbIndex].coor_x));
 		// Data index for neighborhood pixel's BGR pointer
-		pxInfoPtr.nbIndex[nbIndex].bgrDataIndex = 3 * pxInfoPtr.nbIndex[nbIndex].dataIndex;
-		// Model index for neighborhood pixel
-		pxInfoPtr.nbIndex[nbIndex].modelIndex = WORDS_NO * pxInfoPtr.nbIndex[nbIndex].dataIndex;
+		pxInfoPtr.nbIndex[nbIndex].bgrDataIndex = frameChannels * pxInfoPtr.nbIndex[nbIndex].dataIndex;
+		// Compact index for neighborhood pixel
+		const int nbRoiIndex = roiIndexMap.at<int>(pxInfoPtr.nbIndex[nbIndex].coor_y, pxInfoPtr.nbIndex[nbIndex].coor_x);
+		pxInfoPtr.nbIndex[nbIndex].roiIndex = (nbRoiIndex >= 0) ? size_t(nbRoiIndex) : ROI_NONE;
+		// Neighbour models move when they grow; Process reads the neighbour's own entry
+		pxInfoPtr.nbIndex[nbIndex].modelIndex = 0;
 	}
 }
 // Generate LCD differences Lookup table (0: 100% Same -> 1: 100% Different)
@@ -1062,9 +1683,13 @@ void BackgroundSubtractorLCDP::GenerateLCDDiffLUT() {
 	//		LCDDiffLUTPtr[diffIndex]= ((countTexture / 3) + (countColour / 6)) / 2; 1 3   2 3  3 3  0 5
 
 	//}
-	for (int diffColourIndex = 0; diffColourIndex < 97; diffColourIndex++) {
-		for (int diffTextureIndex = 0; diffTextureIndex < 49; diffTextureIndex++) {
-			LCDDiffLUTPtr[diffColourIndex][diffTextureIndex] = ((float(diffColourIndex)/ 96.0f) + (float(diffTextureIndex) / 48.0f)) / 2.0f;
+	for (int variant = 0; variant < LCDP_MAX_DESC_NB / 8; variant++) {
+		// 8, 16 or 24 neighbours
+		const int nbNo = 8 * (variant + 1);
+		for (int diffColourIndex = 0; diffColourIndex <= 6 * nbNo; diffColourIndex++) {
+			for (int diffTextureIndex = 0; diffTextureIndex <= 3 * nbNo; diffTextureIndex++) {
+				LCDDiffLUTPtr[variant][diffColourIndex][diffTextureIndex] = ((float(diffColourIndex) / float(6 * nbNo)) + (float(diffTextureIndex) / float(3 * nbNo))) / 2.0f;
+			}
 		}
 	}
 
@@ -1072,28 +1697,34 @@ void BackgroundSubtractorLCDP::GenerateLCDDiffLUT() {
 
 /*=====MATCHING Methods=====*/ // Edited on 14 May 2017
 							   // Descriptor matching (RETURN: matchResult-1:Not match, 0: Match)
+template <bool LCDPDiff, bool RGBDiff, int NbNo, bool Mono>
 void BackgroundSubtractorLCDP::DescriptorMatching(DescriptorStruct &bgWord, DescriptorStruct &currWord
 	,  size_t &descNeighNo,  double LCDPThreshold,  double upLCDPThreshold,  double RGBThreshold,
 	float &LCDPDistance, float &RGBDistance, bool &matchResult, bool &matchResultBoth)
 {
 
 	// Match LCD descriptor
-	if (clsLCDPDiffSwitch) {
+	if (LCDPDiff) {
 		// LCD Matching (RETURN: LCDPResult-1:Not match, 0: Match)
-		LCDPMatching(bgWord, currWord, descNeighNo, LCDPThreshold, LCDPDistance, matchResult);
+		LCDPMatching<NbNo, Mono>(bgWord, currWord, descNeighNo, LCDPThreshold, LCDPDistance, matchResult);
 	}
 	// Match RGB descriptor
-	if (clsRGBDiffSwitch) {
+	if (RGBDiff) {
 		bool RGBResult = false;
 		// RGB Matching (RETURN: RGBResult-1:Not match, 0: Match)
-		RGBMatching(bgWord, currWord, RGBThreshold, RGBDistance, RGBResult);
+		RGBMatching<Mono>(bgWord, currWord, RGBThreshold, RGBDistance, RGBResult);
 
-		if (clsLCDPDiffSwitch) {
+		if (LCDPDiff) {
 			// LCDP BG and RGB FG
 			if (!matchResult == RGBResult) {
 				bool darkResult = false;
 				// Check dark pixel (RETURN-1:Not Dark Pixel, 0: Dark Pixel)
-				RGBDarkPixel(bgWord, currWord, darkResult);
+				if (Mono) {
+					LuminanceDarkPixel(bgWord, currWord, darkResult);
+				}
+				else {
+					RGBDarkPixel(bgWord, currWord, darkResult);
+				}
 				// If dark pixel, then it classify as shadow pixel
 				matchResult = (darkResult) ? true : false;
 			}
@@ -1112,8 +1743,23 @@ void BackgroundSubtractorLCDP::DescriptorMatching(DescriptorStruct &bgWord, Desc
 	}
 }
 // LCD Matching (RETURN-1:Not match, 0: Match)
+template <int NbNo, bool Mono>
 void BackgroundSubtractorLCDP::LCDPMatching(DescriptorStruct &bgWord, DescriptorStruct &currWord,
 	 size_t &descNeighNo, double &LCDPThreshold, float &minDistance, bool &matchResult) {
+	if (Mono) {
+		// Gray words: one texture bit pair per neighbour, no colour bits
+		size_t textureDiffNo = 0;
+		const unsigned short * bgTexture[2] = { WordLayout<NbNo, true>::Texture(bgWord, 0), WordLayout<NbNo, true>::Texture(bgWord, 1) };
+		const unsigned short * currTexture[2] = { WordLayout<NbNo, true>::Texture(currWord, 0), WordLayout<NbNo, true>::Texture(currWord, 1) };
+		for (int part = 0; part < WordLayout<NbNo, true>::TEXTURE_PARTS; part++) {
+			const unsigned int resultTexture1 = bgTexture[0][part] ^ currTexture[0][part];
+			const unsigned int resultTexture2 = (~resultTexture1) & (unsigned int)(bgTexture[1][part] ^ currTexture[1][part]);
+			textureDiffNo += BitCount(resultTexture1) + BitCount(resultTexture2);
+		}
+		minDistance = float(textureDiffNo) / float(NbNo);
+		matchResult = (minDistance > LCDPThreshold) ? true : false;
+		return;
+	}
 	float tempDistance = 0.0f;
 	//for (size_t neighbourIndex = 0; neighbourIndex < descNeighNo; neighbourIndex++) {
 	//	// Calculate the total number of bit that are different
@@ -1122,17 +1768,31 @@ void BackgroundSubtractorLCDP::LCDPMatching(DescriptorStruct &bgWord, Descriptor
 	//	tempDistance += LCDDiffLUTPtr[std::abs(bgWord.LCDP[neighbourIndex] - currWord.LCDP[neighbourIndex])];
 	//}
 
-	//XOR FIRST ROUND
-	std::bitset<96> resultColour1 = bgWord.LCDPColour[0]^currWord.LCDPColour[0];
-	std::bitset<96> resultColour2 = (~resultColour1)&(bgWord.LCDPColour[1]^currWord.LCDPColour[1]);
-	std::bitset<48> resultTexture1 = bgWord.LCDPTexture[0]^currWord.LCDPTexture[0];
-	std::bitset<48> resultTexture2 = (~resultTexture1)&(bgWord.LCDPTexture[1]^currWord.LCDPTexture[1]);
-	minDistance = LCDDiffLUTPtr[(resultColour1.count() + resultColour2.count())][(resultTexture1.count() + resultTexture2.count())];
+	//XOR FIRST ROUND (plane 1 only counts where plane 0 agrees); only the parts holding the
+	// first NbNo neighbours are compared
+	const unsigned int * bgColour[2] = { WordLayout<NbNo>::Colour(bgWord, 0), WordLayout<NbNo>::Colour(bgWord, 1) };
+	const unsigned int * currColour[2] = { WordLayout<NbNo>::Colour(currWord, 0), WordLayout<NbNo>::Colour(currWord, 1) };
+	const unsigned short * bgTexture[2] = { WordLayout<NbNo>::Texture(bgWord, 0), WordLayout<NbNo>::Texture(bgWord, 1) };
+	const unsigned short * currTexture[2] = { WordLayout<NbNo>::Texture(currWord, 0), WordLayout<NbNo>::Texture(currWord, 1) };
+	size_t colourDiffNo = 0;
+	for (int part = 0; part < WordLayout<NbNo>::COLOUR_PARTS; part++) {
+		const unsigned int resultColour1 = bgColour[0][part] ^ currColour[0][part];
+		const unsigned int resultColour2 = (~resultColour1) & (bgColour[1][part] ^ currColour[1][part]);
+		colourDiffNo += BitCount(resultColour1) + BitCount(resultColour2);
+	}
+	size_t textureDiffNo = 0;
+	for (int part = 0; part < WordLayout<NbNo>::TEXTURE_PARTS; part++) {
+		const unsigned int resultTexture1 = bgTexture[0][part] ^ currTexture[0][part];
+		const unsigned int resultTexture2 = (~resultTexture1) & (unsigned int)(bgTexture[1][part] ^ currTexture[1][part]);
+		textureDiffNo += BitCount(resultTexture1) + BitCount(resultTexture2);
+	}
+	minDistance = LCDDiffLUTPtr[(NbNo / 8) - 1][colourDiffNo][textureDiffNo];
 
 	//minDistance = tempDistance / descNeighNo;
 	matchResult = (minDistance > LCDPThreshold) ? true : false;
 }
 // RGB Matching (RETURN-1:Not match, 0: Match) Checked May 14
+template <bool Mono>
 void BackgroundSubtractorLCDP::RGBMatching(DescriptorStruct &bgWord, DescriptorStruct &currWord,
 	double &RGBThreshold, float &minDistance, bool &matchResult)
 {
@@ -1140,7 +1800,7 @@ void BackgroundSubtractorLCDP::RGBMatching(DescriptorStruct &bgWord, DescriptorS
 	// Maximum of color differences
 	uint distance = 255;
 	uint tempDistance = 0;
-	for (int channel = 0; channel < 3; channel++) {
+	for (int channel = 0; channel < (Mono ? 1 : 3); channel++) {
 		tempDistance = std::abs(bgWord.rgb[channel] - currWord.rgb[channel]);
 		// Update minimum distance
 		distance = tempDistance < distance ? tempDistance : distance;
@@ -1186,33 +1846,82 @@ void BackgroundSubtractorLCDP::RGBDarkPixel(DescriptorStruct &bgWord, Descriptor
 		//}
 	}
 }
+// Luminance Dark Pixel (RETURN-1:Not Dark Pixel, 0: Dark Pixel): without chromaticity a gray
+// pixel is a shadow when it is darker than the background within the intensity ratio bounds
+void BackgroundSubtractorLCDP::LuminanceDarkPixel(DescriptorStruct &bgWord, DescriptorStruct &currWord, bool &result)
+{
+	// A black background word has no shadow to cast
+	if (bgWord.rgb[0] == 0) {
+		result = true;
+		return;
+	}
+	const double IntensityRatio = double(currWord.rgb[0]) / double(bgWord.rgb[0]);
+	result = !((IntensityRatio < darkMaxIntensityRatio) && (IntensityRatio > darkMinIntensityRatio));
+}
 // Dark Pixel generator (RETURN-255: Not dark pixel, 0: dark pixel)
 void BackgroundSubtractorLCDP::DarkPixelGenerator(cv::Mat &inputGrayImg, cv::Mat &inputRGBImg,
 	cv::Mat &lastGrayImg, cv::Mat &lastRGBImg, cv::Mat &darkPixel) {
-	darkPixel = cv::Scalar_<uchar>::all(255);
+	// Pixels outside the ROI are never foreground evidence
+	darkPixel = cv::Scalar_<uchar>::all(0);
 	// Store the pixel's intensity values
 	double IntensityRatio, totalCurrIntensityValue, totalLastIntensityValue, currIntensityValue, lastIntensityValue, currRValue, lastRValue, currGValue, lastGValue, RDiff, GDiff;
 
-	for (size_t pxPointer = 0; pxPointer < frameInitTotalPixel; ++pxPointer) {
-		totalCurrIntensityValue = double(inputRGBImg.data[(pxPointer * 3)] + inputRGBImg.data[(pxPointer * 3) + 1] + inputRGBImg.data[(pxPointer * 3) + 2]);
-		totalLastIntensityValue = double(lastRGBImg.data[(pxPointer * 3)] + lastRGBImg.data[(pxPointer * 3) + 1] + lastRGBImg.data[(pxPointer * 3) + 2]);
-		currIntensityValue = totalCurrIntensityValue / 3.0;
-		lastIntensityValue = totalLastIntensityValue / 3.0;
-
-		IntensityRatio = (currIntensityValue / lastIntensityValue);
-
-		if ((IntensityRatio < darkMaxIntensityRatio) && (IntensityRatio > darkMinIntensityRatio)) {
-			lastRValue = double(lastRGBImg.data[(pxPointer * 3) + 2]) / totalLastIntensityValue;
-			currRValue = double(inputRGBImg.data[(pxPointer * 3) + 2]) / totalCurrIntensityValue;
-			lastGValue = double(lastRGBImg.data[(pxPointer * 3) + 1]) / totalLastIntensityValue;
-			currGValue = double(inputRGBImg.data[(pxPointer * 3) + 1]) / totalCurrIntensityValue;
-			RDiff = std::abs(lastRValue - currRValue);
-			GDiff = std::abs(lastGValue - currGValue);
-			if ((RDiff <= darkRDiffRatioMax) && (GDiff <= darkGDiffRatioMax)) {
-				if ((RDiff >= darkRDiffRatioMin) && (GDiff >= darkGDiffRatioMin)) {
+	for (size_t runIndex = 0; runIndex < roiRuns.size(); ++runIndex) {
+		const size_t runStart = (size_t(roiRuns[runIndex].row) * frameSize.width) + roiRuns[runIndex].colStart;
+		const size_t runEnd = runStart + (roiRuns[runIndex].colEnd - roiRuns[runIndex].colStart);
+		memset(darkPixel.data + runStart, 255, runEnd - runStart);
+		if (frameChannels == 1) {
+			// Gray frames: luminance ratio only
+			for (size_t pxPointer = runStart; pxPointer < runEnd; ++pxPointer) {
+				if (lastGrayImg.data[pxPointer] == 0) {
+					continue;
+				}
+				IntensityRatio = double(inputGrayImg.data[pxPointer]) / double(lastGrayImg.data[pxPointer]);
+				if ((IntensityRatio < darkMaxIntensityRatio) && (IntensityRatio > darkMinIntensityRatio)) {
 					darkPixel.data[pxPointer] = 0;
 				}
 			}
+			continue;
+		}
+		for (size_t pxPointer = runStart; pxPointer < runEnd; ++pxPointer) {
+			totalCurrIntensityValue = double(inputRGBImg.data[(pxPointer * 3)] + inputRGBImg.data[(pxPointer * 3) + 1] + inputRGBImg.data[(pxPointer * 3) + 2]);
+			totalLastIntensityValue = double(lastRGBImg.data[(pxPointer * 3)] + lastRGBImg.data[(pxPointer * 3) + 1] + lastRGBImg.data[(pxPointer * 3) + 2]);
+			currIntensityValue = totalCurrIntensityValue / 3.0;
+			lastIntensityValue = totalLastIntensityValue / 3.0;
+
+			IntensityRatio = (currIntensityValue / lastIntensityValue);
+
+			if ((IntensityRatio < darkMaxIntensityRatio) && (IntensityRatio > darkMinIntensityRatio)) {
+				lastRValue = double(lastRGBImg.data[(pxPointer * 3) + 2]) / totalLastIntensityValue;
+				currRValue = double(inputRGBImg.data[(pxPointer * 3) + 2]) / totalCurrIntensityValue;
+				lastGValue = double(lastRGBImg.data[(pxPointer * 3) + 1]) / totalLastIntensityValue;
+				currGValue = double(inputRGBImg.data[(pxPointer * 3) + 1]) / totalCurrIntensityValue;
+				RDiff = std::abs(lastRValue - currRValue);
+				GDiff = std::abs(lastGValue - currGValue);
+				if ((RDiff <= darkRDiffRatioMax) && (GDiff <= darkGDiffRatioMax)) {
+					if ((RDiff >= darkRDiffRatioMin) && (GDiff >= darkGDiffRatioMin)) {
+						darkPixel.data[pxPointer] = 0;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Mark the unchanged blocks of the change gate
+void BackgroundSubtractorLCDP::UpdateChangeGate(const cv::Mat &inputImg) {
+	cv::absdiff(inputImg, gateLastImg, gateDiffImg);
+	const int blockRowNo = (frameSize.height + gateBlockSize - 1) / gateBlockSize;
+	const int blockColNo = (frameSize.width + gateBlockSize - 1) / gateBlockSize;
+	gateStaticBlocks.create(blockRowNo, blockColNo, CV_8UC1);
+	for (int blockRow = 0; blockRow < blockRowNo; blockRow++) {
+		for (int blockCol = 0; blockCol < blockColNo; blockCol++) {
+			const cv::Rect block(blockCol * gateBlockSize, blockRow * gateBlockSize,
+				std::min(gateBlockSize, frameSize.width - (blockCol * gateBlockSize)),
+				std::min(gateBlockSize, frameSize.height - (blockRow * gateBlockSize)));
+			const cv::Scalar meanDiff = cv::mean(gateDiffImg(block));
+			const double maxDiff = std::max(meanDiff[0], std::max(meanDiff[1], meanDiff[2]));
+			gateStaticBlocks.at<uchar>(blockRow, blockCol) = (maxDiff <= gateNoiseThreshold) ? 255 : 0;
 		}
 	}
 }
@@ -1224,13 +1933,15 @@ cv::Mat BackgroundSubtractorLCDP::CompensationMotionHist(cv::Mat T_1FGMask, cv::
 	cv::Mat compensationResult;
 	compensationResult.create(frameSize, CV_8UC1);
 	compensationResult = cv::Scalar_<uchar>::all(0);
-	for (size_t pxPointer = 0; pxPointer < frameInitTotalPixel; pxPointer++) {
+	// Only ROI pixels are compensated
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		const size_t pxPointer = pxInfoLUTPtr[roiIndex].dataIndex;
 		if (!currFGMask.data[pxPointer]) {
 			double totalFGMask = 0.0;
 			for (size_t nbIndex = 0; nbIndex < 9; nbIndex++) {
-				totalFGMask += T_1FGMask.data[pxInfoLUTPtr[pxPointer].nbIndex[nbIndex].dataIndex];
-				totalFGMask += T_2FGMask.data[pxInfoLUTPtr[pxPointer].nbIndex[nbIndex].dataIndex];
-				totalFGMask += currFGMask.data[pxInfoLUTPtr[pxPointer].nbIndex[nbIndex].dataIndex];
+				totalFGMask += T_1FGMask.data[pxInfoLUTPtr[roiIndex].nbIndex[nbIndex].dataIndex];
+				totalFGMask += T_2FGMask.data[pxInfoLUTPtr[roiIndex].nbIndex[nbIndex].dataIndex];
+				totalFGMask += currFGMask.data[pxInfoLUTPtr[roiIndex].nbIndex[nbIndex].dataIndex];
 			}
 			totalFGMask /= 255.0;
 			compensationResult.data[pxPointer] = ((totalFGMask / 26.0) > postCompensationThreshold) ? 255 : 0;
@@ -1390,8 +2101,7 @@ void BackgroundSubtractorLCDP::SaveParameter(std::string versionFolderName, std:
 	myfile << "\nMaximum of LCD differences threshold:";
 	myfile << clsLCDPMaxThreshold;
 	myfile << "\nInitial matched persistence value threshold:";
-	float * persistenceThreshold = (float*)(clsPersistenceThreshold.data);
-	myfile << *(persistenceThreshold);
+	myfile << clsMinPersistenceThreshold;
 	myfile << "\nNeighbourhood matching switch:";
 	myfile << clsNbMatchSwitch;
 	myfile << "\nClassify matching threshold:";
@@ -1434,4 +2144,654 @@ void BackgroundSubtractorLCDP::SaveParameter(std::string versionFolderName, std:
 	myfile << WORDS_NO;
 	
 	myfile.close();
-}
\ No newline at end of file
+}
+
+/*=====PROFILING Methods=====*/
+// Names of the Process stages
+std::vector<std::string> BackgroundSubtractorLCDP::GetProcessStageNames() {
+	const char * stageNames[PROCESS_STAGE_NO] = { "INPUT", "PRE BLUR", "CHANGE GATE", "DARK PIXEL",
+		"DESCRIPTOR", "MODEL MATCH", "NEIGHBOUR MATCH", "FEEDBACK",
+		"POST BLINK", "POST COMPENSATION", "POST GRADIENT", "POST MORPHOLOGY",
+		"POST BORDERLINE", "POST CONTOUR FILL", "POST MEDIAN", "OUTPUT" };
+	return std::vector<std::string>(stageNames, stageNames + PROCESS_STAGE_NO);
+}
+// Attach a profiler
+void BackgroundSubtractorLCDP::SetProfiler(Profiler *inputProfiler) {
+	profiler = inputProfiler;
+}
+
+/*=====RANDOM Methods=====*/
+// Seed of the random updates
+void BackgroundSubtractorLCDP::SetRandomSeed(unsigned int seed) {
+	randomSeed = seed;
+}
+
+/*=====OPTIMISATION Methods=====*/
+// Turn Process optimisations off (call before Initialize)
+void BackgroundSubtractorLCDP::SetOptimisations(bool matchHints, bool specialisedKernels, bool compactWords) {
+	if (bgWordPtr != nullptr) {
+		std::cout << "The optimisations have to be set before Initialize." << std::endl;
+		return;
+	}
+	matchHintSwitch = matchHints;
+	specialisedKernelSwitch = specialisedKernels;
+	compactWordSwitch = compactWords;
+	processPixelsFn = SelectProcessPixels();
+}
+
+/*=====CHANGE GATE Methods=====*/
+// Skip unchanged blocks
+void BackgroundSubtractorLCDP::SetChangeGate(int blockSize, float noiseThreshold, size_t fullPassInterval) {
+	gateBlockSize = std::max(0, blockSize);
+	gateNoiseThreshold = std::max(0.0f, noiseThreshold);
+	gateFullPassInterval = fullPassInterval;
+	gateLastImg.release();
+	gateSkippedFraction = 0.0;
+}
+// Fraction of the ROI pixels skipped in the last frame
+double BackgroundSubtractorLCDP::GetSkippedFraction() const {
+	return gateSkippedFraction;
+}
+// Skipped fraction of every gated frame
+const std::vector<float> & BackgroundSubtractorLCDP::GetSkippedFractions() const {
+	return gateSkippedLog;
+}
+
+/*=====DEGRADATION Methods=====*/
+// Limits that leave Process unchanged
+BackgroundSubtractorLCDP::QualityLimits BackgroundSubtractorLCDP::FullQuality() {
+	QualityLimits limits;
+	limits.maxNeighbourMatch = SIZE_MAX;
+	limits.maxWordsScanned = SIZE_MAX;
+	limits.skipBorderLine = false;
+	limits.skipContourFill = false;
+	limits.medianFilterSize = 0;
+	return limits;
+}
+// Limits applied from the next Process call on
+void BackgroundSubtractorLCDP::SetQualityLimits(const QualityLimits &limits) {
+	qualityLimits = limits;
+}
+
+/*=====CHECKPOINT Methods=====*/
+// Copy a continuous matrix into a checkpoint section
+static void CopyMatToSection(const cv::Mat &mat, std::vector<uchar> &section) {
+	section.resize(mat.total() * mat.elemSize());
+	if (!section.empty()) {
+		memcpy(section.data(), mat.data, section.size());
+	}
+}
+// Copy a checkpoint section into a matrix of the same size and type (RETURN-true: sizes match)
+static bool CopySectionToMat(const CheckpointReader &reader, int section, cv::Mat &mat) {
+	size_t size;
+	const uchar * data = reader.GetSection(section, size);
+	if ((data == nullptr) || !mat.isContinuous() || (size != mat.total() * mat.elemSize())) {
+		return false;
+	}
+	memcpy(mat.data, data, size);
+	return true;
+}
+// Copy the learnt state into a snapshot
+void BackgroundSubtractorLCDP::CaptureCheckpoint(ModelCheckpoint::Snapshot &snapshot) const {
+	snapshot.header.rows = (unsigned int)frameSize.height;
+	snapshot.header.cols = (unsigned int)frameSize.width;
+	snapshot.header.wordsNo = (unsigned int)WORDS_NO;
+	snapshot.header.wordSize = (unsigned int)wordSize;
+	snapshot.header.frameIndex = frameIndex;
+	// The descriptor bits only mean something for the same neighbourhood
+	std::vector<uchar> &descriptor = snapshot.sections[ModelCheckpoint::SECTION_DESCRIPTOR];
+	const unsigned int descriptorNbNo = (unsigned int)descNbNo;
+	descriptor.resize(sizeof(descriptorNbNo));
+	memcpy(descriptor.data(), &descriptorNbNo, sizeof(descriptorNbNo));
+	// Words of each pixel back to back, in ROI order
+	std::vector<uchar> &words = snapshot.sections[ModelCheckpoint::SECTION_BG_WORDS];
+	std::vector<uchar> &capacities = snapshot.sections[ModelCheckpoint::SECTION_WORD_CAPACITY];
+	words.resize(wordSize*wordPool.GetUsedWords());
+	capacities.resize(sizeof(unsigned short)*frameRoiTotalPixel);
+	size_t wordsOffset = 0;
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		const size_t capacityBytes = wordSize*wordCapacity[roiIndex];
+		memcpy(words.data() + wordsOffset, BgWord(pxInfoLUTPtr[roiIndex].modelIndex), capacityBytes);
+		wordsOffset += capacityBytes;
+	}
+	if (!capacities.empty()) {
+		memcpy(capacities.data(), wordCapacity.data(), capacities.size());
+	}
+	// Word stamps are relative to the pixel epochs
+	std::vector<uchar> &epochs = snapshot.sections[ModelCheckpoint::SECTION_WORD_EPOCH];
+	epochs.resize(sizeof(unsigned long long)*frameRoiTotalPixel);
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		const unsigned long long epoch = wordEpoch[roiIndex];
+		memcpy(epochs.data() + (roiIndex * sizeof(epoch)), &epoch, sizeof(epoch));
+	}
+	CopyMatToSection(clsPersistenceThreshold, snapshot.sections[ModelCheckpoint::SECTION_PERSISTENCE_THRESHOLD]);
+	CopyMatToSection(resDistThreshold, snapshot.sections[ModelCheckpoint::SECTION_DIST_THRESHOLD]);
+	CopyMatToSection(resDynamicRate, snapshot.sections[ModelCheckpoint::SECTION_DYNAMIC_RATE]);
+	CopyMatToSection(resUpdateRate, snapshot.sections[ModelCheckpoint::SECTION_UPDATE_RATE]);
+	CopyMatToSection(resLastImg, snapshot.sections[ModelCheckpoint::SECTION_LAST_IMG]);
+	CopyMatToSection(resLastGrayImg, snapshot.sections[ModelCheckpoint::SECTION_LAST_GRAY_IMG]);
+	CopyMatToSection(resLastFGMask, snapshot.sections[ModelCheckpoint::SECTION_LAST_FG_MASK]);
+	CopyMatToSection(resLastRawBlink, snapshot.sections[ModelCheckpoint::SECTION_LAST_RAW_BLINK]);
+	CopyMatToSection(resBlinkFrame, snapshot.sections[ModelCheckpoint::SECTION_BLINK_FRAME]);
+	CopyMatToSection(resT_1FGMask, snapshot.sections[ModelCheckpoint::SECTION_T_1_FG_MASK]);
+	CopyMatToSection(resT_2FGMask, snapshot.sections[ModelCheckpoint::SECTION_T_2_FG_MASK]);
+	CopyMatToSection(resLastFGMaskDilatedInverted, snapshot.sections[ModelCheckpoint::SECTION_LAST_FG_MASK_DILATED_INVERTED]);
+	CopyMatToSection(frameRoi, snapshot.sections[ModelCheckpoint::SECTION_ROI]);
+}
+// Replace the learnt state after Initialize
+bool BackgroundSubtractorLCDP::RestoreCheckpoint(const CheckpointReader &reader) {
+	const ModelCheckpoint::Header &header = reader.GetHeader();
+	size_t wordsSize;
+	const uchar * words = reader.GetSection(ModelCheckpoint::SECTION_BG_WORDS, wordsSize);
+	size_t capacitiesSize;
+	const uchar * capacities = reader.GetSection(ModelCheckpoint::SECTION_WORD_CAPACITY, capacitiesSize);
+	size_t epochsSize;
+	const uchar * epochs = reader.GetSection(ModelCheckpoint::SECTION_WORD_EPOCH, epochsSize);
+	if ((bgWordPtr == nullptr) || (header.rows != (unsigned int)frameSize.height) || (header.cols != (unsigned int)frameSize.width) ||
+		(header.wordsNo != WORDS_NO) || (header.wordSize != wordSize) ||
+		(words == nullptr) || (capacitiesSize != sizeof(unsigned short)*frameRoiTotalPixel) ||
+		(epochsSize != sizeof(unsigned long long)*frameRoiTotalPixel)) {
+		return false;
+	}
+	size_t descriptorSize;
+	const uchar * descriptor = reader.GetSection(ModelCheckpoint::SECTION_DESCRIPTOR, descriptorSize);
+	unsigned int descriptorNbNo = 0;
+	if ((descriptor != nullptr) && (descriptorSize == sizeof(descriptorNbNo))) {
+		memcpy(&descriptorNbNo, descriptor, sizeof(descriptorNbNo));
+	}
+	if (descriptorNbNo != (unsigned int)descNbNo) {
+		std::cout << "Checkpoint was saved with a different descriptor neighbourhood." << std::endl;
+		return false;
+	}
+	// The words and float maps are stored per ROI pixel, so the ROI has to be the same
+	size_t roiSize;
+	const uchar * roi = reader.GetSection(ModelCheckpoint::SECTION_ROI, roiSize);
+	if ((roi == nullptr) || (roiSize != frameInitTotalPixel) || (memcmp(roi, frameRoi.data, roiSize) != 0)) {
+		std::cout << "Checkpoint was saved with a different ROI." << std::endl;
+		return false;
+	}
+	// Every capacity has to be a size class of this model and the words have to fit the pool
+	std::vector<unsigned short> restoredCapacity(frameRoiTotalPixel);
+	if (capacitiesSize > 0) {
+		memcpy(restoredCapacity.data(), capacities, capacitiesSize);
+	}
+	size_t restoredWords = 0;
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		const size_t capacity = restoredCapacity[roiIndex];
+		if ((capacity < wordMinCapacity) || (wordPool.ClassCapacity(capacity) != capacity)) {
+			std::cout << "Checkpoint was saved with a different adaptive model setting." << std::endl;
+			return false;
+		}
+		restoredWords += capacity;
+	}
+	if ((wordsSize != wordSize*restoredWords) || (restoredWords > wordPool.GetTotalWords())) {
+		std::cout << "Checkpoint model does not fit the model budget." << std::endl;
+		return false;
+	}
+	// Every section is checked before the model is touched
+	const cv::Mat * targets[ModelCheckpoint::CHECKPOINT_SECTION_NO] = { nullptr,
+		&clsPersistenceThreshold, &resDistThreshold, &resDynamicRate, &resUpdateRate, &resLastImg, &resLastGrayImg,
+		&resLastFGMask, &resLastRawBlink, &resBlinkFrame, &resT_1FGMask, &resT_2FGMask, &resLastFGMaskDilatedInverted, &frameRoi, nullptr, nullptr, nullptr };
+	for (int section = 1; section < ModelCheckpoint::CHECKPOINT_SECTION_NO; section++) {
+		size_t size;
+		reader.GetSection(section, size);
+		if ((targets[section] != nullptr) && (size != targets[section]->total() * targets[section]->elemSize())) {
+			return false;
+		}
+	}
+	// Re-carve the pool in ROI order
+	ResetWordPool();
+	size_t wordsOffset = 0;
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		AllocatePixelWords(roiIndex, restoredCapacity[roiIndex]);
+		memcpy(BgWord(pxInfoLUTPtr[roiIndex].modelIndex), words + wordsOffset, wordSize*restoredCapacity[roiIndex]);
+		wordsOffset += wordSize*restoredCapacity[roiIndex];
+		unsigned long long epoch;
+		memcpy(&epoch, epochs + (roiIndex * sizeof(epoch)), sizeof(epoch));
+		wordEpoch[roiIndex] = size_t(epoch);
+	}
+	bool success = CopySectionToMat(reader, ModelCheckpoint::SECTION_PERSISTENCE_THRESHOLD, clsPersistenceThreshold);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_DIST_THRESHOLD, resDistThreshold);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_DYNAMIC_RATE, resDynamicRate);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_UPDATE_RATE, resUpdateRate);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_LAST_IMG, resLastImg);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_LAST_GRAY_IMG, resLastGrayImg);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_LAST_FG_MASK, resLastFGMask);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_LAST_RAW_BLINK, resLastRawBlink);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_BLINK_FRAME, resBlinkFrame);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_T_1_FG_MASK, resT_1FGMask);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_T_2_FG_MASK, resT_2FGMask);
+	success &= CopySectionToMat(reader, ModelCheckpoint::SECTION_LAST_FG_MASK_DILATED_INVERTED, resLastFGMaskDilatedInverted);
+	frameIndex = size_t(header.frameIndex);
+	reinterpret_cast<StorageHeader*>(bgWordStorage.Data())->frameIndex = frameIndex;
+	// The previous frame belongs to another run
+	gateLastImg.release();
+	return success;
+}
+// Save a checkpoint file
+bool BackgroundSubtractorLCDP::SaveCheckpoint(const std::string &fileName) const {
+	ModelCheckpoint::Snapshot snapshot;
+	CaptureCheckpoint(snapshot);
+	return ModelCheckpoint::Save(fileName, snapshot);
+}
+// Load a checkpoint file
+bool BackgroundSubtractorLCDP::LoadCheckpoint(const std::string &fileName) {
+	CheckpointReader reader;
+	return reader.Open(fileName) && RestoreCheckpoint(reader);
+}
+// Frame index reached by the model
+size_t BackgroundSubtractorLCDP::GetFrameIndex() const {
+	return frameIndex;
+}
+
+/*=====DESCRIPTOR Methods=====*/
+// Descriptor neighbourhood (the neighbour offsets are ordered 3x3 ring, 5x5 corners and edge
+// centres, rest of the 5x5, so the first 8, 16 or 24 form each neighbourhood)
+bool BackgroundSubtractorLCDP::SetDescriptorNeighbours(int nbNo) {
+	if (((nbNo != 8) && (nbNo != 16) && (nbNo != 24)) || (nbNo > LCDP_MAX_DESC_NB)) {
+		std::cout << "Unsupported descriptor neighbourhood: " << nbNo << " (8, 16 or 24, up to " << LCDP_MAX_DESC_NB << ")" << std::endl;
+		return false;
+	}
+	descNbNo = nbNo;
+	descNbSize = (nbNo == 8) ? 3 : 5;
+	processPixelsFn = SelectProcessPixels();
+	return true;
+}
+// Total number of descriptor neighbours
+int BackgroundSubtractorLCDP::GetDescriptorNeighbours() const {
+	return descNbNo;
+}
+// Gray frames
+bool BackgroundSubtractorLCDP::IsSingleChannel() const {
+	return frameChannels == 1;
+}
+
+/*=====STORAGE Methods=====*/
+// Place the background words in a mapped file or shared-memory segment
+void BackgroundSubtractorLCDP::SetModelStorage(ModelStorage::Backend backend, const std::string &name) {
+	modelStorageBackend = backend;
+	modelStorageName = name;
+}
+// Page size of the per-pixel arrays
+void BackgroundSubtractorLCDP::SetPageSize(ModelStorage::PageSize inputPageSize) {
+	pageSize = inputPageSize;
+}
+// Reserved huge pages back the model
+bool BackgroundSubtractorLCDP::UsesReservedHugePages() const {
+	return bgWordStorage.UsesReservedHugePages();
+}
+// Backend holding the model
+ModelStorage::Backend BackgroundSubtractorLCDP::GetModelStorageBackend() const {
+	return bgWordStorage.GetBackend();
+}
+// Size of one background word for a descriptor neighbourhood and channel count
+size_t BackgroundSubtractorLCDP::GetWordSize(int nbNo, bool mono) {
+	switch (nbNo) {
+	case 8:
+		return mono ? WordLayout<8, true>::Size() : WordLayout<8>::Size();
+#if LCDP_MAX_DESC_NB >= 16
+	case 16:
+		return mono ? WordLayout<16, true>::Size() : WordLayout<16>::Size();
+#endif
+#if LCDP_MAX_DESC_NB >= 24
+	case 24:
+		return mono ? WordLayout<24, true>::Size() : WordLayout<24>::Size();
+#endif
+	default:
+		return sizeof(DescriptorStruct);
+	}
+}
+
+/*=====ADAPTIVE MODEL Methods=====*/
+// Per-pixel word capacity (call before Initialize)
+void BackgroundSubtractorLCDP::SetAdaptiveModel(bool adaptiveSwitch, size_t budgetBytes) {
+	if (bgWordPtr != nullptr) {
+		std::cout << "The adaptive model has to be set before Initialize." << std::endl;
+		return;
+	}
+	adaptiveModelSwitch = adaptiveSwitch;
+	modelBudgetBytes = budgetBytes;
+	if (adaptiveModelSwitch) {
+		// A pixel always keeps enough words to be classified as background
+		const size_t minWords = std::max(size_t(ADAPTIVE_WORD_STEP), size_t(std::max(1, clsMatchThreshold)));
+		wordMinCapacity = std::min(WORDS_NO, ((minWords + ADAPTIVE_WORD_STEP - 1) / ADAPTIVE_WORD_STEP) * ADAPTIVE_WORD_STEP);
+		wordInitialCapacity = std::max(wordMinCapacity, std::min(WORDS_NO, size_t(ADAPTIVE_INITIAL_WORDS)));
+	}
+	else {
+		wordMinCapacity = WORDS_NO;
+		wordInitialCapacity = WORDS_NO;
+	}
+}
+// Mean number of words per ROI pixel
+double BackgroundSubtractorLCDP::GetAverageWordCapacity() const {
+	return (frameRoiTotalPixel > 0) ? (double(wordPool.GetUsedWords()) / frameRoiTotalPixel) : 0.0;
+}
+// Print pool usage and capacity changes
+void BackgroundSubtractorLCDP::PrintModelStats(std::ostream &output) const {
+	output << "Words per pixel: " << GetAverageWordCapacity() << " (max " << WORDS_NO << ")" << std::endl;
+	output << "Pool: " << wordPool.GetUsedWords() << "/" << wordPool.GetTotalWords() << " words, "
+		<< (wordPool.GetTotalWords() * wordSize) / (1024 * 1024) << " MB" << std::endl;
+	output << "Grown: " << wordGrowNo << ", shrunk: " << wordShrinkNo << ", growths refused by the budget: " << wordGrowFailedNo << std::endl;
+}
+
+/*=====REDUCED RESOLUTION Methods=====*/
+// Upsample a reduced-resolution mask with a colour-guided filter (He et al.): inside every
+// window the output is a linear function of the full-resolution colour, so mask boundaries
+// that fall between two coarse pixels move onto the nearest colour edge.
+void BackgroundSubtractorLCDP::UpsampleMask(const cv::Mat &mask, const cv::Mat &guideImg, cv::Mat &outputMask)
+{
+	const cv::Size windowSize(2 * UPSAMPLE_RADIUS_PER_SCALE * processScale + 1, 2 * UPSAMPLE_RADIUS_PER_SCALE * processScale + 1);
+	cv::Mat guide, maskUp;
+	guideImg.convertTo(guide, CV_32FC3, 1.0 / 255.0);
+	cv::resize(mask, maskUp, fullFrameSize, 0, 0, cv::INTER_LINEAR);
+	maskUp.convertTo(maskUp, CV_32FC1, 1.0 / 255.0);
+	if (guide.channels() == 1) {
+		UpsampleMaskGray(guide, maskUp, windowSize, outputMask);
+		return;
+	}
+	std::vector<cv::Mat> guideChannels;
+	cv::split(guide, guideChannels);
+
+	// Window means of the guide, the mask, guide x mask and guide x guide
+	cv::Mat meanGuide[3], meanGuideMask[3], meanGuideGuide[6];
+	cv::Mat meanMask, product;
+	cv::boxFilter(maskUp, meanMask, CV_32F, windowSize);
+	for (int channel = 0; channel < 3; channel++) {
+		cv::boxFilter(guideChannels[channel], meanGuide[channel], CV_32F, windowSize);
+		cv::multiply(guideChannels[channel], maskUp, product);
+		cv::boxFilter(product, meanGuideMask[channel], CV_32F, windowSize);
+	}
+	// Upper triangle of the covariance: bb, bg, br, gg, gr, rr
+	const int pairs[6][2] = { { 0, 0 },{ 0, 1 },{ 0, 2 },{ 1, 1 },{ 1, 2 },{ 2, 2 } };
+	for (int pairIndex = 0; pairIndex < 6; pairIndex++) {
+		cv::multiply(guideChannels[pairs[pairIndex][0]], guideChannels[pairs[pairIndex][1]], product);
+		cv::boxFilter(product, meanGuideGuide[pairIndex], CV_32F, windowSize);
+	}
+
+	// Per-window linear coefficients: a = (Sigma + eps*I)^-1 * cov(guide, mask), b = mean(mask) - a.mean(guide)
+	cv::Mat coefA[3], coefB(fullFrameSize, CV_32FC1);
+	for (int channel = 0; channel < 3; channel++) {
+		coefA[channel].create(fullFrameSize, CV_32FC1);
+	}
+	for (int rowIndex = 0; rowIndex < fullFrameSize.height; rowIndex++) {
+		const float * mI[3], *mIp[3], *mII[6];
+		float * a[3];
+		for (int channel = 0; channel < 3; channel++) {
+			mI[channel] = meanGuide[channel].ptr<float>(rowIndex);
+			mIp[channel] = meanGuideMask[channel].ptr<float>(rowIndex);
+			a[channel] = coefA[channel].ptr<float>(rowIndex);
+		}
+		for (int pairIndex = 0; pairIndex < 6; pairIndex++) {
+			mII[pairIndex] = meanGuideGuide[pairIndex].ptr<float>(rowIndex);
+		}
+		const float * mp = meanMask.ptr<float>(rowIndex);
+		float * b = coefB.ptr<float>(rowIndex);
+		for (int colIndex = 0; colIndex < fullFrameSize.width; colIndex++) {
+			const float ib = mI[0][colIndex], ig = mI[1][colIndex], ir = mI[2][colIndex], p = mp[colIndex];
+			const float cb = mIp[0][colIndex] - ib * p, cg = mIp[1][colIndex] - ig * p, cr = mIp[2][colIndex] - ir * p;
+			const float sbb = mII[0][colIndex] - ib * ib + UPSAMPLE_EPSILON, sbg = mII[1][colIndex] - ib * ig, sbr = mII[2][colIndex] - ib * ir;
+			const float sgg = mII[3][colIndex] - ig * ig + UPSAMPLE_EPSILON, sgr = mII[4][colIndex] - ig * ir;
+			const float srr = mII[5][colIndex] - ir * ir + UPSAMPLE_EPSILON;
+			// Inverse of the symmetric 3x3 matrix through its cofactors
+			const float ibb = sgg * srr - sgr * sgr, ibg = sgr * sbr - sbg * srr, ibr = sbg * sgr - sgg * sbr;
+			const float igg = sbb * srr - sbr * sbr, igr = sbr * sbg - sbb * sgr, irr = sbb * sgg - sbg * sbg;
+			const float inverseDet = 1.0f / (sbb * ibb + sbg * ibg + sbr * ibr);
+			const float ab = (ibb * cb + ibg * cg + ibr * cr) * inverseDet;
+			const float ag = (ibg * cb + igg * cg + igr * cr) * inverseDet;
+			const float ar = (ibr * cb + igr * cg + irr * cr) * inverseDet;
+			a[0][colIndex] = ab;
+			a[1][colIndex] = ag;
+			a[2][colIndex] = ar;
+			b[colIndex] = p - ab * ib - ag * ig - ar * ir;
+		}
+	}
+
+	// Output: mean coefficients applied to the full-resolution colour, thresholded at one half
+	cv::Mat refined;
+	cv::boxFilter(coefB, refined, CV_32F, windowSize);
+	for (int channel = 0; channel < 3; channel++) {
+		cv::Mat meanA;
+		cv::boxFilter(coefA[channel], meanA, CV_32F, windowSize);
+		cv::multiply(meanA, guideChannels[channel], product);
+		cv::add(refined, product, refined);
+	}
+	cv::threshold(refined, refined, 0.5, 255.0, cv::THRESH_BINARY);
+	refined.convertTo(outputMask, CV_8UC1);
+}
+// Guided filter with a gray guide: a = cov(guide, mask) / (var(guide) + eps), b = mean(mask) - a.mean(guide)
+void BackgroundSubtractorLCDP::UpsampleMaskGray(const cv::Mat &guide, const cv::Mat &maskUp, cv::Size windowSize, cv::Mat &outputMask)
+{
+	cv::Mat meanGuide, meanMask, meanGuideMask, meanGuideGuide, product;
+	cv::boxFilter(guide, meanGuide, CV_32F, windowSize);
+	cv::boxFilter(maskUp, meanMask, CV_32F, windowSize);
+	cv::multiply(guide, maskUp, product);
+	cv::boxFilter(product, meanGuideMask, CV_32F, windowSize);
+	cv::multiply(guide, guide, product);
+	cv::boxFilter(product, meanGuideGuide, CV_32F, windowSize);
+	cv::Mat coefA(fullFrameSize, CV_32FC1), coefB(fullFrameSize, CV_32FC1);
+	for (int rowIndex = 0; rowIndex < fullFrameSize.height; rowIndex++) {
+		const float * mI = meanGuide.ptr<float>(rowIndex);
+		const float * mp = meanMask.ptr<float>(rowIndex);
+		const float * mIp = meanGuideMask.ptr<float>(rowIndex);
+		const float * mII = meanGuideGuide.ptr<float>(rowIndex);
+		float * a = coefA.ptr<float>(rowIndex);
+		float * b = coefB.ptr<float>(rowIndex);
+		for (int colIndex = 0; colIndex < fullFrameSize.width; colIndex++) {
+			a[colIndex] = (mIp[colIndex] - mI[colIndex] * mp[colIndex]) / (mII[colIndex] - mI[colIndex] * mI[colIndex] + UPSAMPLE_EPSILON);
+			b[colIndex] = mp[colIndex] - a[colIndex] * mI[colIndex];
+		}
+	}
+	// Output: mean coefficients applied to the full-resolution intensity, thresholded at one half
+	cv::Mat refined, meanA;
+	cv::boxFilter(coefB, refined, CV_32F, windowSize);
+	cv::boxFilter(coefA, meanA, CV_32F, windowSize);
+	cv::multiply(meanA, guide, product);
+	cv::add(refined, product, refined);
+	cv::threshold(refined, refined, 0.5, 255.0, cv::THRESH_BINARY);
+	refined.convertTo(outputMask, CV_8UC1);
+}
+// Frame size of the model in reduced-resolution mode
+cv::Size BackgroundSubtractorLCDP::ScaledFrameSize(cv::Size inputFrameSize, int scale)
+{
+	scale = std::max(1, scale);
+	return cv::Size(std::max(1, (inputFrameSize.width + scale - 1) / scale), std::max(1, (inputFrameSize.height + scale - 1) / scale));
+}
+// ROI of the model (0/255) in reduced-resolution mode: a coarse pixel is inside when any of its pixels is
+cv::Mat BackgroundSubtractorLCDP::ScaledROI(cv::Mat inputROI, cv::Size scaledSize)
+{
+	cv::Mat scaledROI;
+	if (inputROI.size() == scaledSize) {
+		// Any non-zero value is inside
+		cv::compare(inputROI, 0, scaledROI, cv::CMP_NE);
+		return scaledROI;
+	}
+	cv::resize(inputROI, scaledROI, scaledSize, 0, 0, cv::INTER_AREA);
+	cv::threshold(scaledROI, scaledROI, 0, 255, cv::THRESH_BINARY);
+	return scaledROI;
+}
+// Modelled frame size
+cv::Size BackgroundSubtractorLCDP::GetModelFrameSize() const {
+	return frameSize;
+}
+// Memory held by the model and its pixel LUTs
+size_t BackgroundSubtractorLCDP::GetModelBytes() const {
+	return bgWordStorage.Size() + (sizeof(PxInfo) + wordSize + (8 * sizeof(float))) * frameRoiTotalPixel +
+		(roiIndexMap.total() * roiIndexMap.elemSize()) + (roiRuns.size() * sizeof(RoiRun)) +
+		(wordCapacity.size() * (sizeof(unsigned short) + 4 * sizeof(unsigned char) + sizeof(size_t)));
+}
+
+/*=====ROI Methods=====*/
+// Build the ROI runs and the compact index map from frameRoi
+void BackgroundSubtractorLCDP::BuildROIIndex()
+{
+	roiRuns.clear();
+	roiIndexMap = cv::Mat(frameSize, CV_32SC1, cv::Scalar(-1));
+	size_t roiIndex = 0;
+	for (int rowIndex = 0; rowIndex < frameSize.height; rowIndex++) {
+		const uchar * roiRow = frameRoi.ptr<uchar>(rowIndex);
+		int * indexRow = roiIndexMap.ptr<int>(rowIndex);
+		int colIndex = 0;
+		while (colIndex < frameSize.width) {
+			if (!roiRow[colIndex]) {
+				colIndex++;
+				continue;
+			}
+			RoiRun run;
+			run.row = rowIndex;
+			run.colStart = colIndex;
+			run.roiStart = roiIndex;
+			while ((colIndex < frameSize.width) && roiRow[colIndex]) {
+				indexRow[colIndex++] = int(roiIndex++);
+			}
+			run.colEnd = colIndex;
+			roiRuns.push_back(run);
+		}
+	}
+	frameRoiTotalPixel = roiIndex;
+}
+// Fill a pixel LUT in compact index order
+void BackgroundSubtractorLCDP::GenerateROIPxInfo(PxInfo *pxInfoPtr)
+{
+	memset(pxInfoPtr, 0, sizeof(PxInfo)*frameRoiTotalPixel);
+	for (size_t runIndex = 0; runIndex < roiRuns.size(); runIndex++) {
+		const RoiRun &run = roiRuns[runIndex];
+		for (int colIndex = run.colStart; colIndex < run.colEnd; colIndex++) {
+			const size_t roiIndex = run.roiStart + (colIndex - run.colStart);
+			const size_t pxPointer = (size_t(run.row) * frameSize.width) + colIndex;
+			// Coordinate Y value
+			pxInfoPtr[roiIndex].coor_y = run.row;
+			// Coordinate X value
+			pxInfoPtr[roiIndex].coor_x = colIndex;
+			// Data index for current pixel's pointer
+			pxInfoPtr[roiIndex].dataIndex = pxPointer;
+			// Data index for current pixel's BGR (or gray) pointer
+			pxInfoPtr[roiIndex].bgrDataIndex = pxPointer * frameChannels;
+			// Model index for current pixel (set when AllocateModel gives the pixel its words)
+			pxInfoPtr[roiIndex].modelIndex = 0;
+			// Compact index for current pixel
+			pxInfoPtr[roiIndex].roiIndex = roiIndex;
+			/*=====LUT Methods=====*/
+			// Generate neighborhood pixel offset value
+			GenerateNbOffset(pxInfoPtr[roiIndex]);
+		}
+	}
+}
+// Replace the region of interest
+void BackgroundSubtractorLCDP::SetROI(cv::Mat inputROI)
+{
+	cv::Mat newROI = ScaledROI(inputROI, frameSize);
+	if (bgWordPtr == nullptr) {
+		// Not initialised yet: Initialize builds the model for the new ROI
+		frameRoi = newROI;
+		frameRoiTotalPixel = size_t(cv::countNonZero(frameRoi));
+		return;
+	}
+	// Stage the words of the pixels that stay in the ROI (packed in old ROI order) until the
+	// new model is built; the words of dropped pixels are never copied
+	const cv::Mat oldIndexMap = roiIndexMap;
+	const std::vector<unsigned short> oldCapacity = wordCapacity;
+	std::vector<size_t> oldStageIndex(frameRoiTotalPixel, 0);
+	size_t stageWords = 0;
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		if (newROI.at<uchar>(pxInfoLUTPtr[roiIndex].coor_y, pxInfoLUTPtr[roiIndex].coor_x) != 0) {
+			oldStageIndex[roiIndex] = stageWords;
+			stageWords += oldCapacity[roiIndex];
+		}
+	}
+	ModelStorage stageStorage;
+	stageStorage.SetPageSize(pageSize);
+	unsigned char * stageWordPtr = nullptr;
+	if (stageWords > 0) {
+		if (!stageStorage.Allocate(ModelStorage::STORAGE_HEAP, wordSize*stageWords, "")) {
+			std::cout << "Cannot stage the model to change the ROI. Keep the old ROI." << std::endl;
+			return;
+		}
+		stageWordPtr = stageStorage.Data();
+		for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+			if (newROI.at<uchar>(pxInfoLUTPtr[roiIndex].coor_y, pxInfoLUTPtr[roiIndex].coor_x) != 0) {
+				memcpy(stageWordPtr + (wordSize * oldStageIndex[roiIndex]), BgWord(pxInfoLUTPtr[roiIndex].modelIndex),
+					wordSize*oldCapacity[roiIndex]);
+			}
+		}
+	}
+	const std::vector<size_t> oldEpoch = wordEpoch;
+	const std::vector<unsigned char> oldCurrWords(currWordPtr, currWordPtr + (wordSize * frameRoiTotalPixel));
+	cv::Mat * stateMaps[8] = { &clsPersistenceThreshold, &resDistThreshold, &resDynamicRate, &resUpdateRate,
+		&resCurrPxDistance, &resMinLCDPDistance, &resMinRGBDistance, &resTotalPersistence };
+	cv::Mat oldStateMaps[8];
+	for (int mapIndex = 0; mapIndex < 8; mapIndex++) {
+		// The maps live in the state storage, which is replaced below
+		oldStateMaps[mapIndex] = stateMaps[mapIndex]->clone();
+		stateMaps[mapIndex]->release();
+	}
+
+	frameRoi = newROI;
+	BuildROIIndex();
+	pxInfoLUTPtr = reinterpret_cast<PxInfo*>(AllocatePixelArray(pxInfoStorage, sizeof(PxInfo)*frameRoiTotalPixel));
+	GenerateROIPxInfo(pxInfoLUTPtr);
+	AllocateModel(frameRoiTotalPixel);
+	currWordPtr = AllocatePixelArray(currWordStorage, wordSize*frameRoiTotalPixel);
+	currWordPtrIter = currWordPtr;
+	CreateStateMaps();
+
+	// New pixels start from the running-average image, blurred like the frames Process sees
+	cv::Mat backgroundImg = resLastImg.clone();
+	if (preSwitch) {
+		cv::GaussianBlur(backgroundImg, backgroundImg, preGaussianSize, 0, 0);
+	}
+	// New pixels, and kept pixels with words to fill
+	std::vector<size_t> newPixels;
+	for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+		const int oldIndex = oldIndexMap.at<int>(pxInfoLUTPtr[roiIndex].coor_y, pxInfoLUTPtr[roiIndex].coor_x);
+		if (oldIndex < 0) {
+			DescriptorGenerator(backgroundImg, pxInfoLUTPtr[roiIndex], *CurrWord(roiIndex));
+			newPixels.push_back(roiIndex);
+			continue;
+		}
+		// Kept pixels keep their capacity while the budget allows
+		if (oldCapacity[oldIndex] != wordCapacity[roiIndex]) {
+			ResizePixelWords(roiIndex, oldCapacity[oldIndex]);
+		}
+		const size_t keptWords = std::min(size_t(oldCapacity[oldIndex]), size_t(wordCapacity[roiIndex]));
+		memcpy(BgWord(pxInfoLUTPtr[roiIndex].modelIndex), stageWordPtr + (wordSize * oldStageIndex[oldIndex]), wordSize*keptWords);
+		wordEpoch[roiIndex] = oldEpoch[oldIndex];
+		if (keptWords < wordCapacity[roiIndex]) {
+			newPixels.push_back(roiIndex);
+		}
+		memcpy(CurrWord(roiIndex), oldCurrWords.data() + (wordSize * oldIndex), wordSize);
+		for (int mapIndex = 0; mapIndex < 8; mapIndex++) {
+			stateMaps[mapIndex]->at<float>(0, int(roiIndex)) = oldStateMaps[mapIndex].at<float>(0, oldIndex);
+		}
+	}
+	// New pixels have no previous classification for the change gate
+	gateLastImg.release();
+	// Every current word exists before the new pixels sample their neighbourhoods
+	for (size_t newIndex = 0; newIndex < newPixels.size(); newIndex++) {
+		const size_t roiIndex = newPixels[newIndex];
+		const int oldIndex = oldIndexMap.at<int>(pxInfoLUTPtr[roiIndex].coor_y, pxInfoLUTPtr[roiIndex].coor_x);
+		// Kept pixels that could not keep their capacity only refresh the words they did not have
+		const size_t startWord = (oldIndex < 0) ? 0 : std::min(size_t(oldCapacity[oldIndex]), size_t(wordCapacity[roiIndex]));
+		RefreshPixel(roiIndex, startWord, wordCapacity[roiIndex] - startWord);
+	}
+}
+// Number of modelled (ROI) pixels
+size_t BackgroundSubtractorLCDP::GetROIPixelNo() const {
+	return frameRoiTotalPixel;
+}
+/*=====KERNEL INSTANTIATIONS=====*/
+// Per-pixel kernels used outside this file (the kernel benchmark drives them directly)
+#define INSTANTIATE_LCDP_KERNELS(NbNo) \
+	template void BackgroundSubtractorLCDP::LCDGenerator<NbNo>(cv::Mat, BackgroundSubtractorLCDP::PxInfo &, BackgroundSubtractorLCDP::DescriptorStruct &); \
+	template void BackgroundSubtractorLCDP::LCDPMatching<NbNo, false>(BackgroundSubtractorLCDP::DescriptorStruct &, BackgroundSubtractorLCDP::DescriptorStruct &, \
+		size_t &, double &, float &, bool &); \
+	template void BackgroundSubtractorLCDP::DescriptorMatching<true, true, NbNo, false>(BackgroundSubtractorLCDP::DescriptorStruct &, \
+		BackgroundSubtractorLCDP::DescriptorStruct &, size_t &, double, double, double, float &, float &, bool &, bool &);
+INSTANTIATE_LCDP_KERNELS(8)
+#if LCDP_MAX_DESC_NB >= 16
+INSTANTIATE_LCDP_KERNELS(16)
+#endif
+#if LCDP_MAX_DESC_NB >= 24
+INSTANTIATE_LCDP_KERNELS(24)
+#endif
+template void BackgroundSubtractorLCDP::RGBMatching<false>(BackgroundSubtractorLCDP::DescriptorStruct &, BackgroundSubtractorLCDP::DescriptorStruct &,
+	double &, float &, bool &);
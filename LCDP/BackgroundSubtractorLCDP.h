@@ -2,9 +2,28 @@
 
 #ifndef __BackgroundSubtractorLCDP_H_INCLUDED
 #define __BackgroundSubtractorLCDP_H_INCLUDED
-#include <opencv2\opencv.hpp>
+#include <opencv2/opencv.hpp>
 #include <vector>
-#include <bitset>
+#include <string>
+#include <utility>
+#include <random>
+#include <cstddef>
+#include <cstring>
+#include "Profiler.h"
+#include "ModelCheckpoint.h"
+#include "ModelStorage.h"
+#include "WordPool.h"
+#include "FrameView.h"
+
+// Widest descriptor neighbourhood of the build (8, 16 or 24). Words are sized per instance
+// from its own neighbourhood (36 bytes per word with 8, 48 with 16 and 72 with 24
+// neighbours; gray models 16, 16 and 20), so this only bounds the neighbourhoods compiled in.
+#ifndef LCDP_MAX_DESC_NB
+#define LCDP_MAX_DESC_NB 24
+#endif
+#if (LCDP_MAX_DESC_NB != 8) && (LCDP_MAX_DESC_NB != 16) && (LCDP_MAX_DESC_NB != 24)
+#error LCDP_MAX_DESC_NB must be 8, 16 or 24
+#endif
 
 class BackgroundSubtractorLCDP {
 public:
@@ -17,7 +36,7 @@ public:
 		float inputUpUpdateRateDecrease, float inputUpUpdateRateLowest, float inputUpUpdateRateHighest,
 		float inputDarkMinIntensityRatio, float inputDarkMaxIntensityRatio, float inputDarkRDiffRatioMin, float inputDarkRDiffRatioMax,
 		float inputDarkGDiffRatioMin, float inputDarkGDiffRatioMax,
-		bool inputPostSwitch);
+		bool inputPostSwitch, int inputProcessScale);
 
 	/*******DESTRUCTOR*******/ // Checked
 	~BackgroundSubtractorLCDP();
@@ -25,34 +44,208 @@ public:
 	std::string folderName;
 
 	/*******INITIALIZATION*******/
-	void Initialize(cv::Mat inputImg, cv::Mat inputROI);
-
-	// Program processing
-	void Process(cv::Mat inputImg, cv::Mat &outputImg);
+	// Frames are 8-bit BGR or 8-bit gray (monochrome / IR cameras); the first frame decides
+	// and every later frame has to have the same number of channels. Frames have the input
+	// frame size and are only read.
+	void Initialize(const FrameView &inputFrame, cv::Mat inputROI);
+	// Same with an OpenCV frame (CV_8UC3 BGR, CV_8UC4 BGRA or CV_8UC1)
+	void Initialize(const cv::Mat &inputImg, cv::Mat inputROI);
+
+	// Program processing: the mask (input frame size) is written straight into the caller's buffer
+	void Process(const FrameView &inputFrame, const MaskView &outputMask);
+	// Same with OpenCV matrices (outputImg is reallocated only if it is not a CV_8UC1 frame-size matrix)
+	void Process(const cv::Mat &inputImg, cv::Mat &outputImg);
 
 	/*=====OTHERS Methods=====*/
 	// Save parameters
 	void SaveParameter(std::string versionFolderName, std::string saveFolderName);
+
+	/*=====DESCRIPTOR Methods=====*/
+	// Descriptor neighbourhood (call before Initialize): 8 (3x3 ring), 16 (3x3 ring and the
+	// 5x5 corners and edge centres) or 24 (full 5x5), up to LCDP_MAX_DESC_NB
+	// (RETURN-true: supported by this build)
+	bool SetDescriptorNeighbours(int nbNo);
+	// Total number of descriptor neighbours
+	int GetDescriptorNeighbours() const;
+	// RETURN-true if the frames are gray: the descriptor holds the intensity and texture-only
+	// LCDP bits and shadows are found on luminance alone (set by Initialize)
+	bool IsSingleChannel() const;
+
+	/*=====REDUCED RESOLUTION Methods=====*/
+	// Modelled frame size (the input size divided by the process scale)
+	cv::Size GetModelFrameSize() const;
+	// Memory held by the model and its pixel LUTs (bytes)
+	size_t GetModelBytes() const;
+
+	/*=====STORAGE Methods=====*/
+	// Place the background words in a memory-mapped file or shared-memory segment instead of
+	// the heap (call before Initialize). The storage starts with a 4 KB header
+	// { "LCDPMM02", uint32 rows, uint32 cols, uint32 wordsNo, uint32 wordSize, uint64 frameIndex,
+	// uint64 roiPixelNo, uint64 poolWords } followed by the word pool, wordSize bytes per word
+	// (see GetWordSize). Without an adaptive model every ROI pixel owns WORDS_NO words, in
+	// row-major pixel order.
+	void SetModelStorage(ModelStorage::Backend backend, const std::string &name);
+	// Page size of the model, the pixel LUT, the current words and the float state
+	// (call before Initialize). Pages land on the NUMA node of the thread that first writes
+	// them, so Initialize and Process should run on threads pinned to the same node.
+	void SetPageSize(ModelStorage::PageSize inputPageSize);
+	// RETURN-true if the model got reserved (not transparent) huge pages
+	bool UsesReservedHugePages() const;
+	// Backend the model actually lives in (the heap when the requested storage could not be created)
+	ModelStorage::Backend GetModelStorageBackend() const;
+	// Size of one background word with 'nbNo' descriptor neighbours (bytes); gray words
+	// ('mono') only hold the texture bits
+	static size_t GetWordSize(int nbNo, bool mono);
+
+	/*=====ADAPTIVE MODEL Methods=====*/
+	// Per-pixel word capacity (call before Initialize). Pixels start with a few words drawn
+	// from a pooled allocator, grow by one size class after repeatedly failing to match and
+	// shrink by one class when their least persistent words stay below the minimum
+	// persistence. budgetBytes bounds the pool (0: up to WORDS_NO words per pixel).
+	void SetAdaptiveModel(bool adaptiveSwitch, size_t budgetBytes);
+	// Mean number of words per ROI pixel
+	double GetAverageWordCapacity() const;
+	// Print pool usage and capacity changes
+	void PrintModelStats(std::ostream &output) const;
+
+	/*=====ROI Methods=====*/
+	// Replace the region of interest (input frame size). Pixels that stay inside keep their
+	// words and R/V/T state; pixels that enter are initialised from the running-average
+	// image; pixels that leave are dropped. Before Initialize only the ROI is replaced.
+	void SetROI(cv::Mat inputROI);
+	// Number of modelled (ROI) pixels
+	size_t GetROIPixelNo() const;
+
+	/*=====CHECKPOINT Methods=====*/
+	// Copy the learnt state into a snapshot (see ModelCheckpoint.h)
+	void CaptureCheckpoint(ModelCheckpoint::Snapshot &snapshot) const;
+	// Replace the learnt state after Initialize (RETURN-true: checkpoint matches this subtractor)
+	bool RestoreCheckpoint(const CheckpointReader &reader);
+	// Save / load a checkpoint file (RETURN-true: success)
+	bool SaveCheckpoint(const std::string &fileName) const;
+	bool LoadCheckpoint(const std::string &fileName);
+	// Frame index reached by the model
+	size_t GetFrameIndex() const;
+
+	/*=====DEGRADATION Methods=====*/
+	// Work limits for latency-bounded processing (FullQuality(): no limit)
+	struct QualityLimits {
+		// Maximum neighbours compared for a foreground candidate (0: no neighbour matching)
+		size_t maxNeighbourMatch;
+		// Maximum background words scanned (and re-sorted) per pixel; never below the matching threshold
+		size_t maxWordsScanned;
+		// Skip BorderLineReconst in post-processing
+		bool skipBorderLine;
+		// Skip ContourFill in post-processing
+		bool skipContourFill;
+		// Median filter size override (0: frame-size based default)
+		int medianFilterSize;
+	};
+	// Limits that leave Process unchanged
+	static QualityLimits FullQuality();
+	// Limits applied from the next Process call on
+	void SetQualityLimits(const QualityLimits &limits);
+
+	/*=====CHANGE GATE Methods=====*/
+	// Skip unchanged blocks: the input is compared with the previous input in blockSize x
+	// blockSize blocks, and pixels of blocks whose mean absolute difference stays at or below
+	// noiseThreshold (per channel, 0-255) keep their previous classification; background
+	// pixels only age their top word. Every fullPassInterval-th frame processes every pixel
+	// (0: never forced). blockSize 0 turns the gate off.
+	void SetChangeGate(int blockSize, float noiseThreshold, size_t fullPassInterval);
+	// Fraction of the ROI pixels skipped by the gate in the last frame
+	double GetSkippedFraction() const;
+	// Skipped fraction of every frame processed with the gate on
+	const std::vector<float> & GetSkippedFractions() const;
+
+	/*=====PROFILING Methods=====*/
+	// Stages of Process timed by an attached profiler
+	enum ProcessStage {
+		// Grayscale conversion and running average image
+		STAGE_INPUT,
+		STAGE_PRE_BLUR,
+		// Block differences of the change gate
+		STAGE_CHANGE_GATE,
+		STAGE_DARK_PIXEL,
+		// Per-pixel stages (summed over the frame)
+		STAGE_DESCRIPTOR,
+		STAGE_MODEL_MATCH,
+		STAGE_NEIGHBOUR_MATCH,
+		STAGE_FEEDBACK,
+		// Post-processing steps
+		STAGE_POST_BLINK,
+		STAGE_POST_COMPENSATION,
+		STAGE_POST_GRADIENT,
+		STAGE_POST_MORPHOLOGY,
+		STAGE_POST_BORDERLINE,
+		STAGE_POST_CONTOUR_FILL,
+		STAGE_POST_MEDIAN,
+		// Output copy and per-frame resets
+		STAGE_OUTPUT,
+		PROCESS_STAGE_NO
+	};
+	// Names of the Process stages, in ProcessStage order (to build a Profiler)
+	static std::vector<std::string> GetProcessStageNames();
+	// Attach a profiler built from GetProcessStageNames() (nullptr: profiling off). Per-pixel
+	// stages read the clock four times per pixel, which slows Process down while attached.
+	void SetProfiler(Profiler *inputProfiler);
+
+	/*=====RANDOM Methods=====*/
+	// Seed of the random replacement and neighbour updates (0: seeded from the clock, the
+	// default). With a fixed seed every frame reseeds with seed + frame index, so two runs
+	// on the same frames give the same masks. Every subtractor has its own generator, so
+	// concurrent subtractors do not disturb each other's sequence.
+	void SetRandomSeed(unsigned int seed);
+
+	/*=====OPTIMISATION Methods=====*/
+	// Turn Process optimisations off to get the reference path the regression suite compares
+	// them against (all on by default; call before Initialize). matchHints: try the last
+	// matched word and neighbour slot first; specialisedKernels: use the word loop compiled
+	// for the default word count; compactWords: size words from the neighbourhood and channel
+	// count (off: every word takes the widest BGR layout, as one fixed-size struct).
+	void SetOptimisations(bool matchHints, bool specialisedKernels, bool compactWords);
 protected:
 
 	// PRE-DEFINED STRUCTURE
-	// Descriptor structure
+	struct DescriptorStruct;
+	// Packed LCDP bits of a word with NbNo neighbours: 6 colour bits (bit 6n..6n+5) and 3 texture
+	// bits (bit 3n..3n+2) per neighbour, in two colour planes of 32-bit parts followed by two
+	// texture planes of 16-bit parts; plane 0 marks a difference, plane 1 a negative one.
+	// Gray words (Mono) have no colour planes and one texture bit per neighbour.
+	template <int NbNo, bool Mono = false>
+	struct WordLayout {
+		static const int COLOUR_PARTS = Mono ? 0 : (((6 * NbNo) + 31) / 32);
+		static const int TEXTURE_PARTS = Mono ? ((NbNo + 15) / 16) : (((3 * NbNo) + 15) / 16);
+		// LCDP bits in 32-bit units
+		static const int BITS_PARTS = (2 * COLOUR_PARTS) + (((2 * TEXTURE_PARTS) + 1) / 2);
+		// Bytes per word
+		static size_t Size() { return offsetof(DescriptorStruct, LCDPBits) + (sizeof(unsigned int) * BITS_PARTS); }
+		static unsigned int * Colour(DescriptorStruct &word, int plane) { return word.LCDPBits + (plane * COLOUR_PARTS); }
+		static unsigned short * Texture(DescriptorStruct &word, int plane) {
+			return reinterpret_cast<unsigned short*>(word.LCDPBits + (2 * COLOUR_PARTS)) + (plane * TEXTURE_PARTS);
+		}
+		// Exchange two stored words
+		static void Swap(DescriptorStruct &firstWord, DescriptorStruct &secondWord) {
+			DescriptorStruct tempWord;
+			memcpy(&tempWord, &firstWord, Size());
+			memcpy(&firstWord, &secondWord, Size());
+			memcpy(&secondWord, &tempWord, Size());
+		}
+	};
+	// Descriptor structure. Words are stored WordLayout<descNbNo, gray>::Size() bytes apart (the
+	// model, the current words and checkpoints); the struct has room for the widest layout,
+	// so only whole words of this instance's size may be copied.
 	struct DescriptorStruct {
-		// Store the pixel's RGB values
-		int rgb[3];
 		// Store the number of frames that having same descriptor
-		int frameCount;
-		// Store the frame index of the first occurrences / initial of this descriptor
-		int p;
-		// Store the frame index of the last occurrences of this descriptor
-		int q;
-		// Store the pixel's LCDP values
-		//int LCDP[16];
-		std::bitset<96> LCDPColour[2];
-		std::bitset<48> LCDPTexture[2];
-		int lastF;
-		float gray;
-		int nowF;
+		unsigned int frameCount;
+		// Store the frame stamp (relative to the pixel's epoch) of the last occurrences of this descriptor
+		unsigned short q;
+		// Store the frames between the first and the last occurrences (q - p, saturated)
+		unsigned short span;
+		// Store the pixel's RGB values (gray models use rgb[0] only)
+		unsigned char rgb[3];
+		// Store the pixel's LCDP values (see WordLayout)
+		unsigned int LCDPBits[WordLayout<LCDP_MAX_DESC_NB>::BITS_PARTS];
 	};
 
 	// Pixel info structure
@@ -65,8 +258,10 @@ protected:
 		size_t dataIndex;
 		// Data index for current pixel's BGR pointer
 		size_t bgrDataIndex;
-		// Model index for current pixel
+		// Model index for current pixel (only kept for the pixel itself: models move when they grow)
 		size_t modelIndex;
+		// Compact index of the pixel's words and state (ROI_NONE: outside the ROI)
+		size_t roiIndex;
 	};
 
 	// Pixel info structure
@@ -76,58 +271,104 @@ protected:
 	};
 
 	/*=====LOOK-UP TABLE=====*/
-	// neighborhood's offset value
-	const cv::Point nbOffset[48] = {
-		/*cv::Point(0, -1),	cv::Point(1, 0),	cv::Point(0, 1),	cv::Point(-1, 0),
-		cv::Point(-1, -1),  cv::Point(1, -1),	cv::Point(1, 1),	cv::Point(-1, 1),
-
-		cv::Point(0, -2),   cv::Point(2, 0),    cv::Point(0, 2),    cv::Point(-2, 0),
-		cv::Point(-2, -2),  cv::Point(2, -2),	cv::Point(2, 2),    cv::Point(-2, 2),
-
-		cv::Point(-1, -3),	cv::Point(1, -3),	cv::Point(1, 3),	cv::Point(-1, 3),
-		cv::Point(-3, -1),  cv::Point(3, -1),	cv::Point(3, 1),	cv::Point(-3, 1),
-		cv::Point(-3, -3),  cv::Point(3, -3),   cv::Point(3, 3),	cv::Point(-3, 3),
-
-
-		cv::Point(-2, 1),	cv::Point(2, 1),  	cv::Point(-1, 2),   cv::Point(1, 2),
-		cv::Point(0, -3),	cv::Point(3, 0),	cv::Point(0, 3),	cv::Point(-3, 0),				  
-		cv::Point(-2, -3),  cv::Point(2, -3),	cv::Point(2, 3),	cv::Point(-2, 3),
-		cv::Point(-3, -2),  cv::Point(3, -2),	cv::Point(3, 2),	cv::Point(-3, 2),		
-		cv::Point(-1, -2),  cv::Point(1, -2),	cv::Point(-2, -1),  cv::Point(2, -1)*/
-		cv::Point(0, -1),	cv::Point(1, 0),	cv::Point(0, 1),	cv::Point(-1, 0),
-		cv::Point(-1, -1),  cv::Point(1, -1),	cv::Point(1, 1),	cv::Point(-1, 1),
-		cv::Point(-2, -2), cv::Point(0, -2), cv::Point(2, -2),
-		cv::Point(-2, 0),  cv::Point(2, 0),
-		cv::Point(-2, 2),  cv::Point(0, 2),  cv::Point(2, 2),
-		cv::Point(-1, -2),  cv::Point(1, -2),
-		cv::Point(-2, -1),  cv::Point(2, -1),
-		cv::Point(-2, 1),  cv::Point(2, 1),
-		cv::Point(-1, 2),  cv::Point(1, 2),
-		cv::Point(-3, -3),  cv::Point(0, -3),cv::Point(3, -3),
-		cv::Point(-3, 0),  cv::Point(3, 0),
-		cv::Point(-3, 3),  cv::Point(0, 3),cv::Point(3, 3),
-		cv::Point(-2, -3),  cv::Point(-1, -3),cv::Point(1, -3),cv::Point(2, -3),
-		cv::Point(-3, -2),  cv::Point(3, -2),
-		cv::Point(-3, -1),  cv::Point(3, -1),
-		cv::Point(-3, 2),  cv::Point(3, 2),
-		cv::Point(-3, 1),  cv::Point(3, 1),
-		cv::Point(-2, 3),  cv::Point(-1, 3),cv::Point(1, 3),cv::Point(2, 3)	
-				  
-	};
-	// Internal pixel info LUT for all possible pixel indexes
+	// neighborhood's offset value (shared by all instances)
+	static const cv::Point nbOffset[48];
+	// Internal pixel info LUT for the ROI pixels (compact index order)
 	PxInfo * pxInfoLUTPtr;
-	// LCD differences 
-	float LCDDiffLUTPtr[97][49];
+	// LCD differences per neighbourhood (8/16/24) and number of differing colour / texture
+	// bits (shared by all instances, generated once)
+	static float LCDDiffLUTPtr[3][(6 * LCDP_MAX_DESC_NB) + 1][(3 * LCDP_MAX_DESC_NB) + 1];
+
+	/*=====ROI INDEX=====*/
+	// Compact index of a pixel outside the ROI
+	static const size_t ROI_NONE = size_t(-1);
+	// Run of consecutive ROI pixels in one row
+	struct RoiRun {
+		int row;
+		// First column and one past the last column
+		int colStart;
+		int colEnd;
+		// Compact index of the first pixel of the run
+		size_t roiStart;
+	};
+	// ROI runs in row-major order; the words, the pixel LUT, the current words and the
+	// float state maps are stored for these pixels only, in the same order
+	std::vector<RoiRun> roiRuns;
+	// Compact index of every frame pixel (CV_32SC1, -1: outside the ROI)
+	cv::Mat roiIndexMap;
 
 	/*=====MODEL Parameters=====*/
-	// Store the background's words and it's iterator
-	DescriptorStruct * bgWordPtr, *bgWordPtrIter;
-	// Store the current frame's words and it's iterator
-	DescriptorStruct * currWordPtr, *currWordPtrIter;
+	// Store the background's words and it's iterator (word n starts at n * wordSize)
+	unsigned char * bgWordPtr, *bgWordPtrIter;
+	// Store the current frame's words and it's iterator (one per ROI pixel, wordSize apart)
+	unsigned char * currWordPtr, *currWordPtrIter;
+	// Bytes per word of this instance's neighbourhood (set by Initialize)
+	size_t wordSize;
+	// Background word 'wordIndex' of the pool
+	DescriptorStruct * BgWord(size_t wordIndex) const {
+		return reinterpret_cast<DescriptorStruct*>(bgWordPtr + (wordIndex * wordSize));
+	}
+	// Current word of a ROI pixel
+	DescriptorStruct * CurrWord(size_t roiIndex) const {
+		return reinterpret_cast<DescriptorStruct*>(currWordPtr + (roiIndex * wordSize));
+	}
 	// Total number of words to represent a pixel
 	const size_t WORDS_NO;
 	// Frame index
 	size_t frameIndex;
+	// Memory holding the storage header and the background words
+	ModelStorage bgWordStorage;
+	// Where the background words are placed
+	ModelStorage::Backend modelStorageBackend;
+	// File path or segment name of a mapped model
+	std::string modelStorageName;
+	// Page size of the per-pixel arrays
+	ModelStorage::PageSize pageSize;
+	// Memory holding the pixel LUT, the current words and the float state maps
+	ModelStorage pxInfoStorage, currWordStorage, stateStorage;
+	// Header at the start of the model storage
+	struct StorageHeader {
+		char magic[8];
+		unsigned int rows;
+		unsigned int cols;
+		unsigned int wordsNo;
+		unsigned int wordSize;
+		unsigned long long frameIndex;
+		unsigned long long roiPixelNo;
+		unsigned long long poolWords;
+	};
+
+	/*=====ADAPTIVE MODEL=====*/
+	// Per-pixel capacity switch
+	bool adaptiveModelSwitch;
+	// Memory budget of the word pool (0: WORDS_NO words per pixel)
+	size_t modelBudgetBytes;
+	// Allocator of the per-pixel word blocks inside the model storage
+	WordPool wordPool;
+	// Words owned by each ROI pixel
+	std::vector<unsigned short> wordCapacity;
+	// Consecutive frames a pixel failed to match its own model
+	std::vector<unsigned char> wordMissCount;
+	// Consecutive frames the least persistent words of a pixel stayed below the floor
+	std::vector<unsigned char> wordLowCount;
+
+	/*=====WORD STAMPS=====*/
+	// Frame index each ROI pixel's 16-bit word stamps are relative to
+	std::vector<size_t> wordEpoch;
+
+	/*=====MATCH HINTS=====*/
+	// Per ROI pixel: the word that matched on the last frame and the neighbour slot whose
+	// model last matched; both are tried first, then the normal order is walked without them
+	// (word hints have the width of the word capacities)
+	std::vector<unsigned short> matchHintWord;
+	std::vector<unsigned char> matchHintNb;
+	// Smallest and initial capacity
+	size_t wordMinCapacity;
+	size_t wordInitialCapacity;
+	// Total number of capacity changes and of growths refused by the budget
+	size_t wordGrowNo;
+	size_t wordShrinkNo;
+	size_t wordGrowFailedNo;
 
 	/*=====PRE-PROCESS Parameters=====*/
 	// Pre process switch
@@ -137,9 +378,9 @@ protected:
 
 	/*=====DESCRIPTOR Parameters=====*/
 	// Size of neighborhood 3(3x3)/5(5x5)
-	const int descNbSize;
-	// Total number of neighborhood pixel 8(3x3)/16(5x5)
-	const int descNbNo;
+	int descNbSize;
+	// Total number of neighborhood pixel 8(3x3)/16(5x5)/24(5x5)
+	int descNbNo;
 	// LCD color differences ratio
 	const double descColourDiffRatio;
 	// Total number of differences per descriptor
@@ -182,8 +423,8 @@ protected:
 	cv::Mat postCompensationResult;
 
 	/*=====FRAME Parameters=====*/
-	// ROI frame
-	const cv::Mat frameRoi;
+	// ROI frame (0/255)
+	cv::Mat frameRoi;
 	// Size of input frame
 	const cv::Size frameSize;
 	// Total number of input frame
@@ -191,9 +432,27 @@ protected:
 	// Size of input frame starting from 0
 	const cv::Size frameSizeZero;
 	// Total number of pixel of region of interest
-	const size_t frameRoiTotalPixel;
+	size_t frameRoiTotalPixel;
 	// Total number of pixel of input frame
 	const size_t frameInitTotalPixel;
+	// Reduced-resolution mode: the model runs on frames downsampled by this factor (1: off)
+	// and the mask is upsampled to the input size with a colour-guided filter
+	const int processScale;
+	// Size of the input (and output) frame
+	const cv::Size fullFrameSize;
+	// Channels of the input frame (3: BGR, 1: gray)
+	int frameChannels;
+
+	/*=====INPUT BUFFERS=====*/
+	// The caller's frame is only read: every image derived from it is kept here and reused.
+	// Converted (RGB / BGRA) frame
+	cv::Mat bufConvertedImg;
+	// Downsampled frame (reduced-resolution mode)
+	cv::Mat bufScaledImg;
+	// Blurred (or, without pre-processing, packed) frame read by the per-pixel loop
+	cv::Mat bufPreImg;
+	// Gray frame
+	cv::Mat bufGrayImg;
 
 	/*=====UPDATE Parameters=====*/
 	// Specifies the PX update spread range
@@ -223,6 +482,8 @@ protected:
 	float upUpdateRateUpperCap;
 
 	/*=====RESULTS=====*/
+	// The float maps (R/V/T, distances, persistence and its threshold) are 1 x ROI pixels
+	// in compact index order; the masks and images cover the whole frame.
 	// Per-pixel distance thresholds ('R(x)', but used as a relative value to determine both 
 	// intensity and descriptor variation thresholds)
 	cv::Mat resDistThreshold;
@@ -285,51 +546,175 @@ protected:
 	// G-channel different ratio
 	float darkGDiffRatioMin;
 	float darkGDiffRatioMax;
+
+	/*=====DEGRADATION=====*/
+	// Current work limits
+	QualityLimits qualityLimits;
+
+	/*=====CHANGE GATE=====*/
+	// Block size (0: off)
+	int gateBlockSize;
+	// Largest mean absolute difference of an unchanged block
+	float gateNoiseThreshold;
+	// Every N-th frame is fully processed
+	size_t gateFullPassInterval;
+	// Previous (pre-processed) input; empty: the next frame is fully processed
+	cv::Mat gateLastImg;
+	// Absolute difference to the previous input
+	cv::Mat gateDiffImg;
+	// One entry per block (255: unchanged)
+	cv::Mat gateStaticBlocks;
+	// Raw classification and match-both result of the previous frame
+	cv::Mat gateLastRawFGMask;
+	cv::Mat gateLastMatchBoth;
+	// Skipped fraction of the last frame and of every gated frame
+	double gateSkippedFraction;
+	std::vector<float> gateSkippedLog;
+
+	/*=====PROFILING=====*/
+	// Stage profiler (nullptr: off)
+	Profiler * profiler;
+
+	/*=====RANDOM=====*/
+	// Fixed seed (0: seeded once from std::random_device)
+	unsigned int randomSeed;
+	// Generator of the random replacement and neighbour updates
+	std::mt19937 randomGenerator;
+
+	/*=====OPTIMISATIONS=====*/
+	// Match hints, word count specialised loop and compact words (see SetOptimisations)
+	bool matchHintSwitch;
+	bool specialisedKernelSwitch;
+	bool compactWordSwitch;
 	
 	/*=====METHODS=====*/
 	/*=====DEFAULT methods=====*/
+	// Reseed the generator for the current frame (fixed seed only)
+	void SeedRandom();
 	// Refreshes all samples based on the last analyzed frame - checked
 	void RefreshModel(float refreshFraction);
+	// Refresh 'wordNo' words of one ROI pixel from the current words of its 7x7 neighbourhood
+	void RefreshPixel(size_t roiIndex, size_t startWord, size_t wordNo);
+	// Allocate the storage header and the word pool for 'pixelNo' pixels (contents zeroed)
+	void AllocateModel(size_t pixelNo);
+	// Empty the word pool and forget every pixel's block
+	void ResetWordPool();
+	// Give a pixel a block of 'capacity' words, or of a smaller class when the budget is
+	// spent (RETURN: capacity given, 0: none)
+	size_t AllocatePixelWords(size_t roiIndex, size_t capacity);
+	// Move a pixel's words to a block of another class, keeping the first words
+	// (RETURN-true: moved)
+	bool ResizePixelWords(size_t roiIndex, size_t capacity);
+	// Grow or shrink a pixel's model after it was processed
+	void AdaptPixelWords(size_t roiIndex, bool matched);
+	// Create the float state maps for the current ROI with their initial values
+	void CreateStateMaps();
+	// Allocate zero-filled memory for a per-pixel array with the current page size
+	unsigned char * AllocatePixelArray(ModelStorage &storage, size_t bytes);
+
+	/*=====PROCESS VARIANTS=====*/
+	// Per-pixel loop of Process
+	typedef void (BackgroundSubtractorLCDP::*ProcessPixelsFn)(const cv::Mat &inputImg, bool gateActive, bool bootstrapping, size_t &gateSkippedNo);
+	// Per-pixel detection and update, specialised on the LCDP, RGB, neighbour matching and
+	// feedback switches, the descriptor neighbourhood, gray input (Mono) and the word count
+	// (WordsNo 0: WORDS_NO at run time)
+	template <bool LCDPDiff, bool RGBDiff, bool NbMatch, bool Feedback, int NbNo, bool Mono, size_t WordsNo>
+	void ProcessPixels(const cv::Mat &inputImg, bool gateActive, bool bootstrapping, size_t &gateSkippedNo);
+	// Variant matching the switches and the word count of this instance
+	ProcessPixelsFn SelectProcessPixels() const;
+	// Table of the 16 switch variants for one neighbourhood, channel count and word count
+	template <int NbNo, bool Mono, size_t WordsNo, size_t... Variants>
+	static ProcessPixelsFn SelectProcessPixelsVariant(size_t variant, std::index_sequence<Variants...>);
+	// Per-pixel loop chosen at construction
+	ProcessPixelsFn processPixelsFn;
+
+	/*=====INPUT Methods=====*/
+	// Header over a caller's frame in the BGR / gray layout of the model (no copy; RGB and
+	// BGRA frames are converted into bufConvertedImg)
+	cv::Mat InputHeader(const FrameView &inputFrame);
+
+	/*=====ROI Methods=====*/
+	// Build the ROI runs and the compact index map from frameRoi
+	void BuildROIIndex();
+	// Fill a pixel LUT of frameRoiTotalPixel entries in compact index order
+	void GenerateROIPxInfo(PxInfo *pxInfoPtr);
 
 	/*=====DESCRIPTOR Methods=====*/
 	// DescriptorStruct Generator-Generate pixels' descriptor (RGB+LCDP) - checked
+	template <int NbNo, bool Mono>
+	void DescriptorGenerator(cv::Mat inputFrame, PxInfo &pxInfoPtr, DescriptorStruct &wordPtr);
+	// Descriptor of the current neighbourhood and channel count (outside the per-pixel loop)
 	void DescriptorGenerator(cv::Mat inputFrame, PxInfo &pxInfoPtr, DescriptorStruct &wordPtr);
-	// Generate LCD Descriptor - checked
+	// Generate LCD Descriptor over the first NbNo neighbours - checked
+	template <int NbNo>
 	void LCDGenerator(cv::Mat inputFrame, PxInfo &pxInfoPtr, DescriptorStruct &wordPtr);
-	// Calculate word persistence value
-	void GetLocalWordPersistence(DescriptorStruct &wordPtr, size_t &currFrameIndex,
+	// Generate the texture-only LCD descriptor of a gray frame (one bit pair per neighbour)
+	template <int NbNo>
+	void LCDGeneratorMono(cv::Mat inputFrame, PxInfo &pxInfoPtr, DescriptorStruct &wordPtr);
+	// Copy the intensities and LCDP bits of a word (not its stamps); gray words skip the colour intensities
+	template <int NbNo, bool Mono>
+	static void CopyDescriptor(DescriptorStruct &targetWord, const DescriptorStruct &sourceWord);
+	// Calculate word persistence value (currStamp: current frame relative to the pixel's epoch)
+	void GetLocalWordPersistence(DescriptorStruct &wordPtr, size_t currStamp,
 		size_t offsetValue, float &persistenceValue);
+	// Current frame relative to a pixel's epoch
+	size_t GetWordStamp(size_t roiIndex) const;
+	// A new descriptor: seen once, now
+	static void StampNewWord(DescriptorStruct &wordPtr, size_t currStamp);
+	// A descriptor seen again now
+	static void StampWordOccurrence(DescriptorStruct &wordPtr, size_t currStamp);
+	// Move a pixel's epoch forward before its stamps run out of 16 bits
+	void RebaseWordStamps(size_t roiIndex);
+	// Keep a word position up to date when the words at 'swapIndex' and 'swapIndex - 1' swap
+	static void FollowSwappedWord(size_t &wordIndex, size_t swapIndex);
 
 	/*=====LUT Methods=====*/
 	// Generate neighborhood pixel offset value - checked
-	void BackgroundSubtractorLCDP::GenerateNbOffset(PxInfo &pxInfoPtr);
+	void GenerateNbOffset(PxInfo &pxInfoPtr);
 	// Generate LCD differences Lookup table (0: 100% Same -> 1: 100% Different) - checked
-	void GenerateLCDDiffLUT();
+	static void GenerateLCDDiffLUT();
 
 	/*=====MATCHING Methods=====*/
-	// Descriptor matching (RETURN: LCDPResult-1:Not match, 0: Match)
-	void BackgroundSubtractorLCDP::DescriptorMatching(DescriptorStruct &bgWord, DescriptorStruct &currWord
+	// Descriptor matching (RETURN: LCDPResult-1:Not match, 0: Match), specialised on the LCDP / RGB
+	// switches, the neighbourhood and gray input
+	template <bool LCDPDiff, bool RGBDiff, int NbNo, bool Mono>
+	void DescriptorMatching(DescriptorStruct &bgWord, DescriptorStruct &currWord
 		,  size_t &descNeighNo,  double LCDPThreshold,  double upLCDPThreshold,  double RGBThreshold,
 		float &LCDPDistance, float &RGBDistance, bool &matchResult, bool &matchResultBoth);
 	
 	// LCD Matching (RETURN-1:Not match, 0: Match)
+	template <int NbNo, bool Mono>
 	void LCDPMatching(DescriptorStruct &bgWord, DescriptorStruct &currWord,
 		 size_t &descNeighNo,  double &LCDPThreshold, float &minDistance, bool &matchResult);
-	// RGB Matching (RETURN-1:Not match, 0: Match)
+	// RGB Matching (RETURN-1:Not match, 0: Match); gray words compare their intensity only
+	template <bool Mono>
 	void RGBMatching(DescriptorStruct &bgWord, DescriptorStruct &currWord,
 		double &RGBThreshold, float &minDistance, bool &matchResult);
 	// RGB Dark Pixel (RETURN-1:Not Dark Pixel, 0: Dark Pixel) Checked May 14
-	void BackgroundSubtractorLCDP::RGBDarkPixel(DescriptorStruct &bgWord, DescriptorStruct &currWord, bool &result);
+	void RGBDarkPixel(DescriptorStruct &bgWord, DescriptorStruct &currWord, bool &result);
+	// Luminance Dark Pixel of gray words (RETURN-1:Not Dark Pixel, 0: Dark Pixel)
+	void LuminanceDarkPixel(DescriptorStruct &bgWord, DescriptorStruct &currWord, bool &result);
+	// Mark the unchanged blocks of the change gate
+	void UpdateChangeGate(const cv::Mat &inputImg);
 	// Dark Pixel generator (RETURN-1: Not dark pixel, 0: dark pixel)
 	void DarkPixelGenerator(cv::Mat &inputGrayImg, cv::Mat &inputRGBImg,
 		 cv::Mat &lastGrayImg, cv::Mat &lastRGBImg, cv::Mat &darkPixel);
 
 	/*=====POST-PROCESSING Methods=====*/
+	// Post-processing chain of Process on resCurrFGMask into resLastFGMask (inputGrayImg: current gray frame)
+	void PostProcess(const cv::Mat &inputGrayImg);
 	// Compensation with Motion History - checked
 	cv::Mat CompensationMotionHist(cv::Mat T_1FGMask, cv::Mat T_2FGMask, cv::Mat currFGMask, float postCompensationThreshold);
 	// Contour filling the empty holes - checked
 	cv::Mat ContourFill(cv::Mat inputImg);
 	cv::Mat BorderLineReconst(cv::Mat inputMask);
+	// Upsample a reduced-resolution mask, snapping its boundaries to the full-resolution colour edges
+	void UpsampleMask(const cv::Mat &mask, const cv::Mat &guideImg, cv::Mat &outputMask);
+	// Same with a gray guide (guide and upsampled mask as CV_32FC1 in 0-1)
+	void UpsampleMaskGray(const cv::Mat &guide, const cv::Mat &maskUp, cv::Size windowSize, cv::Mat &outputMask);
+	// Frame size / ROI of the model in reduced-resolution mode
+	static cv::Size ScaledFrameSize(cv::Size inputFrameSize, int scale);
+	static cv::Mat ScaledROI(cv::Mat inputROI, cv::Size scaledSize);
 
 	/*=====DEBUG=====*/
 	cv::Point debPxLocation;
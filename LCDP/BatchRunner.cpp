@@ -0,0 +1,627 @@
+#include "BatchRunner.h"
+#include "Functions.h"
+#include "PipelineRunner.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// Cores kept busy by one dataset in flight
+#define CORES_PER_DATASET 2
+
+LCDPParameters::LCDPParameters() :
+	/*=====PRE PROCESS Parameters=====*/
+	PreSwitch(true),
+	Words_No(35),
+
+	/*=====CLASSIFIER Parameters=====*/
+	descColourDiffRatio(0.15),
+	clsRGBDiffSwitch(true),
+	clsRGBThreshold(10),
+	clsLCDPDiffSwitch(true),
+	clsLCDPThreshold(0.25),
+	clsUpLCDPThreshold(0.7),
+	clsLCDPMaxThreshold(0.7),
+	clsNbMatchSwitch(true),
+	clsMatchingThreshold(2),
+
+	/*=====UPDATE Parameters=====*/
+	upRandomReplaceSwitch(false),
+	upRandomUpdateNbSwitch(false),
+	upFeedbackSwitch(true),
+	upDynamicRateIncrease(1.0f),
+	upDynamicRateDecrease(0.1f),
+	upMinDynamicRate(0.0f),
+	upUpdateRateIncrease(0.5f),
+	upUpdateRateDecrease(0.5f),
+	upUpdateRateLowest(2.0f),
+	upUpdateRateHighest(255.0f),
+
+	/*=====RGB Dark Pixel Parameter=====*/
+	darkMinIntensityRatio(0.25f),
+	darkMaxIntensityRatio(0.8f),
+	darkRDiffRatioMin(0.04097f),
+	darkRDiffRatioMax(0.08477f),
+	darkGDiffRatioMin(-0.0002f),
+	darkGDiffRatioMax(0.02774f),
+
+	/*=====POST PROCESS Parameters=====*/
+	PostSwitch(true),
+
+	/*=====REDUCED RESOLUTION Parameters=====*/
+	processScale(1),
+
+	/*=====DESCRIPTOR Parameters=====*/
+	descNbNo(16)
+{
+}
+
+// Construct a background subtractor for one sequence
+std::unique_ptr<BackgroundSubtractorLCDP> LCDPParameters::CreateSubtractor(cv::Mat ROI, cv::Size frameSize, int frameCount) const {
+	std::unique_ptr<BackgroundSubtractorLCDP> subtractor(new BackgroundSubtractorLCDP(Words_No, PreSwitch,
+		descColourDiffRatio, clsRGBDiffSwitch, clsRGBThreshold, clsLCDPDiffSwitch,
+		clsLCDPThreshold, clsUpLCDPThreshold, clsLCDPMaxThreshold, clsMatchingThreshold,
+		clsNbMatchSwitch, ROI, frameSize, frameCount, upRandomReplaceSwitch, upRandomUpdateNbSwitch,
+		upFeedbackSwitch, upDynamicRateIncrease, upDynamicRateDecrease, upMinDynamicRate, upUpdateRateIncrease,
+		upUpdateRateDecrease, upUpdateRateLowest, upUpdateRateHighest,
+		darkMinIntensityRatio, darkMaxIntensityRatio, darkRDiffRatioMin, darkRDiffRatioMax, darkGDiffRatioMin, darkGDiffRatioMax,
+		PostSwitch, processScale));
+	subtractor->SetDescriptorNeighbours(descNbNo);
+	return subtractor;
+}
+
+DatasetOptions::DatasetOptions() :
+	showInput(false),
+	showOutput(false),
+	saveResult(false),
+	evaluateResult(true),
+	queueCapacity(8),
+	profile(false),
+	latencyBudgetMs(0.0),
+	checkpointInterval(0),
+	resumeCheckpoint(false),
+	modelStorage(ModelStorage::STORAGE_HEAP),
+	changeGateBlockSize(0),
+	changeGateThreshold(2.0f),
+	changeGateInterval(25),
+	adaptiveModel(false),
+	adaptiveModelBudgetMB(0),
+	pageSize(ModelStorage::PAGES_DEFAULT),
+	numaNode(-1),
+
+	/*=====SAVE RESULT Parameters=====*/
+	saveFormat(MaskWriter::MASK_FORMAT_STREAM),
+	savePNGCompression(1),
+	saveArchiveSwitch(false),
+	saveEncoderNo(2),
+	saveMaxPendingBytes(64 * 1024 * 1024)
+{
+}
+
+DatasetReport::DatasetReport() :
+	loaded(false),
+	completed(false),
+	readFailed(false),
+	frameNo(0),
+	processSeconds(0.0),
+	wallSeconds(0.0),
+	evaluatedNo(0),
+	missingNo(0),
+	processScale(1),
+	modelBytes(0),
+	descNbNo(16),
+	numaNode(-1)
+{
+}
+
+// Run one dataset
+bool RunDataset(const std::string &datasetName, const LCDPParameters &parameters,
+	const DatasetOptions &options, DatasetReport &report) {
+	const std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+	report = DatasetReport();
+	report.name = datasetName;
+	// Pin before anything is allocated: Initialize first touches the model on this thread
+	if ((options.numaNode >= 0) && SetCurrentThreadNode(options.numaNode)) {
+		report.numaNode = options.numaNode;
+	}
+	else if (options.numaNode >= 0) {
+		std::cout << "Cannot pin dataset " << datasetName << " to NUMA node " << options.numaNode << std::endl;
+	}
+
+	/// Frame Parameters
+	// Frames per second (FPS) of the input video
+	double FPS;
+	// Total number of frame of the input video
+	double FRAME_COUNT;
+	// Frame size of the input video
+	cv::Size FRAME_SIZE;
+	// Video file name
+	std::string filename = datasetName;
+	bool success = false;
+	cv::VideoCapture videoCapture = readVideoInput2(&filename, &FPS, &FRAME_COUNT, &FRAME_SIZE, &success);
+	if (!success) {
+		std::cout << "Cannot load dataset: " << filename << ". Skip it to next dataset!" << std::endl;
+		return false;
+	}
+	report.loaded = true;
+	std::cout << "Now load dataset: " << filename << std::endl;
+	const std::string versionFolderName = filename + "/" + programVersion;
+	MakeDirectory(versionFolderName);
+	// Region of interest frame
+	cv::Mat ROI_FRAME(FRAME_SIZE, CV_8UC1, cv::Scalar(255));
+
+	// Read first frame from video
+	cv::Mat inputFrame;
+	videoCapture.set(cv::CAP_PROP_POS_FRAMES, 0);
+	videoCapture >> inputFrame;
+
+	// Current date/time based on current system
+	time_t startTime = time(0);
+	// Current process result folder name
+	const std::string saveFolderName = versionFolderName + "/" + filename + "-" + programVersion + "-" + currentDateTimeStamp(&startTime);
+
+	// Declare background subtractor
+	std::unique_ptr<BackgroundSubtractorLCDP> backgroundSubtractorLCDP =
+		parameters.CreateSubtractor(ROI_FRAME, FRAME_SIZE, int(FRAME_COUNT));
+	if (options.modelStorage == ModelStorage::STORAGE_FILE) {
+		backgroundSubtractorLCDP->SetModelStorage(options.modelStorage, versionFolderName + "/model.lcdpmm");
+	}
+	else if (options.modelStorage == ModelStorage::STORAGE_SHARED_MEMORY) {
+#ifdef _WIN32
+		backgroundSubtractorLCDP->SetModelStorage(options.modelStorage, "Local\\lcdp-" + filename);
+#else
+		backgroundSubtractorLCDP->SetModelStorage(options.modelStorage, "/lcdp-" + filename);
+#endif
+	}
+	if (options.adaptiveModel) {
+		backgroundSubtractorLCDP->SetAdaptiveModel(true, options.adaptiveModelBudgetMB * 1024 * 1024);
+	}
+	backgroundSubtractorLCDP->SetPageSize(options.pageSize);
+	// Initialize background subtractor
+	backgroundSubtractorLCDP->Initialize(inputFrame, ROI_FRAME);
+	if (options.changeGateBlockSize > 0) {
+		backgroundSubtractorLCDP->SetChangeGate(options.changeGateBlockSize, options.changeGateThreshold, options.changeGateInterval);
+	}
+	report.processScale = parameters.processScale;
+	report.modelBytes = backgroundSubtractorLCDP->GetModelBytes();
+	report.descNbNo = backgroundSubtractorLCDP->GetDescriptorNeighbours();
+	// The checkpoint is kept per dataset and program version, so it survives restarts
+	const std::string checkpointFileName = versionFolderName + "/model.lcdpck";
+	if (options.resumeCheckpoint) {
+		if (backgroundSubtractorLCDP->LoadCheckpoint(checkpointFileName)) {
+			std::cout << "Warm restart from checkpoint at frame " << backgroundSubtractorLCDP->GetFrameIndex() << std::endl;
+		}
+		else {
+			std::cout << "No usable checkpoint: " << checkpointFileName << ". Start from bootstrapping." << std::endl;
+		}
+	}
+
+	std::string resultFolderName;
+	if (options.saveResult) {
+		MakeDirectory(saveFolderName);
+		SaveParameter(versionFolderName, saveFolderName);
+		backgroundSubtractorLCDP->folderName = saveFolderName;
+		backgroundSubtractorLCDP->SaveParameter(versionFolderName, saveFolderName);
+		resultFolderName = saveFolderName + "/results";
+		MakeDirectory(resultFolderName);
+		report.saveFolderName = saveFolderName;
+	}
+	// Masks are encoded and written by the writer's own threads
+	std::unique_ptr<MaskWriter> maskWriter;
+	if (options.saveResult) {
+		maskWriter.reset(new MaskWriter(resultFolderName, options.saveFormat, options.savePNGCompression,
+			options.saveArchiveSwitch, options.saveEncoderNo, options.saveMaxPendingBytes));
+	}
+	// Per-stage latency histograms of Process
+	Profiler profiler(BackgroundSubtractorLCDP::GetProcessStageNames());
+	if (options.profile) {
+		backgroundSubtractorLCDP->SetProfiler(&profiler);
+	}
+	// Masks are evaluated in memory as they are produced
+	OnlineEvaluator onlineEvaluator;
+	if (options.evaluateResult && !onlineEvaluator.Open(filename)) {
+		std::cout << "Cannot read temporalROI.txt of dataset: " << filename << std::endl;
+	}
+	// Decode, subtract and output run as separate pipeline stages
+	PipelineRunner pipelineRunner(options.queueCapacity, options.showInput, options.showOutput);
+	// Process has to run on the node the model was first touched on
+	pipelineRunner.SetNumaNode(report.numaNode);
+	// Quality is traded for time when a frame budget is set
+	LatencyBudgetController latencyController(options.latencyBudgetMs, parameters.Words_No);
+	if (options.latencyBudgetMs > 0.0) {
+		pipelineRunner.SetLatencyController(&latencyController);
+	}
+	// Periodic model checkpoints, written in the background
+	std::unique_ptr<CheckpointWriter> checkpointWriter;
+	if (options.checkpointInterval > 0) {
+		checkpointWriter.reset(new CheckpointWriter(checkpointFileName));
+		pipelineRunner.SetCheckpointWriter(checkpointWriter.get(), options.checkpointInterval);
+	}
+	pipelineRunner.Run(videoCapture, inputFrame, int(FRAME_COUNT), *backgroundSubtractorLCDP,
+		[&](int currFrameIndex, const cv::Mat &, const cv::Mat &currFGMask) {
+		if (maskWriter) {
+			maskWriter->Write(currFrameIndex, currFGMask);
+		}
+		if (options.evaluateResult) {
+			onlineEvaluator.Add(currFrameIndex, currFGMask);
+		}
+	});
+	if (maskWriter) {
+		// End of run: every mask is on disk after this point
+		maskWriter->Flush();
+		maskWriter->PrintStats(std::cout);
+	}
+	report.processSeconds = pipelineRunner.GetProcessSeconds();
+	report.frameNo = pipelineRunner.GetStageStats()[1].itemNo;
+	report.readFailed = pipelineRunner.IsReadFailed();
+	report.completed = !report.readFailed && (report.frameNo == size_t(FRAME_COUNT));
+	pipelineRunner.PrintStats(std::cout);
+	if (checkpointWriter) {
+		// Final checkpoint of the model as it ends the run
+		checkpointWriter->Flush();
+		checkpointWriter->Submit(*backgroundSubtractorLCDP);
+		if (!checkpointWriter->Flush()) {
+			std::cout << "Cannot write model checkpoint: " << checkpointFileName << std::endl;
+		}
+		checkpointWriter->PrintStats(std::cout);
+	}
+	if (options.profile) {
+		backgroundSubtractorLCDP->SetProfiler(nullptr);
+		profiler.PrintStats(std::cout);
+		MakeDirectory(saveFolderName);
+		if (!profiler.SaveCSV(saveFolderName + "/profile.csv") || !profiler.SaveJSON(saveFolderName + "/profile.json")) {
+			std::cout << "Cannot write profile to " << saveFolderName << std::endl;
+		}
+	}
+
+	if (options.latencyBudgetMs > 0.0) {
+		backgroundSubtractorLCDP->SetQualityLimits(BackgroundSubtractorLCDP::FullQuality());
+		latencyController.PrintStats(std::cout);
+		MakeDirectory(saveFolderName);
+		if (!latencyController.SaveLog(saveFolderName + "/latency.csv")) {
+			std::cout << "Cannot write latency log to " << saveFolderName << std::endl;
+		}
+	}
+
+	if (options.changeGateBlockSize > 0) {
+		const std::vector<float> &skippedFractions = backgroundSubtractorLCDP->GetSkippedFractions();
+		double skippedSum = 0.0;
+		for (auto skippedFraction : skippedFractions) {
+			skippedSum += skippedFraction;
+		}
+		std::cout << "\n<<<<<-CHANGE GATE->>>>>\n";
+		std::cout << "MEAN SKIPPED FRACTION: " << std::setprecision(3) << std::fixed
+			<< (skippedFractions.empty() ? 0.0 : (skippedSum / skippedFractions.size())) << std::endl;
+		MakeDirectory(saveFolderName);
+		std::ofstream gateFile(saveFolderName + "/gate.csv");
+		// One row per Process call with the gate on
+		gateFile << "processed_frame,skipped_fraction" << std::endl;
+		for (size_t frameIndex = 0; frameIndex < skippedFractions.size(); frameIndex++) {
+			gateFile << (frameIndex + 1) << "," << skippedFractions[frameIndex] << std::endl;
+		}
+		if (!gateFile.good()) {
+			std::cout << "Cannot write change gate log to " << saveFolderName << std::endl;
+		}
+	}
+
+	if (options.adaptiveModel) {
+		std::cout << "\n<<<<<-ADAPTIVE MODEL->>>>>\n";
+		backgroundSubtractorLCDP->PrintModelStats(std::cout);
+	}
+
+	time_t finishTime = time(0);
+	GenerateProcessTime(FRAME_COUNT, saveFolderName, startTime, finishTime, report.processSeconds, options.saveResult);
+
+	std::cout << "Background subtraction completed" << std::endl;
+
+	if (options.evaluateResult) {
+		report.evaluatedNo = onlineEvaluator.GetEvaluatedNo();
+		report.missingNo = onlineEvaluator.GetMissingNo();
+		report.counts = onlineEvaluator.GetCounts();
+		if ((report.evaluatedNo > 0) && (report.missingNo == 0)) {
+			if (options.saveResult) {
+				std::ofstream myfile;
+				myfile.open(saveFolderName + "/parameter.txt", std::ios::app);
+				WriteStatistics(myfile, report.counts);
+				myfile.close();
+			}
+			PrintStatisticsSummary(std::cout, report.counts);
+		}
+		else {
+			std::cout << "Groundtruth missing for " << report.missingNo << " frame(s)" << std::endl;
+			std::cout << "Skipping evaluation process!" << std::endl;
+		}
+	}
+	report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	return report.completed;
+}
+
+// Compare reduced-resolution runs with the full-resolution run of the same dataset
+void WriteScaleComparison(std::ostream &output, const std::vector<DatasetReport> &reports, bool csvSwitch) {
+	if (csvSwitch) {
+		output << "dataset,scale,model_mb,ms_per_frame,speedup,recall,precision,f_measure,f_measure_change" << std::endl;
+	}
+	else {
+		output << std::left << std::setw(16) << "DATASET" << std::right << std::setw(7) << "SCALE" << std::setw(11) << "MODEL(MB)"
+			<< std::setw(10) << "MS/FRAME" << std::setw(9) << "SPEEDUP" << std::setw(10) << "RECALL" << std::setw(11) << "PRECISION"
+			<< std::setw(11) << "F-MEASURE" << std::setw(10) << "CHANGE" << std::endl;
+	}
+	for (auto & report : reports) {
+		if (!report.loaded) {
+			continue;
+		}
+		// Full-resolution run of the same dataset
+		const DatasetReport * fullReport = nullptr;
+		for (auto & candidate : reports) {
+			if (candidate.loaded && (candidate.name == report.name) && (candidate.processScale == 1)) {
+				fullReport = &candidate;
+				break;
+			}
+		}
+		const double msPerFrame = (report.frameNo > 0) ? (1000.0 * report.processSeconds / report.frameNo) : 0.0;
+		const double fullMsPerFrame = ((fullReport != nullptr) && (fullReport->frameNo > 0)) ?
+			(1000.0 * fullReport->processSeconds / fullReport->frameNo) : 0.0;
+		const double speedup = (msPerFrame > 0.0) ? (fullMsPerFrame / msPerFrame) : 0.0;
+		const EvaluationMetrics metrics(report.counts);
+		const double change = (fullReport != nullptr) ? (metrics.FMeasure - EvaluationMetrics(fullReport->counts).FMeasure) : 0.0;
+		const double modelMegabytes = report.modelBytes / (1024.0 * 1024.0);
+		if (csvSwitch) {
+			output << report.name << "," << report.processScale << std::setprecision(3) << std::fixed << "," << modelMegabytes
+				<< "," << msPerFrame << "," << speedup << std::setprecision(5) << "," << metrics.recall << "," << metrics.precision
+				<< "," << metrics.FMeasure << "," << change << std::endl;
+		}
+		else {
+			output << std::left << std::setw(16) << report.name << std::right << std::setw(7) << report.processScale
+				<< std::setprecision(1) << std::fixed << std::setw(11) << modelMegabytes << std::setw(10) << msPerFrame
+				<< std::setprecision(2) << std::setw(9) << speedup << std::setprecision(3) << std::setw(10) << metrics.recall
+				<< std::setw(11) << metrics.precision << std::setw(11) << metrics.FMeasure << std::showpos << std::setw(10) << change
+				<< std::noshowpos << std::endl;
+		}
+	}
+}
+
+// Compare runs with other descriptor neighbourhoods with the 16-neighbour run of the same dataset
+void WriteDescriptorComparison(std::ostream &output, const std::vector<DatasetReport> &reports, bool csvSwitch) {
+	if (csvSwitch) {
+		output << "dataset,neighbours,model_mb,ms_per_frame,speedup,recall,precision,f_measure,f_measure_change" << std::endl;
+	}
+	else {
+		output << std::left << std::setw(16) << "DATASET" << std::right << std::setw(11) << "NEIGHBOURS" << std::setw(11) << "MODEL(MB)"
+			<< std::setw(10) << "MS/FRAME" << std::setw(9) << "SPEEDUP" << std::setw(10) << "RECALL" << std::setw(11) << "PRECISION"
+			<< std::setw(11) << "F-MEASURE" << std::setw(10) << "CHANGE" << std::endl;
+	}
+	for (auto & report : reports) {
+		if (!report.loaded) {
+			continue;
+		}
+		// Default-neighbourhood run of the same dataset
+		const DatasetReport * defaultReport = nullptr;
+		for (auto & candidate : reports) {
+			if (candidate.loaded && (candidate.name == report.name) && (candidate.descNbNo == 16)) {
+				defaultReport = &candidate;
+				break;
+			}
+		}
+		const double msPerFrame = (report.frameNo > 0) ? (1000.0 * report.processSeconds / report.frameNo) : 0.0;
+		const double defaultMsPerFrame = ((defaultReport != nullptr) && (defaultReport->frameNo > 0)) ?
+			(1000.0 * defaultReport->processSeconds / defaultReport->frameNo) : 0.0;
+		const double speedup = (msPerFrame > 0.0) ? (defaultMsPerFrame / msPerFrame) : 0.0;
+		const EvaluationMetrics metrics(report.counts);
+		const double change = (defaultReport != nullptr) ? (metrics.FMeasure - EvaluationMetrics(defaultReport->counts).FMeasure) : 0.0;
+		const double modelMegabytes = report.modelBytes / (1024.0 * 1024.0);
+		if (csvSwitch) {
+			output << report.name << "," << report.descNbNo << std::setprecision(3) << std::fixed << "," << modelMegabytes
+				<< "," << msPerFrame << "," << speedup << std::setprecision(5) << "," << metrics.recall << "," << metrics.precision
+				<< "," << metrics.FMeasure << "," << change << std::endl;
+		}
+		else {
+			output << std::left << std::setw(16) << report.name << std::right << std::setw(11) << report.descNbNo
+				<< std::setprecision(1) << std::fixed << std::setw(11) << modelMegabytes << std::setw(10) << msPerFrame
+				<< std::setprecision(2) << std::setw(9) << speedup << std::setprecision(3) << std::setw(10) << metrics.recall
+				<< std::setw(11) << metrics.precision << std::setw(11) << metrics.FMeasure << std::showpos << std::setw(10) << change
+				<< std::noshowpos << std::endl;
+		}
+	}
+}
+
+// Compare the same batch run without and with NUMA pinning
+void WriteNumaComparison(std::ostream &output, const std::vector<DatasetReport> &unpinnedReports, double unpinnedSeconds,
+	const std::vector<DatasetReport> &pinnedReports, double pinnedSeconds, bool csvSwitch) {
+	if (csvSwitch) {
+		output << "dataset,node,unpinned_fps,pinned_fps,speedup" << std::endl;
+	}
+	else {
+		output << std::left << std::setw(16) << "DATASET" << std::right << std::setw(6) << "NODE" << std::setw(14) << "UNPINNED FPS"
+			<< std::setw(12) << "PINNED FPS" << std::setw(9) << "SPEEDUP" << std::endl;
+	}
+	size_t unpinnedFrameNo = 0, pinnedFrameNo = 0;
+	for (size_t reportIndex = 0; reportIndex < std::min(unpinnedReports.size(), pinnedReports.size()); reportIndex++) {
+		const DatasetReport &unpinnedReport = unpinnedReports[reportIndex];
+		const DatasetReport &pinnedReport = pinnedReports[reportIndex];
+		unpinnedFrameNo += unpinnedReport.frameNo;
+		pinnedFrameNo += pinnedReport.frameNo;
+		if (!unpinnedReport.loaded || !pinnedReport.loaded) {
+			continue;
+		}
+		const double unpinnedFPS = (unpinnedReport.processSeconds > 0.0) ? (unpinnedReport.frameNo / unpinnedReport.processSeconds) : 0.0;
+		const double pinnedFPS = (pinnedReport.processSeconds > 0.0) ? (pinnedReport.frameNo / pinnedReport.processSeconds) : 0.0;
+		const double speedup = (unpinnedFPS > 0.0) ? (pinnedFPS / unpinnedFPS) : 0.0;
+		if (csvSwitch) {
+			output << pinnedReport.name << "," << pinnedReport.numaNode << std::setprecision(3) << std::fixed << "," << unpinnedFPS
+				<< "," << pinnedFPS << "," << speedup << std::endl;
+		}
+		else {
+			output << std::left << std::setw(16) << pinnedReport.name << std::right << std::setw(6) << pinnedReport.numaNode
+				<< std::setprecision(2) << std::fixed << std::setw(14) << unpinnedFPS << std::setw(12) << pinnedFPS
+				<< std::setw(9) << speedup << std::endl;
+		}
+	}
+	// Whole batch: every frame of every dataset over the wall time of the batch
+	const double unpinnedFPS = (unpinnedSeconds > 0.0) ? (unpinnedFrameNo / unpinnedSeconds) : 0.0;
+	const double pinnedFPS = (pinnedSeconds > 0.0) ? (pinnedFrameNo / pinnedSeconds) : 0.0;
+	const double speedup = (unpinnedFPS > 0.0) ? (pinnedFPS / unpinnedFPS) : 0.0;
+	if (csvSwitch) {
+		output << "BATCH,," << std::setprecision(3) << std::fixed << unpinnedFPS << "," << pinnedFPS << "," << speedup << std::endl;
+	}
+	else {
+		output << std::left << std::setw(16) << "BATCH" << std::right << std::setw(6) << "" << std::setprecision(2) << std::fixed
+			<< std::setw(14) << unpinnedFPS << std::setw(12) << pinnedFPS << std::setw(9) << speedup << std::endl;
+	}
+}
+
+/*******CONSTRUCTOR*******/
+BatchRunner::BatchRunner(size_t inputCoreBudget, size_t inputJobNo) :
+	coreBudget((inputCoreBudget > 0) ? inputCoreBudget : size_t(GetHardwareThreadNo())),
+	jobNo(inputJobNo),
+	numaPinning(false),
+	nextDataset(0),
+	wallSeconds(0.0)
+{
+}
+
+// Add a dataset to the batch
+void BatchRunner::AddDataset(const std::string &datasetName) {
+	datasetNames.push_back(datasetName);
+}
+
+// Read dataset names from a job file
+bool BatchRunner::ReadJobFile(const std::string &fileName) {
+	std::ifstream jobFile(fileName);
+	if (!jobFile.is_open()) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(jobFile, line)) {
+		const size_t commentStart = line.find('#');
+		if (commentStart != std::string::npos) {
+			line.erase(commentStart);
+		}
+		const size_t first = line.find_first_not_of(" \t\r");
+		if (first == std::string::npos) {
+			continue;
+		}
+		const size_t last = line.find_last_not_of(" \t\r");
+		AddDataset(line.substr(first, last - first + 1));
+	}
+	return true;
+}
+
+// Pin every worker and its datasets to one NUMA node
+void BatchRunner::SetNumaPinning(bool inputNumaPinning) {
+	numaPinning = inputNumaPinning;
+}
+
+// Run every dataset
+bool BatchRunner::Run(const LCDPParameters &parameters, const DatasetOptions &options) {
+	const std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+	reports.assign(datasetNames.size(), DatasetReport());
+	nextDataset = 0;
+	const size_t workerNo = std::max<size_t>(1, std::min(GetJobNo(), datasetNames.size()));
+	std::cout << "Running " << datasetNames.size() << " dataset(s), " << workerNo << " at a time" << std::endl;
+	// OpenCV's own thread pool is shared by every dataset in flight: keep it within one dataset's share of the budget
+	const int openCVThreadNo = cv::getNumThreads();
+	cv::setNumThreads(int(std::max<size_t>(1, coreBudget / workerNo)));
+	std::vector<std::thread> workers;
+	for (size_t workerIndex = 0; workerIndex < workerNo; workerIndex++) {
+		workers.push_back(std::thread(&BatchRunner::WorkerLoop, this, workerIndex, std::cref(parameters), std::cref(options)));
+	}
+	for (auto & worker : workers) {
+		worker.join();
+	}
+	cv::setNumThreads(openCVThreadNo);
+	wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+	bool allCompleted = true;
+	for (auto & report : reports) {
+		allCompleted = allCompleted && report.completed;
+	}
+	return allCompleted;
+}
+
+// Worker thread main loop
+void BatchRunner::WorkerLoop(size_t workerIndex, const LCDPParameters &parameters, const DatasetOptions &options) {
+	DatasetOptions workerOptions = options;
+	if (numaPinning) {
+		workerOptions.numaNode = int(workerIndex % size_t(GetNumaNodeNo()));
+	}
+	while (true) {
+		const size_t datasetIndex = nextDataset++;
+		if (datasetIndex >= datasetNames.size()) {
+			break;
+		}
+		RunDataset(datasetNames[datasetIndex], parameters, workerOptions, reports[datasetIndex]);
+	}
+}
+
+// Total number of datasets run at the same time
+size_t BatchRunner::GetJobNo() const {
+	return (jobNo > 0) ? jobNo : std::max<size_t>(1, coreBudget / CORES_PER_DATASET);
+}
+
+// Wall time of the last Run
+double BatchRunner::GetWallSeconds() const {
+	return wallSeconds;
+}
+
+// Reports in the order the datasets were added
+const std::vector<DatasetReport> & BatchRunner::GetReports() const {
+	return reports;
+}
+
+// Write the per-dataset timing and metrics table
+void BatchRunner::WriteReport(std::ostream &output, bool csvSwitch) const {
+	const char * columnNames[11] = { "DATASET", "STATUS", "FRAMES", "PROCESS(S)", "WALL(S)", "FPS",
+		"EVALUATED", "MISSING", "RECALL", "PRECISION", "F-MEASURE" };
+	const int columnWidths[11] = { 16, 11, 8, 12, 10, 9, 11, 9, 10, 11, 11 };
+	for (int columnIndex = 0; columnIndex < 11; columnIndex++) {
+		if (csvSwitch) {
+			output << ((columnIndex > 0) ? "," : "") << columnNames[columnIndex];
+		}
+		else {
+			output << ((columnIndex < 2) ? std::left : std::right) << std::setw(columnWidths[columnIndex]) << columnNames[columnIndex];
+		}
+	}
+	output << (csvSwitch ? ",RESULT FOLDER" : "") << std::endl;
+	for (auto & report : reports) {
+		const std::string status = !report.loaded ? "NOT LOADED" : (report.completed ? "COMPLETED" : "INCOMPLETE");
+		const double FPS = (report.processSeconds > 0.0) ? (report.frameNo / report.processSeconds) : 0.0;
+		const EvaluationMetrics metrics(report.counts);
+		// Nothing evaluated: the metrics are n/a (empty in CSV), as in OfflineEvaluator
+		const bool evaluated = report.evaluatedNo > 0;
+		if (csvSwitch) {
+			output << report.name << "," << status << "," << report.frameNo << std::setprecision(3) << std::fixed
+				<< "," << report.processSeconds << "," << report.wallSeconds << "," << FPS
+				<< "," << report.evaluatedNo << "," << report.missingNo << std::setprecision(5);
+			if (evaluated) {
+				output << "," << metrics.recall << "," << metrics.precision << "," << metrics.FMeasure;
+			}
+			else {
+				output << ",,,";
+			}
+			output << "," << report.saveFolderName << std::endl;
+		}
+		else {
+			output << std::left << std::setw(16) << report.name << std::setw(11) << status << std::right
+				<< std::setw(8) << report.frameNo << std::setprecision(2) << std::fixed
+				<< std::setw(12) << report.processSeconds << std::setw(10) << report.wallSeconds << std::setw(9) << FPS
+				<< std::setw(11) << report.evaluatedNo << std::setw(9) << report.missingNo << std::setprecision(3);
+			if (evaluated) {
+				output << std::setw(10) << metrics.recall << std::setw(11) << metrics.precision << std::setw(11) << metrics.FMeasure << std::endl;
+			}
+			else {
+				output << std::setw(10) << "n/a" << std::setw(11) << "n/a" << std::setw(11) << "n/a" << std::endl;
+			}
+		}
+	}
+}
+
+// Save the per-dataset timing and metrics table as CSV
+bool BatchRunner::SaveReport(const std::string &fileName) const {
+	std::ofstream reportFile(fileName);
+	if (!reportFile.is_open()) {
+		return false;
+	}
+	WriteReport(reportFile, true);
+	return reportFile.good();
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#ifndef __BatchRunner_H_INCLUDED
+#define __BatchRunner_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include "BackgroundSubtractorLCDP.h"
+#include "MaskWriter.h"
+#include "Evaluation.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <ostream>
+
+// Background subtractor parameters (defaults: proposed method final)
+struct LCDPParameters {
+	/*=====PRE PROCESS Parameters=====*/
+	bool PreSwitch;
+	// Total number of words per pixel
+	size_t Words_No;
+
+	/*=====CLASSIFIER Parameters=====*/
+	double descColourDiffRatio;
+	// RGB detection switch
+	bool clsRGBDiffSwitch;
+	// RGB differences threshold
+	double clsRGBThreshold;
+	// LCDP detection switch
+	bool clsLCDPDiffSwitch;
+	// LCDP differences threshold (0-1)
+	double clsLCDPThreshold;
+	// Up LCDP differences threshold
+	double clsUpLCDPThreshold;
+	// Maximum number of LCDP differences threshold
+	double clsLCDPMaxThreshold;
+	// neighborhood matching switch
+	bool clsNbMatchSwitch;
+	// Matching threshold
+	int clsMatchingThreshold;
+
+	/*=====UPDATE Parameters=====*/
+	// Random replace model switch
+	bool upRandomReplaceSwitch;
+	// Random update neighborhood model switch
+	bool upRandomUpdateNbSwitch;
+	// Feedback loop switch
+	bool upFeedbackSwitch;
+	// Feedback V(x) Increment
+	float upDynamicRateIncrease;
+	// Feedback V(x) Decrement
+	float upDynamicRateDecrease;
+	// Minimum of Feedback V(x) value
+	float upMinDynamicRate;
+	// Feedback T(x) Increment
+	float upUpdateRateIncrease;
+	// Feedback T(x) Decrement
+	float upUpdateRateDecrease;
+	// Feedback T(x) Lowest
+	float upUpdateRateLowest;
+	// Feedback T(x) Highest
+	float upUpdateRateHighest;
+
+	/*=====RGB Dark Pixel Parameter=====*/
+	// Minimum Intensity Ratio
+	float darkMinIntensityRatio;
+	// Maximum Intensity Ratio
+	float darkMaxIntensityRatio;
+	// R-channel different ratio
+	float darkRDiffRatioMin;
+	float darkRDiffRatioMax;
+	// G-channel different ratio
+	float darkGDiffRatioMin;
+	float darkGDiffRatioMax;
+
+	/*=====POST PROCESS Parameters=====*/
+	bool PostSwitch;
+
+	/*=====REDUCED RESOLUTION Parameters=====*/
+	// Model frames downsampled by 2 or 4 and upsample the mask (1: full resolution)
+	int processScale;
+
+	/*=====DESCRIPTOR Parameters=====*/
+	// Descriptor neighbourhood (8, 16 or 24, see BackgroundSubtractorLCDP::SetDescriptorNeighbours)
+	int descNbNo;
+
+	LCDPParameters();
+	// Construct a background subtractor for one sequence
+	std::unique_ptr<BackgroundSubtractorLCDP> CreateSubtractor(cv::Mat ROI, cv::Size frameSize, int frameCount) const;
+};
+
+// How one dataset is run
+struct DatasetOptions {
+	// Show input frame switch
+	bool showInput;
+	// Show output frame switch
+	bool showOutput;
+	// Save result switch
+	bool saveResult;
+	// Evaluate result switch
+	bool evaluateResult;
+	// Capacity of each queue between the decode, subtract and output stages
+	size_t queueCapacity;
+	// Time every Process stage and export 'profile.csv' / 'profile.json' to the result folder
+	bool profile;
+	// Per-frame Process budget in ms (0: off); quality is lowered while frames run over it,
+	// and the decisions are exported as 'latency.csv' to the result folder
+	double latencyBudgetMs;
+	// Checkpoint the model to '<dataset>/<version>/model.lcdpck' every N frames and at the end (0: off)
+	size_t checkpointInterval;
+	// Warm restart: load that checkpoint after Initialize when it exists
+	bool resumeCheckpoint;
+	// Where the background words live: heap, '<dataset>/<version>/model.lcdpmm' (FILE) or
+	// the shared-memory segment '/lcdp-<dataset>' (SHARED_MEMORY)
+	ModelStorage::Backend modelStorage;
+	// Change gate block size (0: off), noise threshold and forced full pass interval (see
+	// BackgroundSubtractorLCDP::SetChangeGate); the skipped fraction of every frame is
+	// exported as 'gate.csv' to the result folder
+	int changeGateBlockSize;
+	float changeGateThreshold;
+	size_t changeGateInterval;
+	// Per-pixel word capacity from a pooled allocator (see BackgroundSubtractorLCDP::SetAdaptiveModel)
+	// and its memory budget in MB (0: up to the full word count per pixel)
+	bool adaptiveModel;
+	size_t adaptiveModelBudgetMB;
+	// Page size of the model and the per-pixel arrays (see BackgroundSubtractorLCDP::SetPageSize)
+	ModelStorage::PageSize pageSize;
+	// NUMA node of the dataset (-1: not pinned). The job thread and the pipeline stages run on
+	// the node's CPUs, so the model is first touched and processed on the same node.
+	int numaNode;
+
+	/*=====SAVE RESULT Parameters=====*/
+	// Mask file format (PNG/PGM/STREAM: run-length encoded mask stream)
+	MaskWriter::MaskFormat saveFormat;
+	// PNG compression level (0: fastest - 9: smallest)
+	int savePNGCompression;
+	// Batch all masks into one archive file instead of one file per frame
+	bool saveArchiveSwitch;
+	// Total number of encoder threads
+	size_t saveEncoderNo;
+	// Memory budget of masks waiting to be written
+	size_t saveMaxPendingBytes;
+
+	DatasetOptions();
+};
+
+// Outcome of one dataset
+struct DatasetReport {
+	// Dataset name
+	std::string name;
+	// Video could be opened
+	bool loaded;
+	// Every frame was processed
+	bool completed;
+	// Decoding stopped because the video could not be read
+	bool readFailed;
+	// Total number of frames processed
+	size_t frameNo;
+	// Time spent inside Process (s)
+	double processSeconds;
+	// Wall time of the whole dataset, including setup and evaluation (s)
+	double wallSeconds;
+	// Result folder (empty: results not saved)
+	std::string saveFolderName;
+	// Total number of frames evaluated / missing groundtruth
+	size_t evaluatedNo;
+	size_t missingNo;
+	// Confusion matrix of the evaluated frames
+	ConfusionCounts counts;
+	// Process scale and memory of the model (bytes)
+	int processScale;
+	size_t modelBytes;
+	// Descriptor neighbourhood
+	int descNbNo;
+	// NUMA node the dataset ran on (-1: not pinned)
+	int numaNode;
+
+	DatasetReport();
+};
+
+// Run one dataset (folder '<datasetName>/<datasetName>.avi|.mp4'): process every frame,
+// optionally save and evaluate the masks (RETURN-true: completed)
+bool RunDataset(const std::string &datasetName, const LCDPParameters &parameters,
+	const DatasetOptions &options, DatasetReport &report);
+// Compare reduced-resolution runs with the full-resolution run of the same dataset: model
+// memory, time per frame and accuracy on the groundtruth (reports without a scale-1 run of
+// their dataset are compared with nothing)
+void WriteScaleComparison(std::ostream &output, const std::vector<DatasetReport> &reports, bool csvSwitch);
+// Compare runs with other descriptor neighbourhoods with the 16-neighbour run of the same
+// dataset: model memory, time per frame and accuracy on the groundtruth
+void WriteDescriptorComparison(std::ostream &output, const std::vector<DatasetReport> &reports, bool csvSwitch);
+// Compare the same batch run without and with NUMA pinning: per-dataset FPS and the batch
+// throughput (frames over the batch wall time)
+void WriteNumaComparison(std::ostream &output, const std::vector<DatasetReport> &unpinnedReports, double unpinnedSeconds,
+	const std::vector<DatasetReport> &pinnedReports, double pinnedSeconds, bool csvSwitch);
+
+// Headless batch runner: runs a list of datasets concurrently on worker threads. The number
+// of datasets in flight follows a core budget (each dataset keeps about CORES_PER_DATASET
+// cores busy: one for Process, the rest shared by decoding, writing and evaluation).
+// With NUMA pinning, worker N runs its datasets on node N modulo the number of nodes.
+class BatchRunner {
+public:
+	/*******CONSTRUCTOR*******/
+	// coreBudget: cores to use (0: all hardware threads); jobNo: datasets in flight (0: from the core budget)
+	BatchRunner(size_t inputCoreBudget, size_t inputJobNo);
+
+	// Add a dataset to the batch
+	void AddDataset(const std::string &datasetName);
+	// Read dataset names from a job file: one per line, '#' starts a comment (RETURN-true: file read)
+	bool ReadJobFile(const std::string &fileName);
+	// Pin every worker and its datasets to one NUMA node (set before Run)
+	void SetNumaPinning(bool inputNumaPinning);
+	// Run every dataset (RETURN-true: every dataset completed)
+	bool Run(const LCDPParameters &parameters, const DatasetOptions &options);
+	// Total number of datasets run at the same time
+	size_t GetJobNo() const;
+	// Wall time of the last Run (s)
+	double GetWallSeconds() const;
+	// Reports in the order the datasets were added
+	const std::vector<DatasetReport> & GetReports() const;
+	// Write the per-dataset timing and metrics table (csvSwitch: comma separated)
+	void WriteReport(std::ostream &output, bool csvSwitch) const;
+	// Save the per-dataset timing and metrics table as CSV (RETURN-true: success)
+	bool SaveReport(const std::string &fileName) const;
+
+private:
+	// Worker thread main loop
+	void WorkerLoop(size_t workerIndex, const LCDPParameters &parameters, const DatasetOptions &options);
+
+	// Cores to use
+	const size_t coreBudget;
+	// Datasets in flight (0: from the core budget)
+	const size_t jobNo;
+	// Pin workers to NUMA nodes
+	bool numaPinning;
+	// Datasets of the batch
+	std::vector<std::string> datasetNames;
+	// Report of every dataset
+	std::vector<DatasetReport> reports;
+	// Next dataset to hand out
+	std::atomic<size_t> nextDataset;
+	// Wall time of the last Run (s)
+	double wallSeconds;
+};
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#ifndef __BoundedQueue_H_INCLUDED
+#define __BoundedQueue_H_INCLUDED
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// Bounded blocking multi-producer/multi-consumer queue used to connect pipeline stages.
+// Producers block while the queue is full, consumers block while it is empty; Close()
+// wakes everybody up and lets consumers drain what is left.
+template<typename T>
+class BoundedQueue {
+public:
+	/*******CONSTRUCTOR*******/
+	explicit BoundedQueue(size_t inputCapacity) :
+		capacity(inputCapacity > 0 ? inputCapacity : 1), closed(false), totalDepth(0), depthSamples(0) {
+	}
+
+	// Push an item, waiting for space (RETURN-true: pushed, false: queue closed)
+	bool Push(const T &item) {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		notFull.wait(lock, [this] { return closed || (items.size() < capacity); });
+		if (closed) {
+			return false;
+		}
+		items.push_back(item);
+		SampleDepth();
+		notEmpty.notify_one();
+		return true;
+	}
+	// Push an item only if there is space (RETURN-true: pushed, false: full or closed)
+	bool TryPush(const T &item) {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (closed || (items.size() >= capacity)) {
+			return false;
+		}
+		items.push_back(item);
+		SampleDepth();
+		notEmpty.notify_one();
+		return true;
+	}
+	// Pop the oldest item, waiting for one (RETURN-true: popped, false: closed and drained)
+	bool Pop(T &item) {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+		if (items.empty()) {
+			return false;
+		}
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+	// Pop the oldest item only if one is ready (RETURN-true: popped)
+	bool TryPop(T &item) {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (items.empty()) {
+			return false;
+		}
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+	// Stop accepting items and wake up every waiting thread
+	void Close() {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		closed = true;
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+	// Current number of queued items
+	size_t Size() {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		return items.size();
+	}
+	// Maximum number of items
+	size_t Capacity() const {
+		return capacity;
+	}
+	// Average queue depth seen by producers (fill ratio = AverageDepth / Capacity)
+	double AverageDepth() {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		return (depthSamples > 0) ? (double(totalDepth) / depthSamples) : 0.0;
+	}
+private:
+	void SampleDepth() {
+		totalDepth += items.size();
+		depthSamples++;
+	}
+	// Maximum number of items
+	const size_t capacity;
+	// Queued items
+	std::deque<T> items;
+	// Queue closed flag
+	bool closed;
+	// Depth statistics
+	size_t totalDepth;
+	size_t depthSamples;
+	std::mutex queueMutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+};
+#endif
@@ -0,0 +1,240 @@
+#include "Evaluation.h"
+#include <fstream>
+#include <iomanip>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define EVALUATION_SSE2
+#endif
+
+ConfusionCounts::ConfusionCounts() :
+	TP(0), FP(0), TN(0), FN(0), totalShadow(0), SE(0) {
+}
+
+// Accumulate another confusion matrix
+ConfusionCounts & ConfusionCounts::operator+=(const ConfusionCounts &other) {
+	TP += other.TP;
+	FP += other.FP;
+	TN += other.TN;
+	FN += other.FN;
+	totalShadow += other.totalShadow;
+	SE += other.SE;
+	return *this;
+}
+
+EvaluationMetrics::EvaluationMetrics(const ConfusionCounts &counts) {
+	const double TP = double(counts.TP), FP = double(counts.FP), TN = double(counts.TN), FN = double(counts.FN);
+	recall = TP / (TP + FN);
+	precision = TP / (TP + FP);
+	FMeasure = (2.0*recall*precision) / (recall + precision);
+	specificity = TN / (TN + FP);
+	FPR = FP / (FP + TN);
+	FNR = FN / (TP + FN);
+	PBC = 100.0 * (FN + FP) / (TP + FP + FN + TN);
+	shadowErrorRatio = double(counts.SE) / double(counts.totalShadow);
+}
+
+// Count one pixel
+static inline void CountPixel(uchar gtValue, uchar resValue, ConfusionCounts &counts) {
+	if (gtValue == GT_LABEL_FOREGROUND) {
+		if (resValue == 255) {
+			counts.TP++;
+		}
+		else if (resValue == 0) {
+			counts.FN++;
+		}
+	}
+	else if (gtValue <= GT_LABEL_SHADOW) {
+		if (gtValue == GT_LABEL_SHADOW) {
+			counts.totalShadow++;
+		}
+		if (resValue == 0) {
+			counts.TN++;
+		}
+		else if (resValue == 255) {
+			counts.FP++;
+			if (gtValue == GT_LABEL_SHADOW) {
+				counts.SE++;
+			}
+		}
+	}
+}
+
+#ifdef EVALUATION_SSE2
+// Add the 16 lane counters of an 8-bit accumulator into a 64-bit total and clear it
+static inline void FlushCounter(__m128i &counter, unsigned long long &total) {
+	const __m128i sum = _mm_sad_epu8(counter, _mm_setzero_si128());
+	total += (unsigned long long)_mm_cvtsi128_si32(sum) + (unsigned long long)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+	counter = _mm_setzero_si128();
+}
+#endif
+
+// Count the confusion matrix of one frame
+void CountConfusion(const cv::Mat &gtImg, const cv::Mat &resultImg, ConfusionCounts &counts) {
+	CV_Assert(gtImg.type() == CV_8UC1 && resultImg.type() == CV_8UC1);
+	CV_Assert(gtImg.rows == resultImg.rows && gtImg.cols == resultImg.cols);
+	for (int rowIndex = 0; rowIndex < gtImg.rows; rowIndex++) {
+		const uchar * gtPtr = gtImg.ptr(rowIndex);
+		const uchar * resPtr = resultImg.ptr(rowIndex);
+		int colIndex = 0;
+#ifdef EVALUATION_SSE2
+		const __m128i labelForeground = _mm_set1_epi8(char(GT_LABEL_FOREGROUND));
+		const __m128i labelShadow = _mm_set1_epi8(char(GT_LABEL_SHADOW));
+		const __m128i labelBelowShadow = _mm_set1_epi8(char(GT_LABEL_SHADOW - 1));
+		const __m128i zero = _mm_setzero_si128();
+		// 8-bit lane counters; every lane grows by at most 1 per block, so flush before 255 blocks
+		__m128i TPCounter = zero, FPCounter = zero, TNCounter = zero, FNCounter = zero, shadowCounter = zero, SECounter = zero;
+		int blockNo = 0;
+		for (; colIndex + 16 <= gtImg.cols; colIndex += 16) {
+			const __m128i gt = _mm_loadu_si128(reinterpret_cast<const __m128i *>(gtPtr + colIndex));
+			const __m128i res = _mm_loadu_si128(reinterpret_cast<const __m128i *>(resPtr + colIndex));
+			const __m128i gtForeground = _mm_cmpeq_epi8(gt, labelForeground);
+			const __m128i gtShadow = _mm_cmpeq_epi8(gt, labelShadow);
+			// gt <= 49 (unsigned): min(gt, 49) == gt
+			const __m128i gtBackground = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(gt, labelBelowShadow), gt), gtShadow);
+			const __m128i resForeground = _mm_cmpeq_epi8(res, labelForeground);
+			const __m128i resBackground = _mm_cmpeq_epi8(res, zero);
+			// Compare results are 0 / -1, so subtracting adds 1 per matching lane
+			TPCounter = _mm_sub_epi8(TPCounter, _mm_and_si128(gtForeground, resForeground));
+			FNCounter = _mm_sub_epi8(FNCounter, _mm_and_si128(gtForeground, resBackground));
+			TNCounter = _mm_sub_epi8(TNCounter, _mm_and_si128(gtBackground, resBackground));
+			FPCounter = _mm_sub_epi8(FPCounter, _mm_and_si128(gtBackground, resForeground));
+			shadowCounter = _mm_sub_epi8(shadowCounter, gtShadow);
+			SECounter = _mm_sub_epi8(SECounter, _mm_and_si128(gtShadow, resForeground));
+			if (++blockNo == 255) {
+				FlushCounter(TPCounter, counts.TP);
+				FlushCounter(FPCounter, counts.FP);
+				FlushCounter(TNCounter, counts.TN);
+				FlushCounter(FNCounter, counts.FN);
+				FlushCounter(shadowCounter, counts.totalShadow);
+				FlushCounter(SECounter, counts.SE);
+				blockNo = 0;
+			}
+		}
+		FlushCounter(TPCounter, counts.TP);
+		FlushCounter(FPCounter, counts.FP);
+		FlushCounter(TNCounter, counts.TN);
+		FlushCounter(FNCounter, counts.FN);
+		FlushCounter(shadowCounter, counts.totalShadow);
+		FlushCounter(SECounter, counts.SE);
+#endif
+		for (; colIndex < gtImg.cols; colIndex++) {
+			CountPixel(gtPtr[colIndex], resPtr[colIndex], counts);
+		}
+	}
+}
+
+// Write the full statistics block
+void WriteStatistics(std::ostream &output, const ConfusionCounts &counts) {
+	const EvaluationMetrics metrics(counts);
+	output << "\n<<<<<-STATISTICS  RESULTS->>>>>\n";
+	output << "TRUE POSITIVE(TP): " << counts.TP << std::endl;
+	output << "FALSE POSITIVE(FP): " << counts.FP << std::endl;
+	output << "TRUE NEGATIVE(TN): " << counts.TN << std::endl;
+	output << "FALSE NEGATIVE(FN): " << counts.FN << std::endl;
+	output << "TOTAL SHADOW: " << counts.totalShadow << std::endl;
+	output << "SHADOW ERROR(SE): " << counts.SE << std::endl;
+	output << "SHADOW ERROR(RATIO): " << std::setprecision(3) << std::fixed << metrics.shadowErrorRatio << std::endl;
+	output << "RECALL: " << std::setprecision(3) << std::fixed << metrics.recall << std::endl;
+	output << "SPECIFICITY: " << std::setprecision(3) << std::fixed << metrics.specificity << std::endl;
+	output << "FPR: " << std::setprecision(3) << std::fixed << metrics.FPR << std::endl;
+	output << "FNR: " << std::setprecision(3) << std::fixed << metrics.FNR << std::endl;
+	output << "PBC: " << std::setprecision(3) << std::fixed << metrics.PBC << std::endl;
+	output << "PRECISION: " << std::setprecision(3) << std::fixed << metrics.precision << std::endl;
+	output << "F-MEASURE: " << std::setprecision(3) << std::fixed << metrics.FMeasure << std::endl;
+}
+
+// Print recall, precision and F-measure
+void PrintStatisticsSummary(std::ostream &output, const ConfusionCounts &counts) {
+	const EvaluationMetrics metrics(counts);
+	output << "\n<<<<<-STATISTICS  RESULTS->>>>>\n";
+	output << "RECALL: " << std::setprecision(3) << std::fixed << metrics.recall << std::endl;
+	output << "PRECISION: " << std::setprecision(3) << std::fixed << metrics.precision << std::endl;
+	output << "F-MEASURE: " << std::setprecision(3) << std::fixed << metrics.FMeasure << std::endl;
+}
+
+/*******CONSTRUCTOR*******/
+OnlineEvaluator::OnlineEvaluator() :
+	idxFrom(1),
+	idxTo(0),
+	evaluatedNo(0),
+	missingNo(0)
+{
+}
+
+// Read the frame range of a dataset folder
+bool OnlineEvaluator::Open(const std::string &datasetFolder) {
+	std::lock_guard<std::mutex> lock(countsMutex);
+	groundtruthFolder = datasetFolder + "/groundtruth";
+	counts = ConfusionCounts();
+	evaluatedNo = 0;
+	missingNo = 0;
+	std::ifstream infile(datasetFolder + "/temporalROI.txt");
+	if (!(infile >> idxFrom >> idxTo)) {
+		// Empty range: nothing is evaluated
+		idxFrom = 1;
+		idxTo = 0;
+		return false;
+	}
+	return true;
+}
+
+// Frame is inside the evaluated range
+bool OnlineEvaluator::InRange(int frameIndex) const {
+	return (frameIndex >= idxFrom) && (frameIndex <= idxTo);
+}
+
+// Count one output mask
+bool OnlineEvaluator::Add(int frameIndex, const cv::Mat &fgMask) {
+	if (!InRange(frameIndex)) {
+		return true;
+	}
+	char s[25];
+	snprintf(s, sizeof(s), "/gt%06d.png", frameIndex);
+	const cv::Mat gtImg = cv::imread(groundtruthFolder + s, cv::IMREAD_GRAYSCALE);
+	if (gtImg.empty() || (gtImg.size() != fgMask.size())) {
+		std::lock_guard<std::mutex> lock(countsMutex);
+		missingNo++;
+		return false;
+	}
+	// Count outside the lock; only the accumulation is shared
+	ConfusionCounts frameCounts;
+	CountConfusion(gtImg, fgMask, frameCounts);
+	std::lock_guard<std::mutex> lock(countsMutex);
+	counts += frameCounts;
+	evaluatedNo++;
+	return true;
+}
+
+// Running confusion matrix
+ConfusionCounts OnlineEvaluator::GetCounts() {
+	std::lock_guard<std::mutex> lock(countsMutex);
+	return counts;
+}
+
+// Total number of frames counted so far
+size_t OnlineEvaluator::GetEvaluatedNo() {
+	std::lock_guard<std::mutex> lock(countsMutex);
+	return evaluatedNo;
+}
+
+// Total number of frames in range whose groundtruth was missing
+size_t OnlineEvaluator::GetMissingNo() {
+	std::lock_guard<std::mutex> lock(countsMutex);
+	return missingNo;
+}
+
+// Every frame of the range has been counted
+bool OnlineEvaluator::IsComplete() {
+	std::lock_guard<std::mutex> lock(countsMutex);
+	return (idxTo >= idxFrom) && (evaluatedNo == size_t(idxTo - idxFrom + 1));
+}
+
+// First evaluated frame
+int OnlineEvaluator::GetFirstFrame() const {
+	return idxFrom;
+}
+
+// Last evaluated frame
+int OnlineEvaluator::GetLastFrame() const {
+	return idxTo;
+}
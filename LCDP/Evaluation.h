@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef __Evaluation_H_INCLUDED
+#define __Evaluation_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <mutex>
+#include <ostream>
+
+// CDnet groundtruth label codes
+#define GT_LABEL_BACKGROUND 0
+#define GT_LABEL_SHADOW 50
+#define GT_LABEL_OUTSIDE_ROI 85
+#define GT_LABEL_UNKNOWN 170
+#define GT_LABEL_FOREGROUND 255
+
+// Confusion matrix of one or more frames
+struct ConfusionCounts {
+	unsigned long long TP;
+	unsigned long long FP;
+	unsigned long long TN;
+	unsigned long long FN;
+	// Groundtruth shadow pixels
+	unsigned long long totalShadow;
+	// Shadow pixels classified as foreground (also counted in FP)
+	unsigned long long SE;
+
+	ConfusionCounts();
+	// Accumulate another confusion matrix
+	ConfusionCounts & operator+=(const ConfusionCounts &other);
+};
+
+// Metrics derived from a confusion matrix
+struct EvaluationMetrics {
+	double recall;
+	double specificity;
+	double FPR;
+	double FNR;
+	double PBC;
+	double precision;
+	double FMeasure;
+	// Shadow error ratio
+	double shadowErrorRatio;
+
+	explicit EvaluationMetrics(const ConfusionCounts &counts);
+};
+
+// Count the confusion matrix of one frame against its groundtruth (both CV_8UC1, same size).
+// Groundtruth 255: foreground; 50: shadow (counted as background); below 50: background;
+// 85 (outside ROI), 170 (unknown) and any other value are ignored. Result pixels other than
+// 0 and 255 are ignored as well. Uses SSE2 with 8-bit lane counters where available.
+void CountConfusion(const cv::Mat &gtImg, const cv::Mat &resultImg, ConfusionCounts &counts);
+// Write the full statistics block (parameter.txt format)
+void WriteStatistics(std::ostream &output, const ConfusionCounts &counts);
+// Print recall, precision and F-measure
+void PrintStatisticsSummary(std::ostream &output, const ConfusionCounts &counts);
+
+// Evaluates masks in memory while a sequence is being processed, so no result has to be
+// written to disk and read back. Only frames inside the dataset's temporalROI.txt range
+// are counted; the groundtruth of a frame is read when its mask arrives.
+class OnlineEvaluator {
+public:
+	/*******CONSTRUCTOR*******/
+	OnlineEvaluator();
+
+	// Read the frame range of a dataset folder (RETURN-true: temporalROI.txt found)
+	bool Open(const std::string &datasetFolder);
+	// Frame is inside the evaluated range
+	bool InRange(int frameIndex) const;
+	// Count one output mask (RETURN-false: inside the range but groundtruth missing)
+	bool Add(int frameIndex, const cv::Mat &fgMask);
+
+	// Running confusion matrix
+	ConfusionCounts GetCounts();
+	// Total number of frames counted so far
+	size_t GetEvaluatedNo();
+	// Total number of frames in range whose groundtruth was missing
+	size_t GetMissingNo();
+	// Every frame of the range has been counted
+	bool IsComplete();
+	// First evaluated frame
+	int GetFirstFrame() const;
+	// Last evaluated frame
+	int GetLastFrame() const;
+
+private:
+	// Groundtruth folder
+	std::string groundtruthFolder;
+	// Evaluated frame range (from temporalROI.txt)
+	int idxFrom;
+	int idxTo;
+	// Running confusion matrix
+	ConfusionCounts counts;
+	size_t evaluatedNo;
+	size_t missingNo;
+	std::mutex countsMutex;
+};
+#endif
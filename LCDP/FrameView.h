@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef __FrameView_H_INCLUDED
+#define __FrameView_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+
+// Read-only view of a caller-owned 8-bit frame: pointer, size, row stride and pixel format.
+// Nothing is copied and the pixels are never written, so pooled decoder buffers with row
+// padding can be handed over as they are.
+struct FrameView {
+	// Pixel layouts (BGR8 and GRAY8 are modelled directly; RGB8 and BGRA8 are converted once)
+	enum PixelFormat {
+		FORMAT_GRAY8,
+		FORMAT_BGR8,
+		FORMAT_RGB8,
+		// 4 bytes per pixel, the 4th is ignored
+		FORMAT_BGRA8
+	};
+
+	const unsigned char * data;
+	int width;
+	int height;
+	// Bytes from one row to the next (0: rows are packed)
+	size_t stride;
+	PixelFormat format;
+
+	FrameView() :
+		data(nullptr), width(0), height(0), stride(0), format(FORMAT_BGR8) {
+	}
+	FrameView(const unsigned char *inputData, int inputWidth, int inputHeight, size_t inputStride, PixelFormat inputFormat) :
+		data(inputData), width(inputWidth), height(inputHeight), stride(inputStride), format(inputFormat) {
+	}
+	// View of an 8-bit 1, 3 (BGR) or 4 (BGRA) channel matrix, keeping its row step
+	explicit FrameView(const cv::Mat &frame) :
+		data(frame.data), width(frame.cols), height(frame.rows), stride(frame.step),
+		format((frame.channels() == 1) ? FORMAT_GRAY8 : ((frame.channels() == 4) ? FORMAT_BGRA8 : FORMAT_BGR8)) {
+		CV_Assert((frame.type() == CV_8UC1) || (frame.type() == CV_8UC3) || (frame.type() == CV_8UC4));
+	}
+
+	// Bytes per pixel
+	int Channels() const {
+		return (format == FORMAT_GRAY8) ? 1 : ((format == FORMAT_BGRA8) ? 4 : 3);
+	}
+	// Size of the frame
+	cv::Size GetSize() const {
+		return cv::Size(width, height);
+	}
+	// OpenCV header over the pixels (no copy). Only pass it to functions that read it.
+	cv::Mat Header() const {
+		return cv::Mat(height, width, CV_MAKETYPE(CV_8U, Channels()), const_cast<unsigned char*>(data),
+			(stride > 0) ? stride : size_t(cv::Mat::AUTO_STEP));
+	}
+};
+
+// Caller-owned 8-bit mask buffer (0: background, 255: foreground) the subtractor writes into
+struct MaskView {
+	unsigned char * data;
+	int width;
+	int height;
+	// Bytes from one row to the next (0: rows are packed)
+	size_t stride;
+
+	MaskView() :
+		data(nullptr), width(0), height(0), stride(0) {
+	}
+	MaskView(unsigned char *inputData, int inputWidth, int inputHeight, size_t inputStride) :
+		data(inputData), width(inputWidth), height(inputHeight), stride(inputStride) {
+	}
+	// View of an allocated CV_8UC1 matrix, keeping its row step
+	explicit MaskView(cv::Mat &mask) :
+		data(mask.data), width(mask.cols), height(mask.rows), stride(mask.step) {
+		CV_Assert(mask.type() == CV_8UC1);
+	}
+
+	// Size of the mask
+	cv::Size GetSize() const {
+		return cv::Size(width, height);
+	}
+	// OpenCV header over the buffer (no copy); results written through it land in the buffer
+	cv::Mat Header() const {
+		return cv::Mat(height, width, CV_8UC1, data, (stride > 0) ? stride : size_t(cv::Mat::AUTO_STEP));
+	}
+};
+#endif
@@ -1,13 +1,25 @@
 #include "Functions.h"
+#include "OfflineEvaluator.h"
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+#endif
 
 // Program version
 std::string programVersion;
-// Program start time
-time_t tempStartTime;
-// Program finish time
-time_t tempFinishTime;
 // Show input frame switch
 bool showInputSwitch;
 // Show output frame switch
@@ -17,9 +29,6 @@ bool saveResultSwitch;
 // Evaluate result switch
 bool evaluateResultSwitch;
 
-// Program process took time
-double firstTotalDiffSeconds;
-
 ///Read input Functions///
 // Read integer value input
 std::vector<int> readVectorIntInput(std::string question) {
@@ -251,12 +260,20 @@ cv::VideoCapture readVideoInput2(std::string *filename, double *FPS, double *FRA
 }
 
 /// Time Functions
+// Thread-safe localtime
+static void LocalTime(const time_t *now, struct tm *tstruct) {
+#ifdef _WIN32
+	localtime_s(tstruct, now);
+#else
+	localtime_r(now, tstruct);
+#endif
+}
 // Get current date/time, format is DDMMYYHHmmss
 const std::string currentDateTimeStamp(time_t * now) {
 	//time_t     now = time(0);
 	struct tm  tstruct;
 	char       buf[80];
-	tstruct = *localtime(now);
+	LocalTime(now, &tstruct);
 	strftime(buf, sizeof(buf), "%d%m%y-%H%M%S", &tstruct);
 
 	return buf;
@@ -265,7 +282,7 @@ const std::string currentDateTimeStamp(time_t * now) {
 const std::string currentDateTime(time_t * now) {
 	struct tm  tstruct;
 	char       buf[80];
-	tstruct = *localtime(now);
+	LocalTime(now, &tstruct);
 	strftime(buf, sizeof(buf), "%d-%b-%G %X", &tstruct);
 
 	return buf;
@@ -288,127 +305,54 @@ void EvaluateResult(std::string filename, std::string saveFolderName, std::strin
 	//and the "temporalROI.txt" file to be valid.The choosen method will be 
 	// applied to all the frames specified in \temporalROI.txt
 
-	// Read index from temporalROI.txt
-	std::ifstream infile(filename + "/temporalROI.txt");
-	int idxFrom, idxTo;
-	bool success = true;
-	double TotalShadow = 0, TP = 0, TN = 0, FP = 0, FN = 0, SE = 0;
-	infile >> idxFrom >> idxTo;
-	infile.close();
-	std::string groundtruthFolder = filename + "/groundtruth";
-	char s[25];
-	for (size_t startIndex = idxFrom; startIndex <= idxTo; startIndex++) {
-		sprintf(s, "%06d.png", (startIndex));
-		cv::Mat gtImg = cv::imread(groundtruthFolder + "/gt" + s, CV_LOAD_IMAGE_GRAYSCALE);
-		if (gtImg.empty()) {
-			std::cout << "Groundtruth image cannot found!"<<std::endl;
-			success = false;
-			break;
-		}
-		cv::Mat resultImg = cv::imread(saveFolderName + "/results/bin" + s, CV_LOAD_IMAGE_GRAYSCALE);
-		if (resultImg.empty()) {
-			std::cout << "Result image cannot found!"<<std::endl;
-			success = false;
-			break;
-		}
-		for (size_t pxPointer = 0; pxPointer < (resultImg.rows*resultImg.cols); pxPointer++) {
-
-			double gtValue = gtImg.data[pxPointer];
-			double resValue = resultImg.data[pxPointer];
-			if (gtValue == 255) {
-				// TP
-				if (resValue == 255) {
-					TP++;
-				}
-				// FN
-				else if (resValue == 0) {
-					FN++;
-				}
-			}
-			else if (gtValue == 50) {
-				TotalShadow++;
-				// TN
-				if (resValue == 0) {
-					TN++;
-				}
-				// SE FP
-				else if (resValue == 255) {
-					SE++;
-					FP++;
-				}
-			}
-			else if (gtValue < 50) {
-				// TN
-				if (resValue == 0) {
-					TN++;
-				}
-				// FP
-				else if (resValue == 255) {
-					FP++;
-				}
-			}
-		}
+	// Frames are decoded and counted in parallel; missing frames are listed instead of
+	// stopping at the first one
+	OfflineEvaluator offlineEvaluator(0);
+	offlineEvaluator.AddSequence(filename, filename, saveFolderName);
+	offlineEvaluator.Run();
+	const OfflineEvaluator::SequenceResult &result = offlineEvaluator.GetResults().front();
+	if (!result.missingGroundtruth.empty()) {
+		std::cout << "Groundtruth image cannot found! (" << result.missingGroundtruth.size()
+			<< " frame(s), first: " << result.missingGroundtruth.front() << ")" << std::endl;
 	}
-	if (success) {
-
-		const double recall = TP / (TP + FN);
-		const double precision = TP / (TP + FP);
-		const double FMeasure = (2.0*recall*precision) / (recall + precision);
-
-		const double specficity = TN / (TN + FP);
-		const double FPR = FP / (FP + TN);
-		const double FNR = FN / (TP + FN);
-		const double PBC = 100.0 * (FN + FP) / (TP + FP + FN + TN);
-
+	if (!result.missingResult.empty()) {
+		std::cout << "Result image cannot found! (" << result.missingResult.size()
+			<< " frame(s), first: " << result.missingResult.front() << ")" << std::endl;
+	}
+	if (offlineEvaluator.IsComplete()) {
 		std::ofstream myfile;
 		myfile.open(saveFolderName + "/parameter.txt", std::ios::app);
-		myfile << "\n<<<<<-STATISTICS  RESULTS->>>>>\n";
-		myfile << "TRUE POSITIVE(TP): " << std::setprecision(0) << std::fixed << TP << std::endl;
-		myfile << "FALSE POSITIVE(FP): " << std::setprecision(0) << std::fixed << FP << std::endl;
-		myfile << "TRUE NEGATIVE(TN): " << std::setprecision(0) << std::fixed << TN << std::endl;
-		myfile << "FALSE NEGATIVE(FN): " << std::setprecision(0) << std::fixed << FN << std::endl;
-		myfile << "TOTAL SHADOW: " << std::setprecision(0) << std::fixed << TotalShadow << std::endl;
-		myfile << "SHADOW ERROR(SE): " << std::setprecision(0) << std::fixed << SE << std::endl;
-		myfile << "SHADOW ERROR(RATIO): " << std::setprecision(3) << std::fixed << (SE/TotalShadow) << std::endl;
-		myfile << "RECALL: " << std::setprecision(3) << std::fixed << recall << std::endl;		
-		myfile << "SPECIFICITY: " << std::setprecision(3) << std::fixed << specficity << std::endl;
-		myfile << "FPR: " << std::setprecision(3) << std::fixed << FPR << std::endl;
-		myfile << "FNR: " << std::setprecision(3) << std::fixed << FNR << std::endl;
-		myfile << "PBC: " << std::setprecision(3) << std::fixed << PBC << std::endl;
-		myfile << "PRECISION: " << std::setprecision(3) << std::fixed << precision << std::endl;
-		myfile << "F-MEASURE: " << std::setprecision(3) << std::fixed << FMeasure << std::endl;		
+		WriteStatistics(myfile, result.counts);
 		myfile.close();
-		std::cout << "\n<<<<<-STATISTICS  RESULTS->>>>>\n";
-		std::cout << "RECALL: " << std::setprecision(3) << std::fixed << recall << std::endl;
-		std::cout << "PRECISION: " << std::setprecision(3) << std::fixed << precision << std::endl;
-		std::cout << "F-MEASURE: " << std::setprecision(3) << std::fixed << FMeasure << std::endl;			
+		PrintStatisticsSummary(std::cout, result.counts);
 	}
 	else {
 		std::cout << "Skipping evaluation process!" << std::endl;
 	}
 }
 // Calculate processing time
-void GenerateProcessTime(double FRAME_COUNT, std::string saveFolderName) {
-	double diffSeconds = firstTotalDiffSeconds;
+void GenerateProcessTime(double FRAME_COUNT, std::string saveFolderName, time_t startTime, time_t finishTime,
+	double processSeconds, bool saveSwitch) {
+	double diffSeconds = processSeconds;
 	int seconds, hours, minutes;
 	minutes = diffSeconds / 60;
 	hours = minutes / 60;
 	minutes = minutes - (60 * hours);
 	seconds = int(diffSeconds) % 60;
 	double fpsProcess = FRAME_COUNT / diffSeconds;
-	std::cout << "<<<<<-TOTAL PROGRAM TIME->>>>>\n" << "PROGRAM START TIME:" << currentDateTime(&tempStartTime) << std::endl;
-	std::cout << "PROGRAM END  TIME:" << currentDateTime(&tempFinishTime) << std::endl;
+	std::cout << "<<<<<-TOTAL PROGRAM TIME->>>>>\n" << "PROGRAM START TIME:" << currentDateTime(&startTime) << std::endl;
+	std::cout << "PROGRAM END  TIME:" << currentDateTime(&finishTime) << std::endl;
 	std::cout << "TOTAL SPEND TIME:" << hours << " H " << minutes << " M " << seconds << " S" << std::endl;
 	std::cout << "AVERAGE FPS:" << fpsProcess << std::endl;
-	if (saveResultSwitch) {
+	if (saveSwitch) {
 		std::ofstream myfile;
 		myfile.open(saveFolderName + "/parameter.txt", std::ios::app);
 		myfile << "\n\n<<<<<-TOTAL PROGRAM TIME->>>>>\n";
 		myfile << "PROGRAM START TIME:";
-		myfile << currentDateTime(&tempStartTime);
+		myfile << currentDateTime(&startTime);
 		myfile << "\n";
 		myfile << "PROGRAM END  TIME:";
-		myfile << currentDateTime(&tempFinishTime);
+		myfile << currentDateTime(&finishTime);
 		myfile << "\n";
 		myfile << "TOTAL SPEND TIME:";
 		myfile << hours << " H " << minutes << " M " << seconds << " S";
@@ -419,3 +363,112 @@ void GenerateProcessTime(double FRAME_COUNT, std::string saveFolderName) {
 		myfile.close();
 	}
 }
+
+/// File Functions
+// Create a folder (RETURN-true: created or already exists)
+bool MakeDirectory(const std::string &folderName) {
+#ifdef _WIN32
+	return (_mkdir(folderName.c_str()) == 0) || (errno == EEXIST);
+#else
+	return (mkdir(folderName.c_str(), 0755) == 0) || (errno == EEXIST);
+#endif
+}
+// Last modification time of a file (RETURN-true: file exists)
+bool GetFileModifiedTime(const std::string &fileName, time_t &modifiedTime) {
+#ifdef _WIN32
+	struct _stat64 fileStatus;
+	if (_stat64(fileName.c_str(), &fileStatus) != 0) {
+		return false;
+	}
+#else
+	struct stat fileStatus;
+	if (stat(fileName.c_str(), &fileStatus) != 0) {
+		return false;
+	}
+#endif
+	modifiedTime = time_t(fileStatus.st_mtime);
+	return true;
+}
+
+/// Thread Functions
+// Total number of hardware threads (at least 1)
+int GetHardwareThreadNo() {
+	const unsigned int threadNo = std::thread::hardware_concurrency();
+	return (threadNo > 0) ? int(threadNo) : 1;
+}
+// Pin the calling thread to one logical CPU (RETURN-true: success)
+bool SetCurrentThreadAffinity(int cpuIndex) {
+	if (cpuIndex < 0) {
+		return false;
+	}
+#ifdef _WIN32
+	if (cpuIndex >= int(sizeof(DWORD_PTR) * 8)) {
+		return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpuIndex) != 0;
+#else
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpuIndex, &cpuSet);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+#endif
+}
+#ifndef _WIN32
+// Logical CPUs of a NUMA node, from its sysfs list (e.g. "0-7,16-23")
+static std::vector<int> GetNumaNodeCPUs(int nodeIndex) {
+	std::vector<int> cpus;
+	std::ifstream cpuListFile("/sys/devices/system/node/node" + std::to_string(nodeIndex) + "/cpulist");
+	std::string cpuList;
+	if (!std::getline(cpuListFile, cpuList)) {
+		return cpus;
+	}
+	std::stringstream rangeList(cpuList);
+	std::string range;
+	while (std::getline(rangeList, range, ',')) {
+		const size_t separator = range.find('-');
+		const int first = atoi(range.c_str());
+		const int last = (separator == std::string::npos) ? first : atoi(range.c_str() + separator + 1);
+		for (int cpuIndex = first; (cpuIndex <= last) && (cpuIndex < CPU_SETSIZE); cpuIndex++) {
+			cpus.push_back(cpuIndex);
+		}
+	}
+	return cpus;
+}
+#endif
+// Total number of NUMA nodes (at least 1)
+int GetNumaNodeNo() {
+#ifdef _WIN32
+	ULONG highestNode = 0;
+	return GetNumaHighestNodeNumber(&highestNode) ? int(highestNode) + 1 : 1;
+#else
+	int nodeNo = 0;
+	while (!GetNumaNodeCPUs(nodeNo).empty()) {
+		nodeNo++;
+	}
+	return std::max(nodeNo, 1);
+#endif
+}
+// Restrict the calling thread to the logical CPUs of one NUMA node (RETURN-true: success)
+bool SetCurrentThreadNode(int nodeIndex) {
+	if (nodeIndex < 0) {
+		return false;
+	}
+#ifdef _WIN32
+	ULONGLONG nodeMask = 0;
+	if ((nodeIndex > 255) || !GetNumaNodeProcessorMask(UCHAR(nodeIndex), &nodeMask) || (nodeMask == 0)) {
+		return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(nodeMask)) != 0;
+#else
+	const std::vector<int> cpus = GetNumaNodeCPUs(nodeIndex);
+	if (cpus.empty()) {
+		return false;
+	}
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (auto cpuIndex : cpus) {
+		CPU_SET(cpuIndex, &cpuSet);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+#endif
+}
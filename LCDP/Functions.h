@@ -2,18 +2,12 @@
 
 #ifndef __Functions_H_INCLUDED
 #define __Functions_H_INCLUDED
-#include <opencv2\opencv.hpp>
+#include <opencv2/opencv.hpp>
 #include <time.h>
 #include <vector>
 
 // Program version
 extern std::string programVersion;
-// Program start time
-extern time_t tempStartTime;
-// Program finish time
-extern time_t tempFinishTime;
-// Program process took time
-extern double firstTotalDiffSeconds;
 
 // Show input frame switch
 extern bool showInputSwitch;
@@ -48,6 +42,24 @@ const std::string currentDateTime(time_t * now);
 void SaveParameter(std::string versionFolderName, std::string saveFolderName);
 // Evaluate results
 void EvaluateResult(std::string filename, std::string saveFolderName, std::string versionFolderName);
-// Calculate processing time
-void GenerateProcessTime(double FRAME_COUNT, std::string saveFolderName);
+// Calculate processing time (saveSwitch: also append it to parameter.txt)
+void GenerateProcessTime(double FRAME_COUNT, std::string saveFolderName, time_t startTime, time_t finishTime,
+	double processSeconds, bool saveSwitch);
+
+/// File Functions
+// Create a folder (RETURN-true: created or already exists)
+bool MakeDirectory(const std::string &folderName);
+// Last modification time of a file (RETURN-true: file exists)
+bool GetFileModifiedTime(const std::string &fileName, time_t &modifiedTime);
+
+/// Thread Functions
+// Total number of hardware threads (at least 1)
+int GetHardwareThreadNo();
+// Pin the calling thread to one logical CPU (RETURN-true: success)
+bool SetCurrentThreadAffinity(int cpuIndex);
+// Total number of NUMA nodes (at least 1)
+int GetNumaNodeNo();
+// Restrict the calling thread to the logical CPUs of one NUMA node (RETURN-true: success).
+// Memory the thread touches first is then placed on that node by the OS.
+bool SetCurrentThreadNode(int nodeIndex);
 #endif
\ No newline at end of file
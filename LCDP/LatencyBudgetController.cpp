@@ -0,0 +1,143 @@
+#include "LatencyBudgetController.h"
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+
+// Total number of degradation levels (including full quality)
+#define LATENCY_LEVEL_NO 6
+
+/*******CONSTRUCTOR*******/
+LatencyBudgetController::LatencyBudgetController(double inputBudgetMs, size_t inputWordsNo) :
+	/*=====BUDGET Parameters=====*/
+	budgetMs(inputBudgetMs),
+	wordsNo(inputWordsNo),
+	highWatermark(0.9),
+	lowWatermark(0.6),
+	smoothingAlpha(0.2),
+	restoreFrameNo(30),
+	settleFrameNo(5),
+
+	/*=====STATE=====*/
+	level(0),
+	smoothedMs(0.0),
+	headroomFrameNo(0),
+	framesSinceChange(0),
+
+	/*=====STATISTICS=====*/
+	levelFrameNo(LATENCY_LEVEL_NO, 0),
+	overBudgetNo(0)
+{
+}
+
+// Limits to apply to the next frame
+BackgroundSubtractorLCDP::QualityLimits LatencyBudgetController::GetLimits() const {
+	BackgroundSubtractorLCDP::QualityLimits limits = BackgroundSubtractorLCDP::FullQuality();
+	if (level >= 1) {
+		limits.maxNeighbourMatch = 16;
+	}
+	if (level >= 2) {
+		limits.maxWordsScanned = std::max<size_t>(1, wordsNo / 2);
+	}
+	if (level >= 3) {
+		limits.skipBorderLine = true;
+		limits.skipContourFill = true;
+	}
+	if (level >= 4) {
+		limits.medianFilterSize = 3;
+		limits.maxNeighbourMatch = 8;
+	}
+	if (level >= 5) {
+		limits.maxNeighbourMatch = 0;
+		limits.maxWordsScanned = std::max<size_t>(1, wordsNo / 4);
+	}
+	return limits;
+}
+
+// Feed the time of a processed frame and decide the next level
+void LatencyBudgetController::Update(int frameIndex, double frameMs) {
+	levelFrameNo[level]++;
+	if (frameMs > budgetMs) {
+		overBudgetNo++;
+	}
+	smoothedMs = decisions.empty() ? frameMs : ((smoothingAlpha * frameMs) + ((1.0 - smoothingAlpha) * smoothedMs));
+	framesSinceChange++;
+
+	Decision decision = DECISION_HOLD;
+	if (smoothedMs > (highWatermark * budgetMs)) {
+		headroomFrameNo = 0;
+		// Give the last change time to show up in the smoothed time, but react at once to a blown budget
+		if ((level < LATENCY_LEVEL_NO - 1) && ((framesSinceChange >= settleFrameNo) || (frameMs > budgetMs))) {
+			level++;
+			decision = DECISION_DEGRADE;
+		}
+	}
+	else if (smoothedMs < (lowWatermark * budgetMs)) {
+		headroomFrameNo++;
+		if ((level > 0) && (headroomFrameNo >= restoreFrameNo)) {
+			level--;
+			decision = DECISION_RESTORE;
+		}
+	}
+	else {
+		headroomFrameNo = 0;
+	}
+	if (decision != DECISION_HOLD) {
+		framesSinceChange = 0;
+		headroomFrameNo = 0;
+	}
+
+	FrameDecision entry;
+	entry.frameIndex = frameIndex;
+	entry.frameMs = frameMs;
+	entry.smoothedMs = smoothedMs;
+	entry.level = level;
+	entry.decision = decision;
+	decisions.push_back(entry);
+}
+
+// Current degradation level
+int LatencyBudgetController::GetLevel() const {
+	return level;
+}
+
+// Total number of levels
+int LatencyBudgetController::GetLevelNo() {
+	return LATENCY_LEVEL_NO;
+}
+
+// Per-frame decisions
+const std::vector<LatencyBudgetController::FrameDecision> & LatencyBudgetController::GetDecisions() const {
+	return decisions;
+}
+
+// Print budget statistics
+void LatencyBudgetController::PrintStats(std::ostream &output) const {
+	size_t degradeNo = 0, restoreNo = 0;
+	for (auto & entry : decisions) {
+		degradeNo += (entry.decision == DECISION_DEGRADE) ? 1 : 0;
+		restoreNo += (entry.decision == DECISION_RESTORE) ? 1 : 0;
+	}
+	output << "\n<<<<<-LATENCY BUDGET->>>>>\n";
+	output << "BUDGET (MS): " << std::setprecision(3) << std::fixed << budgetMs << std::endl;
+	output << "FRAMES OVER BUDGET: " << overBudgetNo << "/" << decisions.size() << std::endl;
+	output << "DEGRADATIONS: " << degradeNo << " RESTORATIONS: " << restoreNo << std::endl;
+	for (int levelIndex = 0; levelIndex < LATENCY_LEVEL_NO; levelIndex++) {
+		output << "FRAMES AT LEVEL " << levelIndex << ": " << levelFrameNo[levelIndex] << std::endl;
+	}
+}
+
+// Export the per-frame decisions as CSV
+bool LatencyBudgetController::SaveLog(const std::string &fileName) const {
+	std::ofstream csvFile(fileName);
+	if (!csvFile.is_open()) {
+		return false;
+	}
+	const char * decisionNames[3] = { "HOLD", "DEGRADE", "RESTORE" };
+	csvFile << "frame,frame_ms,smoothed_ms,level,decision" << std::endl;
+	csvFile << std::setprecision(3) << std::fixed;
+	for (auto & entry : decisions) {
+		csvFile << entry.frameIndex << "," << entry.frameMs << "," << entry.smoothedMs << ","
+			<< entry.level << "," << decisionNames[entry.decision] << std::endl;
+	}
+	return csvFile.good();
+}
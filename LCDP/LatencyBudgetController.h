@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef __LatencyBudgetController_H_INCLUDED
+#define __LatencyBudgetController_H_INCLUDED
+#include "BackgroundSubtractorLCDP.h"
+#include <vector>
+#include <string>
+#include <ostream>
+
+// Keeps Process inside a per-frame latency budget by trading quality for time. The frame
+// time is smoothed (EWMA); when it climbs above the high watermark the controller steps
+// one degradation level down, and when it has stayed below the low watermark for a number
+// of frames it steps one level back up. Levels are cumulative:
+//   0: full quality
+//   1: neighbour matching capped at 16 neighbours
+//   2: + only half of the background words scanned
+//   3: + BorderLineReconst and ContourFill skipped
+//   4: + 3x3 median filter, neighbour matching capped at 8
+//   5: + no neighbour matching, a quarter of the words scanned
+// Every frame's decision is logged, so a run can be audited afterwards.
+class LatencyBudgetController {
+public:
+	// Decision taken after a frame
+	enum Decision {
+		DECISION_HOLD,
+		DECISION_DEGRADE,
+		DECISION_RESTORE
+	};
+	// Per-frame log entry
+	struct FrameDecision {
+		int frameIndex;
+		// Measured frame time (ms)
+		double frameMs;
+		// Smoothed frame time (ms)
+		double smoothedMs;
+		// Level used for the next frame
+		int level;
+		Decision decision;
+	};
+
+	/*******CONSTRUCTOR*******/
+	// budgetMs: per-frame budget; wordsNo: words per pixel model of the subtractor
+	LatencyBudgetController(double inputBudgetMs, size_t inputWordsNo);
+
+	// Limits to apply to the next frame
+	BackgroundSubtractorLCDP::QualityLimits GetLimits() const;
+	// Feed the time of a processed frame and decide the next level
+	void Update(int frameIndex, double frameMs);
+
+	// Current degradation level (0: full quality)
+	int GetLevel() const;
+	// Total number of levels
+	static int GetLevelNo();
+	// Per-frame decisions
+	const std::vector<FrameDecision> & GetDecisions() const;
+	// Print budget statistics
+	void PrintStats(std::ostream &output) const;
+	// Export the per-frame decisions (RETURN-true: success)
+	bool SaveLog(const std::string &fileName) const;
+
+protected:
+	/*=====BUDGET Parameters=====*/
+	// Per-frame budget (ms)
+	const double budgetMs;
+	// Words per pixel model
+	const size_t wordsNo;
+	// Degrade above this share of the budget
+	const double highWatermark;
+	// Restore below this share of the budget
+	const double lowWatermark;
+	// Smoothing factor of the frame time
+	const double smoothingAlpha;
+	// Frames below the low watermark before a level is restored
+	const int restoreFrameNo;
+	// Frames to wait after a change before the next degradation
+	const int settleFrameNo;
+
+	/*=====STATE=====*/
+	int level;
+	double smoothedMs;
+	// Consecutive frames below the low watermark
+	int headroomFrameNo;
+	// Frames since the last level change
+	int framesSinceChange;
+
+	/*=====STATISTICS=====*/
+	std::vector<FrameDecision> decisions;
+	// Frames processed at every level
+	std::vector<size_t> levelFrameNo;
+	// Frames over the budget
+	size_t overBudgetNo;
+};
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef __LockFreeQueue_H_INCLUDED
+#define __LockFreeQueue_H_INCLUDED
+#include <atomic>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring buffer. One thread pushes and at
+// most one thread at a time pops; neither side ever takes a lock.
+template<typename T>
+class LockFreeQueue {
+public:
+	/*******CONSTRUCTOR*******/
+	// One slot is kept empty to tell a full ring from an empty one
+	explicit LockFreeQueue(size_t inputCapacity) :
+		buffer(inputCapacity + 1), head(0), tail(0) {
+	}
+
+	// Push an item (RETURN-true: pushed, false: queue full)
+	bool Push(const T &item) {
+		const size_t currTail = tail.load(std::memory_order_relaxed);
+		const size_t nextTail = Next(currTail);
+		if (nextTail == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		buffer[currTail] = item;
+		tail.store(nextTail, std::memory_order_release);
+		return true;
+	}
+	// Pop the oldest item (RETURN-true: popped, false: queue empty)
+	bool Pop(T &item) {
+		const size_t currHead = head.load(std::memory_order_relaxed);
+		if (currHead == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = buffer[currHead];
+		// Release the slot's resources before handing it back to the producer
+		buffer[currHead] = T();
+		head.store(Next(currHead), std::memory_order_release);
+		return true;
+	}
+	// Peek the oldest item without removing it (consumer side only)
+	const T * Front() const {
+		const size_t currHead = head.load(std::memory_order_relaxed);
+		if (currHead == tail.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		return &buffer[currHead];
+	}
+	// Approximate number of queued items (exact when called from either end)
+	size_t Size() const {
+		const size_t currHead = head.load(std::memory_order_acquire);
+		const size_t currTail = tail.load(std::memory_order_acquire);
+		return (currTail >= currHead) ? (currTail - currHead) : (currTail + buffer.size() - currHead);
+	}
+	// Maximum number of items the queue can hold
+	size_t Capacity() const {
+		return buffer.size() - 1;
+	}
+	bool Empty() const {
+		return Size() == 0;
+	}
+private:
+	size_t Next(size_t index) const {
+		return (index + 1 == buffer.size()) ? 0 : index + 1;
+	}
+	// Ring storage
+	std::vector<T> buffer;
+	// Consumer position
+	std::atomic<size_t> head;
+	// Producer position
+	std::atomic<size_t> tail;
+};
+#endif
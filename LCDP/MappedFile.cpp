@@ -0,0 +1,110 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*******CONSTRUCTOR*******/
+MappedFile::MappedFile() :
+	data(nullptr),
+	size(0)
+#ifdef _WIN32
+	, fileHandle(nullptr),
+	mappingHandle(nullptr)
+#endif
+{
+}
+
+/*******DESTRUCTOR*******/
+MappedFile::~MappedFile() {
+	Close();
+}
+
+// Map a file
+bool MappedFile::Open(const std::string &fileName) {
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0)) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+	void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<const unsigned char *>(view);
+	size = size_t(fileSize.QuadPart);
+#else
+	int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		return false;
+	}
+	struct stat fileStat;
+	if ((fstat(fileDescriptor, &fileStat) != 0) || (fileStat.st_size == 0)) {
+		close(fileDescriptor);
+		return false;
+	}
+	void * view = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	// The mapping stays valid after the descriptor is closed
+	close(fileDescriptor);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+	data = static_cast<const unsigned char *>(view);
+	size = size_t(fileStat.st_size);
+#endif
+	return true;
+}
+
+// Unmap the file
+void MappedFile::Close() {
+	if (data == nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<unsigned char *>(data), size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+// File is mapped
+bool MappedFile::IsOpen() const {
+	return data != nullptr;
+}
+
+// Start of the mapped file
+const unsigned char * MappedFile::Data() const {
+	return data;
+}
+
+// Size of the mapped file (bytes)
+size_t MappedFile::Size() const {
+	return size;
+}
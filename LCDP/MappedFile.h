@@ -0,0 +1,44 @@
+#pragma once
+
+#ifndef __MappedFile_H_INCLUDED
+#define __MappedFile_H_INCLUDED
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file (CreateFileMapping on Windows, mmap elsewhere).
+// Readers seek by pointer arithmetic instead of read() calls, and pages that are never
+// touched are never loaded.
+class MappedFile {
+public:
+	/*******CONSTRUCTOR*******/
+	MappedFile();
+
+	/*******DESTRUCTOR*******/
+	~MappedFile();
+
+	// Map a file (RETURN-true: success; an empty file cannot be mapped)
+	bool Open(const std::string &fileName);
+	// Unmap the file
+	void Close();
+	// File is mapped
+	bool IsOpen() const;
+	// Start of the mapped file
+	const unsigned char * Data() const;
+	// Size of the mapped file (bytes)
+	size_t Size() const;
+
+private:
+	// Not copyable: the mapping is owned by exactly one object
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	// Start of the mapped file
+	const unsigned char * data;
+	// Size of the mapped file (bytes)
+	size_t size;
+#ifdef _WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#endif
+};
+#endif
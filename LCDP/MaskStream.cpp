@@ -0,0 +1,429 @@
+#include "MaskStream.h"
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const char MaskStream::MAGIC[8] = { 'L', 'C', 'D', 'P', 'M', 'S', '0', '1' };
+
+// Largest frame side accepted when validating records
+#define MAX_MASK_SIDE 65536
+
+// Read a little-endian field from the mapped file
+template<typename T>
+static T ReadField(const uchar *data) {
+	T value;
+	memcpy(&value, data, sizeof(T));
+	return value;
+}
+
+// Frame size is within the accepted range
+static bool ValidMaskSize(unsigned int rows, unsigned int cols) {
+	return (rows > 0) && (cols > 0) && (rows <= MAX_MASK_SIDE) && (cols <= MAX_MASK_SIDE);
+}
+
+// Record header at 'offset' is valid and its payload ends before 'endOffset'
+static bool ValidRecord(const uchar *data, unsigned long long offset, unsigned long long endOffset) {
+	if ((offset > endOffset) || (offset + MaskStream::RECORD_HEADER_SIZE > endOffset)) {
+		return false;
+	}
+	const unsigned int rows = ReadField<unsigned int>(data + offset + 4);
+	const unsigned int cols = ReadField<unsigned int>(data + offset + 8);
+	const unsigned int encoding = ReadField<unsigned int>(data + offset + 12);
+	const unsigned int payloadSize = ReadField<unsigned int>(data + offset + 16);
+	return ValidMaskSize(rows, cols) &&
+		((encoding == MaskStream::ENCODING_RAW) || (encoding == MaskStream::ENCODING_RLE)) &&
+		((encoding != MaskStream::ENCODING_RAW) || (payloadSize == size_t(rows) * cols)) &&
+		(offset + MaskStream::RECORD_HEADER_SIZE + payloadSize <= endOffset);
+}
+
+// Sort the index by frame and keep only the last record written for every frame
+static void SortIndex(std::vector<MaskStream::IndexEntry> &index) {
+	std::stable_sort(index.begin(), index.end(),
+		[](const MaskStream::IndexEntry &a, const MaskStream::IndexEntry &b) { return a.frameIndex < b.frameIndex; });
+	std::vector<MaskStream::IndexEntry> uniqueIndex;
+	uniqueIndex.reserve(index.size());
+	for (size_t entryIndex = 0; entryIndex < index.size(); entryIndex++) {
+		if ((entryIndex + 1 < index.size()) && (index[entryIndex + 1].frameIndex == index[entryIndex].frameIndex)) {
+			continue;
+		}
+		uniqueIndex.push_back(index[entryIndex]);
+	}
+	index.swap(uniqueIndex);
+}
+
+// Append an unsigned LEB128 varint
+static void WriteVarint(std::vector<uchar> &buffer, size_t value) {
+	while (value >= 0x80) {
+		buffer.push_back(uchar(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back(uchar(value));
+}
+
+// Read an unsigned LEB128 varint (RETURN-false: truncated)
+static bool ReadVarint(const uchar *&current, const uchar *end, size_t &value) {
+	value = 0;
+	for (int shift = 0; (current < end) && (shift < 64); shift += 7) {
+		const uchar byte = *current++;
+		value |= size_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Seek a stdio file to a 64-bit offset
+static bool SeekFile(FILE *file, unsigned long long offset) {
+#ifdef _WIN32
+	return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Encode a single-channel 8-bit mask into a complete record
+void MaskStream::EncodeRecord(int frameIndex, const cv::Mat &fgMask, std::vector<uchar> &record) {
+	CV_Assert(fgMask.type() == CV_8UC1);
+	record.resize(RECORD_HEADER_SIZE);
+	// Runs continue across row ends, so the mask is walked as one row-major sequence
+	unsigned int encoding = ENCODING_RLE;
+	uchar runValue = 0;
+	size_t runLength = 0;
+	for (int rowIndex = 0; (rowIndex < fgMask.rows) && (encoding == ENCODING_RLE); rowIndex++) {
+		const uchar * rowPtr = fgMask.ptr(rowIndex);
+		for (int colIndex = 0; colIndex < fgMask.cols; colIndex++) {
+			const uchar value = rowPtr[colIndex];
+			if (value == runValue) {
+				runLength++;
+			}
+			else if ((value == 0) || (value == 255)) {
+				WriteVarint(record, runLength);
+				runValue = value;
+				runLength = 1;
+			}
+			else {
+				// Not a binary mask
+				encoding = ENCODING_RAW;
+				break;
+			}
+		}
+	}
+	if (encoding == ENCODING_RLE) {
+		WriteVarint(record, runLength);
+	}
+	else {
+		record.resize(RECORD_HEADER_SIZE + fgMask.total());
+		for (int rowIndex = 0; rowIndex < fgMask.rows; rowIndex++) {
+			memcpy(record.data() + RECORD_HEADER_SIZE + (size_t(rowIndex) * fgMask.cols), fgMask.ptr(rowIndex), fgMask.cols);
+		}
+	}
+	const unsigned int header[5] = { (unsigned int)frameIndex, (unsigned int)fgMask.rows, (unsigned int)fgMask.cols,
+		encoding, (unsigned int)(record.size() - RECORD_HEADER_SIZE) };
+	memcpy(record.data(), header, sizeof(header));
+}
+
+// Decode a record payload into fgMask
+bool MaskStream::DecodePayload(const uchar *payload, size_t payloadSize, int rows, int cols,
+	unsigned int encoding, cv::Mat &fgMask) {
+	// Check the header values before allocating anything from them
+	if ((rows <= 0) || (cols <= 0) || !ValidMaskSize((unsigned int)rows, (unsigned int)cols)) {
+		return false;
+	}
+	const size_t totalPixel = size_t(rows) * cols;
+	fgMask.create(rows, cols, CV_8UC1);
+	if (encoding == ENCODING_RAW) {
+		if (payloadSize != totalPixel) {
+			return false;
+		}
+		memcpy(fgMask.data, payload, totalPixel);
+		return true;
+	}
+	if (encoding != ENCODING_RLE) {
+		return false;
+	}
+	const uchar * current = payload;
+	const uchar * end = payload + payloadSize;
+	uchar * output = fgMask.data;
+	size_t pixelPointer = 0;
+	uchar runValue = 0;
+	while (current < end) {
+		size_t runLength;
+		if (!ReadVarint(current, end, runLength) || (runLength > totalPixel - pixelPointer)) {
+			return false;
+		}
+		memset(output + pixelPointer, runValue, runLength);
+		pixelPointer += runLength;
+		runValue = ~runValue;
+	}
+	return pixelPointer == totalPixel;
+}
+
+// Walk the records from the file header up to 'endOffset'
+unsigned long long MaskStream::ScanRecords(const uchar *data, unsigned long long endOffset, std::vector<IndexEntry> &index) {
+	unsigned long long offset = sizeof(MAGIC);
+	while (offset + RECORD_HEADER_SIZE <= endOffset) {
+		// Stop at the first incomplete or invalid record (e.g. the writer stopped mid-record)
+		if (!ValidRecord(data, offset, endOffset)) {
+			break;
+		}
+		const unsigned int payloadSize = ReadField<unsigned int>(data + offset + 16);
+		IndexEntry entry;
+		entry.frameIndex = ReadField<unsigned int>(data + offset);
+		entry.payloadSize = payloadSize;
+		entry.recordOffset = offset;
+		index.push_back(entry);
+		offset += RECORD_HEADER_SIZE + payloadSize;
+	}
+	return offset;
+}
+
+// Read the footer and index table
+bool MaskStream::ReadIndex(const uchar *data, size_t size, std::vector<IndexEntry> &index, unsigned long long &indexOffset) {
+	if (size < sizeof(MAGIC) + FOOTER_SIZE) {
+		return false;
+	}
+	const uchar * footer = data + size - FOOTER_SIZE;
+	if (memcmp(footer + 12, MAGIC, sizeof(MAGIC)) != 0) {
+		return false;
+	}
+	indexOffset = ReadField<unsigned long long>(footer);
+	const unsigned int indexCount = ReadField<unsigned int>(footer + 8);
+	if ((indexOffset < sizeof(MAGIC)) || (indexOffset > size) || (indexOffset + (unsigned long long)indexCount * INDEX_ENTRY_SIZE + FOOTER_SIZE != size)) {
+		return false;
+	}
+	index.resize(indexCount);
+	for (unsigned int entryIndex = 0; entryIndex < indexCount; entryIndex++) {
+		const uchar * entryPtr = data + indexOffset + size_t(entryIndex) * INDEX_ENTRY_SIZE;
+		index[entryIndex].frameIndex = ReadField<unsigned int>(entryPtr);
+		index[entryIndex].payloadSize = ReadField<unsigned int>(entryPtr + 4);
+		index[entryIndex].recordOffset = ReadField<unsigned long long>(entryPtr + 8);
+		// The entry has to point at a valid record that matches it and ends before the index
+		if ((index[entryIndex].recordOffset < sizeof(MAGIC)) || !ValidRecord(data, index[entryIndex].recordOffset, indexOffset) ||
+			(ReadField<unsigned int>(data + index[entryIndex].recordOffset) != index[entryIndex].frameIndex) ||
+			(ReadField<unsigned int>(data + index[entryIndex].recordOffset + 16) != index[entryIndex].payloadSize)) {
+			index.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+/*******CONSTRUCTOR*******/
+MaskStreamWriter::MaskStreamWriter() :
+	file(nullptr),
+	recordEnd(0),
+	failed(false)
+{
+}
+
+/*******DESTRUCTOR*******/
+MaskStreamWriter::~MaskStreamWriter() {
+	Close(false);
+}
+
+// Create a stream, or continue an existing one
+bool MaskStreamWriter::Open(const std::string &fileName, bool appendSwitch) {
+	Close(false);
+	std::lock_guard<std::mutex> lock(streamMutex);
+	index.clear();
+	failed = false;
+	if (appendSwitch) {
+		MappedFile existingFile;
+		if (existingFile.Open(fileName)) {
+			if ((existingFile.Size() < sizeof(MaskStream::MAGIC)) ||
+				(memcmp(existingFile.Data(), MaskStream::MAGIC, sizeof(MaskStream::MAGIC)) != 0)) {
+				return false;
+			}
+			// New records overwrite the old index table (or a torn record after a crash)
+			unsigned long long indexOffset;
+			if (MaskStream::ReadIndex(existingFile.Data(), existingFile.Size(), index, indexOffset)) {
+				recordEnd = indexOffset;
+			}
+			else {
+				index.clear();
+				recordEnd = MaskStream::ScanRecords(existingFile.Data(), existingFile.Size(), index);
+			}
+			existingFile.Close();
+			file = fopen(fileName.c_str(), "r+b");
+			if ((file == nullptr) || !SeekFile(file, recordEnd)) {
+				if (file != nullptr) {
+					fclose(file);
+					file = nullptr;
+				}
+				return false;
+			}
+			return true;
+		}
+	}
+	file = fopen(fileName.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	fwrite(MaskStream::MAGIC, 1, sizeof(MaskStream::MAGIC), file);
+	recordEnd = sizeof(MaskStream::MAGIC);
+	return true;
+}
+
+// Encode and append one mask
+bool MaskStreamWriter::Append(int frameIndex, const cv::Mat &fgMask) {
+	std::vector<uchar> record;
+	MaskStream::EncodeRecord(frameIndex, fgMask, record);
+	return AppendRecord(record);
+}
+
+// Append an encoded record
+bool MaskStreamWriter::AppendRecord(const std::vector<uchar> &record) {
+	if (record.size() < MaskStream::RECORD_HEADER_SIZE) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (file == nullptr) {
+		return false;
+	}
+	if (fwrite(record.data(), 1, record.size(), file) != record.size()) {
+		failed = true;
+		return false;
+	}
+	MaskStream::IndexEntry entry;
+	entry.frameIndex = ReadField<unsigned int>(record.data());
+	entry.payloadSize = (unsigned int)(record.size() - MaskStream::RECORD_HEADER_SIZE);
+	entry.recordOffset = recordEnd;
+	index.push_back(entry);
+	recordEnd += record.size();
+	return true;
+}
+
+// Write the index table and footer
+bool MaskStreamWriter::Close(bool syncSwitch) {
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (file == nullptr) {
+		return !failed;
+	}
+	SortIndex(index);
+	for (auto & entry : index) {
+		fwrite(&entry.frameIndex, sizeof(entry.frameIndex), 1, file);
+		fwrite(&entry.payloadSize, sizeof(entry.payloadSize), 1, file);
+		fwrite(&entry.recordOffset, sizeof(entry.recordOffset), 1, file);
+	}
+	const unsigned int indexCount = (unsigned int)index.size();
+	fwrite(&recordEnd, sizeof(recordEnd), 1, file);
+	fwrite(&indexCount, sizeof(indexCount), 1, file);
+	fwrite(MaskStream::MAGIC, 1, sizeof(MaskStream::MAGIC), file);
+	if (fflush(file) != 0) {
+		failed = true;
+	}
+	// A re-opened stream may have been longer than what was written this time
+	const unsigned long long fileEnd = recordEnd + index.size() * MaskStream::INDEX_ENTRY_SIZE + MaskStream::FOOTER_SIZE;
+#ifdef _WIN32
+	if ((_chsize_s(_fileno(file), (long long)fileEnd) != 0) || (syncSwitch && (_commit(_fileno(file)) != 0))) {
+		failed = true;
+	}
+#else
+	if ((ftruncate(fileno(file), off_t(fileEnd)) != 0) || (syncSwitch && (fsync(fileno(file)) != 0))) {
+		failed = true;
+	}
+#endif
+	fclose(file);
+	file = nullptr;
+	index.clear();
+	return !failed;
+}
+
+// Stream is open
+bool MaskStreamWriter::IsOpen() const {
+	return file != nullptr;
+}
+
+/*******CONSTRUCTOR*******/
+MaskStreamReader::MaskStreamReader() :
+	complete(false)
+{
+}
+
+// Map a stream
+bool MaskStreamReader::Open(const std::string &fileName) {
+	Close();
+	if (!file.Open(fileName)) {
+		return false;
+	}
+	if ((file.Size() < sizeof(MaskStream::MAGIC)) || (memcmp(file.Data(), MaskStream::MAGIC, sizeof(MaskStream::MAGIC)) != 0)) {
+		file.Close();
+		return false;
+	}
+	unsigned long long indexOffset;
+	complete = MaskStream::ReadIndex(file.Data(), file.Size(), index, indexOffset);
+	if (!complete) {
+		// Writer did not finish: rebuild the index from the records
+		index.clear();
+		MaskStream::ScanRecords(file.Data(), file.Size(), index);
+		SortIndex(index);
+	}
+	return true;
+}
+
+// Unmap the stream
+void MaskStreamReader::Close() {
+	file.Close();
+	index.clear();
+	complete = false;
+}
+
+// Stream was closed properly by its writer
+bool MaskStreamReader::IsComplete() const {
+	return complete;
+}
+
+// Total number of frames
+size_t MaskStreamReader::GetFrameNo() const {
+	return index.size();
+}
+
+// Frame indices in ascending order
+std::vector<int> MaskStreamReader::GetFrameIndices() const {
+	std::vector<int> frameIndices;
+	frameIndices.reserve(index.size());
+	for (auto & entry : index) {
+		frameIndices.push_back(int(entry.frameIndex));
+	}
+	return frameIndices;
+}
+
+// Stream holds this frame
+bool MaskStreamReader::Contains(int frameIndex) const {
+	return Find(frameIndex) != nullptr;
+}
+
+// Decode one frame
+bool MaskStreamReader::Read(int frameIndex, cv::Mat &fgMask) const {
+	const MaskStream::IndexEntry * entry = Find(frameIndex);
+	if (entry == nullptr) {
+		return false;
+	}
+	const uchar * record = file.Data() + entry->recordOffset;
+	const int rows = int(ReadField<unsigned int>(record + 4));
+	const int cols = int(ReadField<unsigned int>(record + 8));
+	const unsigned int encoding = ReadField<unsigned int>(record + 12);
+	if (!MaskStream::DecodePayload(record + MaskStream::RECORD_HEADER_SIZE, entry->payloadSize, rows, cols, encoding, fgMask)) {
+		fgMask.release();
+		return false;
+	}
+	return true;
+}
+
+// Locate a frame in the index
+const MaskStream::IndexEntry * MaskStreamReader::Find(int frameIndex) const {
+	if (frameIndex < 0) {
+		return nullptr;
+	}
+	auto entry = std::lower_bound(index.begin(), index.end(), (unsigned int)frameIndex,
+		[](const MaskStream::IndexEntry &a, unsigned int b) { return a.frameIndex < b; });
+	if ((entry == index.end()) || (entry->frameIndex != (unsigned int)frameIndex)) {
+		return nullptr;
+	}
+	return &(*entry);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#ifndef __MaskStream_H_INCLUDED
+#define __MaskStream_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include "MappedFile.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdio>
+
+// Append-only foreground mask stream ('.lcdms'). Every frame is stored as one record;
+// binary (0/255) masks are run-length encoded, anything else is stored raw. Closing the
+// stream appends a frame index table, so a reader can seek straight to any frame.
+//
+// Layout (little-endian):
+//   "LCDPMS01"
+//   record: uint32 frameIndex | uint32 rows | uint32 cols | uint32 encoding | uint32 payloadSize | payload
+//   index:  { uint32 frameIndex, uint32 payloadSize, uint64 recordOffset }... (sorted by frameIndex)
+//   footer: uint64 indexOffset | uint32 indexCount | "LCDPMS01"
+//
+// RLE payload: lengths of alternating 0/255 runs in row-major order, starting with a 0-run
+// (which may be empty), each written as an unsigned LEB128 varint.
+// A stream that was not closed (no footer) is still readable: the reader rebuilds the index
+// by walking the records, and the writer can re-open it and continue appending.
+class MaskStream {
+public:
+	// Payload encoding
+	enum Encoding {
+		ENCODING_RAW = 0,
+		ENCODING_RLE = 1
+	};
+	// File and footer magic
+	static const char MAGIC[8];
+	// Size of a record header (bytes)
+	static const size_t RECORD_HEADER_SIZE = 20;
+	// Size of an index entry (bytes)
+	static const size_t INDEX_ENTRY_SIZE = 16;
+	// Size of the footer (bytes)
+	static const size_t FOOTER_SIZE = 20;
+
+	// Frame index table entry
+	struct IndexEntry {
+		unsigned int frameIndex;
+		unsigned int payloadSize;
+		unsigned long long recordOffset;
+	};
+
+	// Encode a single-channel 8-bit mask into a complete record (header + payload)
+	static void EncodeRecord(int frameIndex, const cv::Mat &fgMask, std::vector<uchar> &record);
+	// Decode a record payload into fgMask (RETURN-true: valid payload)
+	static bool DecodePayload(const uchar *payload, size_t payloadSize, int rows, int cols,
+		unsigned int encoding, cv::Mat &fgMask);
+	// Walk the records from the file header up to 'endOffset' (RETURN-end of the last complete record)
+	static unsigned long long ScanRecords(const uchar *data, unsigned long long endOffset, std::vector<IndexEntry> &index);
+	// Read the footer and index table (RETURN-true: stream was closed properly)
+	static bool ReadIndex(const uchar *data, size_t size, std::vector<IndexEntry> &index, unsigned long long &indexOffset);
+};
+
+// Writes a mask stream. Append() / AppendRecord() may be called from several threads.
+class MaskStreamWriter {
+public:
+	/*******CONSTRUCTOR*******/
+	MaskStreamWriter();
+
+	/*******DESTRUCTOR*******/
+	~MaskStreamWriter();
+
+	// Create a stream, or with appendSwitch continue an existing one (RETURN-true: success)
+	bool Open(const std::string &fileName, bool appendSwitch);
+	// Encode and append one mask (RETURN-true: success)
+	bool Append(int frameIndex, const cv::Mat &fgMask);
+	// Append a record produced by MaskStream::EncodeRecord (RETURN-true: success)
+	bool AppendRecord(const std::vector<uchar> &record);
+	// Write the index table and footer, optionally sync to disk (RETURN-true: success)
+	bool Close(bool syncSwitch);
+	// Stream is open
+	bool IsOpen() const;
+
+private:
+	// Stream file
+	FILE * file;
+	// End of the last record
+	unsigned long long recordEnd;
+	// Frame index table
+	std::vector<MaskStream::IndexEntry> index;
+	// Set when any write failed
+	bool failed;
+	std::mutex streamMutex;
+};
+
+// Reads a mask stream through a memory mapping; frames are decoded on demand.
+class MaskStreamReader {
+public:
+	/*******CONSTRUCTOR*******/
+	MaskStreamReader();
+
+	// Map a stream (RETURN-true: success)
+	bool Open(const std::string &fileName);
+	// Unmap the stream
+	void Close();
+	// Stream was closed properly by its writer (false: index rebuilt from the records)
+	bool IsComplete() const;
+	// Total number of frames
+	size_t GetFrameNo() const;
+	// Frame indices in ascending order
+	std::vector<int> GetFrameIndices() const;
+	// Stream holds this frame
+	bool Contains(int frameIndex) const;
+	// Decode one frame (RETURN-true: success, false: frame missing or corrupt, fgMask released)
+	bool Read(int frameIndex, cv::Mat &fgMask) const;
+
+private:
+	// Locate a frame in the index
+	const MaskStream::IndexEntry * Find(int frameIndex) const;
+
+	// Mapped stream
+	MappedFile file;
+	// Frame index table (sorted by frameIndex, one entry per frame)
+	std::vector<MaskStream::IndexEntry> index;
+	// Stream was closed properly
+	bool complete;
+};
+#endif
@@ -0,0 +1,268 @@
+#include "MaskWriter.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+const char MaskWriter::ARCHIVE_MAGIC[8] = { 'L', 'C', 'D', 'P', 'A', 'R', '0', '1' };
+
+/*******CONSTRUCTOR*******/
+MaskWriter::MaskWriter(std::string inputFolderName, MaskFormat inputFormat, int inputPNGCompression,
+	bool inputArchiveSwitch, size_t inputEncoderNo, size_t inputMaxPendingBytes) :
+	/*=====OUTPUT Parameters=====*/
+	folderName(inputFolderName),
+	format(inputFormat),
+	PNGCompression(std::min(9, std::max(0, inputPNGCompression))),
+	archiveSwitch(inputArchiveSwitch),
+	maxPendingBytes(inputMaxPendingBytes),
+
+	/*=====ENCODER Parameters=====*/
+	pendingBytes(0),
+	pendingJobNo(0),
+	stopping(false),
+
+	/*=====ARCHIVE=====*/
+	archiveFile(nullptr),
+	archiveOffset(0),
+
+	/*=====STATISTICS=====*/
+	writtenNo(0),
+	writtenBytes(0),
+	errorNo(0),
+	droppedNo(0),
+	throttledSeconds(0.0)
+{
+	if (format == MASK_FORMAT_STREAM) {
+		if (!maskStream.Open(folderName + "/results.lcdms", false)) {
+			std::cout << "Cannot create mask stream in " << folderName << std::endl;
+		}
+	}
+	else if (archiveSwitch) {
+		archiveFile = fopen((folderName + "/results.lcdpar").c_str(), "wb");
+		if (archiveFile == nullptr) {
+			std::cout << "Cannot create mask archive in " << folderName << std::endl;
+		}
+		else {
+			fwrite(ARCHIVE_MAGIC, 1, sizeof(ARCHIVE_MAGIC), archiveFile);
+			archiveOffset = sizeof(ARCHIVE_MAGIC);
+		}
+	}
+	const size_t encoderNo = std::max<size_t>(1, inputEncoderNo);
+	for (size_t encoderIndex = 0; encoderIndex < encoderNo; encoderIndex++) {
+		encoders.push_back(std::thread(&MaskWriter::EncoderLoop, this));
+	}
+}
+
+/*******DESTRUCTOR*******/
+MaskWriter::~MaskWriter() {
+	Flush();
+}
+
+// Queue a mask for writing
+void MaskWriter::Write(int frameIndex, const cv::Mat &fgMask) {
+	const size_t maskBytes = fgMask.total() * fgMask.elemSize();
+	std::unique_lock<std::mutex> lock(jobMutex);
+	if (stopping) {
+		// The archive / stream is already finalised
+		if (droppedNo++ == 0) {
+			std::cout << "Mask writer for " << folderName << " is flushed: frame " << frameIndex << " and later frames are dropped" << std::endl;
+		}
+		errorNo++;
+		return;
+	}
+	// Always admit one mask, so a budget smaller than a frame cannot dead-lock
+	const std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+	spaceAvailable.wait(lock, [&] { return (pendingJobNo == 0) || (pendingBytes + maskBytes <= maxPendingBytes); });
+	throttledSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+	WriteJob job;
+	job.frameIndex = frameIndex;
+	job.fgMask = fgMask;
+	jobs.push_back(job);
+	pendingBytes += maskBytes;
+	pendingJobNo++;
+	jobAvailable.notify_one();
+}
+
+// Wait for every queued mask, finalise the archive and sync to disk
+bool MaskWriter::Flush() {
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (stopping) {
+			return errorNo == 0;
+		}
+		stopping = true;
+		jobAvailable.notify_all();
+	}
+	for (auto & encoder : encoders) {
+		encoder.join();
+	}
+	encoders.clear();
+
+	if (format == MASK_FORMAT_STREAM) {
+		if (!maskStream.Close(true)) {
+			errorNo++;
+		}
+	}
+	else if (archiveFile != nullptr) {
+		// Frames may arrive out of order from several encoders; the index is kept sorted
+		std::sort(archiveIndex.begin(), archiveIndex.end(),
+			[](const ArchiveEntry &a, const ArchiveEntry &b) { return a.frameIndex < b.frameIndex; });
+		const unsigned long long indexOffset = archiveOffset;
+		for (auto & entry : archiveIndex) {
+			fwrite(&entry.frameIndex, sizeof(entry.frameIndex), 1, archiveFile);
+			fwrite(&entry.size, sizeof(entry.size), 1, archiveFile);
+			fwrite(&entry.offset, sizeof(entry.offset), 1, archiveFile);
+		}
+		const unsigned int entryNo = (unsigned int)archiveIndex.size();
+		fwrite(&indexOffset, sizeof(indexOffset), 1, archiveFile);
+		fwrite(&entryNo, sizeof(entryNo), 1, archiveFile);
+		fwrite(ARCHIVE_MAGIC, 1, sizeof(ARCHIVE_MAGIC), archiveFile);
+		if (!SyncFile(archiveFile)) {
+			errorNo++;
+		}
+		fclose(archiveFile);
+		archiveFile = nullptr;
+	}
+#ifndef _WIN32
+	else {
+		// Per-frame files: push everything on the result folder's file system to disk at once
+		// (Windows has no folder-wide sync; use the archive for a durable end-of-run point)
+		int folderDescriptor = open(folderName.c_str(), O_RDONLY);
+		if (folderDescriptor >= 0) {
+			syncfs(folderDescriptor);
+			close(folderDescriptor);
+		}
+	}
+#endif
+	return errorNo == 0;
+}
+
+// Encoder thread main loop
+void MaskWriter::EncoderLoop() {
+	std::vector<uchar> buffer;
+	while (true) {
+		WriteJob job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty()) {
+				break;
+			}
+			job = jobs.front();
+			jobs.pop_front();
+		}
+		const size_t maskBytes = job.fgMask.total() * job.fgMask.elemSize();
+		EncodeMask(job.frameIndex, job.fgMask, buffer);
+		const bool stored = StoreMask(job.frameIndex, buffer);
+		// Release the mask before waking the producer
+		job.fgMask.release();
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			pendingBytes -= maskBytes;
+			pendingJobNo--;
+			if (stored) {
+				writtenNo++;
+				writtenBytes += buffer.size();
+			}
+			else {
+				errorNo++;
+			}
+		}
+		spaceAvailable.notify_all();
+	}
+}
+
+// Encode one mask into a memory buffer
+void MaskWriter::EncodeMask(int frameIndex, const cv::Mat &fgMask, std::vector<uchar> &buffer) const {
+	if (format == MASK_FORMAT_STREAM) {
+		MaskStream::EncodeRecord(frameIndex, fgMask, buffer);
+	}
+	else if (format == MASK_FORMAT_PNG) {
+		std::vector<int> params;
+		params.push_back(cv::IMWRITE_PNG_COMPRESSION);
+		params.push_back(PNGCompression);
+		cv::imencode(".png", fgMask, buffer, params);
+	}
+	else {
+		// Binary PGM: plain header followed by the raw rows
+		char header[64];
+		const int headerLength = snprintf(header, sizeof(header), "P5\n%d %d\n255\n", fgMask.cols, fgMask.rows);
+		buffer.resize(headerLength + fgMask.total());
+		memcpy(buffer.data(), header, headerLength);
+		for (int rowIndex = 0; rowIndex < fgMask.rows; rowIndex++) {
+			memcpy(buffer.data() + headerLength + (size_t(rowIndex) * fgMask.cols), fgMask.ptr(rowIndex), fgMask.cols);
+		}
+	}
+}
+
+// Store one encoded mask
+bool MaskWriter::StoreMask(int frameIndex, const std::vector<uchar> &buffer) {
+	if (format == MASK_FORMAT_STREAM) {
+		return maskStream.AppendRecord(buffer);
+	}
+	if (archiveSwitch) {
+		std::lock_guard<std::mutex> lock(archiveMutex);
+		if (archiveFile == nullptr) {
+			return false;
+		}
+		const unsigned int index = (unsigned int)frameIndex;
+		const unsigned int size = (unsigned int)buffer.size();
+		fwrite(&index, sizeof(index), 1, archiveFile);
+		fwrite(&size, sizeof(size), 1, archiveFile);
+		ArchiveEntry entry;
+		entry.frameIndex = index;
+		entry.size = size;
+		entry.offset = archiveOffset + sizeof(index) + sizeof(size);
+		const bool success = fwrite(buffer.data(), 1, buffer.size(), archiveFile) == buffer.size();
+		archiveOffset = entry.offset + size;
+		archiveIndex.push_back(entry);
+		return success;
+	}
+	char s[25];
+	snprintf(s, sizeof(s), "/bin%06d.%s", frameIndex, (format == MASK_FORMAT_PNG) ? "png" : "pgm");
+	FILE * file = fopen((folderName + s).c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	const bool success = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	fclose(file);
+	return success;
+}
+
+// Flush a stdio file through to the disk
+bool MaskWriter::SyncFile(FILE *file) {
+	if (fflush(file) != 0) {
+		return false;
+	}
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Total number of masks written
+size_t MaskWriter::GetWrittenNo() const {
+	return writtenNo;
+}
+
+// Total number of encoded bytes written
+size_t MaskWriter::GetWrittenBytes() const {
+	return writtenBytes;
+}
+
+// Print writer statistics
+void MaskWriter::PrintStats(std::ostream &output) const {
+	output << "\n<<<<<-MASK WRITER->>>>>\n";
+	output << "MASKS WRITTEN: " << writtenNo << std::endl;
+	output << "BYTES WRITTEN: " << writtenBytes << std::endl;
+	output << "WRITE ERRORS: " << errorNo << std::endl;
+	output << "DROPPED AFTER FLUSH: " << droppedNo << std::endl;
+	output << "TIME THROTTLED (S): " << std::setprecision(3) << std::fixed << throttledSeconds << std::endl;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef __MaskWriter_H_INCLUDED
+#define __MaskWriter_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include "MaskStream.h"
+
+// Asynchronous foreground mask writer. Write() only queues the mask; a pool of encoder
+// threads encodes (PNG or uncompressed PGM) and writes it, either as one file per frame
+// ('binNNNNNN.png/.pgm') or appended to a single archive file ('results.lcdpar') to avoid
+// thousands of small-file creates. The STREAM format run-length encodes every mask into
+// one seekable mask stream ('results.lcdms', see MaskStream.h) and ignores the archive
+// switch. Queued masks are bounded by a byte budget, so a slow disk throttles the caller
+// instead of growing memory. Flush() marks the end of a run: it waits for every queued
+// mask, finalises the archive index and syncs to disk. The writer is single-use: masks
+// written after Flush() are dropped, logged and counted as write errors.
+class MaskWriter {
+public:
+	// Output encoding
+	enum MaskFormat {
+		MASK_FORMAT_PNG,
+		MASK_FORMAT_PGM,
+		MASK_FORMAT_STREAM
+	};
+
+	/*******CONSTRUCTOR*******/
+	// PNGCompression: 0 (fastest) - 9 (smallest); maxPendingBytes: memory budget of queued masks
+	MaskWriter(std::string inputFolderName, MaskFormat inputFormat, int inputPNGCompression,
+		bool inputArchiveSwitch, size_t inputEncoderNo, size_t inputMaxPendingBytes);
+
+	/*******DESTRUCTOR*******/
+	~MaskWriter();
+
+	// Queue a mask for writing; the writer keeps a reference, so the caller must not modify
+	// the mask afterwards. Blocks while the memory budget is used up. Dropped after Flush().
+	void Write(int frameIndex, const cv::Mat &fgMask);
+	// Wait for every queued mask, finalise the archive and sync to disk (RETURN-true: no error)
+	bool Flush();
+
+	// Total number of masks written
+	size_t GetWrittenNo() const;
+	// Total number of encoded bytes written
+	size_t GetWrittenBytes() const;
+	// Print writer statistics
+	void PrintStats(std::ostream &output) const;
+
+	// Archive layout: "LCDPAR01" | { uint32 frameIndex, uint32 size, encoded bytes }... |
+	// index { uint32 frameIndex, uint32 size, uint64 offset }... | uint64 indexOffset | uint32 count | "LCDPAR01"
+	static const char ARCHIVE_MAGIC[8];
+
+protected:
+	// Queued mask
+	struct WriteJob {
+		int frameIndex;
+		cv::Mat fgMask;
+	};
+	// Archive index entry
+	struct ArchiveEntry {
+		unsigned int frameIndex;
+		unsigned int size;
+		unsigned long long offset;
+	};
+
+	// Encoder thread main loop
+	void EncoderLoop();
+	// Encode one mask into a memory buffer
+	void EncodeMask(int frameIndex, const cv::Mat &fgMask, std::vector<uchar> &buffer) const;
+	// Store one encoded mask (RETURN-true: success)
+	bool StoreMask(int frameIndex, const std::vector<uchar> &buffer);
+	// Flush a stdio file through to the disk
+	static bool SyncFile(FILE *file);
+
+	/*=====OUTPUT Parameters=====*/
+	// Result folder
+	const std::string folderName;
+	// Output encoding
+	const MaskFormat format;
+	// PNG compression level
+	const int PNGCompression;
+	// Archive switch
+	const bool archiveSwitch;
+	// Memory budget of queued masks
+	const size_t maxPendingBytes;
+
+	/*=====ENCODER Parameters=====*/
+	std::vector<std::thread> encoders;
+	std::deque<WriteJob> jobs;
+	// Bytes held by queued or encoding masks
+	size_t pendingBytes;
+	// Masks queued or encoding
+	size_t pendingJobNo;
+	bool stopping;
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable spaceAvailable;
+
+	/*=====ARCHIVE=====*/
+	FILE * archiveFile;
+	unsigned long long archiveOffset;
+	std::vector<ArchiveEntry> archiveIndex;
+	std::mutex archiveMutex;
+	// Mask stream (STREAM format)
+	MaskStreamWriter maskStream;
+
+	/*=====STATISTICS=====*/
+	size_t writtenNo;
+	size_t writtenBytes;
+	size_t errorNo;
+	// Masks dropped because they were written after Flush()
+	size_t droppedNo;
+	// Time the caller spent blocked on the memory budget (s)
+	double throttledSeconds;
+};
+#endif
@@ -0,0 +1,292 @@
+#include "ModelCheckpoint.h"
+#include "BackgroundSubtractorLCDP.h"
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Section alignment in the file (bytes)
+#define CHECKPOINT_ALIGNMENT 64
+
+const char ModelCheckpoint::MAGIC[8] = { 'L', 'C', 'D', 'P', 'C', 'K', '0', '1' };
+
+// CRC-32 lookup tables (slicing-by-8)
+static unsigned int CRCTable[8][256];
+// Guards the one-time generation of the CRC tables
+static std::once_flag CRCTableFlag;
+
+// Generate the CRC-32 lookup tables
+static void GenerateCRCTable() {
+	for (unsigned int value = 0; value < 256; value++) {
+		unsigned int crc = value;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 1) ? (0xEDB88320u ^ (crc >> 1)) : (crc >> 1);
+		}
+		CRCTable[0][value] = crc;
+	}
+	for (unsigned int value = 0; value < 256; value++) {
+		for (int slice = 1; slice < 8; slice++) {
+			CRCTable[slice][value] = (CRCTable[slice - 1][value] >> 8) ^ CRCTable[0][CRCTable[slice - 1][value] & 0xFF];
+		}
+	}
+}
+
+// Append a little-endian value to a buffer
+template<typename T>
+static void PutValue(std::vector<uchar> &buffer, T value) {
+	const uchar * bytes = reinterpret_cast<const uchar*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+// Read a little-endian value
+template<typename T>
+static T GetValue(const uchar *data) {
+	T value;
+	memcpy(&value, data, sizeof(T));
+	return value;
+}
+
+// Offset rounded up to the section alignment
+static unsigned long long AlignOffset(unsigned long long offset) {
+	return (offset + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+}
+
+// CRC-32 (IEEE) of a buffer
+unsigned int ModelCheckpoint::Checksum(const void *data, size_t size, unsigned int crc) {
+	std::call_once(CRCTableFlag, &GenerateCRCTable);
+	const uchar * bytes = static_cast<const uchar*>(data);
+	crc = ~crc;
+	while (size >= 8) {
+		const unsigned int low = GetValue<unsigned int>(bytes) ^ crc;
+		const unsigned int high = GetValue<unsigned int>(bytes + 4);
+		crc = CRCTable[7][low & 0xFF] ^ CRCTable[6][(low >> 8) & 0xFF] ^ CRCTable[5][(low >> 16) & 0xFF] ^ CRCTable[4][low >> 24] ^
+			CRCTable[3][high & 0xFF] ^ CRCTable[2][(high >> 8) & 0xFF] ^ CRCTable[1][(high >> 16) & 0xFF] ^ CRCTable[0][high >> 24];
+		bytes += 8;
+		size -= 8;
+	}
+	while (size > 0) {
+		crc = (crc >> 8) ^ CRCTable[0][(crc ^ *bytes) & 0xFF];
+		bytes++;
+		size--;
+	}
+	return ~crc;
+}
+
+// Write a snapshot through a temporary file
+bool ModelCheckpoint::Save(const std::string &fileName, const Snapshot &snapshot) {
+	// Header and section table
+	std::vector<uchar> meta;
+	meta.insert(meta.end(), MAGIC, MAGIC + sizeof(MAGIC));
+	PutValue<unsigned int>(meta, VERSION);
+	PutValue<unsigned int>(meta, snapshot.header.rows);
+	PutValue<unsigned int>(meta, snapshot.header.cols);
+	PutValue<unsigned int>(meta, snapshot.header.wordsNo);
+	PutValue<unsigned int>(meta, snapshot.header.wordSize);
+	PutValue<unsigned int>(meta, CHECKPOINT_SECTION_NO);
+	PutValue<unsigned long long>(meta, snapshot.header.frameIndex);
+	unsigned long long offset = AlignOffset(HEADER_SIZE + (CHECKPOINT_SECTION_NO * TABLE_ENTRY_SIZE) + sizeof(unsigned int));
+	for (int section = 0; section < CHECKPOINT_SECTION_NO; section++) {
+		const std::vector<uchar> &data = snapshot.sections[section];
+		PutValue<unsigned int>(meta, section);
+		PutValue<unsigned int>(meta, Checksum(data.data(), data.size()));
+		PutValue<unsigned long long>(meta, offset);
+		PutValue<unsigned long long>(meta, data.size());
+		offset = AlignOffset(offset + data.size());
+	}
+	PutValue<unsigned int>(meta, Checksum(meta.data(), meta.size()));
+
+	const std::string tempFileName = fileName + ".tmp";
+	FILE * file = fopen(tempFileName.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	const uchar padding[CHECKPOINT_ALIGNMENT] = { 0 };
+	bool success = fwrite(meta.data(), 1, meta.size(), file) == meta.size();
+	unsigned long long position = meta.size();
+	for (int section = 0; success && (section < CHECKPOINT_SECTION_NO); section++) {
+		const std::vector<uchar> &data = snapshot.sections[section];
+		const size_t paddingSize = size_t(AlignOffset(position) - position);
+		success = (fwrite(padding, 1, paddingSize, file) == paddingSize) &&
+			(fwrite(data.data(), 1, data.size(), file) == data.size());
+		position += paddingSize + data.size();
+	}
+#ifdef _WIN32
+	success = success && (fflush(file) == 0) && (_commit(_fileno(file)) == 0);
+	fclose(file);
+	success = success && MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	success = success && (fflush(file) == 0) && (fsync(fileno(file)) == 0);
+	fclose(file);
+	success = success && (rename(tempFileName.c_str(), fileName.c_str()) == 0);
+#endif
+	if (!success) {
+		remove(tempFileName.c_str());
+	}
+	return success;
+}
+
+/*******CONSTRUCTOR*******/
+CheckpointReader::CheckpointReader() {
+	Close();
+}
+
+// Map a checkpoint and verify every checksum
+bool CheckpointReader::Open(const std::string &fileName) {
+	Close();
+	if (!mappedFile.Open(fileName)) {
+		return false;
+	}
+	const uchar * data = mappedFile.Data();
+	const size_t size = mappedFile.Size();
+	const size_t metaSize = ModelCheckpoint::HEADER_SIZE + (ModelCheckpoint::CHECKPOINT_SECTION_NO * ModelCheckpoint::TABLE_ENTRY_SIZE);
+	if ((size < metaSize + sizeof(unsigned int)) || (memcmp(data, ModelCheckpoint::MAGIC, sizeof(ModelCheckpoint::MAGIC)) != 0) ||
+		(GetValue<unsigned int>(data + 8) != ModelCheckpoint::VERSION) ||
+		(GetValue<unsigned int>(data + 28) != ModelCheckpoint::CHECKPOINT_SECTION_NO) ||
+		(GetValue<unsigned int>(data + metaSize) != ModelCheckpoint::Checksum(data, metaSize))) {
+		Close();
+		return false;
+	}
+	header.rows = GetValue<unsigned int>(data + 12);
+	header.cols = GetValue<unsigned int>(data + 16);
+	header.wordsNo = GetValue<unsigned int>(data + 20);
+	header.wordSize = GetValue<unsigned int>(data + 24);
+	header.frameIndex = GetValue<unsigned long long>(data + 32);
+	for (int section = 0; section < ModelCheckpoint::CHECKPOINT_SECTION_NO; section++) {
+		const uchar * entry = data + ModelCheckpoint::HEADER_SIZE + (section * ModelCheckpoint::TABLE_ENTRY_SIZE);
+		const unsigned int checksum = GetValue<unsigned int>(entry + 4);
+		const unsigned long long offset = GetValue<unsigned long long>(entry + 8);
+		const unsigned long long sectionBytes = GetValue<unsigned long long>(entry + 16);
+		if ((GetValue<unsigned int>(entry) != (unsigned int)section) || (offset > size) || (sectionBytes > size - offset) ||
+			(ModelCheckpoint::Checksum(data + offset, size_t(sectionBytes)) != checksum)) {
+			Close();
+			return false;
+		}
+		sectionData[section] = data + offset;
+		sectionSize[section] = size_t(sectionBytes);
+	}
+	return true;
+}
+
+// Unmap the checkpoint
+void CheckpointReader::Close() {
+	mappedFile.Close();
+	memset(&header, 0, sizeof(header));
+	for (int section = 0; section < ModelCheckpoint::CHECKPOINT_SECTION_NO; section++) {
+		sectionData[section] = nullptr;
+		sectionSize[section] = 0;
+	}
+}
+
+// Model shape and progress
+const ModelCheckpoint::Header & CheckpointReader::GetHeader() const {
+	return header;
+}
+
+// Start and size of a section
+const uchar * CheckpointReader::GetSection(int section, size_t &size) const {
+	size = sectionSize[section];
+	return sectionData[section];
+}
+
+/*******CONSTRUCTOR*******/
+CheckpointWriter::CheckpointWriter(const std::string &inputFileName) :
+	/*=====OUTPUT Parameters=====*/
+	fileName(inputFileName),
+
+	/*=====WRITER Parameters=====*/
+	busy(false),
+	stopping(false),
+
+	/*=====STATISTICS=====*/
+	writtenNo(0),
+	skippedNo(0),
+	errorNo(0),
+	captureSeconds(0.0),
+	writeSeconds(0.0)
+{
+	writer = std::thread(&CheckpointWriter::WriterLoop, this);
+}
+
+/*******DESTRUCTOR*******/
+CheckpointWriter::~CheckpointWriter() {
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		stopping = true;
+		snapshotReady.notify_all();
+	}
+	writer.join();
+}
+
+// Capture the model and write it in the background
+bool CheckpointWriter::Submit(const BackgroundSubtractorLCDP &subtractor) {
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		if (busy || stopping) {
+			skippedNo++;
+			return false;
+		}
+	}
+	// The writer thread does not touch the snapshot while idle
+	const std::chrono::steady_clock::time_point captureStart = std::chrono::steady_clock::now();
+	subtractor.CaptureCheckpoint(snapshot);
+	std::lock_guard<std::mutex> lock(writerMutex);
+	captureSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - captureStart).count();
+	busy = true;
+	snapshotReady.notify_one();
+	return true;
+}
+
+// Wait for the checkpoint being written
+bool CheckpointWriter::Flush() {
+	std::unique_lock<std::mutex> lock(writerMutex);
+	writeDone.wait(lock, [this] { return !busy; });
+	return errorNo == 0;
+}
+
+// Writer thread main loop
+void CheckpointWriter::WriterLoop() {
+	std::unique_lock<std::mutex> lock(writerMutex);
+	while (true) {
+		snapshotReady.wait(lock, [this] { return stopping || busy; });
+		if (!busy) {
+			break;
+		}
+		lock.unlock();
+		const std::chrono::steady_clock::time_point writeStart = std::chrono::steady_clock::now();
+		const bool success = ModelCheckpoint::Save(fileName, snapshot);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+		lock.lock();
+		writeSeconds += seconds;
+		if (success) {
+			writtenNo++;
+		}
+		else {
+			errorNo++;
+		}
+		busy = false;
+		writeDone.notify_all();
+	}
+}
+
+// Total number of checkpoints written
+size_t CheckpointWriter::GetWrittenNo() const {
+	std::lock_guard<std::mutex> lock(writerMutex);
+	return writtenNo;
+}
+
+// Print writer statistics
+void CheckpointWriter::PrintStats(std::ostream &output) const {
+	std::lock_guard<std::mutex> lock(writerMutex);
+	output << "\n<<<<<-MODEL CHECKPOINT->>>>>\n";
+	output << "FILE: " << fileName << std::endl;
+	output << "CHECKPOINTS WRITTEN: " << writtenNo << " SKIPPED (BUSY): " << skippedNo << " ERRORS: " << errorNo << std::endl;
+	output << "CAPTURE TIME (S): " << std::setprecision(3) << std::fixed << captureSeconds
+		<< " BACKGROUND WRITE TIME (S): " << writeSeconds << std::endl;
+}
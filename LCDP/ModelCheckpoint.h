@@ -0,0 +1,158 @@
+#pragma once
+
+#ifndef __ModelCheckpoint_H_INCLUDED
+#define __ModelCheckpoint_H_INCLUDED
+#include "MappedFile.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+
+class BackgroundSubtractorLCDP;
+
+// Background model checkpoint ('.lcdpck'). Holds everything a subtractor learns over time
+// (background words, R/V/T maps, persistence thresholds, running-average images, the
+// masks carried to the next frame, the ROI and the frame index), so a restarted subtractor
+// skips bootstrapping. Every section carries a CRC-32; the header and section table carry one too.
+//
+// Layout (little-endian):
+//   header: "LCDPCK01" | uint32 version | uint32 rows | uint32 cols | uint32 wordsNo |
+//           uint32 wordSize | uint32 sectionCount | uint64 frameIndex
+//   table:  { uint32 section, uint32 checksum, uint64 offset, uint64 size }...
+//   uint32 checksum of header and table
+//   sections, each starting on a 64-byte boundary
+//
+// Words are stored as raw structs of the subtractor's word size, which follows its descriptor
+// neighbourhood and channel count; 'wordSize' rejects checkpoints with a different word layout. The words and the float maps only cover ROI pixels (row-major),
+// so a checkpoint is only restored by a subtractor with the same ROI. Each pixel's words
+// are stored back to back; the word capacity section (uint16 per ROI pixel) splits them.
+// Word frame stamps are 16-bit, relative to the word epoch section (uint64 per ROI pixel).
+// The descriptor section (uint32) holds the descriptor neighbourhood the words were built with.
+class ModelCheckpoint {
+public:
+	// Sections (in file order)
+	enum Section {
+		SECTION_BG_WORDS,
+		SECTION_PERSISTENCE_THRESHOLD,
+		SECTION_DIST_THRESHOLD,
+		SECTION_DYNAMIC_RATE,
+		SECTION_UPDATE_RATE,
+		SECTION_LAST_IMG,
+		SECTION_LAST_GRAY_IMG,
+		SECTION_LAST_FG_MASK,
+		SECTION_LAST_RAW_BLINK,
+		SECTION_BLINK_FRAME,
+		SECTION_T_1_FG_MASK,
+		SECTION_T_2_FG_MASK,
+		SECTION_LAST_FG_MASK_DILATED_INVERTED,
+		SECTION_ROI,
+		SECTION_WORD_CAPACITY,
+		SECTION_WORD_EPOCH,
+		SECTION_DESCRIPTOR,
+		CHECKPOINT_SECTION_NO
+	};
+	// File magic
+	static const char MAGIC[8];
+	// Format version
+	static const unsigned int VERSION = 6;
+	// Size of the header (bytes)
+	static const size_t HEADER_SIZE = 40;
+	// Size of a section table entry (bytes)
+	static const size_t TABLE_ENTRY_SIZE = 24;
+
+	// Model shape and progress
+	struct Header {
+		unsigned int rows;
+		unsigned int cols;
+		unsigned int wordsNo;
+		unsigned int wordSize;
+		unsigned long long frameIndex;
+	};
+	// In-memory copy of a model (buffers are reused between captures)
+	struct Snapshot {
+		Header header;
+		std::vector<uchar> sections[CHECKPOINT_SECTION_NO];
+	};
+
+	// CRC-32 (IEEE) of a buffer, continued from a previous value
+	static unsigned int Checksum(const void *data, size_t size, unsigned int crc = 0);
+	// Write a snapshot to '<fileName>.tmp', sync it and rename it over fileName, so a crash
+	// never leaves a half-written checkpoint behind (RETURN-true: success)
+	static bool Save(const std::string &fileName, const Snapshot &snapshot);
+};
+
+// Reads a checkpoint through a memory mapping; sections are used in place.
+class CheckpointReader {
+public:
+	/*******CONSTRUCTOR*******/
+	CheckpointReader();
+
+	// Map a checkpoint and verify every checksum (RETURN-true: valid checkpoint)
+	bool Open(const std::string &fileName);
+	// Unmap the checkpoint
+	void Close();
+	// Model shape and progress
+	const ModelCheckpoint::Header & GetHeader() const;
+	// Start and size of a section (valid until Close)
+	const uchar * GetSection(int section, size_t &size) const;
+
+private:
+	MappedFile mappedFile;
+	ModelCheckpoint::Header header;
+	const uchar * sectionData[ModelCheckpoint::CHECKPOINT_SECTION_NO];
+	size_t sectionSize[ModelCheckpoint::CHECKPOINT_SECTION_NO];
+};
+
+// Periodic checkpointing without stalling Process. Submit() copies the model into a
+// reused snapshot on the calling thread (between two Process calls, so the copy is
+// consistent) and a background thread checksums and writes it. While a checkpoint is
+// still being written, further submits are skipped rather than waited for.
+class CheckpointWriter {
+public:
+	/*******CONSTRUCTOR*******/
+	explicit CheckpointWriter(const std::string &inputFileName);
+
+	/*******DESTRUCTOR*******/
+	~CheckpointWriter();
+
+	// Capture the model and write it in the background (RETURN-false: skipped, writer busy)
+	bool Submit(const BackgroundSubtractorLCDP &subtractor);
+	// Wait for the checkpoint being written (RETURN-true: no write error so far)
+	bool Flush();
+
+	// Total number of checkpoints written
+	size_t GetWrittenNo() const;
+	// Print writer statistics
+	void PrintStats(std::ostream &output) const;
+
+private:
+	// Writer thread main loop
+	void WriterLoop();
+
+	/*=====OUTPUT Parameters=====*/
+	// Checkpoint file
+	const std::string fileName;
+
+	/*=====WRITER Parameters=====*/
+	std::thread writer;
+	// Snapshot owned by the writer thread while 'busy'
+	ModelCheckpoint::Snapshot snapshot;
+	bool busy;
+	bool stopping;
+	mutable std::mutex writerMutex;
+	std::condition_variable snapshotReady;
+	std::condition_variable writeDone;
+
+	/*=====STATISTICS=====*/
+	size_t writtenNo;
+	size_t skippedNo;
+	size_t errorNo;
+	// Time spent copying the model on the caller's thread (s)
+	double captureSeconds;
+	// Time spent writing in the background (s)
+	double writeSeconds;
+};
+#endif
@@ -0,0 +1,340 @@
+#include "ModelStorage.h"
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/*******CONSTRUCTOR*******/
+ModelStorage::ModelStorage() :
+	backend(STORAGE_HEAP),
+	data(nullptr),
+	size(0),
+	pageSize(PAGES_DEFAULT),
+	heapMapped(false),
+	mappedSize(0),
+	reservedHugePages(false)
+#ifdef _WIN32
+	, fileHandle(nullptr),
+	mappingHandle(nullptr)
+#endif
+{
+}
+
+/*******DESTRUCTOR*******/
+ModelStorage::~ModelStorage() {
+	Release();
+}
+
+// Allocate zeroed bytes
+bool ModelStorage::Allocate(Backend inputBackend, size_t inputSize, const std::string &inputName) {
+	Release();
+	if (inputSize == 0) {
+		return false;
+	}
+	if ((inputBackend == STORAGE_HEAP) && (pageSize != PAGES_DEFAULT)) {
+		if (!MapHeap(inputSize)) {
+			return false;
+		}
+	}
+	else if (inputBackend == STORAGE_HEAP) {
+		data = new unsigned char[inputSize];
+		memset(data, 0, inputSize);
+	}
+	else {
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		if (inputBackend == STORAGE_FILE) {
+			// The model is scanned front to back every frame
+			file = CreateFileA(inputName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+		}
+		// A file mapping grows the file; without a file it is backed by the paging file
+		const unsigned long long mappingSize = inputSize;
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, DWORD(mappingSize >> 32), DWORD(mappingSize & 0xFFFFFFFF),
+			(inputBackend == STORAGE_SHARED_MEMORY) ? inputName.c_str() : NULL);
+		if ((mapping == NULL) || ((inputBackend == STORAGE_SHARED_MEMORY) && (GetLastError() == ERROR_ALREADY_EXISTS))) {
+			if (mapping != NULL) {
+				CloseHandle(mapping);
+			}
+			if (file != INVALID_HANDLE_VALUE) {
+				CloseHandle(file);
+			}
+			return false;
+		}
+		void * view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, inputSize);
+		if (view == NULL) {
+			CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE) {
+				CloseHandle(file);
+			}
+			return false;
+		}
+		fileHandle = (file != INVALID_HANDLE_VALUE) ? file : nullptr;
+		mappingHandle = mapping;
+		data = static_cast<unsigned char *>(view);
+#else
+		int fileDescriptor = -1;
+		if (inputBackend == STORAGE_FILE) {
+			fileDescriptor = open(inputName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		}
+		else {
+			fileDescriptor = shm_open(inputName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+			// A segment left behind by a crashed run outlives the process: drop it and retry once
+			if ((fileDescriptor < 0) && (errno == EEXIST)) {
+				shm_unlink(inputName.c_str());
+				fileDescriptor = shm_open(inputName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+			}
+		}
+		if (fileDescriptor < 0) {
+			return false;
+		}
+		// A freshly truncated file reads back as zeros
+		if (ftruncate(fileDescriptor, off_t(inputSize)) != 0) {
+			close(fileDescriptor);
+			if (inputBackend == STORAGE_SHARED_MEMORY) {
+				shm_unlink(inputName.c_str());
+			}
+			return false;
+		}
+		void * view = mmap(nullptr, inputSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+		// The mapping stays valid after the descriptor is closed
+		close(fileDescriptor);
+		if (view == MAP_FAILED) {
+			if (inputBackend == STORAGE_SHARED_MEMORY) {
+				shm_unlink(inputName.c_str());
+			}
+			return false;
+		}
+		data = static_cast<unsigned char *>(view);
+#endif
+	}
+	backend = inputBackend;
+	name = inputName;
+	size = inputSize;
+	return true;
+}
+
+// Unmap / free the memory
+void ModelStorage::Release() {
+	if (data == nullptr) {
+		return;
+	}
+	if ((backend == STORAGE_HEAP) && heapMapped) {
+#ifdef _WIN32
+		VirtualFree(data, 0, MEM_RELEASE);
+#else
+		munmap(data, mappedSize);
+#endif
+		heapMapped = false;
+		mappedSize = 0;
+		reservedHugePages = false;
+	}
+	else if (backend == STORAGE_HEAP) {
+		delete[] data;
+	}
+	else {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(mappingHandle);
+		if (fileHandle != nullptr) {
+			CloseHandle(fileHandle);
+		}
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		munmap(data, size);
+		if (backend == STORAGE_SHARED_MEMORY) {
+			shm_unlink(name.c_str());
+		}
+#endif
+	}
+	data = nullptr;
+	size = 0;
+	name.clear();
+	backend = STORAGE_HEAP;
+}
+
+// Map zeroed heap memory with the requested page size
+bool ModelStorage::MapHeap(size_t inputSize) {
+#ifdef _WIN32
+	if (pageSize == PAGES_HUGE) {
+		// Needs SeLockMemoryPrivilege; large pages are committed (and zeroed) up front
+		const size_t largePageSize = GetLargePageMinimum();
+		if (largePageSize > 0) {
+			const size_t largeSize = (inputSize + largePageSize - 1) / largePageSize * largePageSize;
+			void * view = VirtualAlloc(NULL, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (view != NULL) {
+				data = static_cast<unsigned char *>(view);
+				mappedSize = largeSize;
+				reservedHugePages = true;
+			}
+		}
+	}
+	if (data == nullptr) {
+		// Committed pages are zeroed when first touched
+		void * view = VirtualAlloc(NULL, inputSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (view == NULL) {
+			return false;
+		}
+		data = static_cast<unsigned char *>(view);
+		mappedSize = inputSize;
+	}
+#else
+	// Whole 2 MB pages, so the tail of the array is covered too
+	const size_t hugePageSize = 2 * 1024 * 1024;
+	const size_t hugeSize = (inputSize + hugePageSize - 1) / hugePageSize * hugePageSize;
+#ifdef MAP_HUGETLB
+	if (pageSize == PAGES_HUGE) {
+		void * view = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (view != MAP_FAILED) {
+			data = static_cast<unsigned char *>(view);
+			mappedSize = hugeSize;
+			reservedHugePages = true;
+		}
+	}
+#endif
+	if (data == nullptr) {
+		void * view = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		data = static_cast<unsigned char *>(view);
+		mappedSize = hugeSize;
+#ifdef MADV_HUGEPAGE
+		madvise(data, mappedSize, MADV_HUGEPAGE);
+#endif
+	}
+#endif
+	heapMapped = true;
+	return true;
+}
+
+// Page size of later heap allocations
+void ModelStorage::SetPageSize(PageSize inputPageSize) {
+	pageSize = inputPageSize;
+}
+
+// Hint the access pattern of a byte range to the OS
+void ModelStorage::Advise(Access access, size_t offset, size_t length) const {
+	if ((data == nullptr) || (backend == STORAGE_HEAP) || (offset >= size)) {
+		return;
+	}
+#ifndef _WIN32
+	// madvise works on whole pages
+	const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+	const size_t start = offset / pageSize * pageSize;
+	const size_t end = std::min(size, offset + length);
+	const int advice = (access == ACCESS_SEQUENTIAL) ? MADV_SEQUENTIAL : ((access == ACCESS_WILL_NEED) ? MADV_WILLNEED : MADV_NORMAL);
+	madvise(data + start, end - start, advice);
+#else
+	// Windows has no per-range advice for mapped views; FILE_FLAG_SEQUENTIAL_SCAN covers the file case
+	(void)access;
+	(void)length;
+#endif
+}
+
+// Write dirty pages of a file back
+bool ModelStorage::Flush(bool syncSwitch) const {
+	if ((data == nullptr) || (backend != STORAGE_FILE)) {
+		return true;
+	}
+#ifdef _WIN32
+	return FlushViewOfFile(data, size) && (!syncSwitch || FlushFileBuffers(fileHandle));
+#else
+	return msync(data, size, syncSwitch ? MS_SYNC : MS_ASYNC) == 0;
+#endif
+}
+
+// Start of the memory
+unsigned char * ModelStorage::Data() const {
+	return data;
+}
+
+// Size of the memory (bytes)
+size_t ModelStorage::Size() const {
+	return size;
+}
+
+// Where the memory comes from
+ModelStorage::Backend ModelStorage::GetBackend() const {
+	return backend;
+}
+
+// Backend name
+const char * ModelStorage::GetBackendName(Backend backend) {
+	switch (backend) {
+	case STORAGE_FILE:
+		return "file";
+	case STORAGE_SHARED_MEMORY:
+		return "shm";
+	default:
+		return "heap";
+	}
+}
+
+// Requested page size
+ModelStorage::PageSize ModelStorage::GetPageSize() const {
+	return pageSize;
+}
+
+// Reserved huge pages were obtained
+bool ModelStorage::UsesReservedHugePages() const {
+	return reservedHugePages;
+}
+
+// Page size name
+const char * ModelStorage::GetPageSizeName(PageSize pageSize) {
+	switch (pageSize) {
+	case PAGES_TRANSPARENT_HUGE:
+		return "thp";
+	case PAGES_HUGE:
+		return "huge";
+	default:
+		return "default";
+	}
+}
+
+// Parse a page size name
+bool ModelStorage::ParsePageSize(const std::string &name, PageSize &pageSize) {
+	if (name == "default") {
+		pageSize = PAGES_DEFAULT;
+	}
+	else if (name == "thp") {
+		pageSize = PAGES_TRANSPARENT_HUGE;
+	}
+	else if (name == "huge") {
+		pageSize = PAGES_HUGE;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+// Parse a backend name
+bool ModelStorage::ParseBackend(const std::string &name, Backend &backend) {
+	if (name == "heap") {
+		backend = STORAGE_HEAP;
+	}
+	else if (name == "file") {
+		backend = STORAGE_FILE;
+	}
+	else if (name == "shm") {
+		backend = STORAGE_SHARED_MEMORY;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
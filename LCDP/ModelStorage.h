@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef __ModelStorage_H_INCLUDED
+#define __ModelStorage_H_INCLUDED
+#include <string>
+#include <cstddef>
+
+// Zero-filled, writable memory for the background model. Besides the heap, the model can
+// live in a memory-mapped file (pages are written back to the file instead of the swap,
+// so models larger than RAM keep running) or in a named shared-memory segment (another
+// process can map it to inspect or back up the model without copying).
+// Heap memory can be backed by huge pages to cut TLB misses on large per-pixel arrays.
+// Huge-page heap memory is zeroed by the OS when a page is first written, so each page is
+// placed on the NUMA node of the thread that first writes it rather than the allocator's
+// (plain heap memory is written, and placed, by the allocating thread).
+class ModelStorage {
+public:
+	// Where the memory comes from
+	enum Backend {
+		STORAGE_HEAP,
+		// Memory-mapped file (name: file path)
+		STORAGE_FILE,
+		// Named shared-memory segment (name: segment name, e.g. "/lcdp-highway")
+		STORAGE_SHARED_MEMORY
+	};
+	// Expected access pattern
+	enum Access {
+		ACCESS_NORMAL,
+		// Front-to-back scans: read ahead aggressively and free pages behind the scan
+		ACCESS_SEQUENTIAL,
+		// Pages are needed soon
+		ACCESS_WILL_NEED
+	};
+
+	// Page size of heap memory
+	enum PageSize {
+		// new[] and memset
+		PAGES_DEFAULT,
+		// Anonymous mapping with a transparent huge page hint (Linux; plain pages elsewhere)
+		PAGES_TRANSPARENT_HUGE,
+		// Reserved huge pages (Linux hugetlbfs pool / Windows large pages with the "Lock pages
+		// in memory" privilege); falls back to PAGES_TRANSPARENT_HUGE
+		PAGES_HUGE
+	};
+
+	/*******CONSTRUCTOR*******/
+	ModelStorage();
+
+	/*******DESTRUCTOR*******/
+	~ModelStorage();
+
+	// Allocate 'inputSize' zeroed bytes (RETURN-true: success). A file is created or
+	// truncated; a shared-memory segment is created and removed again on Release.
+	bool Allocate(Backend inputBackend, size_t inputSize, const std::string &inputName);
+	// Unmap / free the memory (a file keeps its content)
+	void Release();
+	// Page size of later heap allocations
+	void SetPageSize(PageSize inputPageSize);
+	// Hint the access pattern of a byte range to the OS (no effect on the heap)
+	void Advise(Access access, size_t offset, size_t length) const;
+	// Write dirty pages of a file back (RETURN-true: success; nothing to do otherwise)
+	bool Flush(bool syncSwitch) const;
+
+	// Start of the memory (nullptr: not allocated)
+	unsigned char * Data() const;
+	// Size of the memory (bytes)
+	size_t Size() const;
+	// Where the memory comes from
+	Backend GetBackend() const;
+	// Backend name
+	static const char * GetBackendName(Backend backend);
+	// Parse 'heap', 'file' or 'shm' (RETURN-true: known name)
+	static bool ParseBackend(const std::string &name, Backend &backend);
+	// Requested page size
+	PageSize GetPageSize() const;
+	// Reserved huge pages were obtained (PAGES_HUGE only)
+	bool UsesReservedHugePages() const;
+	// Page size name
+	static const char * GetPageSizeName(PageSize pageSize);
+	// Parse 'default', 'thp' or 'huge' (RETURN-true: known name)
+	static bool ParsePageSize(const std::string &name, PageSize &pageSize);
+
+private:
+	// Not copyable: the memory is owned by exactly one object
+	ModelStorage(const ModelStorage &);
+	ModelStorage & operator=(const ModelStorage &);
+
+	// Map zeroed heap memory of 'inputSize' bytes with the requested page size (RETURN-true: success)
+	bool MapHeap(size_t inputSize);
+
+	Backend backend;
+	// File path or segment name
+	std::string name;
+	unsigned char * data;
+	size_t size;
+	// Page size of heap memory
+	PageSize pageSize;
+	// Heap memory was mapped (not new[]) and its mapped length
+	bool heapMapped;
+	size_t mappedSize;
+	bool reservedHugePages;
+#ifdef _WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#endif
+};
+#endif
@@ -0,0 +1,260 @@
+#include "MultiStreamEngine.h"
+#include "Functions.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+/*******CONSTRUCTOR*******/
+MultiStreamEngine::MultiStreamEngine(size_t inputWorkerNo, std::vector<int> inputWorkerCPUs, double inputMaxQueueLatencyMs) :
+	/*=====WORKER Parameters=====*/
+	// Total number of worker threads
+	workerNo((inputWorkerNo > 0) ? inputWorkerNo : size_t(GetHardwareThreadNo())),
+	// Logical CPU per worker
+	workerCPUs(inputWorkerCPUs),
+	// Frames older than this are skipped (0: never)
+	maxQueueLatencyMs(inputMaxQueueLatencyMs),
+
+	/*=====STREAM Parameters=====*/
+	pendingFrameNo(0),
+	running(false),
+
+	/*=====IDLE WAIT=====*/
+	workEpoch(0)
+{
+	if (workerCPUs.empty()) {
+		const int cpuNo = GetHardwareThreadNo();
+		for (size_t workerIndex = 0; workerIndex < workerNo; workerIndex++) {
+			workerCPUs.push_back(int(workerIndex % cpuNo));
+		}
+	}
+}
+
+/*******DESTRUCTOR*******/
+MultiStreamEngine::~MultiStreamEngine() {
+	Stop();
+}
+
+// Register a stream
+size_t MultiStreamEngine::AddStream(std::string name, BackgroundSubtractorLCDP *subtractor, cv::Mat ROI,
+	size_t queueCapacity, ResultCallback callback) {
+	CV_Assert(!running && subtractor != nullptr && queueCapacity > 0);
+	std::unique_ptr<Stream> stream(new Stream(queueCapacity));
+	stream->id = streams.size();
+	stream->name = name;
+	stream->subtractor.reset(subtractor);
+	stream->ROI = ROI;
+	stream->callback = callback;
+	stream->busy = false;
+	stream->initialized = false;
+	stream->framesPushed = 0;
+	stream->framesProcessed = 0;
+	stream->framesRejected = 0;
+	stream->framesDropped = 0;
+	stream->maxQueueDepth = 0;
+	stream->totalLatencyUs = 0;
+	stream->maxLatencyUs = 0;
+	stream->totalProcessUs = 0;
+	streams.push_back(std::move(stream));
+	return streams.size() - 1;
+}
+
+// Start the worker pool
+void MultiStreamEngine::Start() {
+	if (running) {
+		return;
+	}
+	running = true;
+	startTime = Clock::now();
+	for (size_t workerIndex = 0; workerIndex < workerNo; workerIndex++) {
+		workers.push_back(std::thread(&MultiStreamEngine::WorkerLoop, this, workerIndex));
+	}
+}
+
+// Stop accepting frames, finish queued frames and join the workers
+void MultiStreamEngine::Stop() {
+	if (!running) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(idleMutex);
+		running = false;
+		workEpoch++;
+	}
+	workCondition.notify_all();
+	for (auto & worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+// Queue a frame for a stream
+bool MultiStreamEngine::PushFrame(size_t streamId, const cv::Mat &inputFrame) {
+	Stream &stream = *streams.at(streamId);
+	// Count the frame before it becomes visible so workers never see a negative total
+	pendingFrameNo++;
+	QueuedFrame queuedFrame;
+	queuedFrame.frame = inputFrame;
+	// The stream has a single producer, so the index is only taken once the push succeeds
+	queuedFrame.frameIndex = stream.framesPushed + 1;
+	queuedFrame.pushTime = Clock::now();
+	if (!stream.queue.Push(queuedFrame)) {
+		pendingFrameNo--;
+		stream.framesRejected++;
+		return false;
+	}
+	stream.framesPushed++;
+	const size_t queueDepth = stream.queue.Size();
+	if (queueDepth > stream.maxQueueDepth) {
+		stream.maxQueueDepth = queueDepth;
+	}
+	{
+		std::lock_guard<std::mutex> lock(idleMutex);
+		workEpoch++;
+	}
+	workCondition.notify_one();
+	return true;
+}
+
+// Block until every queued frame has been processed
+void MultiStreamEngine::WaitIdle() {
+	std::unique_lock<std::mutex> lock(idleMutex);
+	idleCondition.wait(lock, [this] { return pendingFrameNo == 0; });
+}
+
+// Total number of registered streams
+size_t MultiStreamEngine::GetStreamNo() const {
+	return streams.size();
+}
+
+// Statistics of one stream
+MultiStreamEngine::StreamStats MultiStreamEngine::GetStreamStats(size_t streamId) const {
+	const Stream &stream = *streams.at(streamId);
+	StreamStats stats;
+	stats.name = stream.name;
+	stats.framesPushed = stream.framesPushed;
+	stats.framesProcessed = stream.framesProcessed;
+	stats.framesRejected = stream.framesRejected;
+	stats.framesDropped = stream.framesDropped;
+	stats.queueDepth = stream.queue.Size();
+	stats.maxQueueDepth = stream.maxQueueDepth;
+	const double processedNo = double(std::max<size_t>(1, stats.framesProcessed));
+	stats.avgLatencyMs = (stream.totalLatencyUs / processedNo) / 1000.0;
+	stats.maxLatencyMs = stream.maxLatencyUs / 1000.0;
+	stats.avgProcessMs = (stream.totalProcessUs / processedNo) / 1000.0;
+	const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	stats.throughputFPS = (elapsedSeconds > 0.0) ? (stats.framesProcessed / elapsedSeconds) : 0.0;
+	return stats;
+}
+
+// Print statistics of every stream
+void MultiStreamEngine::PrintStats(std::ostream &output) const {
+	output << "\n<<<<<-STREAM STATISTICS->>>>>\n";
+	output << std::left << std::setw(16) << "STREAM" << std::right
+		<< std::setw(10) << "PUSHED" << std::setw(10) << "DONE" << std::setw(10) << "REJECTED" << std::setw(10) << "DROPPED"
+		<< std::setw(8) << "DEPTH" << std::setw(8) << "MAXDEP" << std::setw(12) << "LAT(ms)" << std::setw(12) << "MAXLAT(ms)"
+		<< std::setw(12) << "PROC(ms)" << std::setw(10) << "FPS" << std::endl;
+	for (size_t streamId = 0; streamId < streams.size(); streamId++) {
+		const StreamStats stats = GetStreamStats(streamId);
+		output << std::left << std::setw(16) << stats.name << std::right
+			<< std::setw(10) << stats.framesPushed << std::setw(10) << stats.framesProcessed
+			<< std::setw(10) << stats.framesRejected << std::setw(10) << stats.framesDropped
+			<< std::setw(8) << stats.queueDepth << std::setw(8) << stats.maxQueueDepth
+			<< std::setprecision(2) << std::fixed
+			<< std::setw(12) << stats.avgLatencyMs << std::setw(12) << stats.maxLatencyMs
+			<< std::setw(12) << stats.avgProcessMs << std::setw(10) << stats.throughputFPS << std::endl;
+	}
+}
+
+// Worker thread main loop
+void MultiStreamEngine::WorkerLoop(size_t workerIndex) {
+	SetCurrentThreadAffinity(workerCPUs[workerIndex % workerCPUs.size()]);
+	while (true) {
+		size_t seenEpoch;
+		{
+			std::lock_guard<std::mutex> lock(idleMutex);
+			seenEpoch = workEpoch;
+		}
+		const int streamIndex = ClaimNextStream();
+		if (streamIndex < 0) {
+			std::unique_lock<std::mutex> lock(idleMutex);
+			if (!running && (pendingFrameNo == 0)) {
+				break;
+			}
+			// Frames left in a stream another worker holds are served by that worker
+			workCondition.wait(lock, [&] { return (workEpoch != seenEpoch) || (!running && (pendingFrameNo == 0)); });
+			continue;
+		}
+		Stream &stream = *streams[streamIndex];
+		ServeStream(stream);
+		stream.busy.store(false, std::memory_order_release);
+	}
+}
+
+// Claim the stream whose oldest queued frame has waited longest
+int MultiStreamEngine::ClaimNextStream() {
+	int bestIndex = -1;
+	Clock::time_point bestPushTime;
+	for (size_t streamIndex = 0; streamIndex < streams.size(); streamIndex++) {
+		Stream &stream = *streams[streamIndex];
+		if (stream.busy.load(std::memory_order_relaxed) || stream.queue.Empty()) {
+			continue;
+		}
+		bool expected = false;
+		if (!stream.busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			continue;
+		}
+		// The queue head can only be read safely while holding the stream
+		const QueuedFrame * front = stream.queue.Front();
+		if ((front != nullptr) && ((bestIndex < 0) || (front->pushTime < bestPushTime))) {
+			if (bestIndex >= 0) {
+				streams[bestIndex]->busy.store(false, std::memory_order_release);
+			}
+			bestIndex = int(streamIndex);
+			bestPushTime = front->pushTime;
+		}
+		else {
+			stream.busy.store(false, std::memory_order_release);
+		}
+	}
+	return bestIndex;
+}
+
+// Process one queued frame of a claimed stream
+void MultiStreamEngine::ServeStream(Stream &stream) {
+	QueuedFrame queuedFrame;
+	if (!stream.queue.Pop(queuedFrame)) {
+		return;
+	}
+	// Skip stale frames while newer ones are waiting, so latency stays bounded
+	while ((maxQueueLatencyMs > 0.0) && !stream.queue.Empty() &&
+		(std::chrono::duration<double, std::milli>(Clock::now() - queuedFrame.pushTime).count() > maxQueueLatencyMs)) {
+		stream.queue.Pop(queuedFrame);
+		stream.framesDropped++;
+		pendingFrameNo--;
+	}
+	const Clock::time_point processStart = Clock::now();
+	if (!stream.initialized) {
+		stream.subtractor->Initialize(queuedFrame.frame, stream.ROI);
+		stream.initialized = true;
+	}
+	stream.subtractor->Process(queuedFrame.frame, stream.fgMask);
+	const Clock::time_point processEnd = Clock::now();
+	stream.framesProcessed++;
+	if (stream.callback) {
+		stream.callback(stream.id, queuedFrame.frameIndex, stream.fgMask);
+	}
+
+	const long long latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(processEnd - queuedFrame.pushTime).count();
+	const long long processUs = std::chrono::duration_cast<std::chrono::microseconds>(processEnd - processStart).count();
+	stream.totalLatencyUs += latencyUs;
+	stream.totalProcessUs += processUs;
+	if (latencyUs > stream.maxLatencyUs) {
+		stream.maxLatencyUs = latencyUs;
+	}
+	if (--pendingFrameNo == 0) {
+		std::lock_guard<std::mutex> lock(idleMutex);
+		idleCondition.notify_all();
+		// Workers waiting to shut down
+		workCondition.notify_all();
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#ifndef __MultiStreamEngine_H_INCLUDED
+#define __MultiStreamEngine_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include "BackgroundSubtractorLCDP.h"
+#include "LockFreeQueue.h"
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <ostream>
+
+// Runs many background subtractor instances (one per camera stream) on one shared
+// pool of worker threads. Each stream has its own lock-free ingestion queue; the
+// scheduler always serves the stream whose oldest queued frame has waited longest,
+// and a stream is only ever processed by one worker at a time so its frames keep
+// their order.
+class MultiStreamEngine {
+public:
+	// Called on a worker thread for every processed frame
+	typedef std::function<void(size_t streamId, size_t frameIndex, const cv::Mat &fgMask)> ResultCallback;
+
+	// Per-stream statistics snapshot
+	struct StreamStats {
+		// Stream name
+		std::string name;
+		// Total number of frames accepted into the queue
+		size_t framesPushed;
+		// Total number of frames processed
+		size_t framesProcessed;
+		// Frames rejected because the queue was full
+		size_t framesRejected;
+		// Frames skipped because they waited longer than the latency bound
+		size_t framesDropped;
+		// Current number of queued frames
+		size_t queueDepth;
+		// Maximum queue depth observed
+		size_t maxQueueDepth;
+		// Average time from push to result (ms)
+		double avgLatencyMs;
+		// Maximum time from push to result (ms)
+		double maxLatencyMs;
+		// Average time spent in Process (ms)
+		double avgProcessMs;
+		// Processed frames per second since the engine started
+		double throughputFPS;
+	};
+
+	/*******CONSTRUCTOR*******/
+	// workerNo: 0 uses every hardware thread; workerCPUs: logical CPU per worker (empty: worker i on CPU i)
+	// maxQueueLatencyMs: frames older than this are skipped (0: never skip)
+	MultiStreamEngine(size_t inputWorkerNo, std::vector<int> inputWorkerCPUs, double inputMaxQueueLatencyMs);
+
+	/*******DESTRUCTOR*******/
+	~MultiStreamEngine();
+
+	// Register a stream; the engine takes ownership of the subtractor, which is initialized
+	// with the first frame pushed (RETURN: stream id). Must be called before Start.
+	size_t AddStream(std::string name, BackgroundSubtractorLCDP *subtractor, cv::Mat ROI,
+		size_t queueCapacity, ResultCallback callback);
+	// Start the worker pool
+	void Start();
+	// Stop accepting frames, finish queued frames and join the workers
+	void Stop();
+	// Queue a frame for a stream; the engine keeps a reference so the caller must not reuse
+	// the buffer. Only one thread may push to a given stream. (RETURN-true: queued, false:
+	// queue full and frame rejected; a rejected frame does not use up a frame index)
+	bool PushFrame(size_t streamId, const cv::Mat &inputFrame);
+	// Block until every queued frame has been processed
+	void WaitIdle();
+
+	// Total number of registered streams
+	size_t GetStreamNo() const;
+	// Statistics of one stream
+	StreamStats GetStreamStats(size_t streamId) const;
+	// Print statistics of every stream
+	void PrintStats(std::ostream &output) const;
+
+protected:
+	typedef std::chrono::steady_clock Clock;
+
+	// Queued frame with its arrival time
+	struct QueuedFrame {
+		cv::Mat frame;
+		// 1-based index of the frame among the stream's accepted frames
+		size_t frameIndex;
+		Clock::time_point pushTime;
+	};
+
+	// Stream state
+	struct Stream {
+		explicit Stream(size_t queueCapacity) : queue(queueCapacity) {}
+		// Stream id
+		size_t id;
+		// Stream name
+		std::string name;
+		// Background subtractor of this stream
+		std::unique_ptr<BackgroundSubtractorLCDP> subtractor;
+		// Region of interest used at initialization
+		cv::Mat ROI;
+		// Result callback
+		ResultCallback callback;
+		// Ingestion queue (producer: caller, consumer: the worker holding the stream)
+		LockFreeQueue<QueuedFrame> queue;
+		// Set while a worker is processing this stream
+		std::atomic<bool> busy;
+		// Subtractor has been initialized with the first frame
+		bool initialized;
+		// Output mask buffer
+		cv::Mat fgMask;
+		// Counters
+		std::atomic<size_t> framesPushed;
+		std::atomic<size_t> framesProcessed;
+		std::atomic<size_t> framesRejected;
+		std::atomic<size_t> framesDropped;
+		std::atomic<size_t> maxQueueDepth;
+		// Accumulated latencies in microseconds
+		std::atomic<long long> totalLatencyUs;
+		std::atomic<long long> maxLatencyUs;
+		std::atomic<long long> totalProcessUs;
+	};
+
+	// Worker thread main loop
+	void WorkerLoop(size_t workerIndex);
+	// Claim the stream whose oldest queued frame has waited longest (RETURN: stream index or -1)
+	int ClaimNextStream();
+	// Process one queued frame of a claimed stream
+	void ServeStream(Stream &stream);
+
+	/*=====WORKER Parameters=====*/
+	// Total number of worker threads
+	const size_t workerNo;
+	// Logical CPU per worker
+	std::vector<int> workerCPUs;
+	// Worker threads
+	std::vector<std::thread> workers;
+	// Frames older than this are skipped (0: never)
+	const double maxQueueLatencyMs;
+
+	/*=====STREAM Parameters=====*/
+	std::vector<std::unique_ptr<Stream>> streams;
+	// Total number of queued frames over all streams
+	std::atomic<size_t> pendingFrameNo;
+	// Engine running flag
+	std::atomic<bool> running;
+	// Engine start time
+	Clock::time_point startTime;
+
+	/*=====IDLE WAIT=====*/
+	std::mutex idleMutex;
+	// Bumped under idleMutex by every push and by Stop, so a worker that found nothing to
+	// claim cannot miss a frame queued before it went to sleep
+	size_t workEpoch;
+	std::condition_variable workCondition;
+	std::condition_variable idleCondition;
+};
+#endif
@@ -0,0 +1,272 @@
+#include "OfflineEvaluator.h"
+#include "Functions.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+
+// Total number of frames per evaluation task
+#define EVALUATION_CHUNK_FRAMES 32
+
+/*******CONSTRUCTOR*******/
+OfflineEvaluator::OfflineEvaluator(size_t inputThreadNo) :
+	threadNo((inputThreadNo > 0) ? inputThreadNo : size_t(GetHardwareThreadNo())),
+	nextTask(0)
+{
+}
+
+// Add a sequence
+void OfflineEvaluator::AddSequence(const std::string &name, const std::string &datasetFolder, const std::string &resultFolder) {
+	SequenceResult result;
+	result.name = name;
+	if (result.name.empty()) {
+		std::string folder = datasetFolder;
+		while (!folder.empty() && ((folder.back() == '/') || (folder.back() == '\\'))) {
+			folder.pop_back();
+		}
+		const size_t separator = folder.find_last_of("/\\");
+		result.name = (separator == std::string::npos) ? folder : folder.substr(separator + 1);
+	}
+	result.datasetFolder = datasetFolder;
+	result.resultFolder = resultFolder;
+	result.idxFrom = 1;
+	result.idxTo = 0;
+	result.ROIFound = false;
+	result.evaluatedNo = 0;
+	results.push_back(result);
+	resultStreams.push_back(std::shared_ptr<MaskStreamReader>());
+}
+
+// Evaluate every added sequence
+void OfflineEvaluator::Run() {
+	tasks.clear();
+	for (size_t sequenceIndex = 0; sequenceIndex < results.size(); sequenceIndex++) {
+		SequenceResult &result = results[sequenceIndex];
+		result.counts = ConfusionCounts();
+		result.evaluatedNo = 0;
+		result.missingGroundtruth.clear();
+		result.missingResult.clear();
+		std::ifstream infile(result.datasetFolder + "/temporalROI.txt");
+		result.ROIFound = bool(infile >> result.idxFrom >> result.idxTo);
+		if (!result.ROIFound) {
+			std::cout << "Cannot read temporalROI.txt of sequence: " << result.name << std::endl;
+			result.idxFrom = 1;
+			result.idxTo = 0;
+			continue;
+		}
+		// Results saved as a mask stream are read from the stream, otherwise from image files.
+		// When a folder holds both, the newer of the stream and the first result image wins.
+		const std::string streamFileName = result.resultFolder + "/results/results.lcdms";
+		char s[25];
+		snprintf(s, sizeof(s), "/results/bin%06d.png", result.idxFrom);
+		std::string imageFileName = result.resultFolder + s;
+		time_t streamTime = 0, imageTime = 0;
+		bool imageFound = GetFileModifiedTime(imageFileName, imageTime);
+		if (!imageFound) {
+			snprintf(s, sizeof(s), "/results/bin%06d.pgm", result.idxFrom);
+			imageFileName = result.resultFolder + s;
+			imageFound = GetFileModifiedTime(imageFileName, imageTime);
+		}
+		bool useStream = GetFileModifiedTime(streamFileName, streamTime);
+		if (useStream && imageFound) {
+			useStream = streamTime >= imageTime;
+			std::cout << "Both a mask stream and result images in " << result.resultFolder << "/results: using the newer "
+				<< (useStream ? streamFileName : ("images (" + imageFileName + ")")) << std::endl;
+		}
+		std::shared_ptr<MaskStreamReader> resultStream(new MaskStreamReader());
+		if (useStream && resultStream->Open(streamFileName)) {
+			resultStreams[sequenceIndex] = resultStream;
+		}
+		else {
+			resultStreams[sequenceIndex].reset();
+		}
+		for (int frameFrom = result.idxFrom; frameFrom <= result.idxTo; frameFrom += EVALUATION_CHUNK_FRAMES) {
+			EvaluationTask task;
+			task.sequenceIndex = sequenceIndex;
+			task.frameFrom = frameFrom;
+			task.frameTo = std::min(result.idxTo, frameFrom + EVALUATION_CHUNK_FRAMES - 1);
+			task.evaluatedNo = 0;
+			tasks.push_back(task);
+		}
+	}
+
+	nextTask = 0;
+	std::vector<std::thread> workers;
+	const size_t workerNo = std::max<size_t>(1, std::min(threadNo, tasks.size()));
+	for (size_t workerIndex = 0; workerIndex < workerNo; workerIndex++) {
+		workers.push_back(std::thread(&OfflineEvaluator::WorkerLoop, this));
+	}
+	for (auto & worker : workers) {
+		worker.join();
+	}
+
+	// Tasks are in frame order, so the merged missing lists stay sorted
+	for (auto & task : tasks) {
+		SequenceResult &result = results[task.sequenceIndex];
+		result.counts += task.counts;
+		result.evaluatedNo += task.evaluatedNo;
+		result.missingGroundtruth.insert(result.missingGroundtruth.end(), task.missingGroundtruth.begin(), task.missingGroundtruth.end());
+		result.missingResult.insert(result.missingResult.end(), task.missingResult.begin(), task.missingResult.end());
+	}
+	tasks.clear();
+	for (auto & resultStream : resultStreams) {
+		resultStream.reset();
+	}
+}
+
+// Worker thread main loop
+void OfflineEvaluator::WorkerLoop() {
+	while (true) {
+		const size_t taskIndex = nextTask++;
+		if (taskIndex >= tasks.size()) {
+			break;
+		}
+		EvaluateTask(tasks[taskIndex]);
+	}
+}
+
+// Evaluate one task
+void OfflineEvaluator::EvaluateTask(EvaluationTask &task) {
+	const SequenceResult &result = results[task.sequenceIndex];
+	char s[25];
+	for (int frameIndex = task.frameFrom; frameIndex <= task.frameTo; frameIndex++) {
+		snprintf(s, sizeof(s), "/gt%06d.png", frameIndex);
+		const cv::Mat gtImg = cv::imread(result.datasetFolder + "/groundtruth" + s, cv::IMREAD_GRAYSCALE);
+		if (gtImg.empty()) {
+			task.missingGroundtruth.push_back(frameIndex);
+			continue;
+		}
+		cv::Mat resultImg;
+		if (!ReadResult(task.sequenceIndex, frameIndex, resultImg) || (resultImg.size() != gtImg.size())) {
+			task.missingResult.push_back(frameIndex);
+			continue;
+		}
+		CountConfusion(gtImg, resultImg, task.counts);
+		task.evaluatedNo++;
+	}
+}
+
+// Read one result frame
+bool OfflineEvaluator::ReadResult(size_t sequenceIndex, int frameIndex, cv::Mat &resultImg) const {
+	if (resultStreams[sequenceIndex]) {
+		return resultStreams[sequenceIndex]->Read(frameIndex, resultImg);
+	}
+	char s[25];
+	snprintf(s, sizeof(s), "/results/bin%06d.png", frameIndex);
+	resultImg = cv::imread(results[sequenceIndex].resultFolder + s, cv::IMREAD_GRAYSCALE);
+	if (resultImg.empty()) {
+		snprintf(s, sizeof(s), "/results/bin%06d.pgm", frameIndex);
+		resultImg = cv::imread(results[sequenceIndex].resultFolder + s, cv::IMREAD_GRAYSCALE);
+	}
+	return !resultImg.empty();
+}
+
+// Results in the order the sequences were added
+const std::vector<OfflineEvaluator::SequenceResult> & OfflineEvaluator::GetResults() const {
+	return results;
+}
+
+// Every frame of every sequence was counted
+bool OfflineEvaluator::IsComplete() const {
+	for (auto & result : results) {
+		if (!result.ROIFound || !result.missingGroundtruth.empty() || !result.missingResult.empty()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Write one row of the metrics table (metrics nullptr: nothing evaluated, values are n/a)
+static void WriteTableRow(std::ostream &output, bool csvSwitch, const std::string &name, size_t frameNo,
+	size_t missingNo, const EvaluationMetrics *metrics) {
+	const double values[7] = { metrics ? metrics->recall : 0.0, metrics ? metrics->specificity : 0.0,
+		metrics ? metrics->FPR : 0.0, metrics ? metrics->FNR : 0.0, metrics ? metrics->PBC : 0.0,
+		metrics ? metrics->precision : 0.0, metrics ? metrics->FMeasure : 0.0 };
+	if (csvSwitch) {
+		output << name << "," << frameNo << "," << missingNo;
+		for (int valueIndex = 0; valueIndex < 7; valueIndex++) {
+			output << ",";
+			if (metrics) {
+				output << std::setprecision(5) << std::fixed << values[valueIndex];
+			}
+		}
+	}
+	else {
+		output << std::left << std::setw(20) << name << std::right << std::setw(8) << frameNo << std::setw(9) << missingNo;
+		for (int valueIndex = 0; valueIndex < 7; valueIndex++) {
+			output << std::setw(12);
+			if (metrics) {
+				output << std::setprecision(3) << std::fixed << values[valueIndex];
+			}
+			else {
+				output << "n/a";
+			}
+		}
+	}
+	output << std::endl;
+}
+
+// Write the consolidated metrics table
+void OfflineEvaluator::WriteTable(std::ostream &output, bool csvSwitch) const {
+	const char * columnNames[10] = { "SEQUENCE", "FRAMES", "MISSING", "RECALL", "SPECIFICITY", "FPR", "FNR",
+		"PBC", "PRECISION", "F-MEASURE" };
+	const int columnWidths[10] = { 20, 8, 9, 12, 12, 12, 12, 12, 12, 12 };
+	for (int columnIndex = 0; columnIndex < 10; columnIndex++) {
+		if (csvSwitch) {
+			output << ((columnIndex > 0) ? "," : "") << columnNames[columnIndex];
+		}
+		else {
+			output << ((columnIndex == 0) ? std::left : std::right) << std::setw(columnWidths[columnIndex]) << columnNames[columnIndex];
+		}
+	}
+	output << std::endl;
+
+	// OVERALL: metrics of the summed confusion matrix; AVERAGE: mean of the per-sequence metrics (CDnet style)
+	ConfusionCounts totalCounts;
+	size_t totalFrameNo = 0, totalMissingNo = 0, averageNo = 0;
+	double averageValues[7] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for (auto & result : results) {
+		const size_t missingNo = result.missingGroundtruth.size() + result.missingResult.size();
+		const EvaluationMetrics metrics(result.counts);
+		WriteTableRow(output, csvSwitch, result.name, result.evaluatedNo, missingNo, (result.evaluatedNo > 0) ? &metrics : nullptr);
+		totalCounts += result.counts;
+		totalFrameNo += result.evaluatedNo;
+		totalMissingNo += missingNo;
+		if (result.evaluatedNo > 0) {
+			averageValues[0] += metrics.recall;
+			averageValues[1] += metrics.specificity;
+			averageValues[2] += metrics.FPR;
+			averageValues[3] += metrics.FNR;
+			averageValues[4] += metrics.PBC;
+			averageValues[5] += metrics.precision;
+			averageValues[6] += metrics.FMeasure;
+			averageNo++;
+		}
+	}
+	if (results.size() > 1) {
+		const EvaluationMetrics overallMetrics(totalCounts);
+		WriteTableRow(output, csvSwitch, "OVERALL", totalFrameNo, totalMissingNo, (totalFrameNo > 0) ? &overallMetrics : nullptr);
+		// Nothing to average without an evaluated sequence
+		EvaluationMetrics averageMetrics(totalCounts);
+		const double divisor = double(std::max(averageNo, size_t(1)));
+		averageMetrics.recall = averageValues[0] / divisor;
+		averageMetrics.specificity = averageValues[1] / divisor;
+		averageMetrics.FPR = averageValues[2] / divisor;
+		averageMetrics.FNR = averageValues[3] / divisor;
+		averageMetrics.PBC = averageValues[4] / divisor;
+		averageMetrics.precision = averageValues[5] / divisor;
+		averageMetrics.FMeasure = averageValues[6] / divisor;
+		WriteTableRow(output, csvSwitch, "AVERAGE", totalFrameNo, totalMissingNo, (averageNo > 0) ? &averageMetrics : nullptr);
+	}
+}
+
+// Save the consolidated metrics table as CSV
+bool OfflineEvaluator::SaveTable(const std::string &fileName) const {
+	std::ofstream tableFile(fileName);
+	if (!tableFile.is_open()) {
+		return false;
+	}
+	WriteTable(tableFile, true);
+	return tableFile.good();
+}
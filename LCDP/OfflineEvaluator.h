@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef __OfflineEvaluator_H_INCLUDED
+#define __OfflineEvaluator_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include "Evaluation.h"
+#include "MaskStream.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <ostream>
+
+// Scores saved results of many sequences at once. Every sequence is split into chunks of
+// frames and a pool of worker threads decodes groundtruth and result frames and counts the
+// confusion matrix (CountConfusion), so decoding runs in parallel within a sequence and
+// across sequences. Missing frames are recorded instead of stopping the evaluation.
+class OfflineEvaluator {
+public:
+	// Evaluation of one sequence
+	struct SequenceResult {
+		// Sequence name
+		std::string name;
+		// Dataset folder (holds 'groundtruth' and 'temporalROI.txt')
+		std::string datasetFolder;
+		// Result folder (holds 'results')
+		std::string resultFolder;
+		// Evaluated frame range (from temporalROI.txt)
+		int idxFrom;
+		int idxTo;
+		// temporalROI.txt was found
+		bool ROIFound;
+		// Total number of frames counted
+		size_t evaluatedNo;
+		// Frames whose groundtruth or result could not be read
+		std::vector<int> missingGroundtruth;
+		std::vector<int> missingResult;
+		// Confusion matrix of the counted frames
+		ConfusionCounts counts;
+	};
+
+	/*******CONSTRUCTOR*******/
+	// threadNo: total number of worker threads (0: one per hardware thread)
+	explicit OfflineEvaluator(size_t inputThreadNo);
+
+	// Add a sequence (name: empty uses the dataset folder name)
+	void AddSequence(const std::string &name, const std::string &datasetFolder, const std::string &resultFolder);
+	// Evaluate every added sequence
+	void Run();
+	// Results in the order the sequences were added
+	const std::vector<SequenceResult> & GetResults() const;
+	// Every frame of every sequence was counted
+	bool IsComplete() const;
+	// Write the consolidated metrics table (csvSwitch: comma separated, otherwise aligned columns)
+	void WriteTable(std::ostream &output, bool csvSwitch) const;
+	// Save the consolidated metrics table as CSV (RETURN-true: success)
+	bool SaveTable(const std::string &fileName) const;
+
+private:
+	// Frames of one sequence handled by one worker
+	struct EvaluationTask {
+		size_t sequenceIndex;
+		int frameFrom;
+		int frameTo;
+		ConfusionCounts counts;
+		size_t evaluatedNo;
+		std::vector<int> missingGroundtruth;
+		std::vector<int> missingResult;
+	};
+
+	// Worker thread main loop
+	void WorkerLoop();
+	// Evaluate one task
+	void EvaluateTask(EvaluationTask &task);
+	// Read one result frame (RETURN-true: success)
+	bool ReadResult(size_t sequenceIndex, int frameIndex, cv::Mat &resultImg) const;
+
+	// Total number of worker threads
+	const size_t threadNo;
+	// Sequences
+	std::vector<SequenceResult> results;
+	// Mask stream of every sequence (null: results saved as image files)
+	std::vector<std::shared_ptr<MaskStreamReader> > resultStreams;
+	// Tasks of the current run
+	std::vector<EvaluationTask> tasks;
+	// Next task to hand out
+	std::atomic<size_t> nextTask;
+};
+#endif
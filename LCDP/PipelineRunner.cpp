@@ -0,0 +1,238 @@
+#include "PipelineRunner.h"
+#include "Functions.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+/*******CONSTRUCTOR*******/
+PipelineRunner::PipelineRunner(size_t inputQueueCapacity, bool inputShowInput, bool inputShowOutput) :
+	/*=====PIPELINE Parameters=====*/
+	queueCapacity(inputQueueCapacity),
+	showInput(inputShowInput),
+	showOutput(inputShowOutput),
+
+	/*=====QUEUES=====*/
+	decodeQueue(inputQueueCapacity),
+	resultQueue(inputQueueCapacity),
+	displayQueue(2),
+
+	/*=====STATE=====*/
+	stopRequested(false),
+	readFailed(false),
+	latencyController(nullptr),
+	checkpointWriter(nullptr),
+	checkpointInterval(0),
+	numaNode(-1),
+	wallSeconds(0.0)
+{
+	const char * stageNames[4] = { "DECODE", "SUBTRACT", "OUTPUT", "DISPLAY" };
+	for (int stageIndex = 0; stageIndex < 4; stageIndex++) {
+		stageStats[stageIndex].name = stageNames[stageIndex];
+		stageStats[stageIndex].itemNo = 0;
+		stageStats[stageIndex].busySeconds = 0.0;
+		stageStats[stageIndex].waitInputSeconds = 0.0;
+		stageStats[stageIndex].waitOutputSeconds = 0.0;
+		stageStats[stageIndex].inputQueueFill = 0.0;
+	}
+}
+
+// Run the sequence
+bool PipelineRunner::Run(cv::VideoCapture &videoCapture, cv::Mat firstFrame, int frameCount,
+	BackgroundSubtractorLCDP &subtractor, OutputCallback outputCallback) {
+	const Clock::time_point runStart = Clock::now();
+	std::thread decodeThread(&PipelineRunner::DecodeStage, this, std::ref(videoCapture), firstFrame, frameCount);
+	std::thread subtractThread(&PipelineRunner::SubtractStage, this, std::ref(subtractor));
+	std::thread outputThread(&PipelineRunner::OutputStage, this, outputCallback);
+
+	if (showInput || showOutput) {
+		// HighGUI has to be driven from the calling thread
+		PipelineItem item;
+		while (true) {
+			Clock::time_point waitStart = Clock::now();
+			if (!displayQueue.Pop(item)) {
+				break;
+			}
+			stageStats[3].waitInputSeconds += SecondsSince(waitStart);
+			Clock::time_point busyStart = Clock::now();
+			if (showInput) {
+				cv::imshow("Input Video", item.inputFrame);
+			}
+			if (showOutput) {
+				cv::imshow("Results", item.fgMask);
+			}
+			// If 'esc' key is pressed, stop decoding new frames
+			if (cv::waitKey(1) == 27) {
+				std::cout << "Program ended by users." << std::endl;
+				stopRequested = true;
+			}
+			stageStats[3].busySeconds += SecondsSince(busyStart);
+			stageStats[3].itemNo++;
+		}
+	}
+	decodeThread.join();
+	subtractThread.join();
+	outputThread.join();
+	wallSeconds = SecondsSince(runStart);
+
+	stageStats[1].inputQueueFill = decodeQueue.AverageDepth() / decodeQueue.Capacity();
+	stageStats[2].inputQueueFill = resultQueue.AverageDepth() / resultQueue.Capacity();
+	stageStats[3].inputQueueFill = displayQueue.AverageDepth() / displayQueue.Capacity();
+	return !stopRequested && !readFailed;
+}
+
+// Decode stage: read frames from the video
+void PipelineRunner::DecodeStage(cv::VideoCapture &videoCapture, cv::Mat firstFrame, int frameCount) {
+	StageStats &stats = stageStats[0];
+	SetCurrentThreadNode(numaNode);
+	cv::Mat inputFrame = firstFrame;
+	for (int currFrameIndex = 1; currFrameIndex <= frameCount && !stopRequested; currFrameIndex++) {
+		if (currFrameIndex > 1) {
+			Clock::time_point busyStart = Clock::now();
+			// A fresh buffer per frame, because Process and the later stages keep using it
+			inputFrame = cv::Mat();
+			bool inputCheck = videoCapture.read(inputFrame);
+			stats.busySeconds += SecondsSince(busyStart);
+			if (!inputCheck) {
+				std::cout << "Video having problem. Cannot read the frame from video file." << std::endl;
+				readFailed = true;
+				break;
+			}
+		}
+		PipelineItem item;
+		item.frameIndex = currFrameIndex;
+		item.inputFrame = inputFrame;
+		Clock::time_point waitStart = Clock::now();
+		if (!decodeQueue.Push(item)) {
+			break;
+		}
+		stats.waitOutputSeconds += SecondsSince(waitStart);
+		stats.itemNo++;
+	}
+	decodeQueue.Close();
+}
+
+// Subtract stage: run the background subtractor
+void PipelineRunner::SubtractStage(BackgroundSubtractorLCDP &subtractor) {
+	StageStats &stats = stageStats[1];
+	// Process touches the model from here, so it has to run on the node it was first touched on
+	SetCurrentThreadNode(numaNode);
+	PipelineItem item;
+	while (true) {
+		Clock::time_point waitStart = Clock::now();
+		if (!decodeQueue.Pop(item)) {
+			break;
+		}
+		stats.waitInputSeconds += SecondsSince(waitStart);
+		Clock::time_point busyStart = Clock::now();
+		// Process current frame
+		item.fgMask = cv::Mat();
+		if (latencyController) {
+			subtractor.SetQualityLimits(latencyController->GetLimits());
+		}
+		subtractor.Process(item.inputFrame, item.fgMask);
+		const double processSeconds = SecondsSince(busyStart);
+		if (latencyController) {
+			latencyController->Update(item.frameIndex, 1000.0 * processSeconds);
+		}
+		stats.busySeconds += processSeconds;
+		if (checkpointWriter && (item.frameIndex % checkpointInterval == 0)) {
+			// Only the copy happens here; the write runs on the checkpoint writer's thread
+			Clock::time_point checkpointStart = Clock::now();
+			checkpointWriter->Submit(subtractor);
+			stats.busySeconds += SecondsSince(checkpointStart);
+		}
+		stats.itemNo++;
+		if (showInput || showOutput) {
+			displayQueue.TryPush(item);
+		}
+		waitStart = Clock::now();
+		resultQueue.Push(item);
+		stats.waitOutputSeconds += SecondsSince(waitStart);
+	}
+	resultQueue.Close();
+	displayQueue.Close();
+}
+
+// Output stage: hand results to the caller
+void PipelineRunner::OutputStage(OutputCallback outputCallback) {
+	StageStats &stats = stageStats[2];
+	SetCurrentThreadNode(numaNode);
+	PipelineItem item;
+	while (true) {
+		Clock::time_point waitStart = Clock::now();
+		if (!resultQueue.Pop(item)) {
+			break;
+		}
+		stats.waitInputSeconds += SecondsSince(waitStart);
+		Clock::time_point busyStart = Clock::now();
+		if (outputCallback) {
+			outputCallback(item.frameIndex, item.inputFrame, item.fgMask);
+		}
+		stats.busySeconds += SecondsSince(busyStart);
+		stats.itemNo++;
+	}
+}
+
+// Seconds elapsed since a time point
+double PipelineRunner::SecondsSince(Clock::time_point startTime) {
+	return std::chrono::duration<double>(Clock::now() - startTime).count();
+}
+
+// Adapt the subtractor's quality limits to a frame-time budget
+void PipelineRunner::SetLatencyController(LatencyBudgetController *controller) {
+	latencyController = controller;
+}
+
+// Checkpoint the model every 'interval' frames from the subtract stage
+void PipelineRunner::SetCheckpointWriter(CheckpointWriter *writer, size_t interval) {
+	checkpointWriter = (interval > 0) ? writer : nullptr;
+	checkpointInterval = interval;
+}
+
+// Run the stage threads on the CPUs of one NUMA node
+void PipelineRunner::SetNumaNode(int nodeIndex) {
+	numaNode = nodeIndex;
+}
+
+// Decoding stopped before the last frame because the video could not be read
+bool PipelineRunner::IsReadFailed() const {
+	return readFailed;
+}
+
+// Total time spent inside Process (s)
+double PipelineRunner::GetProcessSeconds() const {
+	return stageStats[1].busySeconds;
+}
+
+// Statistics of decode / subtract / output / display stages
+std::vector<PipelineRunner::StageStats> PipelineRunner::GetStageStats() const {
+	return std::vector<StageStats>(stageStats, stageStats + 4);
+}
+
+// Print per-stage occupancy
+void PipelineRunner::PrintStats(std::ostream &output) const {
+	const int stageNo = (showInput || showOutput) ? 4 : 3;
+	int bottleneckIndex = 0;
+	for (int stageIndex = 1; stageIndex < stageNo; stageIndex++) {
+		if (stageStats[stageIndex].busySeconds > stageStats[bottleneckIndex].busySeconds) {
+			bottleneckIndex = stageIndex;
+		}
+	}
+	output << "\n<<<<<-PIPELINE STAGE OCCUPANCY->>>>>\n";
+	output << std::left << std::setw(10) << "STAGE" << std::right << std::setw(8) << "ITEMS"
+		<< std::setw(10) << "BUSY(%)" << std::setw(12) << "WAIT-IN(%)" << std::setw(13) << "WAIT-OUT(%)"
+		<< std::setw(12) << "QUEUE(%)" << std::setw(12) << "MS/ITEM" << std::endl;
+	for (int stageIndex = 0; stageIndex < stageNo; stageIndex++) {
+		const StageStats &stats = stageStats[stageIndex];
+		const double wall = (wallSeconds > 0.0) ? wallSeconds : 1.0;
+		output << std::left << std::setw(10) << stats.name << std::right << std::setw(8) << stats.itemNo
+			<< std::setprecision(1) << std::fixed
+			<< std::setw(10) << (100.0 * stats.busySeconds / wall)
+			<< std::setw(12) << (100.0 * stats.waitInputSeconds / wall)
+			<< std::setw(13) << (100.0 * stats.waitOutputSeconds / wall)
+			<< std::setw(12) << (100.0 * stats.inputQueueFill)
+			<< std::setprecision(3)
+			<< std::setw(12) << ((stats.itemNo > 0) ? (1000.0 * stats.busySeconds / stats.itemNo) : 0.0)
+			<< ((stageIndex == bottleneckIndex) ? "  <- bottleneck" : "") << std::endl;
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef __PipelineRunner_H_INCLUDED
+#define __PipelineRunner_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include "BackgroundSubtractorLCDP.h"
+#include "BoundedQueue.h"
+#include "LatencyBudgetController.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <ostream>
+
+// Runs one sequence through a decode -> subtract -> output pipeline. Each stage has its
+// own thread and the stages are connected by bounded queues, so decoding and writing
+// overlap with Process instead of adding to its frame time. Display (if enabled) is
+// served from the calling thread and never blocks the subtract stage: frames are
+// skipped when the display falls behind.
+class PipelineRunner {
+public:
+	// Called on the output thread for every processed frame (frameIndex starts from 1)
+	typedef std::function<void(int frameIndex, const cv::Mat &inputFrame, const cv::Mat &fgMask)> OutputCallback;
+
+	// Per-stage statistics
+	struct StageStats {
+		// Stage name
+		std::string name;
+		// Total number of items handled
+		size_t itemNo;
+		// Time spent working (s)
+		double busySeconds;
+		// Time spent waiting for input (s)
+		double waitInputSeconds;
+		// Time spent waiting for space downstream (s)
+		double waitOutputSeconds;
+		// Average fill of the stage's input queue (0-1)
+		double inputQueueFill;
+	};
+
+	/*******CONSTRUCTOR*******/
+	PipelineRunner(size_t inputQueueCapacity, bool inputShowInput, bool inputShowOutput);
+
+	// Run the sequence (firstFrame: already read frame 1). RETURN-true: completed, false: stopped or read error
+	bool Run(cv::VideoCapture &videoCapture, cv::Mat firstFrame, int frameCount,
+		BackgroundSubtractorLCDP &subtractor, OutputCallback outputCallback);
+
+	// Adapt the subtractor's quality limits to a frame-time budget (nullptr: off); set before Run
+	void SetLatencyController(LatencyBudgetController *controller);
+
+	// Checkpoint the model every 'interval' frames from the subtract stage (nullptr: off); set before Run
+	void SetCheckpointWriter(CheckpointWriter *writer, size_t interval);
+
+	// Run the stage threads on the CPUs of one NUMA node (-1: not pinned); set before Run
+	void SetNumaNode(int nodeIndex);
+
+	// Decoding stopped before the last frame because the video could not be read
+	bool IsReadFailed() const;
+	// Total time spent inside Process (s)
+	double GetProcessSeconds() const;
+	// Statistics of decode / subtract / output / display stages
+	std::vector<StageStats> GetStageStats() const;
+	// Print per-stage occupancy; the stage with the highest busy share is the bottleneck
+	void PrintStats(std::ostream &output) const;
+
+protected:
+	typedef std::chrono::steady_clock Clock;
+
+	// Frame travelling through the pipeline
+	struct PipelineItem {
+		int frameIndex;
+		cv::Mat inputFrame;
+		cv::Mat fgMask;
+	};
+
+	// Stage threads
+	void DecodeStage(cv::VideoCapture &videoCapture, cv::Mat firstFrame, int frameCount);
+	void SubtractStage(BackgroundSubtractorLCDP &subtractor);
+	void OutputStage(OutputCallback outputCallback);
+	// Seconds elapsed since a time point
+	static double SecondsSince(Clock::time_point startTime);
+
+	/*=====PIPELINE Parameters=====*/
+	// Capacity of each inter-stage queue
+	const size_t queueCapacity;
+	// Show input frame switch
+	const bool showInput;
+	// Show output frame switch
+	const bool showOutput;
+
+	/*=====QUEUES=====*/
+	BoundedQueue<PipelineItem> decodeQueue;
+	BoundedQueue<PipelineItem> resultQueue;
+	BoundedQueue<PipelineItem> displayQueue;
+
+	/*=====STATE=====*/
+	// Set when the user stops the run or decoding fails
+	std::atomic<bool> stopRequested;
+	std::atomic<bool> readFailed;
+	// Latency budget controller (nullptr: off)
+	LatencyBudgetController * latencyController;
+	// Model checkpoint writer (nullptr: off) and its interval (frames)
+	CheckpointWriter * checkpointWriter;
+	size_t checkpointInterval;
+	// NUMA node of the stage threads (-1: not pinned)
+	int numaNode;
+	// Wall time of the whole run (s)
+	double wallSeconds;
+	// Decode / subtract / output / display statistics
+	StageStats stageStats[4];
+};
+#endif
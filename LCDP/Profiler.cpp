@@ -0,0 +1,199 @@
+#include "Profiler.h"
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+// Sub-buckets per power of two (must be a power of two)
+#define PROFILER_SUB_BUCKET_BITS 4
+#define PROFILER_SUB_BUCKET_NO (1 << PROFILER_SUB_BUCKET_BITS)
+// Enough buckets for any 63-bit value
+#define PROFILER_BUCKET_NO (PROFILER_SUB_BUCKET_NO * (64 - PROFILER_SUB_BUCKET_BITS + 1))
+
+/*******CONSTRUCTOR*******/
+Profiler::Profiler(const std::vector<std::string> &inputStageNames) :
+	stageNames(inputStageNames),
+	frameStart(0),
+	lapStart(0)
+{
+	stageNames.push_back("FRAME TOTAL");
+	histograms.resize(stageNames.size());
+	frameNanoseconds.assign(stageNames.size(), -1);
+	Reset();
+}
+
+// Monotonic clock
+long long Profiler::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Start timing a frame
+void Profiler::StartFrame() {
+	frameStart = Now();
+	lapStart = frameStart;
+}
+
+// Charge the time since the previous lap to a stage
+void Profiler::Lap(int stage) {
+	const long long now = Now();
+	Record(stage, now - lapStart);
+	lapStart = now;
+}
+
+// Restart the lap clock without charging anybody
+void Profiler::ResetLap() {
+	lapStart = Now();
+}
+
+// Charge time measured elsewhere to a stage
+void Profiler::Record(int stage, long long nanoseconds) {
+	frameNanoseconds[stage] = std::max(0LL, frameNanoseconds[stage]) + std::max(0LL, nanoseconds);
+}
+
+// Add one sample to a stage's histogram
+void Profiler::AddSample(int stage, long long nanoseconds) {
+	StageHistogram &histogram = histograms[stage];
+	nanoseconds = std::max(0LL, nanoseconds);
+	histogram.buckets[BucketIndex(nanoseconds)]++;
+	histogram.sampleNo++;
+	histogram.totalNanoseconds += nanoseconds;
+	histogram.max = std::max(histogram.max, nanoseconds);
+}
+
+// Finish the frame
+void Profiler::EndFrame() {
+	if (frameStart > 0) {
+		frameNanoseconds.back() = Now() - frameStart;
+		frameStart = 0;
+	}
+	for (size_t stage = 0; stage < frameNanoseconds.size(); stage++) {
+		if (frameNanoseconds[stage] >= 0) {
+			AddSample(int(stage), frameNanoseconds[stage]);
+			frameNanoseconds[stage] = -1;
+		}
+	}
+}
+
+// Forget every sample
+void Profiler::Reset() {
+	for (auto & histogram : histograms) {
+		histogram.buckets.assign(PROFILER_BUCKET_NO, 0);
+		histogram.sampleNo = 0;
+		histogram.totalNanoseconds = 0;
+		histogram.max = 0;
+	}
+	frameNanoseconds.assign(frameNanoseconds.size(), -1);
+}
+
+// Bucket of a sample: exact below 16 ns, then 16 linear sub-buckets per power of two
+int Profiler::BucketIndex(long long nanoseconds) {
+	const unsigned long long value = (unsigned long long)nanoseconds;
+	if (value < PROFILER_SUB_BUCKET_NO) {
+		return int(value);
+	}
+	int exponent = 0;
+	while ((value >> (exponent + 1)) != 0) {
+		exponent++;
+	}
+	const int shift = exponent - PROFILER_SUB_BUCKET_BITS;
+	const int subBucket = int((value >> shift) & (PROFILER_SUB_BUCKET_NO - 1));
+	return PROFILER_SUB_BUCKET_NO + (shift * PROFILER_SUB_BUCKET_NO) + subBucket;
+}
+
+// Representative value of a bucket (its midpoint)
+long long Profiler::BucketValue(int bucketIndex) {
+	if (bucketIndex < PROFILER_SUB_BUCKET_NO) {
+		return bucketIndex;
+	}
+	const int shift = (bucketIndex - PROFILER_SUB_BUCKET_NO) / PROFILER_SUB_BUCKET_NO;
+	const int subBucket = (bucketIndex - PROFILER_SUB_BUCKET_NO) % PROFILER_SUB_BUCKET_NO;
+	const long long lower = (long long)(PROFILER_SUB_BUCKET_NO + subBucket) << shift;
+	return lower + ((1LL << shift) / 2);
+}
+
+// Value at a percentile
+long long Profiler::Percentile(const StageHistogram &histogram, double percentile) const {
+	if (histogram.sampleNo == 0) {
+		return 0;
+	}
+	const unsigned long long rank = std::max(1ULL, (unsigned long long)std::ceil(percentile * histogram.sampleNo));
+	unsigned long long cumulative = 0;
+	for (int bucketIndex = 0; bucketIndex < PROFILER_BUCKET_NO; bucketIndex++) {
+		cumulative += histogram.buckets[bucketIndex];
+		if (cumulative >= rank) {
+			return std::min(histogram.max, BucketValue(bucketIndex));
+		}
+	}
+	return histogram.max;
+}
+
+// Total number of stages
+int Profiler::GetStageNo() const {
+	return int(stageNames.size());
+}
+
+// Latency summary of one stage
+Profiler::StageSummary Profiler::GetSummary(int stage) const {
+	const StageHistogram &histogram = histograms[stage];
+	StageSummary summary;
+	summary.name = stageNames[stage];
+	summary.sampleNo = histogram.sampleNo;
+	summary.totalNanoseconds = histogram.totalNanoseconds;
+	summary.p50 = Percentile(histogram, 0.50);
+	summary.p95 = Percentile(histogram, 0.95);
+	summary.p99 = Percentile(histogram, 0.99);
+	summary.max = histogram.max;
+	return summary;
+}
+
+// Print a latency table
+void Profiler::PrintStats(std::ostream &output) const {
+	output << "\n<<<<<-STAGE LATENCY (MS)->>>>>\n";
+	output << std::left << std::setw(22) << "STAGE" << std::right << std::setw(9) << "SAMPLES"
+		<< std::setw(11) << "TOTAL" << std::setw(9) << "MEAN" << std::setw(9) << "P50"
+		<< std::setw(9) << "P95" << std::setw(9) << "P99" << std::setw(9) << "MAX" << std::endl;
+	for (int stage = 0; stage < GetStageNo(); stage++) {
+		const StageSummary summary = GetSummary(stage);
+		const double mean = (summary.sampleNo > 0) ? (double(summary.totalNanoseconds) / summary.sampleNo) : 0.0;
+		output << std::left << std::setw(22) << summary.name << std::right << std::setw(9) << summary.sampleNo
+			<< std::setprecision(1) << std::fixed << std::setw(11) << (summary.totalNanoseconds / 1e6)
+			<< std::setprecision(3) << std::setw(9) << (mean / 1e6) << std::setw(9) << (summary.p50 / 1e6)
+			<< std::setw(9) << (summary.p95 / 1e6) << std::setw(9) << (summary.p99 / 1e6)
+			<< std::setw(9) << (summary.max / 1e6) << std::endl;
+	}
+}
+
+// Export the summaries as CSV (nanoseconds)
+bool Profiler::SaveCSV(const std::string &fileName) const {
+	std::ofstream csvFile(fileName);
+	if (!csvFile.is_open()) {
+		return false;
+	}
+	csvFile << "stage,samples,total_ns,mean_ns,p50_ns,p95_ns,p99_ns,max_ns" << std::endl;
+	for (int stage = 0; stage < GetStageNo(); stage++) {
+		const StageSummary summary = GetSummary(stage);
+		const long long mean = (summary.sampleNo > 0) ? (summary.totalNanoseconds / (long long)summary.sampleNo) : 0;
+		csvFile << summary.name << "," << summary.sampleNo << "," << summary.totalNanoseconds << "," << mean
+			<< "," << summary.p50 << "," << summary.p95 << "," << summary.p99 << "," << summary.max << std::endl;
+	}
+	return csvFile.good();
+}
+
+// Export the summaries as JSON (nanoseconds)
+bool Profiler::SaveJSON(const std::string &fileName) const {
+	std::ofstream jsonFile(fileName);
+	if (!jsonFile.is_open()) {
+		return false;
+	}
+	jsonFile << "{\n  \"unit\": \"ns\",\n  \"stages\": [\n";
+	for (int stage = 0; stage < GetStageNo(); stage++) {
+		const StageSummary summary = GetSummary(stage);
+		const long long mean = (summary.sampleNo > 0) ? (summary.totalNanoseconds / (long long)summary.sampleNo) : 0;
+		jsonFile << "    {\"stage\": \"" << summary.name << "\", \"samples\": " << summary.sampleNo
+			<< ", \"total\": " << summary.totalNanoseconds << ", \"mean\": " << mean
+			<< ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+			<< ", \"max\": " << summary.max << "}" << ((stage + 1 < GetStageNo()) ? "," : "") << "\n";
+	}
+	jsonFile << "  ]\n}\n";
+	return jsonFile.good();
+}
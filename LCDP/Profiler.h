@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef __Profiler_H_INCLUDED
+#define __Profiler_H_INCLUDED
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ostream>
+
+// Per-stage latency profiler on a monotonic nanosecond clock. Every stage keeps a
+// log-linear histogram (16 sub-buckets per power of two, ~3% resolution), so p50/p95/p99
+// come out of constant memory however long the run is. A profiler is used by one thread.
+//
+// Usage per frame: StartFrame(), then Lap(stage) at the end of every stage (the time since
+// the previous lap is charged to that stage), or Record() for time measured elsewhere.
+// Everything charged to a stage within one frame is summed, and EndFrame() adds one sample
+// per charged stage plus the whole frame under the extra "FRAME TOTAL" stage.
+class Profiler {
+public:
+	// Latency summary of one stage (nanoseconds)
+	struct StageSummary {
+		std::string name;
+		// Total number of samples
+		unsigned long long sampleNo;
+		long long totalNanoseconds;
+		long long p50;
+		long long p95;
+		long long p99;
+		long long max;
+	};
+
+	/*******CONSTRUCTOR*******/
+	explicit Profiler(const std::vector<std::string> &inputStageNames);
+
+	// Monotonic clock (ns)
+	static long long Now();
+
+	// Start timing a frame
+	void StartFrame();
+	// Charge the time since the previous lap (or frame start) to a stage
+	void Lap(int stage);
+	// Restart the lap clock without charging anybody
+	void ResetLap();
+	// Charge time measured elsewhere to a stage
+	void Record(int stage, long long nanoseconds);
+	// Finish the frame
+	void EndFrame();
+	// Forget every sample
+	void Reset();
+
+	// Total number of stages (including FRAME TOTAL)
+	int GetStageNo() const;
+	// Latency summary of one stage
+	StageSummary GetSummary(int stage) const;
+	// Print a latency table (ms)
+	void PrintStats(std::ostream &output) const;
+	// Export the summaries (RETURN-true: success)
+	bool SaveCSV(const std::string &fileName) const;
+	bool SaveJSON(const std::string &fileName) const;
+
+private:
+	// Histogram of one stage
+	struct StageHistogram {
+		std::vector<unsigned long long> buckets;
+		unsigned long long sampleNo;
+		long long totalNanoseconds;
+		long long max;
+	};
+	// Add one sample to a stage's histogram
+	void AddSample(int stage, long long nanoseconds);
+	// Bucket of a sample
+	static int BucketIndex(long long nanoseconds);
+	// Representative value of a bucket
+	static long long BucketValue(int bucketIndex);
+	// Value at a percentile (0-1)
+	long long Percentile(const StageHistogram &histogram, double percentile) const;
+
+	// Stage names (the last one is FRAME TOTAL)
+	std::vector<std::string> stageNames;
+	// Histogram of every stage
+	std::vector<StageHistogram> histograms;
+	// Time charged to every stage in the current frame (-1: not charged)
+	std::vector<long long> frameNanoseconds;
+	// Frame start / last lap (ns)
+	long long frameStart;
+	long long lapStart;
+};
+#endif
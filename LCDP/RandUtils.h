@@ -1,4 +1,5 @@
 #pragma once
+#include <random>
 
 // gaussian 3x3 pattern, based on 'floor(fspecial('gaussian', 3, 1)*256)'
 static const int s_nSamplesInitPatternWidth_3x3 = 3;
@@ -11,8 +12,8 @@ static const int s_anSamplesInitPattern_3x3[s_nSamplesInitPatternHeight_3x3][s_n
 };
 //! returns a random init/sampling position for the specified pixel position; also guards against out-of-bounds values via image/border size check.
 static inline void getRandSamplePosition_3x3(cv::Point & sampleCoor, const cv::Point currCoor, const int border,
-	const cv::Size& imgsize) {
-	int r = 1 + rand() % s_nSamplesInitPatternTot_3x3;
+	const cv::Size& imgsize, std::mt19937 &generator) {
+	int r = 1 + int(generator() % s_nSamplesInitPatternTot_3x3);
 	for (sampleCoor.x = 0; sampleCoor.x < s_nSamplesInitPatternWidth_3x3; ++sampleCoor.x) {
 		for (sampleCoor.y = 0; sampleCoor.y < s_nSamplesInitPatternHeight_3x3; ++sampleCoor.y) {
 			r -= s_anSamplesInitPattern_3x3[sampleCoor.y][sampleCoor.x];
@@ -48,8 +49,8 @@ static const int s_anSamplesInitPattern_7x7[s_nSamplesInitPatternHeight_7x7][s_n
 
 //! returns a random init/sampling position for the specified pixel position; also guards against out-of-bounds values via image/border size check.
 static inline void getRandSamplePosition_7x7(cv::Point & sampleCoor, const cv::Point currCoor, const int border,
-	const cv::Size& imgsize) {
-	int r = 1 + rand() % s_nSamplesInitPatternTot_7x7;
+	const cv::Size& imgsize, std::mt19937 &generator) {
+	int r = 1 + int(generator() % s_nSamplesInitPatternTot_7x7);
 	for (sampleCoor.x = 0; sampleCoor.x < s_nSamplesInitPatternWidth_7x7; ++sampleCoor.x) {
 		for (sampleCoor.y = 0; sampleCoor.y < s_nSamplesInitPatternHeight_7x7; ++sampleCoor.y) {
 			r -= s_anSamplesInitPattern_7x7[sampleCoor.y][sampleCoor.x];
@@ -80,8 +81,8 @@ static const int s_anNeighborPattern_3x3[8][2] = {
 
 //! returns a random neighbor position for the specified pixel position; also guards against out-of-bounds values via image/border size check.
 static inline void getRandNeighborPosition_3x3(int& x_neighbor, int& y_neighbor, const int x_orig, const int y_orig, const int border,
-	const cv::Size& imgsize) {
-	int r = rand() % s_anNeighborPatternSize_3x3;
+	const cv::Size& imgsize, std::mt19937 &generator) {
+	int r = int(generator() % s_anNeighborPatternSize_3x3);
 	x_neighbor = x_orig + s_anNeighborPattern_3x3[r][0];
 	y_neighbor = y_orig + s_anNeighborPattern_3x3[r][1];
 	if (x_neighbor < border)
@@ -107,8 +108,9 @@ static const int s_anNeighborPattern_5x5[24][2] = {
 };
 
 //! returns a random neighbor position for the specified pixel position; also guards against out-of-bounds values via image/border size check.
-static inline void 	getRandSamplePosition_5x5(cv::Point & sampleCoor, const cv::Point currCoor, const int border, const cv::Size& imgsize) {
-	int r = rand() % s_anNeighborPatternSize_5x5;
+static inline void 	getRandSamplePosition_5x5(cv::Point & sampleCoor, const cv::Point currCoor, const int border, const cv::Size& imgsize,
+	std::mt19937 &generator) {
+	int r = int(generator() % s_anNeighborPatternSize_5x5);
 	sampleCoor.x = s_anNeighborPattern_5x5[r][0];
 	sampleCoor.y = s_anNeighborPattern_5x5[r][1];
 
@@ -0,0 +1,419 @@
+#include "RegressionSuite.h"
+#include "SequenceBenchmark.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+// Backing file of the FILE storage variant (removed after the run)
+#define REGRESSION_STORAGE_FILE "regression.lcdpmm"
+// Bytes added to every row of the padded-view frames and masks, and the value they hold
+#define REGRESSION_ROW_PADDING 64
+#define REGRESSION_PADDING_VALUE 0xA5
+
+// Reference configuration
+RegressionSuite::Variant::Variant() :
+	name("reference"),
+	exact(true),
+	modelStorage(ModelStorage::STORAGE_HEAP),
+	pageSize(ModelStorage::PAGES_DEFAULT),
+	adaptiveModel(false),
+	changeGateBlockSize(0),
+	changeGateThreshold(2.0f),
+	changeGateInterval(25),
+	matchHints(false),
+	specialisedKernels(false),
+	compactWords(false),
+	input(INPUT_BGR),
+	maxFMeasureDrop(0.0),
+	maxPBCIncrease(0.0)
+{
+}
+
+RegressionSuite::Result::Result() :
+	exact(true),
+	modelStorage(ModelStorage::STORAGE_HEAP),
+	frameNo(0),
+	processSeconds(0.0),
+	speedup(0.0),
+	differentPixelNo(0),
+	differentFrameNo(0),
+	firstDifferentFrame(0),
+	evaluated(false),
+	FMeasureDelta(0.0),
+	PBCDelta(0.0),
+	passed(false)
+{
+}
+
+/*******CONSTRUCTOR*******/
+RegressionSuite::RegressionSuite(unsigned int inputSeed, size_t inputMaxFrameNo) :
+	/*=====SUITE Parameters=====*/
+	seed(inputSeed),
+	maxFrameNo(inputMaxFrameNo)
+{
+}
+
+// Every exact mode and the approximate modes with their tolerance bands
+std::vector<RegressionSuite::Variant> RegressionSuite::DefaultVariants() {
+	std::vector<Variant> defaultVariants;
+	Variant variant;
+	// Same configuration again: the fixed seed makes Process deterministic
+	variant.name = "reference-rerun";
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "file-storage";
+	variant.modelStorage = ModelStorage::STORAGE_FILE;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "thp-pages";
+	variant.pageSize = ModelStorage::PAGES_TRANSPARENT_HUGE;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "huge-pages";
+	variant.pageSize = ModelStorage::PAGES_HUGE;
+	defaultVariants.push_back(variant);
+	// Exact optimisations of the per-pixel loop and the frame API, one at a time
+	variant = Variant();
+	variant.name = "compact-words";
+	variant.compactWords = true;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "specialised-loop";
+	variant.specialisedKernels = true;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "padded-view";
+	variant.input = INPUT_PADDED_VIEW;
+	defaultVariants.push_back(variant);
+	// Approximate modes
+	variant = Variant();
+	variant.name = "match-hints";
+	variant.exact = false;
+	variant.matchHints = true;
+	variant.maxFMeasureDrop = 0.01;
+	variant.maxPBCIncrease = 0.1;
+	defaultVariants.push_back(variant);
+	// Every optimisation on, as Process runs by default
+	variant.name = "all-optimisations";
+	variant.specialisedKernels = true;
+	variant.compactWords = true;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "gray-input";
+	variant.exact = false;
+	variant.input = INPUT_GRAY;
+	variant.maxFMeasureDrop = 0.03;
+	variant.maxPBCIncrease = 0.5;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "change-gate";
+	variant.exact = false;
+	variant.changeGateBlockSize = 8;
+	variant.maxFMeasureDrop = 0.01;
+	variant.maxPBCIncrease = 0.1;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "adaptive-model";
+	variant.exact = false;
+	variant.adaptiveModel = true;
+	variant.maxFMeasureDrop = 0.01;
+	variant.maxPBCIncrease = 0.1;
+	defaultVariants.push_back(variant);
+	variant = Variant();
+	variant.name = "scale-2";
+	variant.exact = false;
+	variant.parameters.processScale = 2;
+	variant.maxFMeasureDrop = 0.03;
+	variant.maxPBCIncrease = 0.5;
+	defaultVariants.push_back(variant);
+	variant.name = "scale-4";
+	variant.parameters.processScale = 4;
+	variant.maxFMeasureDrop = 0.06;
+	variant.maxPBCIncrease = 1.0;
+	defaultVariants.push_back(variant);
+	for (int descNbNo = 8; descNbNo <= LCDP_MAX_DESC_NB; descNbNo += 8) {
+		if (descNbNo == LCDPParameters().descNbNo) {
+			continue;
+		}
+		variant = Variant();
+		variant.name = "desc-nb-" + std::to_string(descNbNo);
+		variant.exact = false;
+		variant.parameters.descNbNo = descNbNo;
+		variant.maxFMeasureDrop = 0.03;
+		variant.maxPBCIncrease = 0.5;
+		defaultVariants.push_back(variant);
+	}
+	return defaultVariants;
+}
+
+// Run a variant after the reference
+void RegressionSuite::AddVariant(const Variant &variant) {
+	variants.push_back(variant);
+}
+
+// Run the reference and every variant on each folder
+bool RegressionSuite::Run(const std::vector<std::string> &datasetFolders) {
+	if (variants.empty()) {
+		variants = DefaultVariants();
+	}
+	results.clear();
+	bool allPassed = true;
+	for (auto & datasetFolder : datasetFolders) {
+		std::vector<cv::Mat> frames;
+		if (!SequenceBenchmark::PreloadFrames(datasetFolder, maxFrameNo, frames)) {
+			std::cout << "Cannot read input frames: " << datasetFolder << "/input/in000001.jpg" << std::endl;
+			Result result;
+			result.datasetFolder = datasetFolder;
+			result.variantName = "reference";
+			result.failure = "no input frames";
+			results.push_back(result);
+			allPassed = false;
+			continue;
+		}
+		std::cout << datasetFolder << ": " << frames.size() << " frames" << std::endl;
+		// REFERENCE run records the masks every variant is compared with
+		std::vector<cv::Mat> referenceMasks;
+		const Variant referenceVariant;
+		const Result reference = RunVariant(datasetFolder, referenceVariant, frames, referenceMasks, true);
+		results.push_back(reference);
+		results.back().speedup = 1.0;
+		results.back().passed = true;
+		// Gray frames and the reference on them replicated to BGR (built for the first gray variant)
+		std::vector<cv::Mat> grayFrames;
+		std::vector<cv::Mat> grayReferenceMasks;
+		Result grayReference;
+		for (auto & variant : variants) {
+			if ((variant.input == INPUT_GRAY) && grayFrames.empty()) {
+				std::vector<cv::Mat> grayBGRFrames(frames.size());
+				grayFrames.resize(frames.size());
+				for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++) {
+					cv::cvtColor(frames[frameIndex], grayFrames[frameIndex], cv::COLOR_BGR2GRAY);
+					cv::cvtColor(grayFrames[frameIndex], grayBGRFrames[frameIndex], cv::COLOR_GRAY2BGR);
+				}
+				std::cout << "  reference-gray" << std::endl;
+				Variant grayReferenceVariant;
+				grayReferenceVariant.name = "reference-gray";
+				grayReference = RunVariant(datasetFolder, grayReferenceVariant, grayBGRFrames, grayReferenceMasks, true);
+				results.push_back(grayReference);
+				results.back().speedup = 1.0;
+				results.back().passed = true;
+			}
+			const bool grayInput = (variant.input == INPUT_GRAY);
+			std::cout << "  " << variant.name << std::endl;
+			Result result = RunVariant(datasetFolder, variant, grayInput ? grayFrames : frames,
+				grayInput ? grayReferenceMasks : referenceMasks, false);
+			Judge(result, variant, grayInput ? grayReference : reference);
+			allPassed = allPassed && result.passed;
+			results.push_back(result);
+		}
+	}
+	return allPassed;
+}
+
+// Run one configuration over the preloaded frames
+RegressionSuite::Result RegressionSuite::RunVariant(const std::string &datasetFolder, const Variant &variant,
+	const std::vector<cv::Mat> &frames, std::vector<cv::Mat> &referenceMasks, bool recordMasks) {
+	typedef std::chrono::steady_clock Clock;
+	Result result;
+	result.datasetFolder = datasetFolder;
+	result.variantName = variant.name;
+	result.exact = variant.exact;
+
+	OnlineEvaluator onlineEvaluator;
+	onlineEvaluator.Open(datasetFolder);
+	const cv::Size frameSize = frames[0].size();
+	const cv::Mat ROI(frameSize, CV_8UC1, cv::Scalar(255));
+	{
+		std::unique_ptr<BackgroundSubtractorLCDP> backgroundSubtractorLCDP =
+			variant.parameters.CreateSubtractor(ROI, frameSize, int(frames.size()));
+		backgroundSubtractorLCDP->SetRandomSeed(seed);
+		if (variant.modelStorage != ModelStorage::STORAGE_HEAP) {
+			backgroundSubtractorLCDP->SetModelStorage(variant.modelStorage, REGRESSION_STORAGE_FILE);
+		}
+		if (variant.adaptiveModel) {
+			backgroundSubtractorLCDP->SetAdaptiveModel(true, 0);
+		}
+		backgroundSubtractorLCDP->SetPageSize(variant.pageSize);
+		backgroundSubtractorLCDP->SetOptimisations(variant.matchHints, variant.specialisedKernels, variant.compactWords);
+		// Padded-view frames are copied into buffers whose padding holds a marker value
+		// before the timed loop; the masks are written into a padded buffer as well
+		std::vector<cv::Mat> paddedFrames;
+		cv::Mat paddedMask;
+		if (variant.input == INPUT_PADDED_VIEW) {
+			for (auto & frame : frames) {
+				cv::Mat paddedFrame(frame.rows, (frame.cols * frame.channels()) + REGRESSION_ROW_PADDING, CV_8UC1, cv::Scalar(REGRESSION_PADDING_VALUE));
+				cv::Mat paddedPixels(frame.rows, frame.cols, frame.type(), paddedFrame.data, paddedFrame.step);
+				frame.copyTo(paddedPixels);
+				paddedFrames.push_back(paddedFrame);
+			}
+			paddedMask.create(frameSize.height, frameSize.width + REGRESSION_ROW_PADDING, CV_8UC1);
+			paddedMask.setTo(cv::Scalar(REGRESSION_PADDING_VALUE));
+		}
+		const MaskView paddedMaskView(paddedMask.data, frameSize.width, frameSize.height, paddedMask.step);
+		auto paddedView = [&](size_t frameIndex) {
+			return FrameView(paddedFrames[frameIndex].data, frameSize.width, frameSize.height, paddedFrames[frameIndex].step, FrameView::FORMAT_BGR8);
+		};
+		if (variant.input == INPUT_PADDED_VIEW) {
+			backgroundSubtractorLCDP->Initialize(paddedView(0), ROI);
+		}
+		else {
+			backgroundSubtractorLCDP->Initialize(frames[0], ROI);
+		}
+		result.modelStorage = backgroundSubtractorLCDP->GetModelStorageBackend();
+		if (variant.changeGateBlockSize > 0) {
+			backgroundSubtractorLCDP->SetChangeGate(variant.changeGateBlockSize, variant.changeGateThreshold, variant.changeGateInterval);
+		}
+
+		cv::Mat fgMask, differentPixels;
+		for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++) {
+			const Clock::time_point startTime = Clock::now();
+			if (variant.input == INPUT_PADDED_VIEW) {
+				backgroundSubtractorLCDP->Process(paddedView(frameIndex), paddedMaskView);
+			}
+			else {
+				backgroundSubtractorLCDP->Process(frames[frameIndex], fgMask);
+			}
+			result.processSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+			if (variant.input == INPUT_PADDED_VIEW) {
+				fgMask = paddedMask(cv::Rect(0, 0, frameSize.width, frameSize.height));
+			}
+			// Frame indexes start at 1, like the groundtruth
+			onlineEvaluator.Add(int(frameIndex) + 1, fgMask);
+			if (recordMasks) {
+				referenceMasks.push_back(fgMask.clone());
+				continue;
+			}
+			cv::compare(fgMask, referenceMasks[frameIndex], differentPixels, cv::CMP_NE);
+			int differentPixelNo = cv::countNonZero(differentPixels);
+			if (variant.input == INPUT_PADDED_VIEW) {
+				// Bytes written into the mask padding count as differing pixels
+				cv::compare(paddedMask(cv::Rect(frameSize.width, 0, REGRESSION_ROW_PADDING, frameSize.height)),
+					double(REGRESSION_PADDING_VALUE), differentPixels, cv::CMP_NE);
+				differentPixelNo += cv::countNonZero(differentPixels);
+			}
+			if (differentPixelNo > 0) {
+				result.differentPixelNo += differentPixelNo;
+				if (result.differentFrameNo++ == 0) {
+					result.firstDifferentFrame = frameIndex + 1;
+				}
+			}
+		}
+		result.frameNo = frames.size();
+	}
+	if (variant.modelStorage == ModelStorage::STORAGE_FILE) {
+		std::remove(REGRESSION_STORAGE_FILE);
+	}
+	result.evaluated = (onlineEvaluator.GetEvaluatedNo() > 0) && (onlineEvaluator.GetMissingNo() == 0);
+	result.counts = onlineEvaluator.GetCounts();
+	return result;
+}
+
+// Check a variant's result against the reference result
+void RegressionSuite::Judge(Result &result, const Variant &variant, const Result &reference) {
+	result.speedup = (result.processSeconds > 0.0) ? (reference.processSeconds / result.processSeconds) : 0.0;
+	if (result.evaluated && reference.evaluated) {
+		const EvaluationMetrics metrics(result.counts);
+		const EvaluationMetrics referenceMetrics(reference.counts);
+		result.FMeasureDelta = metrics.FMeasure - referenceMetrics.FMeasure;
+		result.PBCDelta = metrics.PBC - referenceMetrics.PBC;
+	}
+	std::stringstream failure;
+	if (result.modelStorage != variant.modelStorage) {
+		// A silent fallback would test the heap under the variant's name
+		failure << "model storage fell back from " << ModelStorage::GetBackendName(variant.modelStorage)
+			<< " to " << ModelStorage::GetBackendName(result.modelStorage);
+	}
+	else if (result.frameNo != reference.frameNo) {
+		failure << "processed " << result.frameNo << " of " << reference.frameNo << " frames";
+	}
+	else if (variant.exact) {
+		if (result.differentPixelNo > 0) {
+			failure << result.differentFrameNo << " mask(s) differ (first: frame " << result.firstDifferentFrame << ")";
+		}
+	}
+	else if (!result.evaluated || !reference.evaluated) {
+		failure << "no groundtruth to check the tolerance band";
+	}
+	else if (-result.FMeasureDelta > variant.maxFMeasureDrop) {
+		failure << "F-measure drop " << std::setprecision(4) << -result.FMeasureDelta << " > " << variant.maxFMeasureDrop;
+	}
+	else if (result.PBCDelta > variant.maxPBCIncrease) {
+		failure << "PBC increase " << std::setprecision(4) << result.PBCDelta << " > " << variant.maxPBCIncrease;
+	}
+	result.failure = failure.str();
+	result.passed = result.failure.empty();
+}
+
+// Per-folder, per-variant results
+const std::vector<RegressionSuite::Result> & RegressionSuite::GetResults() const {
+	return results;
+}
+
+// Print the speed / accuracy table
+void RegressionSuite::PrintResults(std::ostream &output) const {
+	output << "\n<<<<<-OPTIMISATION REGRESSION->>>>>\n";
+	output << "SEED: " << seed << " FRAMES: " << ((maxFrameNo > 0) ? std::to_string(maxFrameNo) : "all") << std::endl;
+	size_t failedNo = 0;
+	std::string datasetFolder;
+	for (auto & result : results) {
+		if (result.datasetFolder != datasetFolder) {
+			datasetFolder = result.datasetFolder;
+			output << "DATASET: " << datasetFolder << std::endl;
+			output << std::left << std::setw(18) << "VARIANT" << std::setw(7) << "CHECK" << std::right << std::setw(10) << "MS/FRAME"
+				<< std::setw(9) << "SPEEDUP" << std::setw(10) << "F-MEASURE" << std::setw(9) << "DELTA F" << std::setw(8) << "PBC"
+				<< std::setw(10) << "DELTA PBC" << std::setw(12) << "DIFF PIXELS" << "  RESULT" << std::endl;
+		}
+		output << std::left << std::setw(18) << result.variantName << std::setw(7) << (result.exact ? "exact" : "band") << std::right;
+		if (result.frameNo == 0) {
+			output << "  " << result.failure << std::endl;
+			failedNo++;
+			continue;
+		}
+		const EvaluationMetrics metrics(result.counts);
+		output << std::setprecision(2) << std::fixed << std::setw(10) << (1000.0 * result.processSeconds / result.frameNo)
+			<< std::setw(9) << result.speedup;
+		if (result.evaluated) {
+			output << std::setprecision(4) << std::setw(10) << metrics.FMeasure << std::setw(9) << result.FMeasureDelta
+				<< std::setprecision(3) << std::setw(8) << metrics.PBC << std::setw(10) << result.PBCDelta;
+		}
+		else {
+			output << std::setw(10) << "-" << std::setw(9) << "-" << std::setw(8) << "-" << std::setw(10) << "-";
+		}
+		output << std::setw(12) << result.differentPixelNo << "  " << (result.passed ? "PASS" : "FAIL: " + result.failure) << std::endl;
+		if (!result.passed) {
+			failedNo++;
+		}
+	}
+	output << (failedNo == 0 ? "ALL PASSED" : std::to_string(failedNo) + " FAILED") << std::endl;
+}
+
+// Export the results as CSV
+bool RegressionSuite::SaveCSV(const std::string &csvFileName) const {
+	std::ofstream csvFile(csvFileName);
+	if (!csvFile.is_open()) {
+		return false;
+	}
+	csvFile << "dataset,variant,exact,storage,seed,frames,process_s,ms_per_frame,speedup,different_pixels,different_frames,"
+		<< "evaluated,TP,FP,TN,FN,f_measure,f_measure_delta,pbc,pbc_delta,passed,failure" << std::endl;
+	for (auto & result : results) {
+		const EvaluationMetrics metrics(result.counts);
+		csvFile << result.datasetFolder << "," << result.variantName << "," << (result.exact ? 1 : 0) << ","
+			<< ModelStorage::GetBackendName(result.modelStorage) << "," << seed << ","
+			<< result.frameNo << "," << result.processSeconds << ","
+			<< ((result.frameNo > 0) ? (1000.0 * result.processSeconds / result.frameNo) : 0.0) << "," << result.speedup << ","
+			<< result.differentPixelNo << "," << result.differentFrameNo << "," << (result.evaluated ? 1 : 0) << ","
+			<< result.counts.TP << "," << result.counts.FP << "," << result.counts.TN << "," << result.counts.FN << ",";
+		if (result.evaluated) {
+			csvFile << metrics.FMeasure << "," << result.FMeasureDelta << "," << metrics.PBC << "," << result.PBCDelta << ",";
+		}
+		else {
+			csvFile << ",,,,";
+		}
+		csvFile << (result.passed ? 1 : 0) << "," << result.failure << std::endl;
+	}
+	return csvFile.good();
+}
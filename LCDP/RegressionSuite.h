@@ -0,0 +1,129 @@
+#pragma once
+
+#ifndef __RegressionSuite_H_INCLUDED
+#define __RegressionSuite_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include "BatchRunner.h"
+#include "Evaluation.h"
+#include <vector>
+#include <string>
+#include <ostream>
+
+// Accuracy guard of the performance modes: every recorded sequence (CDnet-style folder,
+// see SequenceBenchmark) runs through the reference Process path, with the Process
+// optimisations off, and then through each variant, all with the same fixed random seed.
+// Exact variants (storage backends, page sizes, compact words, the word count specialised
+// loop, padded-stride frame views, a second reference run) have to reproduce the reference
+// masks bit for bit; approximate variants (match hints, change gate, adaptive model, reduced
+// resolution, other descriptor neighbourhoods, native gray input) have to keep their
+// F-measure and PBC within a tolerance band of the reference on the groundtruth. Frames
+// are preloaded, so only Process is timed.
+class RegressionSuite {
+public:
+	// How a variant is handed its frames
+	enum FrameInput {
+		// BGR cv::Mat frames
+		INPUT_BGR,
+		// Native 8-bit gray frames, judged against the reference on the same frames replicated
+		// to BGR (the path gray cameras took before the single-channel mode)
+		INPUT_GRAY,
+		// BGR frames and masks in caller buffers with padded rows, through FrameView / MaskView
+		INPUT_PADDED_VIEW
+	};
+
+	// One optimised configuration
+	struct Variant {
+		std::string name;
+		// Masks must equal the reference masks bit for bit
+		bool exact;
+		// Subtractor parameters
+		LCDPParameters parameters;
+		// Model storage and page size
+		ModelStorage::Backend modelStorage;
+		ModelStorage::PageSize pageSize;
+		// Per-pixel word capacity (unlimited budget)
+		bool adaptiveModel;
+		// Change gate block size (0: off), noise threshold and forced full pass interval
+		int changeGateBlockSize;
+		float changeGateThreshold;
+		size_t changeGateInterval;
+		// Process optimisations (see BackgroundSubtractorLCDP::SetOptimisations)
+		bool matchHints;
+		bool specialisedKernels;
+		bool compactWords;
+		// Frames handed to the subtractor
+		FrameInput input;
+		// Tolerance band of an approximate variant: largest F-measure drop (0-1) and largest
+		// PBC increase (percentage points) against the reference
+		double maxFMeasureDrop;
+		double maxPBCIncrease;
+
+		// Reference configuration (every optimisation off)
+		Variant();
+	};
+
+	// Result of one variant on one sequence
+	struct Result {
+		// Dataset folder and variant
+		std::string datasetFolder;
+		std::string variantName;
+		bool exact;
+		// Backend the model actually lived in (the subtractor falls back to the heap)
+		ModelStorage::Backend modelStorage;
+		// Total number of frames processed and time spent inside Process (s)
+		size_t frameNo;
+		double processSeconds;
+		// Reference time per frame divided by this variant's
+		double speedup;
+		// Pixels / frames whose mask differs from the reference, and the first such frame (0: none)
+		unsigned long long differentPixelNo;
+		size_t differentFrameNo;
+		size_t firstDifferentFrame;
+		// Every frame of the temporal ROI was evaluated on the groundtruth
+		bool evaluated;
+		ConfusionCounts counts;
+		// Change of F-measure and PBC against the reference (evaluated runs only)
+		double FMeasureDelta;
+		double PBCDelta;
+		// Outcome and the reason of a failure
+		bool passed;
+		std::string failure;
+
+		Result();
+	};
+
+	/*******CONSTRUCTOR*******/
+	// seed: fixed random seed of every run (see BackgroundSubtractorLCDP::SetRandomSeed);
+	// maxFrameNo: frames to run from the start of each sequence (0: every frame)
+	RegressionSuite(unsigned int inputSeed, size_t inputMaxFrameNo);
+
+	// Variants run when none were added: every exact mode and the approximate modes with
+	// their tolerance bands
+	static std::vector<Variant> DefaultVariants();
+	// Run a variant after the reference (the default list is used when none was added)
+	void AddVariant(const Variant &variant);
+	// Run the reference and every variant on each folder (RETURN-true: every variant passed)
+	bool Run(const std::vector<std::string> &datasetFolders);
+	// Per-folder, per-variant results (the reference comes first for each folder)
+	const std::vector<Result> & GetResults() const;
+	// Print the speed / accuracy table
+	void PrintResults(std::ostream &output) const;
+	// Export the results (RETURN-true: success)
+	bool SaveCSV(const std::string &fileName) const;
+
+private:
+	// Run one configuration over the preloaded frames; masks are recorded into referenceMasks
+	// (reference run) or compared with them
+	Result RunVariant(const std::string &datasetFolder, const Variant &variant,
+		const std::vector<cv::Mat> &frames, std::vector<cv::Mat> &referenceMasks, bool recordMasks);
+	// Check a variant's result against the reference result
+	static void Judge(Result &result, const Variant &variant, const Result &reference);
+
+	/*=====SUITE Parameters=====*/
+	const unsigned int seed;
+	const size_t maxFrameNo;
+
+	std::vector<Variant> variants;
+	std::vector<Result> results;
+};
+#endif
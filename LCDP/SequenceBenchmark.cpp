@@ -0,0 +1,239 @@
+#include "SequenceBenchmark.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// Latency of the given percentile (0-100) of sorted latencies (nearest rank)
+static double Percentile(const std::vector<double> &sortedLatencies, double percentile) {
+	if (sortedLatencies.empty()) {
+		return 0.0;
+	}
+	const size_t rank = size_t(std::ceil(percentile / 100.0 * sortedLatencies.size()));
+	return sortedLatencies[std::min(sortedLatencies.size(), std::max(size_t(1), rank)) - 1];
+}
+
+// Quote a string for JSON
+static std::string JSONString(const std::string &text) {
+	std::string quoted = "\"";
+	for (auto character : text) {
+		if ((character == '"') || (character == '\\')) {
+			quoted += '\\';
+		}
+		quoted += character;
+	}
+	return quoted + "\"";
+}
+
+/*******CONSTRUCTOR*******/
+SequenceBenchmark::SequenceBenchmark(const LCDPParameters &inputParameters, size_t inputMaxFrameNo) :
+	/*=====BENCHMARK Parameters=====*/
+	parameters(inputParameters),
+	maxFrameNo(inputMaxFrameNo)
+{
+	result = Result();
+	result.loaded = false;
+	result.peakRSSBytes = -1;
+}
+
+// Preload, process and evaluate one folder
+bool SequenceBenchmark::Run(const std::string &datasetFolder) {
+	typedef std::chrono::steady_clock Clock;
+	result = Result();
+	result.datasetFolder = datasetFolder;
+	result.loaded = false;
+	result.peakRSSBytes = -1;
+	latencies.clear();
+
+	// DECODE every frame first
+	std::vector<cv::Mat> frames;
+	Clock::time_point startTime = Clock::now();
+	if (!PreloadFrames(datasetFolder, maxFrameNo, frames)) {
+		std::cout << "Cannot read input frames: " << datasetFolder << "/input/in000001.jpg" << std::endl;
+		return false;
+	}
+	result.preloadSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	result.loaded = true;
+	result.frameSize = frames[0].size();
+	for (auto & frame : frames) {
+		result.frameBytes += frame.total() * frame.elemSize();
+	}
+	std::cout << "Preloaded " << frames.size() << " frames (" << (result.frameBytes / (1024 * 1024)) << " MB) in "
+		<< std::setprecision(1) << std::fixed << result.preloadSeconds << " s" << std::endl;
+
+	// Masks are evaluated in memory as they are produced
+	OnlineEvaluator onlineEvaluator;
+	if (!onlineEvaluator.Open(datasetFolder)) {
+		std::cout << "Cannot read temporalROI.txt of dataset: " << datasetFolder << std::endl;
+	}
+	const cv::Mat ROI(result.frameSize, CV_8UC1, cv::Scalar(255));
+	std::unique_ptr<BackgroundSubtractorLCDP> backgroundSubtractorLCDP =
+		parameters.CreateSubtractor(ROI, result.frameSize, int(frames.size()));
+	startTime = Clock::now();
+	backgroundSubtractorLCDP->Initialize(frames[0], ROI);
+	result.initializeSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	result.modelBytes = backgroundSubtractorLCDP->GetModelBytes();
+
+	// PROCESS every frame (frame indexes start at 1, like the groundtruth)
+	latencies.reserve(frames.size());
+	cv::Mat fgMask;
+	for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++) {
+		startTime = Clock::now();
+		backgroundSubtractorLCDP->Process(frames[frameIndex], fgMask);
+		const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		latencies.push_back(1000.0 * seconds);
+		result.processSeconds += seconds;
+		onlineEvaluator.Add(int(frameIndex) + 1, fgMask);
+		// Processed frames are not needed any more
+		frames[frameIndex].release();
+	}
+	result.frameNo = latencies.size();
+	result.FPS = (result.processSeconds > 0.0) ? (result.frameNo / result.processSeconds) : 0.0;
+	result.peakRSSBytes = GetPeakRSS();
+	result.evaluatedNo = onlineEvaluator.GetEvaluatedNo();
+	result.missingNo = onlineEvaluator.GetMissingNo();
+	result.counts = onlineEvaluator.GetCounts();
+
+	// Latency distribution
+	std::vector<double> sortedLatencies(latencies);
+	std::sort(sortedLatencies.begin(), sortedLatencies.end());
+	double total = 0.0;
+	for (auto latency : latencies) {
+		total += latency;
+	}
+	result.latencyMeanMs = total / latencies.size();
+	double squareTotal = 0.0;
+	for (auto latency : latencies) {
+		squareTotal += (latency - result.latencyMeanMs) * (latency - result.latencyMeanMs);
+	}
+	result.latencyStdDevMs = (latencies.size() > 1) ? std::sqrt(squareTotal / (latencies.size() - 1)) : 0.0;
+	result.latencyMinMs = sortedLatencies.front();
+	result.latencyP50Ms = Percentile(sortedLatencies, 50.0);
+	result.latencyP90Ms = Percentile(sortedLatencies, 90.0);
+	result.latencyP95Ms = Percentile(sortedLatencies, 95.0);
+	result.latencyP99Ms = Percentile(sortedLatencies, 99.0);
+	result.latencyMaxMs = sortedLatencies.back();
+	return true;
+}
+
+// Decode the input frames
+bool SequenceBenchmark::PreloadFrames(const std::string &datasetFolder, size_t maxFrameNo, std::vector<cv::Mat> &frames) {
+	frames.clear();
+	for (size_t frameIndex = 1; (maxFrameNo == 0) || (frameIndex <= maxFrameNo); frameIndex++) {
+		char s[25];
+		snprintf(s, sizeof(s), "/input/in%06d.jpg", int(frameIndex));
+		cv::Mat frame = cv::imread(datasetFolder + s, cv::IMREAD_COLOR);
+		if (frame.empty() || (!frames.empty() && (frame.size() != frames[0].size()))) {
+			break;
+		}
+		frames.push_back(frame);
+	}
+	return !frames.empty();
+}
+
+// Result of the last run
+const SequenceBenchmark::Result & SequenceBenchmark::GetResult() const {
+	return result;
+}
+
+// Per-frame Process latency of the last run
+const std::vector<double> & SequenceBenchmark::GetLatencies() const {
+	return latencies;
+}
+
+// Print a summary
+void SequenceBenchmark::PrintResult(std::ostream &output) const {
+	output << "\n<<<<<-SEQUENCE BENCHMARK->>>>>\n";
+	output << "DATASET: " << result.datasetFolder << " FRAMES: " << result.frameNo << " SIZE: "
+		<< result.frameSize.width << "x" << result.frameSize.height << std::endl;
+	if (!result.loaded) {
+		output << "No frames read" << std::endl;
+		return;
+	}
+	output << std::setprecision(2) << std::fixed;
+	output << "FPS: " << result.FPS << " (Process " << result.processSeconds << " s, Initialize " << result.initializeSeconds << " s)" << std::endl;
+	output << "LATENCY (MS): MEAN " << result.latencyMeanMs << " STDDEV " << result.latencyStdDevMs << " MIN " << result.latencyMinMs
+		<< " P50 " << result.latencyP50Ms << " P90 " << result.latencyP90Ms << " P95 " << result.latencyP95Ms
+		<< " P99 " << result.latencyP99Ms << " MAX " << result.latencyMaxMs << std::endl;
+	output << "PEAK RSS (MB): ";
+	if (result.peakRSSBytes >= 0) {
+		output << (result.peakRSSBytes / (1024 * 1024));
+	}
+	else {
+		output << "n/a";
+	}
+	output << " (frames " << (result.frameBytes / (1024 * 1024)) << ", model " << (result.modelBytes / (1024 * 1024)) << ")" << std::endl;
+	if ((result.evaluatedNo > 0) && (result.missingNo == 0)) {
+		PrintStatisticsSummary(output, result.counts);
+	}
+	else {
+		output << "Not evaluated: " << result.evaluatedNo << " frame(s) evaluated, groundtruth missing for "
+			<< result.missingNo << " frame(s)" << std::endl;
+	}
+}
+
+// Export the result and the per-frame latencies as JSON
+bool SequenceBenchmark::SaveJSON(const std::string &fileName) const {
+	std::ofstream jsonFile(fileName);
+	if (!jsonFile.is_open()) {
+		return false;
+	}
+	const EvaluationMetrics metrics(result.counts);
+	const bool evaluated = (result.evaluatedNo > 0) && (result.missingNo == 0);
+	jsonFile << std::setprecision(6);
+	jsonFile << "{\n  \"dataset\": " << JSONString(result.datasetFolder) << ",\n";
+	jsonFile << "  \"loaded\": " << (result.loaded ? "true" : "false") << ",\n";
+	jsonFile << "  \"width\": " << result.frameSize.width << ",\n  \"height\": " << result.frameSize.height << ",\n";
+	jsonFile << "  \"frames\": " << result.frameNo << ",\n";
+	jsonFile << "  \"parameters\": {\"words\": " << parameters.Words_No << ", \"desc_nb\": " << parameters.descNbNo
+		<< ", \"max_desc_nb\": " << LCDP_MAX_DESC_NB << ", \"scale\": " << parameters.processScale
+		<< ", \"pre\": " << (parameters.PreSwitch ? "true" : "false") << ", \"post\": " << (parameters.PostSwitch ? "true" : "false") << "},\n";
+	jsonFile << "  \"preload_s\": " << result.preloadSeconds << ",\n  \"initialize_s\": " << result.initializeSeconds
+		<< ",\n  \"process_s\": " << result.processSeconds << ",\n  \"fps\": " << result.FPS << ",\n";
+	jsonFile << "  \"latency_ms\": {\"mean\": " << result.latencyMeanMs << ", \"stddev\": " << result.latencyStdDevMs
+		<< ", \"min\": " << result.latencyMinMs << ", \"p50\": " << result.latencyP50Ms << ", \"p90\": " << result.latencyP90Ms
+		<< ", \"p95\": " << result.latencyP95Ms << ", \"p99\": " << result.latencyP99Ms << ", \"max\": " << result.latencyMaxMs << "},\n";
+	jsonFile << "  \"peak_rss_bytes\": " << result.peakRSSBytes << ",\n  \"frame_bytes\": " << result.frameBytes
+		<< ",\n  \"model_bytes\": " << result.modelBytes << ",\n";
+	jsonFile << "  \"evaluation\": {\"evaluated_frames\": " << result.evaluatedNo << ", \"missing_frames\": " << result.missingNo;
+	if (evaluated) {
+		jsonFile << ", \"TP\": " << result.counts.TP << ", \"FP\": " << result.counts.FP << ", \"TN\": " << result.counts.TN
+			<< ", \"FN\": " << result.counts.FN << ", \"recall\": " << metrics.recall << ", \"precision\": " << metrics.precision
+			<< ", \"f_measure\": " << metrics.FMeasure << ", \"pbc\": " << metrics.PBC;
+	}
+	jsonFile << "},\n  \"frame_latency_ms\": [";
+	for (size_t frameIndex = 0; frameIndex < latencies.size(); frameIndex++) {
+		jsonFile << ((frameIndex > 0) ? ", " : "") << latencies[frameIndex];
+	}
+	jsonFile << "]\n}\n";
+	return jsonFile.good();
+}
+
+// Peak resident set size of this process
+long long SequenceBenchmark::GetPeakRSS() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return (long long)counters.PeakWorkingSetSize;
+	}
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		// Kilobytes on Linux
+		return (long long)usage.ru_maxrss * 1024;
+	}
+#endif
+	return -1;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef __SequenceBenchmark_H_INCLUDED
+#define __SequenceBenchmark_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include "BatchRunner.h"
+#include "Evaluation.h"
+#include <vector>
+#include <string>
+#include <ostream>
+
+// End-to-end benchmark on a CDnet-style folder: '<folder>/input/in%06d.jpg' frames,
+// '<folder>/groundtruth/gt%06d.png' and '<folder>/temporalROI.txt'. Every frame is decoded
+// before the run, so the timings cover Process alone; the first frame initialises the model
+// and is processed as well, like in the runner. Masks are evaluated in memory between two
+// Process calls (not timed), so speed and accuracy come from the same run.
+class SequenceBenchmark {
+public:
+	// Result of one run
+	struct Result {
+		// Dataset folder
+		std::string datasetFolder;
+		bool loaded;
+		cv::Size frameSize;
+		// Total number of frames processed
+		size_t frameNo;
+		// Decoding of every frame (s) and memory held by the decoded frames (bytes)
+		double preloadSeconds;
+		size_t frameBytes;
+		// Time of Initialize and of every Process call (s)
+		double initializeSeconds;
+		double processSeconds;
+		// Frames per second of Process
+		double FPS;
+		// Per-frame Process latency (ms)
+		double latencyMeanMs;
+		double latencyStdDevMs;
+		double latencyMinMs;
+		double latencyP50Ms;
+		double latencyP90Ms;
+		double latencyP95Ms;
+		double latencyP99Ms;
+		double latencyMaxMs;
+		// Peak resident set size of the process, decoded frames included (bytes, -1: not available)
+		long long peakRSSBytes;
+		// Memory held by the model and its pixel LUTs (bytes)
+		size_t modelBytes;
+		// Total number of frames evaluated / missing groundtruth and their confusion matrix
+		size_t evaluatedNo;
+		size_t missingNo;
+		ConfusionCounts counts;
+	};
+
+	/*******CONSTRUCTOR*******/
+	// maxFrameNo: frames to run from the start of the sequence (0: every frame)
+	SequenceBenchmark(const LCDPParameters &inputParameters, size_t inputMaxFrameNo);
+
+	// Preload, process and evaluate one folder (RETURN-true: at least one frame was read)
+	bool Run(const std::string &datasetFolder);
+	// Result of the last run
+	const Result & GetResult() const;
+	// Per-frame Process latency of the last run (ms)
+	const std::vector<double> & GetLatencies() const;
+	// Print a summary
+	void PrintResult(std::ostream &output) const;
+	// Export the result and the per-frame latencies (RETURN-true: success)
+	bool SaveJSON(const std::string &fileName) const;
+	// Peak resident set size of this process (bytes, -1: not available)
+	static long long GetPeakRSS();
+	// Decode 'input/in%06d.jpg' from frame 1 until a file is missing or maxFrameNo is reached
+	// (0: every frame) (RETURN-true: at least one frame was read)
+	static bool PreloadFrames(const std::string &datasetFolder, size_t maxFrameNo, std::vector<cv::Mat> &frames);
+
+private:
+	/*=====BENCHMARK Parameters=====*/
+	const LCDPParameters parameters;
+	const size_t maxFrameNo;
+
+	Result result;
+	std::vector<double> latencies;
+};
+#endif
@@ -0,0 +1,186 @@
+#include "StorageBenchmark.h"
+#include "BackgroundSubtractorLCDP.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Words per pixel of the default model
+#define STORAGE_BENCH_WORDS_NO 35
+// Neighbour update spread (rows / columns)
+#define STORAGE_BENCH_NB_SPREAD 3
+
+/*******CONSTRUCTOR*******/
+StorageBenchmark::StorageBenchmark(size_t inputModelMegabytes, int inputPassNo, int inputFrameWidth, const std::string &inputFileName) :
+	/*=====BENCHMARK Parameters=====*/
+	modelMegabytes(inputModelMegabytes),
+	passNo(std::max(1, inputPassNo)),
+	frameWidth(std::max(2 * STORAGE_BENCH_NB_SPREAD + 1, inputFrameWidth)),
+	fileName(inputFileName),
+	// Words of the default 16-neighbour BGR model
+	wordSize(BackgroundSubtractorLCDP::GetWordSize(16, false)),
+	checksum(0)
+{
+}
+
+// Benchmark file and shared memory, then the heap with every page size
+void StorageBenchmark::Run() {
+	results.clear();
+	// A model larger than RAM can get the process killed on the heap, so the mapped backends go first
+	const ModelStorage::Backend backends[2] = { ModelStorage::STORAGE_FILE, ModelStorage::STORAGE_SHARED_MEMORY };
+	for (int backendIndex = 0; backendIndex < 2; backendIndex++) {
+		std::cout << "Benchmarking " << ModelStorage::GetBackendName(backends[backendIndex]) << " storage..." << std::endl;
+		results.push_back(RunBackend(backends[backendIndex], ModelStorage::PAGES_DEFAULT));
+	}
+	remove(fileName.c_str());
+	const ModelStorage::PageSize pageSizes[3] = { ModelStorage::PAGES_DEFAULT, ModelStorage::PAGES_TRANSPARENT_HUGE, ModelStorage::PAGES_HUGE };
+	for (int pageIndex = 0; pageIndex < 3; pageIndex++) {
+		std::cout << "Benchmarking heap storage with " << ModelStorage::GetPageSizeName(pageSizes[pageIndex]) << " pages..." << std::endl;
+		results.push_back(RunBackend(ModelStorage::STORAGE_HEAP, pageSizes[pageIndex]));
+	}
+}
+
+// Benchmark one backend
+StorageBenchmark::Result StorageBenchmark::RunBackend(ModelStorage::Backend backend, ModelStorage::PageSize pageSize) {
+	typedef std::chrono::steady_clock Clock;
+	Result result;
+	result.backend = backend;
+	result.pageSize = pageSize;
+	result.allocated = false;
+	result.reservedHugePages = false;
+	result.allocateSeconds = 0.0;
+	result.passSeconds = 0.0;
+	result.megabytesPerSecond = 0.0;
+	result.pixelsPerSecond = 0.0;
+	result.majorFaultNo = -1;
+
+	const size_t pixelBytes = STORAGE_BENCH_WORDS_NO * wordSize;
+	const size_t pixelNo = (modelMegabytes * 1024 * 1024) / pixelBytes;
+	if (pixelNo < size_t(frameWidth) * (2 * STORAGE_BENCH_NB_SPREAD + 1)) {
+		return result;
+	}
+#ifdef _WIN32
+	const std::string segmentName = "Local\\lcdp-storage-benchmark";
+#else
+	const std::string segmentName = "/lcdp-storage-benchmark";
+#endif
+	ModelStorage storage;
+	storage.SetPageSize(pageSize);
+	Clock::time_point startTime = Clock::now();
+	result.allocated = storage.Allocate(backend, pixelNo * pixelBytes,
+		(backend == ModelStorage::STORAGE_FILE) ? fileName : segmentName);
+	if (!result.allocated) {
+		return result;
+	}
+	result.reservedHugePages = storage.UsesReservedHugePages();
+	storage.Advise(ModelStorage::ACCESS_SEQUENTIAL, 0, storage.Size());
+	result.allocateSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+	unsigned int randomState = 12345;
+	// The first pass faults every page in, like the first frames after Initialize
+	checksum += ScanModel(storage.Data(), pixelNo, randomState);
+	const long long faultStart = GetMajorFaultNo();
+	startTime = Clock::now();
+	for (int passIndex = 0; passIndex < passNo; passIndex++) {
+		checksum += ScanModel(storage.Data(), pixelNo, randomState);
+	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	const long long faultEnd = GetMajorFaultNo();
+	result.passSeconds = seconds / passNo;
+	result.megabytesPerSecond = (seconds > 0.0) ? (double(storage.Size()) * passNo / (1024.0 * 1024.0) / seconds) : 0.0;
+	result.pixelsPerSecond = (seconds > 0.0) ? (double(pixelNo) * passNo / seconds) : 0.0;
+	result.majorFaultNo = ((faultStart >= 0) && (faultEnd >= 0)) ? (faultEnd - faultStart) : -1;
+	return result;
+}
+
+// One full pass over the model
+unsigned long long StorageBenchmark::ScanModel(unsigned char *model, size_t pixelNo, unsigned int &randomState) const {
+	const size_t pixelBytes = STORAGE_BENCH_WORDS_NO * wordSize;
+	const size_t spread = STORAGE_BENCH_NB_SPREAD;
+	unsigned long long checksum = 0;
+	for (size_t pxPointer = 0; pxPointer < pixelNo; pxPointer++) {
+		unsigned char * pixelModel = model + (pxPointer * pixelBytes);
+		// Matching reads every word of the pixel
+		for (size_t wordIndex = 0; wordIndex < STORAGE_BENCH_WORDS_NO; wordIndex++) {
+			const unsigned char * word = pixelModel + (wordIndex * wordSize);
+			for (size_t byteIndex = 0; byteIndex < wordSize; byteIndex += 8) {
+				unsigned long long value = 0;
+				memcpy(&value, word + byteIndex, std::min(sizeof(value), wordSize - byteIndex));
+				checksum += value;
+			}
+		}
+		// Updating the matched word
+		pixelModel[0]++;
+		// Random neighbour update (about one pixel in 16)
+		randomState = randomState * 1664525u + 1013904223u;
+		if ((randomState >> 28) == 0) {
+			const size_t row = pxPointer / frameWidth;
+			const size_t col = pxPointer % frameWidth;
+			const size_t nbRow = std::min(pixelNo / frameWidth - 1, std::max(spread, row) + ((randomState >> 4) % (2 * spread + 1)) - spread);
+			const size_t nbCol = std::min(size_t(frameWidth) - 1, std::max(spread, col) + ((randomState >> 8) % (2 * spread + 1)) - spread);
+			const size_t nbWord = (randomState >> 12) % STORAGE_BENCH_WORDS_NO;
+			model[((nbRow * frameWidth) + nbCol) * pixelBytes + (nbWord * wordSize)]++;
+		}
+	}
+	return checksum;
+}
+
+// Page faults that needed I/O so far
+long long StorageBenchmark::GetMajorFaultNo() {
+#ifndef _WIN32
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		return (long long)usage.ru_majflt;
+	}
+#endif
+	return -1;
+}
+
+// Per-backend results
+const std::vector<StorageBenchmark::Result> & StorageBenchmark::GetResults() const {
+	return results;
+}
+
+// Print a result table
+void StorageBenchmark::PrintResults(std::ostream &output) const {
+	output << "\n<<<<<-MODEL STORAGE BENCHMARK->>>>>\n";
+	output << "MODEL SIZE (MB): " << modelMegabytes << " PASSES: " << passNo << " FRAME WIDTH: " << frameWidth << std::endl;
+	output << std::left << std::setw(8) << "BACKEND" << std::setw(9) << "PAGES" << std::right << std::setw(12) << "ALLOC(S)" << std::setw(12) << "PASS(S)"
+		<< std::setw(12) << "MB/S" << std::setw(14) << "MPIXELS/S" << std::setw(14) << "MAJOR FAULTS" << std::endl;
+	for (auto & result : results) {
+		// A huge page request that fell back to transparent huge pages is marked with '*'
+		const std::string pageName = std::string(ModelStorage::GetPageSizeName(result.pageSize)) +
+			(((result.pageSize == ModelStorage::PAGES_HUGE) && result.allocated && !result.reservedHugePages) ? "*" : "");
+		output << std::left << std::setw(8) << ModelStorage::GetBackendName(result.backend) << std::setw(9) << pageName << std::right;
+		if (!result.allocated) {
+			output << "  cannot allocate" << std::endl;
+			continue;
+		}
+		output << std::setprecision(3) << std::fixed << std::setw(12) << result.allocateSeconds
+			<< std::setw(12) << result.passSeconds << std::setprecision(1) << std::setw(12) << result.megabytesPerSecond
+			<< std::setprecision(3) << std::setw(14) << (result.pixelsPerSecond / 1e6) << std::setw(14) << result.majorFaultNo << std::endl;
+	}
+	output << "* no reserved huge pages, transparent huge pages used" << std::endl;
+}
+
+// Export the results as CSV
+bool StorageBenchmark::SaveCSV(const std::string &csvFileName) const {
+	std::ofstream csvFile(csvFileName);
+	if (!csvFile.is_open()) {
+		return false;
+	}
+	csvFile << "backend,pages,reserved_huge_pages,model_mb,passes,allocated,allocate_s,pass_s,mb_per_s,pixels_per_s,major_faults" << std::endl;
+	for (auto & result : results) {
+		csvFile << ModelStorage::GetBackendName(result.backend) << "," << ModelStorage::GetPageSizeName(result.pageSize) << ","
+			<< (result.reservedHugePages ? 1 : 0) << "," << modelMegabytes << "," << passNo << ","
+			<< (result.allocated ? 1 : 0) << "," << result.allocateSeconds << "," << result.passSeconds << ","
+			<< result.megabytesPerSecond << "," << result.pixelsPerSecond << "," << result.majorFaultNo << std::endl;
+	}
+	return csvFile.good();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#ifndef __StorageBenchmark_H_INCLUDED
+#define __StorageBenchmark_H_INCLUDED
+#include "ModelStorage.h"
+#include <vector>
+#include <string>
+#include <ostream>
+
+// Model storage throughput under Process's access pattern: pixels are visited in row-major
+// order, every word of the pixel is read, the first word is updated and every 16th pixel
+// also updates a random neighbour's word up to 3 rows away. Run with a model larger than
+// RAM to compare the heap (paged to swap, or killed) with a mapped file (paged to the file).
+// The heap is measured with default, transparent huge and reserved huge pages, which shows
+// the TLB cost of the scattered neighbour updates. The file and shared-memory backends run
+// first, so a heap run that exhausts memory cannot take their results down with it.
+class StorageBenchmark {
+public:
+	// Result of one backend
+	struct Result {
+		ModelStorage::Backend backend;
+		// Requested page size (heap only)
+		ModelStorage::PageSize pageSize;
+		bool allocated;
+		// Reserved huge pages were obtained
+		bool reservedHugePages;
+		// Time to allocate and zero the model (s)
+		double allocateSeconds;
+		// Mean time of one full pass over the model (s)
+		double passSeconds;
+		// Model bytes scanned per second
+		double megabytesPerSecond;
+		// Pixels per second (a 4K frame has 8.3M pixels)
+		double pixelsPerSecond;
+		// Page faults that needed I/O during the passes (-1: not available)
+		long long majorFaultNo;
+	};
+
+	/*******CONSTRUCTOR*******/
+	// fileName: backing file of the FILE backend; the segment name is derived from it
+	StorageBenchmark(size_t inputModelMegabytes, int inputPassNo, int inputFrameWidth, const std::string &inputFileName);
+
+	// Benchmark file and shared memory, then the heap with every page size
+	void Run();
+	// Per-backend results
+	const std::vector<Result> & GetResults() const;
+	// Print a result table
+	void PrintResults(std::ostream &output) const;
+	// Export the results (RETURN-true: success)
+	bool SaveCSV(const std::string &fileName) const;
+
+private:
+	// Benchmark one backend
+	Result RunBackend(ModelStorage::Backend backend, ModelStorage::PageSize pageSize);
+	// One full pass over the model (RETURN-checksum, so the reads are not optimised away)
+	unsigned long long ScanModel(unsigned char *model, size_t pixelNo, unsigned int &randomState) const;
+	// Page faults that needed I/O so far
+	static long long GetMajorFaultNo();
+
+	/*=====BENCHMARK Parameters=====*/
+	const size_t modelMegabytes;
+	const int passNo;
+	// Pixels per row
+	const int frameWidth;
+	const std::string fileName;
+	// Bytes per word of the subtractor's model
+	const size_t wordSize;
+
+	std::vector<Result> results;
+	// Sum of everything read, so the reads are not optimised away
+	unsigned long long checksum;
+};
+#endif
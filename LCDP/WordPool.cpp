@@ -0,0 +1,93 @@
+#include "WordPool.h"
+#include <algorithm>
+
+/*******CONSTRUCTOR*******/
+WordPool::WordPool() :
+	/*=====POOL Parameters=====*/
+	capacityStep(1),
+	maxCapacity(1),
+	totalWords(0),
+	topWord(0),
+
+	/*=====STATISTICS=====*/
+	usedWords(0),
+	failedNo(0)
+{
+}
+
+// Empty the pool and set its shape
+void WordPool::Reset(size_t inputCapacityStep, size_t inputMaxCapacity, size_t inputTotalWords) {
+	maxCapacity = std::max(size_t(1), inputMaxCapacity);
+	capacityStep = std::min(maxCapacity, std::max(size_t(1), inputCapacityStep));
+	totalWords = inputTotalWords;
+	topWord = 0;
+	usedWords = 0;
+	failedNo = 0;
+	freeBlocks.assign(ClassIndex(maxCapacity) + 1, std::vector<size_t>());
+}
+
+// Capacity of the size class holding 'capacity' words
+size_t WordPool::ClassCapacity(size_t capacity) const {
+	const size_t classCapacity = ((std::max(size_t(1), capacity) + capacityStep - 1) / capacityStep) * capacityStep;
+	return std::min(maxCapacity, classCapacity);
+}
+
+// Capacity of the next smaller size class
+size_t WordPool::SmallerCapacity(size_t capacity) const {
+	capacity = ClassCapacity(capacity);
+	if (capacity <= capacityStep) {
+		return capacity;
+	}
+	// The last class may not be a multiple of the step
+	return ((capacity - 1) / capacityStep) * capacityStep;
+}
+
+// Capacity of the next larger size class
+size_t WordPool::LargerCapacity(size_t capacity) const {
+	return ClassCapacity(ClassCapacity(capacity) + 1);
+}
+
+// Allocate a block of a class capacity
+bool WordPool::Allocate(size_t capacity, size_t &offset) {
+	std::vector<size_t> &classFreeBlocks = freeBlocks[ClassIndex(capacity)];
+	if (!classFreeBlocks.empty()) {
+		offset = classFreeBlocks.back();
+		classFreeBlocks.pop_back();
+	}
+	else if (topWord + capacity <= totalWords) {
+		offset = topWord;
+		topWord += capacity;
+	}
+	else {
+		failedNo++;
+		return false;
+	}
+	usedWords += capacity;
+	return true;
+}
+
+// Return a block to its free list
+void WordPool::Free(size_t offset, size_t capacity) {
+	freeBlocks[ClassIndex(capacity)].push_back(offset);
+	usedWords -= capacity;
+}
+
+// Size class index of a class capacity
+size_t WordPool::ClassIndex(size_t capacity) const {
+	return (capacity + capacityStep - 1) / capacityStep - 1;
+}
+
+// Words in allocated blocks
+size_t WordPool::GetUsedWords() const {
+	return usedWords;
+}
+
+// Size of the arena (words)
+size_t WordPool::GetTotalWords() const {
+	return totalWords;
+}
+
+// Total number of allocations refused by the budget
+size_t WordPool::GetFailedNo() const {
+	return failedNo;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef __WordPool_H_INCLUDED
+#define __WordPool_H_INCLUDED
+#include <vector>
+#include <cstddef>
+
+// Allocator of per-pixel word blocks inside one arena (offsets and sizes in words, so it
+// works with any word layout). Block capacities are rounded up to size classes of
+// 'capacityStep' words (the last class is 'maxCapacity'); every class keeps a free list
+// and new blocks are carved from the top of the arena. The arena size is the memory
+// budget: an allocation fails instead of growing it.
+class WordPool {
+public:
+	/*******CONSTRUCTOR*******/
+	WordPool();
+
+	// Empty the pool and set its shape
+	void Reset(size_t inputCapacityStep, size_t inputMaxCapacity, size_t inputTotalWords);
+	// Capacity of the size class holding 'capacity' words
+	size_t ClassCapacity(size_t capacity) const;
+	// Capacity of the next smaller / larger size class (the same class at the ends)
+	size_t SmallerCapacity(size_t capacity) const;
+	size_t LargerCapacity(size_t capacity) const;
+	// Allocate a block of a class capacity (RETURN-true: offset set)
+	bool Allocate(size_t capacity, size_t &offset);
+	// Return a block of a class capacity to its free list
+	void Free(size_t offset, size_t capacity);
+
+	// Words in allocated blocks
+	size_t GetUsedWords() const;
+	// Size of the arena (words)
+	size_t GetTotalWords() const;
+	// Total number of allocations refused by the budget
+	size_t GetFailedNo() const;
+
+private:
+	// Size class index of a class capacity
+	size_t ClassIndex(size_t capacity) const;
+
+	/*=====POOL Parameters=====*/
+	size_t capacityStep;
+	size_t maxCapacity;
+	size_t totalWords;
+	// First word never handed out
+	size_t topWord;
+	// Free block offsets per size class
+	std::vector<std::vector<size_t>> freeBlocks;
+
+	/*=====STATISTICS=====*/
+	size_t usedWords;
+	size_t failedNo;
+};
+#endif
@@ -1,35 +1,683 @@
+// LCDP background subtraction runner (LCDP.vcxproj on Windows). On Linux, from this folder:
+// g++ -std=c++14 -O2 *.cpp $(pkg-config --cflags --libs opencv) -pthread -lrt -o LCDP
 #include <iostream>
-#include <direct.h>
-#include <opencv2\opencv.hpp>
+#include <opencv2/opencv.hpp>
 #include "BackgroundSubtractorLCDP.h"
 #include "Functions.h"
 #include <time.h>
 #include <fstream>
 #include <iomanip>
-#include <conio.h>
-#include <windows.h>
 #include <vector>
 #include <bitset>
+#include <memory>
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include "BatchRunner.h"
+#include "OfflineEvaluator.h"
+#include "StorageBenchmark.h"
+#include "SequenceBenchmark.h"
+#include "RegressionSuite.h"
+#include "MultiStreamEngine.h"
 
-int main() {
+// Capacity of each queue between the decode, subtract and output stages
+#define PIPELINE_QUEUE_SIZE 8
+
+// List of video file name
+static const std::vector<std::string> filenames = {
+	"badminton","boulevard","bungalows",
+	"canoe","copyMachine","cubicle",
+	"fall","fountain02","PETS2006",
+	"sidewalk","sofa","wetSnow"
+};
+
+// Offline evaluation mode:
+// LCDP --evaluate [--threads N] [--output table.csv] <datasetFolder> <resultFolder> [<datasetFolder> <resultFolder>]...
+static int RunEvaluateCommand(int argc, char *argv[]) {
+	size_t threadNo = 0;
+	std::string tableFileName;
+	std::vector<std::string> folders;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--threads") && (argIndex + 1 < argc)) {
+			threadNo = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--output") && (argIndex + 1 < argc)) {
+			tableFileName = argv[++argIndex];
+		}
+		else {
+			folders.push_back(arg);
+		}
+	}
+	if (folders.empty() || (folders.size() % 2 != 0)) {
+		std::cout << "Usage: " << argv[0] << " --evaluate [--threads N] [--output table.csv] "
+			<< "<datasetFolder> <resultFolder> [<datasetFolder> <resultFolder>]..." << std::endl;
+		return -1;
+	}
+	OfflineEvaluator offlineEvaluator(threadNo);
+	for (size_t folderIndex = 0; folderIndex < folders.size(); folderIndex += 2) {
+		offlineEvaluator.AddSequence("", folders[folderIndex], folders[folderIndex + 1]);
+	}
+	offlineEvaluator.Run();
+	for (auto & result : offlineEvaluator.GetResults()) {
+		if (!result.missingGroundtruth.empty() || !result.missingResult.empty()) {
+			std::cout << result.name << ": " << result.missingGroundtruth.size() << " groundtruth and "
+				<< result.missingResult.size() << " result frame(s) missing" << std::endl;
+		}
+	}
+	offlineEvaluator.WriteTable(std::cout, false);
+	if (!tableFileName.empty() && !offlineEvaluator.SaveTable(tableFileName)) {
+		std::cout << "Cannot write metrics table: " << tableFileName << std::endl;
+		return -1;
+	}
+	return offlineEvaluator.IsComplete() ? 0 : 1;
+}
+
+// Headless batch mode (no prompts, no windows):
+// LCDP --run [--jobs N] [--cores N] [--save] [--profile] [--budget MS] [--checkpoint N] [--resume] [--storage heap|file|shm] [--scale 1|2|4] [--gate BLOCK] [--gate-threshold T] [--gate-interval N] [--adaptive-model MB] [--pages default|thp|huge] [--numa] [--desc-nb 8|16|24] [--no-evaluate] [--report report.csv] [--job-file jobs.txt] [<dataset>|all]...
+static int RunBatchCommand(int argc, char *argv[]) {
+	size_t jobNo = 0;
+	size_t coreBudget = 0;
+	bool numaPinning = false;
+	LCDPParameters parameters;
+	DatasetOptions options;
+	// One encoder per dataset; the datasets themselves run in parallel
+	options.saveEncoderNo = 1;
+	options.queueCapacity = PIPELINE_QUEUE_SIZE;
+	std::string reportFileName;
+	std::vector<std::string> datasetNames;
+	std::vector<std::string> jobFileNames;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--jobs") && (argIndex + 1 < argc)) {
+			jobNo = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--cores") && (argIndex + 1 < argc)) {
+			coreBudget = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if (arg == "--save") {
+			options.saveResult = true;
+		}
+		else if (arg == "--profile") {
+			options.profile = true;
+		}
+		else if ((arg == "--budget") && (argIndex + 1 < argc)) {
+			options.latencyBudgetMs = std::max(0.0, atof(argv[++argIndex]));
+		}
+		else if ((arg == "--checkpoint") && (argIndex + 1 < argc)) {
+			options.checkpointInterval = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if (arg == "--resume") {
+			options.resumeCheckpoint = true;
+		}
+		else if ((arg == "--storage") && (argIndex + 1 < argc)) {
+			if (!ModelStorage::ParseBackend(argv[++argIndex], options.modelStorage)) {
+				std::cout << "Unknown model storage: " << argv[argIndex] << std::endl;
+				return -1;
+			}
+		}
+		else if ((arg == "--scale") && (argIndex + 1 < argc)) {
+			parameters.processScale = std::max(1, atoi(argv[++argIndex]));
+		}
+		else if ((arg == "--gate") && (argIndex + 1 < argc)) {
+			options.changeGateBlockSize = std::max(0, atoi(argv[++argIndex]));
+		}
+		else if ((arg == "--gate-threshold") && (argIndex + 1 < argc)) {
+			options.changeGateThreshold = float(std::max(0.0, atof(argv[++argIndex])));
+		}
+		else if ((arg == "--gate-interval") && (argIndex + 1 < argc)) {
+			options.changeGateInterval = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--adaptive-model") && (argIndex + 1 < argc)) {
+			// Memory budget in MB (0: no budget)
+			options.adaptiveModel = true;
+			options.adaptiveModelBudgetMB = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--desc-nb") && (argIndex + 1 < argc)) {
+			parameters.descNbNo = atoi(argv[++argIndex]);
+			if (((parameters.descNbNo % 8) != 0) || (parameters.descNbNo < 8) || (parameters.descNbNo > LCDP_MAX_DESC_NB)) {
+				std::cout << "Unsupported descriptor neighbourhood: " << argv[argIndex] << std::endl;
+				return -1;
+			}
+		}
+		else if ((arg == "--pages") && (argIndex + 1 < argc)) {
+			if (!ModelStorage::ParsePageSize(argv[++argIndex], options.pageSize)) {
+				std::cout << "Unknown page size: " << argv[argIndex] << std::endl;
+				return -1;
+			}
+		}
+		else if (arg == "--numa") {
+			numaPinning = true;
+		}
+		else if (arg == "--no-evaluate") {
+			options.evaluateResult = false;
+		}
+		else if ((arg == "--report") && (argIndex + 1 < argc)) {
+			reportFileName = argv[++argIndex];
+		}
+		else if ((arg == "--job-file") && (argIndex + 1 < argc)) {
+			jobFileNames.push_back(argv[++argIndex]);
+		}
+		else if (arg == "all") {
+			datasetNames.insert(datasetNames.end(), filenames.begin(), filenames.end());
+		}
+		else {
+			datasetNames.push_back(arg);
+		}
+	}
+	BatchRunner batchRunner(coreBudget, jobNo);
+	batchRunner.SetNumaPinning(numaPinning);
+	for (auto & jobFileName : jobFileNames) {
+		if (!batchRunner.ReadJobFile(jobFileName)) {
+			std::cout << "Cannot read job file: " << jobFileName << std::endl;
+			return -1;
+		}
+	}
+	for (auto & datasetName : datasetNames) {
+		batchRunner.AddDataset(datasetName);
+	}
+	if (datasetNames.empty() && jobFileNames.empty()) {
+		std::cout << "Usage: " << argv[0] << " --run [--jobs N] [--cores N] [--save] [--profile] [--budget MS] [--checkpoint N] [--resume] [--storage heap|file|shm] [--scale 1|2|4] "
+			<< "[--gate BLOCK] [--gate-threshold T] [--gate-interval N] [--adaptive-model MB] [--pages default|thp|huge] [--numa] [--desc-nb 8|16|24] [--no-evaluate] [--report report.csv] [--job-file jobs.txt] [<dataset>|all]..." << std::endl;
+		return -1;
+	}
+	std::cout << "Program Version: " << programVersion << std::endl;
+	const bool allCompleted = batchRunner.Run(parameters, options);
+	std::cout << "\n<<<<<-BATCH REPORT->>>>>\n";
+	batchRunner.WriteReport(std::cout, false);
+	if (reportFileName.empty()) {
+		time_t now = time(0);
+		reportFileName = "batch-" + currentDateTimeStamp(&now) + ".csv";
+	}
+	if (!batchRunner.SaveReport(reportFileName)) {
+		std::cout << "Cannot write batch report: " << reportFileName << std::endl;
+		return -1;
+	}
+	std::cout << "Batch report saved to " << reportFileName << std::endl;
+	return allCompleted ? 0 : 1;
+}
+
+// Reduced-resolution accuracy report: every dataset runs at full resolution and at each
+// scale in turn (one at a time, so the timings are comparable) and is evaluated in memory:
+// LCDP --compare-scales [--scales 2,4] [--output scales.csv] [<dataset>|all]...
+static int RunCompareScalesCommand(int argc, char *argv[]) {
+	std::vector<int> scales = { 1, 2, 4 };
+	std::string outputFileName;
+	std::vector<std::string> datasetNames;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--scales") && (argIndex + 1 < argc)) {
+			scales.assign(1, 1);
+			std::stringstream scaleList(argv[++argIndex]);
+			std::string scale;
+			while (std::getline(scaleList, scale, ',')) {
+				if (atoi(scale.c_str()) > 1) {
+					scales.push_back(atoi(scale.c_str()));
+				}
+			}
+		}
+		else if ((arg == "--output") && (argIndex + 1 < argc)) {
+			outputFileName = argv[++argIndex];
+		}
+		else if (arg == "all") {
+			datasetNames.insert(datasetNames.end(), filenames.begin(), filenames.end());
+		}
+		else {
+			datasetNames.push_back(arg);
+		}
+	}
+	if (datasetNames.empty()) {
+		std::cout << "Usage: " << argv[0] << " --compare-scales [--scales 2,4] [--output scales.csv] [<dataset>|all]..." << std::endl;
+		return -1;
+	}
+	DatasetOptions options;
+	options.queueCapacity = PIPELINE_QUEUE_SIZE;
+	std::vector<DatasetReport> reports;
+	for (auto & datasetName : datasetNames) {
+		for (auto scale : scales) {
+			LCDPParameters parameters;
+			parameters.processScale = scale;
+			reports.push_back(DatasetReport());
+			RunDataset(datasetName, parameters, options, reports.back());
+		}
+	}
+	std::cout << "\n<<<<<-REDUCED RESOLUTION ACCURACY->>>>>\n";
+	WriteScaleComparison(std::cout, reports, false);
+	if (!outputFileName.empty()) {
+		std::ofstream outputFile(outputFileName);
+		WriteScaleComparison(outputFile, reports, true);
+		if (!outputFile.good()) {
+			std::cout << "Cannot write scale comparison: " << outputFileName << std::endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// Descriptor neighbourhood report: every dataset runs with each neighbourhood the build
+// supports (8, 16, 24 up to LCDP_MAX_DESC_NB) in turn and is evaluated in memory:
+// LCDP --compare-descriptors [--output descriptors.csv] [<dataset>|all]...
+static int RunCompareDescriptorsCommand(int argc, char *argv[]) {
+	std::string outputFileName;
+	std::vector<std::string> datasetNames;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--output") && (argIndex + 1 < argc)) {
+			outputFileName = argv[++argIndex];
+		}
+		else if (arg == "all") {
+			datasetNames.insert(datasetNames.end(), filenames.begin(), filenames.end());
+		}
+		else {
+			datasetNames.push_back(arg);
+		}
+	}
+	if (datasetNames.empty()) {
+		std::cout << "Usage: " << argv[0] << " --compare-descriptors [--output descriptors.csv] [<dataset>|all]..." << std::endl;
+		return -1;
+	}
+	DatasetOptions options;
+	options.queueCapacity = PIPELINE_QUEUE_SIZE;
+	std::vector<DatasetReport> reports;
+	for (auto & datasetName : datasetNames) {
+		for (int descNbNo = 8; descNbNo <= LCDP_MAX_DESC_NB; descNbNo += 8) {
+			LCDPParameters parameters;
+			parameters.descNbNo = descNbNo;
+			reports.push_back(DatasetReport());
+			RunDataset(datasetName, parameters, options, reports.back());
+		}
+	}
+	std::cout << "\n<<<<<-DESCRIPTOR NEIGHBOURHOOD ACCURACY->>>>>\n";
+	WriteDescriptorComparison(std::cout, reports, false);
+	if (!outputFileName.empty()) {
+		std::ofstream outputFile(outputFileName);
+		WriteDescriptorComparison(outputFile, reports, true);
+		if (!outputFile.good()) {
+			std::cout << "Cannot write descriptor comparison: " << outputFileName << std::endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// NUMA placement report: the batch runs twice with the same jobs, first unpinned, then with
+// every worker pinned to a node (datasets are not evaluated, only timed):
+// LCDP --compare-numa [--jobs N] [--cores N] [--pages default|thp|huge] [--output numa.csv] [<dataset>|all]...
+static int RunCompareNumaCommand(int argc, char *argv[]) {
+	size_t jobNo = 0;
+	size_t coreBudget = 0;
+	std::string outputFileName;
+	std::vector<std::string> datasetNames;
+	LCDPParameters parameters;
+	DatasetOptions options;
+	options.saveEncoderNo = 1;
+	options.queueCapacity = PIPELINE_QUEUE_SIZE;
+	options.evaluateResult = false;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--jobs") && (argIndex + 1 < argc)) {
+			jobNo = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--cores") && (argIndex + 1 < argc)) {
+			coreBudget = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--pages") && (argIndex + 1 < argc)) {
+			if (!ModelStorage::ParsePageSize(argv[++argIndex], options.pageSize)) {
+				std::cout << "Unknown page size: " << argv[argIndex] << std::endl;
+				return -1;
+			}
+		}
+		else if ((arg == "--output") && (argIndex + 1 < argc)) {
+			outputFileName = argv[++argIndex];
+		}
+		else if (arg == "all") {
+			datasetNames.insert(datasetNames.end(), filenames.begin(), filenames.end());
+		}
+		else {
+			datasetNames.push_back(arg);
+		}
+	}
+	if (datasetNames.empty()) {
+		std::cout << "Usage: " << argv[0] << " --compare-numa [--jobs N] [--cores N] [--pages default|thp|huge] [--output numa.csv] [<dataset>|all]..." << std::endl;
+		return -1;
+	}
+	if (GetNumaNodeNo() < 2) {
+		std::cout << "Only one NUMA node: both runs place the memory the same way" << std::endl;
+	}
+	std::vector<DatasetReport> reports[2];
+	double wallSeconds[2];
+	for (int pinnedIndex = 0; pinnedIndex < 2; pinnedIndex++) {
+		BatchRunner batchRunner(coreBudget, jobNo);
+		batchRunner.SetNumaPinning(pinnedIndex == 1);
+		for (auto & datasetName : datasetNames) {
+			batchRunner.AddDataset(datasetName);
+		}
+		batchRunner.Run(parameters, options);
+		reports[pinnedIndex] = batchRunner.GetReports();
+		wallSeconds[pinnedIndex] = batchRunner.GetWallSeconds();
+	}
+	std::cout << "\n<<<<<-NUMA PLACEMENT THROUGHPUT->>>>>\n";
+	WriteNumaComparison(std::cout, reports[0], wallSeconds[0], reports[1], wallSeconds[1], false);
+	if (!outputFileName.empty()) {
+		std::ofstream outputFile(outputFileName);
+		WriteNumaComparison(outputFile, reports[0], wallSeconds[0], reports[1], wallSeconds[1], true);
+		if (!outputFile.good()) {
+			std::cout << "Cannot write NUMA comparison: " << outputFileName << std::endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// Model storage benchmark (heap / mapped file / shared memory):
+// LCDP --bench-storage [--size-mb N] [--passes N] [--width N] [--file model.bench] [--output storage.csv]
+static int RunStorageBenchmarkCommand(int argc, char *argv[]) {
+	size_t modelMegabytes = 1024;
+	int passNo = 3;
+	int frameWidth = 3840;
+	std::string fileName = "model.bench";
+	std::string outputFileName;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--size-mb") && (argIndex + 1 < argc)) {
+			modelMegabytes = size_t(std::max(1, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--passes") && (argIndex + 1 < argc)) {
+			passNo = atoi(argv[++argIndex]);
+		}
+		else if ((arg == "--width") && (argIndex + 1 < argc)) {
+			frameWidth = atoi(argv[++argIndex]);
+		}
+		else if ((arg == "--file") && (argIndex + 1 < argc)) {
+			fileName = argv[++argIndex];
+		}
+		else if ((arg == "--output") && (argIndex + 1 < argc)) {
+			outputFileName = argv[++argIndex];
+		}
+		else {
+			std::cout << "Usage: " << argv[0] << " --bench-storage [--size-mb N] [--passes N] [--width N] "
+				<< "[--file model.bench] [--output storage.csv]" << std::endl;
+			return -1;
+		}
+	}
+	StorageBenchmark storageBenchmark(modelMegabytes, passNo, frameWidth, fileName);
+	storageBenchmark.Run();
+	storageBenchmark.PrintResults(std::cout);
+	if (!outputFileName.empty() && !storageBenchmark.SaveCSV(outputFileName)) {
+		std::cout << "Cannot write benchmark results: " << outputFileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+// End-to-end benchmark on a CDnet-style folder ('input/in%06d.jpg', groundtruth, temporalROI.txt):
+// frames are preloaded, then FPS, Process latency, peak RSS and F-measure come from one run:
+// LCDP --bench-sequence [--frames N] [--scale 1|2|4] [--desc-nb 8|16|24] [--output bench.json] <datasetFolder>
+static int RunSequenceBenchmarkCommand(int argc, char *argv[]) {
+	LCDPParameters parameters;
+	size_t maxFrameNo = 0;
+	std::string outputFileName;
+	std::string datasetFolder;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--frames") && (argIndex + 1 < argc)) {
+			maxFrameNo = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--scale") && (argIndex + 1 < argc)) {
+			parameters.processScale = std::max(1, atoi(argv[++argIndex]));
+		}
+		else if ((arg == "--desc-nb") && (argIndex + 1 < argc)) {
+			parameters.descNbNo = atoi(argv[++argIndex]);
+			if (((parameters.descNbNo % 8) != 0) || (parameters.descNbNo < 8) || (parameters.descNbNo > LCDP_MAX_DESC_NB)) {
+				std::cout << "Unsupported descriptor neighbourhood: " << argv[argIndex] << std::endl;
+				return -1;
+			}
+		}
+		else if ((arg == "--output") && (argIndex + 1 < argc)) {
+			outputFileName = argv[++argIndex];
+		}
+		else if (datasetFolder.empty() && (arg.compare(0, 2, "--") != 0)) {
+			datasetFolder = arg;
+		}
+		else {
+			datasetFolder.clear();
+			break;
+		}
+	}
+	if (datasetFolder.empty()) {
+		std::cout << "Usage: " << argv[0] << " --bench-sequence [--frames N] [--scale 1|2|4] [--desc-nb 8|16|24] "
+			<< "[--output bench.json] <datasetFolder>" << std::endl;
+		return -1;
+	}
+	SequenceBenchmark sequenceBenchmark(parameters, maxFrameNo);
+	if (!sequenceBenchmark.Run(datasetFolder)) {
+		return -1;
+	}
+	sequenceBenchmark.PrintResult(std::cout);
+	if (!outputFileName.empty() && !sequenceBenchmark.SaveJSON(outputFileName)) {
+		std::cout << "Cannot write benchmark results: " << outputFileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+// Accuracy guard of the performance modes: the reference path and every variant run on the
+// same frames with a fixed seed; exact variants must match the reference masks bit for bit,
+// approximate ones must stay within their F-measure / PBC band (exit code 1 on a failure):
+// LCDP --regression [--frames N] [--seed N] [--variant NAME]... [--output regression.csv] <datasetFolder>...
+static int RunRegressionCommand(int argc, char *argv[]) {
+	size_t maxFrameNo = 0;
+	unsigned int seed = 12345;
+	std::vector<std::string> variantNames;
+	std::string outputFileName;
+	std::vector<std::string> datasetFolders;
+	bool validArgs = true;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--frames") && (argIndex + 1 < argc)) {
+			maxFrameNo = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--seed") && (argIndex + 1 < argc)) {
+			seed = unsigned(std::max(1, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--variant") && (argIndex + 1 < argc)) {
+			variantNames.push_back(argv[++argIndex]);
+		}
+		else if ((arg == "--output") && (argIndex + 1 < argc)) {
+			outputFileName = argv[++argIndex];
+		}
+		else if (arg.compare(0, 2, "--") != 0) {
+			datasetFolders.push_back(arg);
+		}
+		else {
+			validArgs = false;
+		}
+	}
+	RegressionSuite regressionSuite(seed, maxFrameNo);
+	const std::vector<RegressionSuite::Variant> defaultVariants = RegressionSuite::DefaultVariants();
+	for (auto & variantName : variantNames) {
+		auto variant = std::find_if(defaultVariants.begin(), defaultVariants.end(),
+			[&](const RegressionSuite::Variant &defaultVariant) { return defaultVariant.name == variantName; });
+		if (variant == defaultVariants.end()) {
+			std::cout << "Unknown variant: " << variantName << std::endl;
+			validArgs = false;
+			continue;
+		}
+		regressionSuite.AddVariant(*variant);
+	}
+	if (!validArgs || datasetFolders.empty()) {
+		std::cout << "Usage: " << argv[0] << " --regression [--frames N] [--seed N] [--variant NAME]... "
+			<< "[--output regression.csv] <datasetFolder>..." << std::endl;
+		std::cout << "Variants:";
+		for (auto & variant : defaultVariants) {
+			std::cout << " " << variant.name;
+		}
+		std::cout << std::endl;
+		return -1;
+	}
+	const bool allPassed = regressionSuite.Run(datasetFolders);
+	regressionSuite.PrintResults(std::cout);
+	if (!outputFileName.empty() && !regressionSuite.SaveCSV(outputFileName)) {
+		std::cout << "Cannot write regression results: " << outputFileName << std::endl;
+		return -1;
+	}
+	return allPassed ? 0 : 1;
+}
+
+// Multi-stream check: every sequence is first run alone, then N streams (cycling over the
+// sequences) run together on one MultiStreamEngine worker pool with the same seed; each
+// stream's masks must equal its sequence's single-stream masks (exit code 1 on a mismatch):
+// LCDP --multi-stream [--streams N] [--workers N] [--frames N] [--seed N] <datasetFolder>...
+static int RunMultiStreamCommand(int argc, char *argv[]) {
+	size_t streamNo = 4;
+	size_t workerNo = 0;
+	size_t maxFrameNo = 0;
+	unsigned int seed = 12345;
+	std::vector<std::string> datasetFolders;
+	bool validArgs = true;
+	for (int argIndex = 2; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		if ((arg == "--streams") && (argIndex + 1 < argc)) {
+			streamNo = size_t(std::max(1, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--workers") && (argIndex + 1 < argc)) {
+			workerNo = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--frames") && (argIndex + 1 < argc)) {
+			maxFrameNo = size_t(std::max(0, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--seed") && (argIndex + 1 < argc)) {
+			seed = unsigned(std::max(1, atoi(argv[++argIndex])));
+		}
+		else if (arg.compare(0, 2, "--") != 0) {
+			datasetFolders.push_back(arg);
+		}
+		else {
+			validArgs = false;
+		}
+	}
+	if (!validArgs || datasetFolders.empty()) {
+		std::cout << "Usage: " << argv[0] << " --multi-stream [--streams N] [--workers N] [--frames N] [--seed N] <datasetFolder>..." << std::endl;
+		return -1;
+	}
+	const LCDPParameters parameters;
+	// SINGLE-STREAM runs record the masks every stream is compared with
+	std::vector<std::vector<cv::Mat>> sequenceFrames(datasetFolders.size());
+	std::vector<std::vector<cv::Mat>> sequenceMasks(datasetFolders.size());
+	for (size_t sequenceIndex = 0; sequenceIndex < datasetFolders.size(); sequenceIndex++) {
+		std::vector<cv::Mat> &frames = sequenceFrames[sequenceIndex];
+		if (!SequenceBenchmark::PreloadFrames(datasetFolders[sequenceIndex], maxFrameNo, frames)) {
+			std::cout << "Cannot read input frames: " << datasetFolders[sequenceIndex] << "/input/in000001.jpg" << std::endl;
+			return -1;
+		}
+		std::cout << datasetFolders[sequenceIndex] << ": " << frames.size() << " frames" << std::endl;
+		const cv::Mat ROI(frames[0].size(), CV_8UC1, cv::Scalar(255));
+		std::unique_ptr<BackgroundSubtractorLCDP> backgroundSubtractorLCDP =
+			parameters.CreateSubtractor(ROI, frames[0].size(), int(frames.size()));
+		backgroundSubtractorLCDP->SetRandomSeed(seed);
+		backgroundSubtractorLCDP->Initialize(frames[0], ROI);
+		cv::Mat fgMask;
+		for (auto & frame : frames) {
+			backgroundSubtractorLCDP->Process(frame, fgMask);
+			sequenceMasks[sequenceIndex].push_back(fgMask.clone());
+		}
+	}
+	// MULTI-STREAM run; every queue holds the whole sequence, so no frame is rejected or skipped
+	std::vector<std::vector<cv::Mat>> streamMasks(streamNo);
+	MultiStreamEngine engine(workerNo, std::vector<int>(), 0.0);
+	for (size_t streamId = 0; streamId < streamNo; streamId++) {
+		const size_t sequenceIndex = streamId % datasetFolders.size();
+		const std::vector<cv::Mat> &frames = sequenceFrames[sequenceIndex];
+		const cv::Mat ROI(frames[0].size(), CV_8UC1, cv::Scalar(255));
+		std::unique_ptr<BackgroundSubtractorLCDP> backgroundSubtractorLCDP =
+			parameters.CreateSubtractor(ROI, frames[0].size(), int(frames.size()));
+		backgroundSubtractorLCDP->SetRandomSeed(seed);
+		streamMasks[streamId].resize(frames.size());
+		// A stream is served by one worker at a time, so its own mask list needs no lock
+		std::vector<cv::Mat> &masks = streamMasks[streamId];
+		engine.AddStream(datasetFolders[sequenceIndex] + "#" + std::to_string(streamId), backgroundSubtractorLCDP.release(), ROI,
+			frames.size(), [&masks](size_t, size_t frameIndex, const cv::Mat &fgMask) { masks[frameIndex - 1] = fgMask.clone(); });
+	}
+	engine.Start();
+	// Interleave the streams, like cameras delivering frames at the same time
+	for (size_t frameIndex = 0; ; frameIndex++) {
+		bool pushed = false;
+		for (size_t streamId = 0; streamId < streamNo; streamId++) {
+			const std::vector<cv::Mat> &frames = sequenceFrames[streamId % datasetFolders.size()];
+			if (frameIndex < frames.size()) {
+				engine.PushFrame(streamId, frames[frameIndex]);
+				pushed = true;
+			}
+		}
+		if (!pushed) {
+			break;
+		}
+	}
+	engine.WaitIdle();
+	engine.Stop();
+	engine.PrintStats(std::cout);
+
+	size_t failedNo = 0;
+	cv::Mat differentPixels;
+	for (size_t streamId = 0; streamId < streamNo; streamId++) {
+		const std::vector<cv::Mat> &referenceMasks = sequenceMasks[streamId % datasetFolders.size()];
+		size_t differentFrameNo = 0;
+		size_t firstDifferentFrame = 0;
+		for (size_t frameIndex = 0; frameIndex < referenceMasks.size(); frameIndex++) {
+			const cv::Mat &fgMask = streamMasks[streamId][frameIndex];
+			bool different = fgMask.empty() || (fgMask.size() != referenceMasks[frameIndex].size());
+			if (!different) {
+				cv::compare(fgMask, referenceMasks[frameIndex], differentPixels, cv::CMP_NE);
+				different = cv::countNonZero(differentPixels) > 0;
+			}
+			if (different && (differentFrameNo++ == 0)) {
+				firstDifferentFrame = frameIndex + 1;
+			}
+		}
+		const MultiStreamEngine::StreamStats stats = engine.GetStreamStats(streamId);
+		std::cout << stats.name << ": ";
+		if (differentFrameNo == 0) {
+			std::cout << "PASS" << std::endl;
+		}
+		else {
+			std::cout << "FAIL: " << differentFrameNo << " mask(s) differ from the single-stream run (first: frame " << firstDifferentFrame << ")" << std::endl;
+			failedNo++;
+		}
+	}
+	std::cout << (failedNo == 0 ? "ALL PASSED" : std::to_string(failedNo) + " FAILED") << std::endl;
+	return (failedNo == 0) ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
 	// Program version
 	programVersion = "PROPOSED METHOD FINAL";
-	/// Frame Parameters
-	// Frames per second (FPS) of the input video
-	double FPS;
-	// Total number of frame of the input video
-	double FRAME_COUNT;
-	// Frame size of the input video
-	cv::Size FRAME_SIZE;
-	// Video file name
-	std::string filename;
-	// List of video file name
-	std::vector<std::string> filenames = {
-		"badminton","boulevard","bungalows",
-		"canoe","copyMachine","cubicle",
-		"fall","fountain02","PETS2006",
-		"sidewalk","sofa","wetSnow"
-	};
+	if ((argc > 1) && (std::string(argv[1]) == "--evaluate")) {
+		return RunEvaluateCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--run")) {
+		return RunBatchCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--compare-scales")) {
+		return RunCompareScalesCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--compare-descriptors")) {
+		return RunCompareDescriptorsCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--compare-numa")) {
+		return RunCompareNumaCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--bench-storage")) {
+		return RunStorageBenchmarkCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--bench-sequence")) {
+		return RunSequenceBenchmarkCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--regression")) {
+		return RunRegressionCommand(argc, argv);
+	}
+	if ((argc > 1) && (std::string(argv[1]) == "--multi-stream")) {
+		return RunMultiStreamCommand(argc, argv);
+	}
 	// Test dataset name
 	std::vector<int> datasetInput;
 	int datasetIndex = 0;
@@ -55,17 +703,6 @@ int main() {
 	// Evaluate result switch
 	evaluateResultSwitch = readBoolInput("Evaluate result(1/0)");
 
-	// Read video input from user
-	cv::VideoCapture videoCapture;
-
-	// Input frame
-	cv::Mat inputFrame;
-	// Foreground Mask
-	cv::Mat fgMask;
-
-	// Region of interest frame
-	cv::Mat ROI_FRAME;
-
 	if (showInputSwitch) {
 		// Display input video windows
 		cv::namedWindow("Input Video");
@@ -74,211 +711,41 @@ int main() {
 		// Display results windows
 		cv::namedWindow("Results");
 	}
-	// Program start time
-	std::string startTime;
 
 	/****Define Threshold****/
-	/*=====PRE PROCESS Parameters=====*/
-	bool PreSwitch = true;
-
-	// Total number of words per pixel
-	size_t Words_No = 35;
-	/*=====CLASSIFIER Parameters=====*/
-	//double ratio[2] = { 0.15,0.2 };
-	double descColourDiffRatio = 0.15;
-	// RGB detection switch
-	bool clsRGBDiffSwitch = true;
-	// RGB differences threshold
-	double clsRGBThreshold = 10;
-	//// Up RGB differences threshold
-	//double clsUpRGBThreshold = 30;
-	// LCDP detection switch
-	bool clsLCDPDiffSwitch = true;
-	// LCDP differences threshold (0-1)
-	//double LCDPThreshold = readDoubleInput("LCDP Threshold (0-1)");
-	double clsLCDPThreshold = 0.25;
-	// Up LCDP differences threshold
-	double clsUpLCDPThreshold = 0.7;
-	// Maximum number of LCDP differences threshold
-	double clsLCDPMaxThreshold = 0.7;
-	// neighborhood matching switch
-	bool clsNbMatchSwitch = true;
-	// Matching threshold
-	int clsMatchingThreshold = 2;
-
-	/*=====UPDATE Parameters=====*/
-	// Random replace model switch
-	bool upRandomReplaceSwitch = false;
-	// Random update neighborhood model switch
-	bool upRandomUpdateNbSwitch = false;
-	// Feedback loop switch
-	bool upFeedbackSwitch = true;
-
-	// Feedback V(x) Increment
-	//float DynamicRateIncrease[3] = { 0.5f,0.8f,1.0f };
-	//float upDynamicRateIncrease = 0.01f;
-	//float upDynamicRateIncrease = 0.005f;
-	float upDynamicRateIncrease = 1.0f;
-
-	// Feedback V(x) Decrement
-	//float DynamicRateDecrease[3] = { 0.4f,0.3f,0.1f };
-	//float upDynamicRateDecrease = 0.005f;
-	//float upDynamicRateDecrease = 0.05f;
-	float upDynamicRateDecrease = 0.1f;
-	// Minimum of Feedback V(x) value
-	float upMinDynamicRate = 0.0f;
-	// Feedback T(x) Increment
-	float upUpdateRateIncrease = 0.5f;
-	// Feedback T(x) Decrement
-	float upUpdateRateDecrease = 0.5f;
-	// Feedback T(x) Lowest
-	float upUpdateRateLowest = 2.0f;
-	// Feedback T(x) Highest
-	float upUpdateRateHighest = 255.0f;
-
-	/*=====RGB Dark Pixel Parameter=====*/
-	// Minimum Intensity Ratio
-	float darkMinIntensityRatio = 0.25f;
-	// Maximum Intensity Ratio
-	float darkMaxIntensityRatio = 0.8f;
-	// R-channel different ratio
-	//float darkRDiffRatio = 0.15;
-	float darkRDiffRatioMin = 0.04097f;
-	//float darkRDiffRatioMin = 0.0f;
-	float darkRDiffRatioMax = 0.08477f;
-	// G-channel different ratio
-	//float darkGDiffRatio = 0.1;
-	float darkGDiffRatioMin = -0.0002f;
-	//float darkGDiffRatioMin = 0.0f;
-	float darkGDiffRatioMax = 0.02774f;
+	// Background subtractor parameters (see LCDPParameters for the defaults)
+	LCDPParameters parameters;
 
+	/*=====RUN Parameters=====*/
+	DatasetOptions options;
+	options.showInput = showInputSwitch;
+	options.showOutput = showOutputSwitch;
+	options.saveResult = saveResultSwitch;
+	options.evaluateResult = evaluateResultSwitch;
+	options.queueCapacity = PIPELINE_QUEUE_SIZE;
+	// Per-stage latency profile of Process
+	options.profile = false;
+	// Per-frame Process budget in ms (0: full quality always)
+	options.latencyBudgetMs = 0.0;
+	// Model checkpoint interval in frames (0: off) and warm restart from the last checkpoint
+	options.checkpointInterval = 0;
+	options.resumeCheckpoint = false;
 
-	/*=====POST PROCESS Parameters=====*/
-	bool PostSwitch = true;
-
-	std::string versionFolderName;
-	std::string saveFolderName;
-	std::string resultFolderName;
-	std::string imageSaveFolder;
-	if (!clsLCDPDiffSwitch) {
+	if (!parameters.clsLCDPDiffSwitch) {
 		programVersion = programVersion + " NO LCDP";
 	}
 	std::cout << "Program Version: " << programVersion << std::endl;
 
-	bool success;
-	const char *s2;
-	int datasetNo;
-	char s[25];
-	std::ofstream myfile;
-	//for (size_t datasetIndex = 7; datasetIndex < 8; datasetIndex++) {
-	//for (std::vector<int>::iterator datasetIndex = datasetInput.begin(); datasetIndex != datasetInput.end(); ++datasetIndex) {
 	for (auto & datasetIndex : datasetInput) {
-		success = false;		
-
-		// Video file name
-		filename = filenames.at(datasetIndex);		
-		// Read video input from user
-		//cv::VideoCapture videoCapture = readVideoInput("Video folder", &filename, &FPS, &FRAME_COUNT, &FRAME_SIZE);
-		videoCapture = readVideoInput2(&filename, &FPS, &FRAME_COUNT, &FRAME_SIZE, &success);
-		if (success) {
-			std::cout << "Now load dataset: " << filename << std::endl;
-			versionFolderName = filename + "/" + programVersion;
-			s2 = versionFolderName.c_str();
-			_mkdir(s2);
-			ROI_FRAME.create(FRAME_SIZE, CV_8UC1);
-			ROI_FRAME = cv::Scalar_<uchar>(255);
-
-			// Read first frame from video
-			videoCapture.set(cv::CAP_PROP_POS_FRAMES, 0);
-			videoCapture >> inputFrame;
-
-			// Current date/time based on current system
-			tempStartTime = time(0);
-			// Program start time
-			startTime = currentDateTimeStamp(&tempStartTime);
-
-			// Current process result folder name
-			saveFolderName = versionFolderName + "/" + filename + "-" + programVersion + "-" + startTime;
-
-			// Declare background subtractor constructor
-			BackgroundSubtractorLCDP backgroundSubtractorLCDP(Words_No, PreSwitch,
-				descColourDiffRatio, clsRGBDiffSwitch, clsRGBThreshold, clsLCDPDiffSwitch,
-				clsLCDPThreshold, clsUpLCDPThreshold, clsLCDPMaxThreshold, clsMatchingThreshold,
-				clsNbMatchSwitch, ROI_FRAME, FRAME_SIZE, FRAME_COUNT, upRandomReplaceSwitch, upRandomUpdateNbSwitch,
-				upFeedbackSwitch, upDynamicRateIncrease, upDynamicRateDecrease, upMinDynamicRate, upUpdateRateIncrease,
-				upUpdateRateDecrease, upUpdateRateLowest, upUpdateRateHighest,
-				darkMinIntensityRatio, darkMaxIntensityRatio, darkRDiffRatioMin, darkRDiffRatioMax, darkGDiffRatioMin, darkGDiffRatioMax,
-				PostSwitch);
-
-			// Initialize background subtractor
-			backgroundSubtractorLCDP.Initialize(inputFrame, ROI_FRAME);
-
-			if (saveResultSwitch) {
-				s2 = saveFolderName.c_str();
-				_mkdir(s2);
-				SaveParameter(versionFolderName, saveFolderName);
-				backgroundSubtractorLCDP.folderName = saveFolderName;
-				backgroundSubtractorLCDP.SaveParameter(versionFolderName, saveFolderName);
-				resultFolderName = saveFolderName + "/results";
-				s2 = resultFolderName.c_str();
-				_mkdir(s2);
-			}
-			// Program start time
-			time_t firstStartTime = time(0);
-			time_t firstEndTime = time(0);
-			firstTotalDiffSeconds = 0.0;
-			for (int currFrameIndex = 1; currFrameIndex <= FRAME_COUNT; currFrameIndex++) {
-				firstStartTime = time(0);
-				// Process current frame
-				backgroundSubtractorLCDP.Process(inputFrame, fgMask);
-				firstEndTime = time(0);
-				firstTotalDiffSeconds += difftime(firstEndTime, firstStartTime);
-				if (showInputSwitch) {
-					cv::imshow("Input Video", inputFrame);
-				}
-				if (showOutputSwitch) {
-					cv::imshow("Results", fgMask);
-				}
-				if (saveResultSwitch) {
-					sprintf(s, "/bin%06d.png", (currFrameIndex));
-					imageSaveFolder = resultFolderName + s;
-					cv::imwrite(imageSaveFolder, fgMask);
-				}
-				// If 'esc' key is pressed, break loop
-				if (cv::waitKey(1) == 27)
-				{
-					std::cout << "Program ended by users." << std::endl;
-					break;
-				}
-				bool inputCheck = videoCapture.read(inputFrame);
-				if (!inputCheck && (currFrameIndex < FRAME_COUNT)) {
-					std::cout << "Video having problem. Cannot read the frame from video file." << std::endl;
-					return -1;
-				}
-			}
-
-			tempFinishTime = time(0);
-			GenerateProcessTime(FRAME_COUNT, saveFolderName);
-
-			std::cout << "Background subtraction completed" << std::endl;
-
-			if (evaluateResultSwitch) {
-				if (saveResultSwitch) {
-					std::cout << "Now starting evaluate the processed result..." << std::endl;
-					EvaluateResult(filename, saveFolderName, versionFolderName);
-				}
-				else {
-					std::cout << "No saved results for evaluation" << std::endl;
-				}
-			}
-		}
-		else {
-			std::cout << "Cannot load dataset: " << filename << ". Skip it to next dataset!" << std::endl;
+		DatasetReport report;
+		RunDataset(filenames.at(datasetIndex), parameters, options, report);
+		if (report.readFailed) {
+			return -1;
 		}
 	}
 	std::cout << "Program Completed!" << std::endl;
+#ifdef _WIN32
 	system("pause");
+#endif
 	return 0;
 }
-
-
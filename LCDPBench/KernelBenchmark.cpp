@@ -0,0 +1,405 @@
+#include "KernelBenchmark.h"
+#include "BackgroundSubtractorLCDP.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <utility>
+
+// Frames of the synthetic sequence: the model is initialised on the first, the previous
+// masks come from the next two and the kernels run on the last
+#define KERNEL_BENCH_INIT_FRAME 0
+#define KERNEL_BENCH_TIMED_FRAME 3
+// Moving blocks of the synthetic frames
+#define KERNEL_BENCH_BLOCK_NO 4
+// Frames between the oldest word occurrence and now in the persistence benchmark
+#define KERNEL_BENCH_STAMP_RANGE 1000
+
+// Subtractor with the protected kernels exposed: each pass runs one kernel over every ROI
+// pixel (or the whole mask) and returns a checksum of its output
+class KernelProbe : public BackgroundSubtractorLCDP {
+public:
+	/*******CONSTRUCTOR*******/
+	// Defaults of LCDPParameters
+	KernelProbe(size_t inputWordsNo, cv::Mat inputROI, cv::Size inputFrameSize) :
+		BackgroundSubtractorLCDP(inputWordsNo, true,
+			0.15, true, 10, true,
+			0.25, 0.7, 0.7, 2,
+			true, inputROI, inputFrameSize, KERNEL_BENCH_TIMED_FRAME + 1, false, false,
+			true, 1.0f, 0.1f, 0.0f, 0.5f,
+			0.5f, 2.0f, 255.0f,
+			0.25f, 0.8f, 0.04097f, 0.08477f,
+			-0.0002f, 0.02774f,
+			true, 1)
+	{
+	}
+
+	/*=====DESCRIPTOR Kernels=====*/
+	// LCDGenerator into the current words
+	unsigned long long LCDGeneratorPass(const cv::Mat &inputImg) {
+		switch (descNbNo) {
+		case 8:
+			return LCDGeneratorPass<8>(inputImg);
+#if LCDP_MAX_DESC_NB >= 24
+		case 24:
+			return LCDGeneratorPass<24>(inputImg);
+#endif
+#if LCDP_MAX_DESC_NB >= 16
+		default:
+			return LCDGeneratorPass<16>(inputImg);
+#else
+		default:
+			return LCDGeneratorPass<8>(inputImg);
+#endif
+		}
+	}
+	// Current word intensities (LCDGenerator only fills the LCDP bits)
+	void CopyIntensities(const cv::Mat &inputImg) {
+		for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+			for (int channel = 0; channel < 3; channel++) {
+				CurrWord(roiIndex)->rgb[channel] = inputImg.data[pxInfoLUTPtr[roiIndex].bgrDataIndex + channel];
+			}
+		}
+	}
+
+	/*=====MATCHING Kernels=====*/
+	// Every current word against the top word of its pixel; kernel: 0 DescriptorMatching,
+	// 1 LCDPMatching, 2 RGBMatching, 3 RGBDarkPixel
+	unsigned long long MatchingPass(int kernel) {
+		switch (descNbNo) {
+		case 8:
+			return MatchingPass<8>(kernel);
+#if LCDP_MAX_DESC_NB >= 24
+		case 24:
+			return MatchingPass<24>(kernel);
+#endif
+#if LCDP_MAX_DESC_NB >= 16
+		default:
+			return MatchingPass<16>(kernel);
+#else
+		default:
+			return MatchingPass<8>(kernel);
+#endif
+		}
+	}
+	// DarkPixelGenerator of the current frame against the initial frame
+	unsigned long long DarkPixelPass(cv::Mat &inputGrayImg, cv::Mat &inputImg, cv::Mat &lastGrayImg, cv::Mat &lastImg) {
+		DarkPixelGenerator(inputGrayImg, inputImg, lastGrayImg, lastImg, resDarkPixel);
+		return (unsigned long long)cv::countNonZero(resDarkPixel);
+	}
+
+	/*=====PERSISTENCE Kernels=====*/
+	// Spread the word stamps over the last KERNEL_BENCH_STAMP_RANGE frames, so the persistence
+	// values differ and the sort moves words
+	void ScrambleWordStamps(cv::RNG &rng) {
+		frameIndex = 1 + KERNEL_BENCH_STAMP_RANGE;
+		for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+			const size_t currStamp = GetWordStamp(roiIndex);
+			const size_t modelIndex = pxInfoLUTPtr[roiIndex].modelIndex;
+			for (size_t wordIndex = 0; wordIndex < wordCapacity[roiIndex]; wordIndex++) {
+				DescriptorStruct &word = *BgWord(modelIndex + wordIndex);
+				const int age = rng.uniform(0, KERNEL_BENCH_STAMP_RANGE);
+				word.q = (unsigned short)(currStamp - age);
+				word.span = (unsigned short)rng.uniform(0, int(currStamp) - age + 1);
+				word.frameCount = 1 + rng.uniform(0, word.span + 1);
+			}
+		}
+	}
+	// GetLocalWordPersistence of every word and one sorting pass, as the model scan of Process
+	unsigned long long PersistenceSortPass() {
+		unsigned long long swapNo = 0;
+		for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+			const size_t modelIndex = pxInfoLUTPtr[roiIndex].modelIndex;
+			const size_t currStamp = GetWordStamp(roiIndex);
+			float currLastWordPersistence = FLT_MAX;
+			for (size_t wordIndex = 0; wordIndex < wordCapacity[roiIndex]; wordIndex++) {
+				float currWordPersistence;
+				GetLocalWordPersistence(*BgWord(modelIndex + wordIndex), currStamp, descOffsetValue, currWordPersistence);
+				if (currWordPersistence > currLastWordPersistence) {
+					// Words are wordSize bytes long, not sizeof(DescriptorStruct)
+					DescriptorStruct tempWord;
+					memcpy(&tempWord, BgWord(modelIndex + wordIndex), wordSize);
+					memcpy(BgWord(modelIndex + wordIndex), BgWord(modelIndex + wordIndex - 1), wordSize);
+					memcpy(BgWord(modelIndex + wordIndex - 1), &tempWord, wordSize);
+					swapNo++;
+				}
+				else {
+					currLastWordPersistence = currWordPersistence;
+				}
+			}
+		}
+		return swapNo;
+	}
+
+	/*=====POST-PROCESSING Kernels=====*/
+	// Masks of Process before post-processing: current raw mask, the two previous masks and the dark pixels
+	void SetMasks(const cv::Mat &currMask, const cv::Mat &T_1Mask, const cv::Mat &T_2Mask, const cv::Mat &darkPixel) {
+		currMask.copyTo(resCurrFGMask);
+		T_1Mask.copyTo(resT_1FGMask);
+		T_2Mask.copyTo(resT_2FGMask);
+		darkPixel.copyTo(resDarkPixel);
+		resMatchResultBoth = cv::Scalar_<uchar>::all(0);
+	}
+	unsigned long long CompensationPass() {
+		return (unsigned long long)cv::countNonZero(CompensationMotionHist(resT_1FGMask, resT_2FGMask, resCurrFGMask, postCompensationThreshold));
+	}
+	unsigned long long ContourFillPass() {
+		return (unsigned long long)cv::countNonZero(ContourFill(resCurrFGMask));
+	}
+	unsigned long long BorderLinePass() {
+		return (unsigned long long)cv::countNonZero(BorderLineReconst(resCurrFGMask));
+	}
+	unsigned long long PostProcessPass(const cv::Mat &inputGrayImg) {
+		PostProcess(inputGrayImg);
+		return (unsigned long long)cv::countNonZero(resLastFGMask);
+	}
+
+	/*=====SIZES=====*/
+	size_t WordBytes() const {
+		return wordSize;
+	}
+	size_t LCDPBytes() const {
+		return wordSize - offsetof(DescriptorStruct, LCDPBits);
+	}
+	static size_t PixelInfoBytes() {
+		return sizeof(PxInfoStruct);
+	}
+
+private:
+	template <int NbNo>
+	unsigned long long LCDGeneratorPass(const cv::Mat &inputImg) {
+		unsigned long long result = 0;
+		for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+			LCDGenerator<NbNo>(inputImg, pxInfoLUTPtr[roiIndex], *CurrWord(roiIndex));
+			result += WordLayout<NbNo>::Texture(*CurrWord(roiIndex), 0)[0];
+		}
+		return result;
+	}
+	template <int NbNo>
+	unsigned long long MatchingPass(int kernel) {
+		unsigned long long result = 0;
+		size_t descNeighNo = size_t(NbNo);
+		double LCDPThreshold = clsLCDPThreshold;
+		double RGBThreshold = clsRGBThreshold;
+		float LCDPDistance = 0.0f, RGBDistance = 0.0f;
+		bool matchResult = false, matchResultBoth = false;
+		for (size_t roiIndex = 0; roiIndex < frameRoiTotalPixel; roiIndex++) {
+			DescriptorStruct &bgWord = *BgWord(pxInfoLUTPtr[roiIndex].modelIndex);
+			DescriptorStruct &currWord = *CurrWord(roiIndex);
+			switch (kernel) {
+			case 0:
+				DescriptorMatching<true, true, NbNo, false>(bgWord, currWord, descNeighNo, LCDPThreshold, clsUpLCDPThreshold, RGBThreshold,
+					LCDPDistance, RGBDistance, matchResult, matchResultBoth);
+				break;
+			case 1:
+				LCDPMatching<NbNo, false>(bgWord, currWord, descNeighNo, LCDPThreshold, LCDPDistance, matchResult);
+				break;
+			case 2:
+				RGBMatching<false>(bgWord, currWord, RGBThreshold, RGBDistance, matchResult);
+				break;
+			default:
+				RGBDarkPixel(bgWord, currWord, matchResult);
+				break;
+			}
+			result += matchResult ? 1 : 0;
+		}
+		return result;
+	}
+};
+
+/*******CONSTRUCTOR*******/
+KernelBenchmark::KernelBenchmark(int inputRepeatNo, size_t inputWordsNo, int inputDescNbNo, unsigned int inputSeed) :
+	/*=====BENCHMARK Parameters=====*/
+	repeatNo(std::max(2, inputRepeatNo)),
+	wordsNo(std::max(size_t(2), inputWordsNo)),
+	descNbNo(inputDescNbNo),
+	seed(inputSeed),
+	checksum(0)
+{
+	// QVGA, 720p and 1080p
+	frameSizes.push_back(cv::Size(320, 240));
+	frameSizes.push_back(cv::Size(1280, 720));
+	frameSizes.push_back(cv::Size(1920, 1080));
+}
+
+// Frame sizes to run
+void KernelBenchmark::SetFrameSizes(const std::vector<cv::Size> &inputFrameSizes) {
+	frameSizes = inputFrameSizes;
+}
+
+// Benchmark every kernel at every frame size
+bool KernelBenchmark::Run() {
+	results.clear();
+	for (auto & frameSize : frameSizes) {
+		std::cout << "Benchmarking kernels at " << frameSize.width << "x" << frameSize.height << "..." << std::endl;
+		if (!RunFrameSize(frameSize)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Benchmark every kernel at one frame size
+bool KernelBenchmark::RunFrameSize(cv::Size frameSize) {
+	typedef std::chrono::steady_clock Clock;
+	const cv::Mat ROI(frameSize, CV_8UC1, cv::Scalar(255));
+	KernelProbe probe(wordsNo, ROI, frameSize);
+	if (!probe.SetDescriptorNeighbours(descNbNo)) {
+		std::cout << "Descriptor neighbourhood not supported by this build: " << descNbNo << std::endl;
+		return false;
+	}
+	cv::Mat initImg = GenerateFrame(frameSize, KERNEL_BENCH_INIT_FRAME, seed);
+	cv::Mat inputImg = GenerateFrame(frameSize, KERNEL_BENCH_TIMED_FRAME, seed);
+	cv::Mat initGrayImg, inputGrayImg;
+	cv::cvtColor(initImg, initGrayImg, cv::COLOR_RGB2GRAY);
+	cv::cvtColor(inputImg, inputGrayImg, cv::COLOR_RGB2GRAY);
+	probe.Initialize(initImg, ROI);
+	std::cout << "Model: " << (probe.GetModelBytes() / (1024 * 1024)) << " MB" << std::endl;
+	const size_t pixelNo = size_t(frameSize.area());
+
+	// Time 'pass' repeatNo times after one warm-up run; 'reset' restores its input before each run (not timed)
+	auto timeKernel = [&](const std::string &kernel, double bytesPerPixel,
+		const std::function<unsigned long long()> &pass, const std::function<void()> &reset) {
+		std::vector<double> nsPerPixel;
+		for (int repeatIndex = 0; repeatIndex <= repeatNo; repeatIndex++) {
+			reset();
+			const Clock::time_point startTime = Clock::now();
+			checksum += pass();
+			const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+			if (repeatIndex > 0) {
+				nsPerPixel.push_back(seconds * 1e9 / pixelNo);
+			}
+		}
+		Result result;
+		result.kernel = kernel;
+		result.frameSize = frameSize;
+		double total = 0.0;
+		for (auto & value : nsPerPixel) {
+			total += value;
+		}
+		result.nsPerPixel = total / nsPerPixel.size();
+		double squareTotal = 0.0;
+		for (auto & value : nsPerPixel) {
+			squareTotal += (value - result.nsPerPixel) * (value - result.nsPerPixel);
+		}
+		result.nsPerPixelStdDev = std::sqrt(squareTotal / (nsPerPixel.size() - 1));
+		result.nsPerPixelMin = *std::min_element(nsPerPixel.begin(), nsPerPixel.end());
+		result.bytesPerPixel = bytesPerPixel;
+		result.megabytesPerSecond = (result.nsPerPixel > 0.0) ? (bytesPerPixel / result.nsPerPixel * 1e9 / (1024.0 * 1024.0)) : 0.0;
+		results.push_back(result);
+	};
+	const std::function<void()> noReset = []() {};
+
+	/*=====DESCRIPTOR=====*/
+	const double nbBytes = double(descNbNo + 1);
+	timeKernel("LCDGenerator", (nbBytes * 3) + (nbBytes * KernelProbe::PixelInfoBytes()) + probe.LCDPBytes(),
+		[&]() { return probe.LCDGeneratorPass(inputImg); }, noReset);
+	probe.CopyIntensities(inputImg);
+
+	/*=====MATCHING=====*/
+	timeKernel("DescriptorMatching", 2.0 * probe.WordBytes(), [&]() { return probe.MatchingPass(0); }, noReset);
+	timeKernel("LCDPMatching", 2.0 * probe.LCDPBytes(), [&]() { return probe.MatchingPass(1); }, noReset);
+	timeKernel("RGBMatching", 6.0, [&]() { return probe.MatchingPass(2); }, noReset);
+	timeKernel("RGBDarkPixel", 6.0, [&]() { return probe.MatchingPass(3); }, noReset);
+	// Two gray and two BGR frames read, one map written
+	timeKernel("DarkPixelGenerator", 9.0, [&]() { return probe.DarkPixelPass(inputGrayImg, inputImg, initGrayImg, initImg); }, noReset);
+
+	/*=====PERSISTENCE=====*/
+	// Every word read once (swaps not counted)
+	cv::RNG stampRng(seed);
+	timeKernel("GetLocalWordPersistence+sort", double(wordsNo * probe.WordBytes()),
+		[&]() { return probe.PersistenceSortPass(); }, [&]() { probe.ScrambleWordStamps(stampRng); });
+
+	/*=====POST-PROCESSING=====*/
+	const cv::Mat currMask = GenerateMask(frameSize, KERNEL_BENCH_TIMED_FRAME);
+	const cv::Mat T_1Mask = GenerateMask(frameSize, KERNEL_BENCH_TIMED_FRAME - 1);
+	const cv::Mat T_2Mask = GenerateMask(frameSize, KERNEL_BENCH_TIMED_FRAME - 2);
+	cv::Mat darkPixel(frameSize, CV_8UC1, cv::Scalar(255));
+	const std::function<void()> resetMasks = [&]() { probe.SetMasks(currMask, T_1Mask, T_2Mask, darkPixel); };
+	// Three masks read, one written
+	timeKernel("CompensationMotionHist", 4.0, [&]() { return probe.CompensationPass(); }, resetMasks);
+	timeKernel("ContourFill", 2.0, [&]() { return probe.ContourFillPass(); }, resetMasks);
+	// Result written, only the border lines of the mask read
+	timeKernel("BorderLineReconst", 1.0, [&]() { return probe.BorderLinePass(); }, resetMasks);
+	// Gray frame read, mask read and written
+	timeKernel("PostProcess", 3.0, [&]() { return probe.PostProcessPass(inputGrayImg); }, resetMasks);
+	return true;
+}
+
+// Per-kernel results
+const std::vector<KernelBenchmark::Result> & KernelBenchmark::GetResults() const {
+	return results;
+}
+
+// Print a result table
+void KernelBenchmark::PrintResults(std::ostream &output) const {
+	output << "\n<<<<<-KERNEL BENCHMARK->>>>>\n";
+	output << "WORDS: " << wordsNo << " DESCRIPTOR NEIGHBOURS: " << descNbNo << " REPETITIONS: " << repeatNo
+		<< " SEED: " << seed << " (checksum " << checksum << ")" << std::endl;
+	output << std::left << std::setw(30) << "KERNEL" << std::setw(11) << "FRAME" << std::right << std::setw(10) << "NS/PX"
+		<< std::setw(10) << "STDDEV" << std::setw(8) << "CV(%)" << std::setw(10) << "MIN" << std::setw(10) << "BYTES/PX"
+		<< std::setw(10) << "MB/S" << std::endl;
+	for (auto & result : results) {
+		std::ostringstream frameName;
+		frameName << result.frameSize.width << "x" << result.frameSize.height;
+		output << std::left << std::setw(30) << result.kernel << std::setw(11) << frameName.str() << std::right
+			<< std::setprecision(3) << std::fixed << std::setw(10) << result.nsPerPixel << std::setw(10) << result.nsPerPixelStdDev
+			<< std::setprecision(1) << std::setw(8) << ((result.nsPerPixel > 0.0) ? (100.0 * result.nsPerPixelStdDev / result.nsPerPixel) : 0.0)
+			<< std::setprecision(3) << std::setw(10) << result.nsPerPixelMin << std::setprecision(1) << std::setw(10) << result.bytesPerPixel
+			<< std::setw(10) << result.megabytesPerSecond << std::endl;
+	}
+}
+
+// Export the results as CSV
+bool KernelBenchmark::SaveCSV(const std::string &csvFileName) const {
+	std::ofstream csvFile(csvFileName);
+	if (!csvFile.is_open()) {
+		return false;
+	}
+	csvFile << "kernel,width,height,words,desc_nb,repetitions,ns_per_pixel,ns_per_pixel_stddev,ns_per_pixel_variance,ns_per_pixel_min,bytes_per_pixel,mb_per_s" << std::endl;
+	for (auto & result : results) {
+		csvFile << result.kernel << "," << result.frameSize.width << "," << result.frameSize.height << "," << wordsNo << ","
+			<< descNbNo << "," << repeatNo << "," << result.nsPerPixel << "," << result.nsPerPixelStdDev << ","
+			<< (result.nsPerPixelStdDev * result.nsPerPixelStdDev) << "," << result.nsPerPixelMin << ","
+			<< result.bytesPerPixel << "," << result.megabytesPerSecond << std::endl;
+	}
+	return csvFile.good();
+}
+
+// Synthetic frame of a sequence
+cv::Mat KernelBenchmark::GenerateFrame(cv::Size frameSize, int frameIndex, unsigned int seed) {
+	// Background texture: the same for every frame of the sequence
+	cv::RNG backgroundRng(seed);
+	cv::Mat frame(frameSize, CV_8UC3);
+	backgroundRng.fill(frame, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+	cv::GaussianBlur(frame, frame, cv::Size(5, 5), 0, 0);
+	// Moving blocks
+	frame.setTo(cv::Scalar(40, 160, 220), GenerateMask(frameSize, frameIndex));
+	// Sensor noise, different in every frame
+	cv::RNG noiseRng(seed + 1 + unsigned(frameIndex));
+	cv::Mat noise(frameSize, CV_16SC3);
+	noiseRng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(3));
+	cv::Mat noisyFrame;
+	frame.convertTo(noisyFrame, CV_16SC3);
+	noisyFrame += noise;
+	noisyFrame.convertTo(frame, CV_8UC3);
+	return frame;
+}
+
+// Foreground of the moving blocks
+cv::Mat KernelBenchmark::GenerateMask(cv::Size frameSize, int frameIndex) {
+	cv::Mat mask(frameSize, CV_8UC1, cv::Scalar(0));
+	const cv::Size blockSize(std::max(1, frameSize.width / 8), std::max(1, frameSize.height / 6));
+	for (int blockIndex = 0; blockIndex < KERNEL_BENCH_BLOCK_NO; blockIndex++) {
+		// Blocks move right by 1/40 of the width per frame, each on its own row band
+		const int x = ((blockIndex * frameSize.width / KERNEL_BENCH_BLOCK_NO) + (frameIndex * frameSize.width / 40)) % frameSize.width;
+		const int y = (blockIndex + 1) * frameSize.height / (KERNEL_BENCH_BLOCK_NO + 2);
+		cv::rectangle(mask, cv::Rect(cv::Point(x, y), blockSize), cv::Scalar(255), cv::FILLED);
+	}
+	return mask;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef __KernelBenchmark_H_INCLUDED
+#define __KernelBenchmark_H_INCLUDED
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <ostream>
+
+// Timing of the subtractor's hot kernels on synthetic frames. Each frame size gets its own
+// subtractor, initialised on a textured background; the kernels then run over every ROI pixel
+// (or the whole mask) of the next frame, where a few moving blocks and sensor noise leave a mix
+// of matching and non-matching pixels. Every kernel is run once to warm the caches and then
+// timed repeatNo times; the spread of the repetitions tells whether a before/after difference
+// is larger than the noise.
+class KernelBenchmark {
+public:
+	// Result of one kernel at one frame size
+	struct Result {
+		std::string kernel;
+		cv::Size frameSize;
+		// Mean, standard deviation and minimum of the repetitions (ns per pixel)
+		double nsPerPixel;
+		double nsPerPixelStdDev;
+		double nsPerPixelMin;
+		// Bytes of the kernel's own data read and written per pixel (OpenCV temporaries not counted)
+		double bytesPerPixel;
+		// bytesPerPixel at the mean time (MB/s)
+		double megabytesPerSecond;
+	};
+
+	/*******CONSTRUCTOR*******/
+	// wordsNo: words per pixel of the model; descNbNo: descriptor neighbourhood (8, 16 or 24)
+	KernelBenchmark(int inputRepeatNo, size_t inputWordsNo, int inputDescNbNo, unsigned int inputSeed);
+
+	// Frame sizes to run (default: QVGA, 720p and 1080p)
+	void SetFrameSizes(const std::vector<cv::Size> &inputFrameSizes);
+	// Benchmark every kernel at every frame size (RETURN-false: the descriptor neighbourhood is not supported)
+	bool Run();
+	// Per-kernel results
+	const std::vector<Result> & GetResults() const;
+	// Print a result table
+	void PrintResults(std::ostream &output) const;
+	// Export the results (RETURN-true: success)
+	bool SaveCSV(const std::string &fileName) const;
+	// Synthetic frame 'frameIndex' of a sequence: textured background, moving blocks and sensor noise
+	static cv::Mat GenerateFrame(cv::Size frameSize, int frameIndex, unsigned int seed);
+	// Foreground of the moving blocks of frame 'frameIndex' (CV_8UC1, 0/255)
+	static cv::Mat GenerateMask(cv::Size frameSize, int frameIndex);
+
+private:
+	// Benchmark every kernel at one frame size
+	bool RunFrameSize(cv::Size frameSize);
+
+	/*=====BENCHMARK Parameters=====*/
+	const int repeatNo;
+	const size_t wordsNo;
+	const int descNbNo;
+	const unsigned int seed;
+	std::vector<cv::Size> frameSizes;
+
+	std::vector<Result> results;
+	// Sum of the kernels' outputs, so the work is not optimised away
+	unsigned long long checksum;
+};
+#endif
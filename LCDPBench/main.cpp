@@ -0,0 +1,83 @@
+// Kernel microbenchmark of the LCDP subtractor (LCDPBench.vcxproj on Windows). On Linux, from this folder:
+// g++ -std=c++14 -O2 -I../LCDP main.cpp KernelBenchmark.cpp ../LCDP/BackgroundSubtractorLCDP.cpp ../LCDP/ModelCheckpoint.cpp
+//     ../LCDP/MappedFile.cpp ../LCDP/ModelStorage.cpp ../LCDP/WordPool.cpp ../LCDP/Profiler.cpp
+//     $(pkg-config --cflags --libs opencv) -pthread -o LCDPBench
+#include "KernelBenchmark.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+// Frame size name (qvga, 720p, 1080p or WIDTHxHEIGHT) (RETURN-true: valid)
+static bool ParseFrameSize(const std::string &name, cv::Size &frameSize) {
+	if (name == "qvga") {
+		frameSize = cv::Size(320, 240);
+		return true;
+	}
+	if (name == "720p") {
+		frameSize = cv::Size(1280, 720);
+		return true;
+	}
+	if (name == "1080p") {
+		frameSize = cv::Size(1920, 1080);
+		return true;
+	}
+	const size_t separator = name.find('x');
+	if (separator == std::string::npos) {
+		return false;
+	}
+	frameSize = cv::Size(atoi(name.substr(0, separator).c_str()), atoi(name.substr(separator + 1).c_str()));
+	return (frameSize.width >= 8) && (frameSize.height >= 8);
+}
+
+// LCDPBench [--size qvga|720p|1080p|WxH]... [--repeat N] [--words N] [--desc-nb 8|16|24] [--seed N] [--output kernels.csv]
+int main(int argc, char *argv[]) {
+	std::vector<cv::Size> frameSizes;
+	int repeatNo = 10;
+	size_t wordsNo = 35;
+	int descNbNo = 16;
+	unsigned int seed = 12345;
+	std::string outputFileName;
+	for (int argIndex = 1; argIndex < argc; argIndex++) {
+		const std::string arg = argv[argIndex];
+		cv::Size frameSize;
+		if ((arg == "--size") && (argIndex + 1 < argc) && ParseFrameSize(argv[argIndex + 1], frameSize)) {
+			frameSizes.push_back(frameSize);
+			argIndex++;
+		}
+		else if ((arg == "--repeat") && (argIndex + 1 < argc)) {
+			repeatNo = atoi(argv[++argIndex]);
+		}
+		else if ((arg == "--words") && (argIndex + 1 < argc)) {
+			wordsNo = size_t(std::max(2, atoi(argv[++argIndex])));
+		}
+		else if ((arg == "--desc-nb") && (argIndex + 1 < argc)) {
+			descNbNo = atoi(argv[++argIndex]);
+		}
+		else if ((arg == "--seed") && (argIndex + 1 < argc)) {
+			seed = unsigned(strtoul(argv[++argIndex], nullptr, 10));
+		}
+		else if ((arg == "--output") && (argIndex + 1 < argc)) {
+			outputFileName = argv[++argIndex];
+		}
+		else {
+			std::cout << "Usage: " << argv[0] << " [--size qvga|720p|1080p|WxH]... [--repeat N] [--words N] "
+				<< "[--desc-nb 8|16|24] [--seed N] [--output kernels.csv]" << std::endl;
+			return -1;
+		}
+	}
+	KernelBenchmark kernelBenchmark(repeatNo, wordsNo, descNbNo, seed);
+	if (!frameSizes.empty()) {
+		kernelBenchmark.SetFrameSizes(frameSizes);
+	}
+	if (!kernelBenchmark.Run()) {
+		return -1;
+	}
+	kernelBenchmark.PrintResults(std::cout);
+	if (!outputFileName.empty() && !kernelBenchmark.SaveCSV(outputFileName)) {
+		std::cout << "Cannot write benchmark results: " << outputFileName << std::endl;
+		return -1;
+	}
+	return 0;
+}